@@ -76,7 +76,7 @@
           -minimizer-size  (1 arg) :    size of a minimizer  [default '8']
 
    [bloom options]
-          -bloom        (1 arg) :    bloom type ('basic', 'cache', 'neighbor')  [default 'neighbor']
+          -bloom        (1 arg) :    bloom type ('basic', 'cache', 'neighbor', 'blocked')  [default 'neighbor']
           -debloom      (1 arg) :    debloom type ('none', 'original' or 'cascading')  [default 'cascading']
           -debloom-impl (1 arg) :    debloom impl ('basic', 'minimizer')  [default 'minimizer']
 
@@ -252,6 +252,26 @@ public:
 	
 	/** Get a vector holding the composite structure of the iterator. */
 	virtual std::vector<Iterator<bank::Sequence>*> getComposition() { return _iterators; }
+
+	/** Split each delegate iterator; a delegate that can't be split is provided as a single part. */
+	virtual std::vector<Iterator<bank::Sequence>*> split (size_t nbParts)
+	{
+		std::vector<Iterator<bank::Sequence>*> result;
+		bool isSplit = false;
+
+		for (size_t i=0; i<_iterators.size(); i++)
+		{
+			std::vector<Iterator<bank::Sequence>*> parts = _iterators[i]->split (nbParts);
+			if (parts.empty())  { parts.push_back (_iterators[i]); }
+			else                { isSplit = true; }
+			result.insert (result.end(), parts.begin(), parts.end());
+		}
+
+		/** Nothing to be gained if no delegate could be split. */
+		if (isSplit == false)  { result.clear(); }
+
+		return result;
+	}
 	
 private:
 	size_t _seqIndex;
@@ -19,6 +19,7 @@
 
 #include <gatb/bank/impl/BankBinary.hpp>
 #include <gatb/tools/misc/api/StringsRepository.hpp>
+#include <gatb/tools/misc/impl/NucleotideKernels.hpp>
 
 #include <gatb/system/impl/System.hpp>
 
@@ -28,6 +29,7 @@ using namespace std;
 using namespace gatb::core::system;
 using namespace gatb::core::system::impl;
 using namespace gatb::core::tools::misc;
+using namespace gatb::core::tools::misc::impl;
 
 #define DEBUG(a)  //printf a
 
@@ -57,41 +59,6 @@ static bool checkMagic (FILE* file)
 
 /********************************************************************************/
 
-int NT2int(char nt)
-{
-    int i;
-    i = nt;
-    i = (i>>1)&3; // that's quite clever, guillaume.
-    return i;
-}
-
-unsigned char  code4NT(const char *seq)
-{
-    int i;
-    unsigned char x;
-
-    x=0;
-    for (i=0; i<4; ++i)
-    {
-        x = x*4 + NT2int(seq[i]);
-    }
-    return x;
-}
-
-unsigned char  code_n_NT(const char *seq, int nb)
-{
-    int i;
-    unsigned char x;
-
-    x=0;
-    for (i=0; i<nb; ++i)
-    {
-        x = x*4 + NT2int(seq[i]);
-    }
-    x = x << ((4-nb)*2) ;
-    return x;
-}
-
 /*********************************************************************
 ** METHOD  :
 ** PURPOSE :
@@ -144,8 +111,6 @@ void BankBinary::insert (const Sequence& seq)
     char* pt_end        = pt_start + whole_readlen;
     
     int readlen = 0;
-    int tai = readlen;
-    unsigned char rbin;
     unsigned int block_size = 0;
     char *pt;
     
@@ -177,7 +142,7 @@ void BankBinary::insert (const Sequence& seq)
         if (0<_nbValidLetters && idx<_nbValidLetters)  {  continue; }
 
         //we have a seq beginning at  pt_begin of size idx  ,without any N, will be treated as a read: of size readlen, beginning at pt
-        readlen = tai = idx;
+        readlen = idx;
         pt      = pt_begin;
         
         /** We may have to open the file at first call. */
@@ -209,20 +174,9 @@ void BankBinary::insert (const Sequence& seq)
         memcpy(buffer+cpt_buffer,&readlen,sizeof(int));
         cpt_buffer+= sizeof(int);
         
-        /** We write one byte for 4 nucleotides. */
-        for (tai=readlen; tai>=4  ; tai-=4)
-        {
-            rbin = code4NT(pt);
-            buffer[cpt_buffer]=rbin; cpt_buffer++;
-            pt +=4;
-        }
-        
-        /** We write the remaining part. */
-        if(tai)
-        {
-            rbin = code_n_NT(pt,tai);
-            buffer[cpt_buffer]=rbin; cpt_buffer++;
-        }
+        /** We write one byte for 4 nucleotides, the last one being padded. */
+        NucleotideKernels::pack (pt, readlen, buffer+cpt_buffer);
+        cpt_buffer += (readlen+3)/4;
     }
  }
 
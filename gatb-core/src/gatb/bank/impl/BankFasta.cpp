@@ -19,6 +19,7 @@
 
 #include <gatb/bank/impl/BankFasta.hpp>
 #include <gatb/bank/impl/BankComposite.hpp>
+#include <gatb/bank/impl/GzipReader.hpp>
 
 #include <gatb/system/impl/System.hpp>
 #include <gatb/tools/misc/api/StringsRepository.hpp>
@@ -28,6 +29,10 @@
 #include <algorithm>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <zlib.h> // Added by Pierre Peterlongo on 02/08/2012.
 
 using namespace std;
@@ -51,6 +56,8 @@ namespace gatb {  namespace core {  namespace bank {  namespace impl {
 /********************************************************************************/
 
 size_t BankFasta::_dataLineSize = 70;
+bool   BankFasta::_useMmap      = true;
+int    BankFasta::_gzipThreads  = -1;
 
 /********************************************************************************/
 // heavily inspired by kseq.h from Heng Li (https://github.com/attractivechaos/klib)
@@ -62,13 +69,27 @@ typedef struct
     bool eof;
     char last_char;
 
+    /** Threaded decompression of a gzip file (null when reading through zlib in the current thread). */
+    GzipReader* reader;
+
+    /** Memory mapped content of an uncompressed file (null when reading through zlib). */
+    char*    map;
+    uint64_t map_size;
+    uint64_t map_pos;
+
+    /** Range of the mapped file whose records are iterated (see BankFasta::Iterator::split). */
+    uint64_t map_begin;
+    uint64_t map_end;
+
     void rewind ()
     {
-        gzrewind (stream);
+        if (stream != 0)  { gzrewind (stream); }
+        if (reader != 0)  { reader->rewind(); }
         last_char    = 0;
         eof          = 0;
         buffer_start = 0;
         buffer_end   = 0;
+        map_pos      = map_begin;
     }
 
 } buffered_file_t;
@@ -81,6 +102,19 @@ struct variable_string_t
 
     uint64_t length, max;
     char *string;
+
+    void append (const char* s, uint64_t n)
+    {
+        if (length + n + 1 > max)
+        {
+            max = length + n + 1;
+            nearest_power_of_2(max);
+            string = (char*)  REALLOC (string, max);
+        }
+        memcpy (string + length, s, n);
+        length += n;
+        string[length] = '\0';
+    }
 };
 
 /********************************************************************************/
@@ -205,6 +239,20 @@ void BankFasta::estimate (u_int64_t& number, u_int64_t& totalSize, u_int64_t& ma
     it.estimate (number, totalSize, maxSize);
 }
 
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+size_t BankFasta::getGzipThreads ()
+{
+    if (_gzipThreads < 0)  { _gzipThreads = GzipReader::getDefaultThreads(); }
+    return _gzipThreads;
+}
+
 /*********************************************************************
 ** METHOD  :
 ** PURPOSE :
@@ -303,7 +351,7 @@ void BankFasta::insert (const Sequence& item)
 *********************************************************************/
 BankFasta::Iterator::Iterator (BankFasta& ref, CommentMode_e commentMode)
     : _ref(ref), _commentsMode(commentMode), _isDone(true), _isInitialized(false), _nIters(0),
-      index_file(0), buffered_file(0), buffered_strings(0), _index(0)
+      index_file(0), buffered_file(0), buffered_strings(0), _index(0), _rangeBegin(0), _rangeEnd(0)
 {
     DEBUG (("Bank::Iterator::Iterator\n"));
 
@@ -325,6 +373,8 @@ BankFasta::Iterator::~Iterator ()
 {
     DEBUG (("Bank::Iterator::~Iterator\n"));
     finalize ();
+
+    for (size_t i=0; i<_retiredMaps.size(); i++)  { munmap (_retiredMaps[i].first, _retiredMaps[i].second); }
 }
 
 /*********************************************************************
@@ -392,7 +442,7 @@ inline bool rebuffer (buffered_file_t *bf)
 {
     if (bf->eof) return false;
     bf->buffer_start = 0;
-    bf->buffer_end = gzread (bf->stream, bf->buffer, BUFFER_SIZE);
+    bf->buffer_end = bf->reader != 0 ? bf->reader->read (bf->buffer, BUFFER_SIZE) : gzread (bf->stream, bf->buffer, BUFFER_SIZE);
     if (bf->buffer_end < BUFFER_SIZE) bf->eof = 1;
     if (bf->buffer_end == 0) return false;
     return true;
@@ -474,6 +524,207 @@ inline signed int buffered_gets (
     return s->length;
 }
 
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+// Maps the file in memory if it is a regular, non empty and not gzipped file.
+static bool map_file (buffered_file_t* bf, const char* fname)
+{
+    int fd = open (fname, O_RDONLY);
+    if (fd < 0)  { return false; }
+
+    struct stat st;
+    unsigned char magic[2] = {0, 0};
+
+    bool ok = fstat (fd, &st) == 0  &&  S_ISREG (st.st_mode)  &&  st.st_size > 0
+        &&  pread (fd, magic, sizeof(magic), 0) >= 0
+        &&  ! (magic[0] == 0x1f  &&  magic[1] == 0x8b);
+
+    if (ok)
+    {
+        /** Private writable mapping: clients may modify the sequence data in place
+         * without affecting the file (pages are copied on write only). */
+        void* addr = mmap (0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+        if (addr == MAP_FAILED)  { ok = false; }
+        else
+        {
+            madvise (addr, st.st_size, MADV_SEQUENTIAL);
+            bf->map      = (char*) addr;
+            bf->map_size  = st.st_size;
+            bf->map_pos   = 0;
+            bf->map_begin = 0;
+            bf->map_end   = st.st_size;
+        }
+    }
+
+    close (fd);
+    return ok;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+// Returns the end of the line starting at p; memchr is vectorized by the libc.
+inline char* mapped_eol (char* p, char* end)
+{
+    char* eol = (char*) memchr (p, '\n', end - p);
+    return eol != 0 ? eol : end;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+// Same parsing rules as the buffered version below, but reading directly from the mapped file.
+// Single line sequences are not copied: the data refers to the mapped pages.
+static bool mapped_next_seq (
+    buffered_file_t*    bf,
+    buffered_strings_t* bs,
+    Vector<char>&       data,
+    string&             comment,
+    string&             quality,
+    BankFasta::Iterator::CommentMode_e mode
+)
+{
+    char* p   = bf->map + bf->map_pos;
+    char* end = bf->map + bf->map_size;
+
+    if (bf->last_char == 0)
+    {
+        while (p < end && *p != '>' && *p != '@')  { p++; } // go to next header
+        if (p >= end)  { bf->map_pos = bf->map_size;  return false; } // eof
+        bf->last_char = *(p++);
+    }
+
+    /** The record must begin in the iterated range (its marker is just before p). */
+    if (p >= end || (uint64_t)(p - 1 - bf->map) >= bf->map_end)  { bf->map_pos = bf->map_size;  return false; } // eof
+
+    /** We read the header. */
+    char* eol  = mapped_eol (p, end);
+    char* last = (eol > p && eol[-1] == '\r') ? eol-1 : eol;
+
+    if (mode == BankFasta::Iterator::FULL)  { comment.assign (p, last - p); }
+    else if (mode == BankFasta::Iterator::IDONLY)
+    {
+        char* idEnd = p;
+        while (idEnd < last && !isspace (*idEnd))  { idEnd++; }
+        comment.assign (p, idEnd - p);
+    }
+
+    p = eol < end ? eol+1 : end;
+
+    /** We read the sequence lines until the next header or quality separator. */
+    char*    seq    = p;
+    uint64_t seqLen = 0;
+    bool     joined = false;
+    char     c      = 0;
+
+    while (p < end)
+    {
+        c = *p;
+        if (c == '>' || c == '+' || c == '@')  { break; }
+
+        eol  = mapped_eol (p, end);
+        last = (eol > p && eol[-1] == '\r') ? eol-1 : eol;
+
+        if (last > p)
+        {
+            if (seqLen == 0 && !joined)  { seq = p;  seqLen = last - p; }
+            else
+            {
+                /** Multi-line sequence: we have to join the lines in the read buffer. */
+                if (!joined)  { bs->read->length = 0;  bs->read->append (seq, seqLen);  joined = true; }
+                bs->read->append (p, last - p);
+            }
+        }
+
+        p = eol < end ? eol+1 : end;
+        c = 0;
+    }
+
+    if (c == '>' || c == '@')  { bf->last_char = c;  p++; }
+
+    if (c == '+') // fastq
+    {
+        p = mapped_eol (p, end);    // skip rest of quality comment
+        p = p < end ? p+1 : end;
+
+        uint64_t readLen = joined ? bs->read->length : seqLen;
+        bool     first   = true;
+
+        quality.clear();
+        while (p < end && (first || quality.size() < readLen))
+        {
+            eol  = mapped_eol (p, end);
+            last = (eol > p && eol[-1] == '\r') ? eol-1 : eol;
+            quality.append (p, last - p);
+            p = eol < end ? eol+1 : end;
+            first = false;
+        }
+        bf->last_char = 0;
+    }
+
+    bf->map_pos = p - bf->map;
+
+    /** We update the data of the sequence. A joined sequence is copied since the
+     * read buffer is reused by the next call. */
+    if (joined)  { data.set    (bs->read->string, bs->read->length); }
+    else         { data.setRef (seq, seqLen);                       }
+
+    return true;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+// Returns the offset of the first record beginning at or after 'from' in a mapped file.
+// In FASTQ, a line beginning with '@' may be a quality line, so we also check that the
+// second next line is the '+' separator.
+static uint64_t mapped_resync (buffered_file_t* bf, uint64_t from, bool fastq)
+{
+    char* end = bf->map + bf->map_size;
+    char* p   = bf->map + from;
+
+    /** We go to the beginning of the next line if needed. */
+    if (from > 0 && p[-1] != '\n')  { p = mapped_eol (p, end);  p = p < end ? p+1 : end; }
+
+    for ( ; p < end;  p = p < end ? p+1 : end)
+    {
+        if (!fastq && *p == '>')  { return p - bf->map; }
+
+        if (fastq && *p == '@')
+        {
+            char* sep = mapped_eol (p, end);
+            if (sep < end)  { sep = mapped_eol (sep+1, end); }
+            if (sep+1 < end && sep[1] == '+')  { return p - bf->map; }
+        }
+
+        p = mapped_eol (p, end);
+    }
+
+    return bf->map_size;
+}
+
 /*********************************************************************
 ** METHOD  :
 ** PURPOSE :
@@ -490,6 +741,10 @@ bool BankFasta::Iterator::get_next_seq_from_file (Vector<char>& data, string& co
 
     signed char c;
     buffered_file_t *bf = (buffered_file_t *) buffered_file[file_id];
+
+    /** Uncompressed files are parsed straight from the mapped pages. */
+    if (bf->map != 0)  { return mapped_next_seq (bf, bs, data, comment, quality, mode); }
+
     if (bf->last_char == 0)
     {
         while ((c = buffered_getc (bf)) != -1 && c != '>' && c != '@')
@@ -649,12 +904,36 @@ void BankFasta::Iterator::init ()
 
         buffered_file_t** bf = (buffered_file_t **) buffered_file + i;
         *bf = (buffered_file_t *)  CALLOC (1, sizeof(buffered_file_t));
+
+        /** Uncompressed files are memory mapped when possible, so we don't need zlib for them. */
+        if (BankFasta::_useMmap && map_file (*bf, fname))
+        {
+            /** We may iterate only a part of the file (see split). */
+            if (_rangeEnd > 0)
+            {
+                (*bf)->map_begin = (*bf)->map_pos = std::min (_rangeBegin, (*bf)->map_size);
+                (*bf)->map_end   = std::min (_rangeEnd, (*bf)->map_size);
+            }
+            continue;
+        }
+
+        /** A range can be iterated only from a mapped file. */
+        if (_rangeEnd > 0)  { throw gatb::core::system::Exception ("unable to map file %s for iterating a part of it", fname); }
+
         (*bf)->buffer = (unsigned char*)  MALLOC (BUFFER_SIZE);
+
+        /** Gzipped files are decompressed by other threads if allowed. */
+        if (BankFasta::getGzipThreads() > 0 && GzipReader::isGzip (fname))
+        {
+            (*bf)->reader = new GzipReader (fname, BankFasta::getGzipThreads());
+            continue;
+        }
+
         (*bf)->stream = gzopen (fname, "r");
-        gzbuffer((*bf)->stream,2*1024*1024);
 		
         /** We check that we can open the file. */
-        if ((*bf)->stream == NULL)
+        if ((*bf)->stream != NULL)  { gzbuffer ((*bf)->stream, 2*1024*1024); }
+        else
         {
             // there used to be some cleanup here but what's the point, we're going to throw an exception anyway
         
@@ -702,8 +981,14 @@ void BankFasta::Iterator::finalize ()
             /** We close the handle of the file. */
             if (bf->stream != NULL)  {  gzclose (bf->stream);  bf->stream = 0; }
 
+            /** We stop the decompression threads if needed. */
+            if (bf->reader != 0)  { delete bf->reader;  bf->reader = 0; }
+
+            /** We keep the mapping until destruction, since the last sequences may refer to it. */
+            if (bf->map != 0)  { _retiredMaps.push_back (std::make_pair ((void*)bf->map, (size_t)bf->map_size));  bf->map = 0; }
+
             /** We delete the buffer. */
-            FREE (bf->buffer);
+            if (bf->buffer != 0)  { FREE (bf->buffer); }
 
             /** We delete the buffered file itself. */
             FREE (bf);
@@ -717,6 +1002,52 @@ void BankFasta::Iterator::finalize ()
     _isInitialized = false;
 }
 
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+std::vector<tools::dp::Iterator<Sequence>*> BankFasta::Iterator::split (size_t nbParts)
+{
+    std::vector<tools::dp::Iterator<Sequence>*> result;
+
+    /** We need the file to be mapped for splitting it. */
+    init ();
+
+    buffered_file_t* bf = (buffered_file_t *) buffered_file[0];
+    if (nbParts <= 1  ||  bf == 0  ||  bf->map == 0)  { return result; }
+
+    /** We look for the first record, which tells the file format. */
+    uint64_t first = bf->map_begin;
+    while (first < bf->map_end && bf->map[first] != '>' && bf->map[first] != '@')  { first++; }
+    if (first >= bf->map_end)  { return result; }
+
+    bool fastq = bf->map[first] == '@';
+
+    /** We split the range in parts of equal sizes, resynchronized on the next record boundary. */
+    uint64_t begin = first;
+    for (size_t i=1; i<=nbParts && begin < bf->map_end; i++)
+    {
+        uint64_t end = i<nbParts ? first + (bf->map_end - first) * i / nbParts : bf->map_end;
+        end = end > begin ? std::min (mapped_resync (bf, end, fastq), bf->map_end) : begin;
+
+        if (end > begin)
+        {
+            Iterator* part = new Iterator (_ref, _commentsMode);
+            part->_rangeBegin = begin;
+            part->_rangeEnd   = end;
+            result.push_back (part);
+        }
+
+        begin = end;
+    }
+
+    return result;
+}
+
 /*********************************************************************
 ** METHOD  :
 ** PURPOSE :
@@ -760,7 +1091,9 @@ void BankFasta::Iterator::estimate (u_int64_t& number, u_int64_t& totalSize, u_i
     {
         buffered_file_t* current = (buffered_file_t *) buffered_file[i];
 
-        actualPosition += gztell (current->stream);
+        if      (current->map    != 0)  { actualPosition += current->map_pos;         }
+        else if (current->reader != 0)  { actualPosition += current->reader->tell();  }
+        else                            { actualPosition += gztell (current->stream); }
     }
 
     if (actualPosition > 0)
@@ -103,6 +103,22 @@ public:
     static void setDataLineSize (size_t len) { _dataLineSize = len; }
     static size_t getDataLineSize ()  { return _dataLineSize; }
 
+    /** Tells whether uncompressed files are memory mapped by the iterators (true by default).
+     * In that case, single line sequences are not copied: the sequence data refers to the
+     * mapped pages and remains valid as long as the iterator is alive.
+     * \param[in] enabled : true for memory mapping, false for reading through zlib. */
+    static void setMmap (bool enabled)  { _useMmap = enabled; }
+    static bool getMmap ()  { return _useMmap; }
+
+    /** Set the number of threads used for decompressing gzipped files (see GzipReader).
+     * BGZF files are inflated in parallel by this number of threads; other gzip files are
+     * decompressed by one thread ahead of the parsing. With 0, the files are decompressed
+     * by the iterating thread through zlib. By default, a few threads are used (see GzipReader::getDefaultThreads).
+     * The threads of an iterator are started by its first read, not when it is created.
+     * \param[in] nbThreads : number of decompression threads. */
+    static void setGzipThreads (size_t nbThreads)  { _gzipThreads = nbThreads; }
+    static size_t getGzipThreads ();
+
     /** \copydoc IBank::finalize */
     void finalize ();
 
@@ -169,6 +185,12 @@ public:
         /** Estimation of the sequences information */
         void estimate (u_int64_t& number, u_int64_t& totalSize, u_int64_t& maxSize);
 
+        /** \copydoc tools::dp::Iterator::split
+         * Only memory mapped files (see BankFasta::setMmap) can be split: the file is divided into
+         * byte ranges of equal sizes, each one being resynchronized on the next record boundary.
+         * Note that the sequences indexes are relative to the beginning of each part. */
+        std::vector<tools::dp::Iterator<Sequence>*> split (size_t nbParts);
+
     private:
 
         /** Reference to the underlying Iterable instance. */
@@ -204,6 +226,14 @@ public:
         bool get_next_seq_from_file (tools::misc::Vector<char>& data, std::string& comment, std::string& quality, int file_id, CommentMode_e mode);
 
         size_t _index;
+
+        /** Range of the file to be iterated (no range if end is 0). */
+        u_int64_t _rangeBegin;
+        u_int64_t _rangeEnd;
+
+        /** Files mapped before a call to finalize. The sequences got from them may still refer to
+         * their pages (for instance through a composite iterator), so they are unmapped by the destructor. */
+        std::vector<std::pair<void*,size_t> > _retiredMaps;
     };
 
 protected:
@@ -229,6 +259,10 @@ protected:
     
     static size_t _dataLineSize;
 
+    static bool _useMmap;
+
+    static int _gzipThreads;
+
     /** Initialization method (compute the file sizes). */
     void init ();
 };
@@ -0,0 +1,509 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include <gatb/bank/impl/GzipReader.hpp>
+
+#include <gatb/system/impl/System.hpp>
+#include <gatb/tools/misc/api/StringsRepository.hpp>
+
+#include <zlib.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+using namespace gatb::core::system;
+using namespace gatb::core::system::impl;
+
+#define DEBUG(a)  //printf a
+
+/** Size of the chunks decompressed by zlib for non BGZF files. */
+#define GZIP_CHUNK_SIZE  (1024*1024)
+
+/** Number of slots for non BGZF files, and per inflating thread for BGZF files. */
+#define GZIP_NB_SLOTS    4
+#define BGZF_NB_SLOTS    8
+
+/** Default number of inflating threads: a few threads are enough to inflate ahead of the parsing. */
+#define GZIP_DEFAULT_THREADS  4
+
+/** Size of the fixed part of a gzip member header, and of its trailer (CRC32 + ISIZE). */
+#define GZIP_HEADER_SIZE   12
+#define GZIP_TRAILER_SIZE   8
+
+/********************************************************************************/
+namespace gatb {  namespace core {  namespace bank {  namespace impl {
+/********************************************************************************/
+
+static inline u_int32_t readLE16 (const unsigned char* p)  { return p[0] | (p[1]<<8); }
+static inline u_int32_t readLE32 (const unsigned char* p)  { return p[0] | (p[1]<<8) | (p[2]<<16) | ((u_int32_t)p[3]<<24); }
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+bool GzipReader::isGzip (const std::string& filename)
+{
+    unsigned char header[2];
+
+    FILE* file = fopen (filename.c_str(), "rb");
+    if (file == 0)  { return false; }
+
+    bool result = fread (header, 1, sizeof(header), file) == sizeof(header)  &&  header[0]==0x1f  &&  header[1]==0x8b;
+
+    fclose (file);
+    return result;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+bool GzipReader::isBgzf (const std::string& filename)
+{
+    unsigned char header[18];
+
+    FILE* file = fopen (filename.c_str(), "rb");
+    if (file == 0)  { return false; }
+
+    /** See the SAM specification: gzip header with FEXTRA flag and a 'BC' subfield of length 2. */
+    bool result = fread (header, 1, sizeof(header), file) == sizeof(header)
+        &&  header[0]==0x1f  &&  header[1]==0x8b  &&  header[2]==8  &&  (header[3] & 4) != 0
+        &&  readLE16(header+10) >= 6
+        &&  header[12]=='B'  &&  header[13]=='C'  &&  readLE16(header+14) == 2;
+
+    fclose (file);
+    return result;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+size_t GzipReader::getDefaultThreads ()
+{
+    return std::min ((size_t)GZIP_DEFAULT_THREADS, (size_t)System::info().getNbCores());
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+GzipReader::GzipReader (const std::string& filename, size_t nbThreads)
+    : _filename(filename), _bgzf(isBgzf(filename)), _nbThreads(nbThreads),
+      _nbProduced(0), _nbDispatched(0), _current(0), _offset(0), _position(0), _finished(false), _stop(false), _started(false)
+{
+    if (_nbThreads == 0)  { _nbThreads = getDefaultThreads(); }
+
+    _slots.resize (_bgzf ? BGZF_NB_SLOTS * _nbThreads : GZIP_NB_SLOTS);
+
+    DEBUG (("GzipReader::GzipReader  file=%s  bgzf=%d  nbThreads=%ld\n", filename.c_str(), _bgzf, _nbThreads));
+
+    /** The threads are started by the first read, so a reader that is never read costs no thread. */
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+GzipReader::~GzipReader ()
+{
+    stop ();
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void GzipReader::start ()
+{
+    for (size_t i=0; i<_slots.size(); i++)  { _slots[i].status = Slot::EMPTY; }
+
+    _nbProduced   = 0;
+    _nbDispatched = 0;
+    _current      = 0;
+    _offset       = 0;
+    _position     = 0;
+    _finished     = false;
+    _stop         = false;
+    _error.clear();
+    _started      = true;
+
+    if (_bgzf)
+    {
+        _producer = std::thread (&GzipReader::produceBgzf, this);
+        for (size_t i=0; i<_nbThreads; i++)  {  _workers.push_back (std::thread (&GzipReader::consumeBgzf, this));  }
+    }
+    else
+    {
+        _producer = std::thread (&GzipReader::produceGzip, this);
+    }
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void GzipReader::stop ()
+{
+    {
+        std::unique_lock<std::mutex> lock (_mutex);
+        _stop = true;
+    }
+    _condFree.notify_all();
+    _condJob.notify_all();
+    _condReady.notify_all();
+
+    if (_producer.joinable())  { _producer.join(); }
+    for (size_t i=0; i<_workers.size(); i++)  { _workers[i].join(); }
+    _workers.clear();
+
+    _started = false;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void GzipReader::rewind ()
+{
+    /** The decompression restarts from the beginning at the next read. */
+    stop  ();
+
+    _current  = 0;
+    _offset   = 0;
+    _position = 0;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void GzipReader::fail (const std::string& message)
+{
+    {
+        std::unique_lock<std::mutex> lock (_mutex);
+        if (_error.empty())  { _error = message; }
+        _finished = true;
+    }
+    _condJob.notify_all();
+    _condReady.notify_all();
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+bool GzipReader::acquire (u_int64_t seq, std::unique_lock<std::mutex>& lock)
+{
+    Slot& slot = _slots[seq % _slots.size()];
+
+    _condFree.wait (lock, [&] { return _stop || slot.status == Slot::EMPTY; });
+    if (_stop)  { return false; }
+
+    slot.status = Slot::BUSY;
+    slot.seq    = seq;
+    return true;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE : Producer for non BGZF files: decompresses the file by chunks through zlib
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS : multi-member gzip files are handled by gzread
+*********************************************************************/
+void GzipReader::produceGzip ()
+{
+    gzFile file = gzopen (_filename.c_str(), "r");
+    if (file == 0)  { fail (string("unable to open file ") + _filename);  return; }
+
+    gzbuffer (file, 2*1024*1024);
+
+    for (u_int64_t seq=0; ; seq++)
+    {
+        std::unique_lock<std::mutex> lock (_mutex);
+        if (acquire (seq, lock) == false)  { break; }
+        lock.unlock();
+
+        Slot& slot = _slots[seq % _slots.size()];
+        slot.output.resize (GZIP_CHUNK_SIZE);
+
+        int nbRead = gzread (file, slot.output.data(), GZIP_CHUNK_SIZE);
+        if (nbRead < 0)
+        {
+            int errnum = 0;
+            fail (string("unable to decompress file ") + _filename + " : " + gzerror (file, &errnum));
+            break;
+        }
+        slot.output.resize (nbRead);
+
+        lock.lock();
+        slot.status = nbRead > 0 ? Slot::READY : Slot::EMPTY;
+        if (nbRead > 0)  { _nbProduced = seq + 1; }
+        if (nbRead < GZIP_CHUNK_SIZE)  { _finished = true; }
+        lock.unlock();
+
+        _condReady.notify_all();
+
+        if (nbRead < GZIP_CHUNK_SIZE)  { break; }
+    }
+
+    gzclose (file);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE : Producer for BGZF files: reads the compressed blocks
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS : the blocks are inflated by the consumeBgzf threads
+*********************************************************************/
+void GzipReader::produceBgzf ()
+{
+    FILE* file = fopen (_filename.c_str(), "rb");
+    if (file == 0)  { fail (string("unable to open file ") + _filename);  return; }
+
+    unsigned char header[GZIP_HEADER_SIZE];
+
+    for (u_int64_t seq=0; ; seq++)
+    {
+        size_t nbRead = fread (header, 1, sizeof(header), file);
+
+        /** Clean end of file. */
+        if (nbRead == 0)  { break; }
+
+        if (nbRead != sizeof(header) || header[0]!=0x1f || header[1]!=0x8b || (header[3] & 4)==0)
+        {
+            fail (string("bad BGZF block header in file ") + _filename);
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock (_mutex);
+        if (acquire (seq, lock) == false)  { break; }
+        lock.unlock();
+
+        Slot& slot = _slots[seq % _slots.size()];
+
+        /** We read the extra field and look for the BSIZE subfield. */
+        size_t xlen = readLE16 (header+10);
+        slot.input.resize (GZIP_HEADER_SIZE + xlen);
+        memcpy (slot.input.data(), header, GZIP_HEADER_SIZE);
+
+        size_t blockSize = 0;
+        if (fread (slot.input.data() + GZIP_HEADER_SIZE, 1, xlen, file) == xlen)
+        {
+            const unsigned char* extra = (const unsigned char*) slot.input.data() + GZIP_HEADER_SIZE;
+            for (size_t i=0; i+4<=xlen; )
+            {
+                size_t slen = readLE16 (extra+i+2);
+                if (extra[i]=='B' && extra[i+1]=='C' && slen==2 && i+6<=xlen)  { blockSize = readLE16 (extra+i+4) + 1;  break; }
+                i += 4 + slen;
+            }
+        }
+
+        if (blockSize < GZIP_HEADER_SIZE + xlen + GZIP_TRAILER_SIZE)
+        {
+            fail (string("bad BGZF block in file ") + _filename);
+            break;
+        }
+
+        /** We read the rest of the block (deflated data + trailer). */
+        size_t remaining = blockSize - GZIP_HEADER_SIZE - xlen;
+        slot.input.resize (blockSize);
+        if (fread (slot.input.data() + GZIP_HEADER_SIZE + xlen, 1, remaining, file) != remaining)
+        {
+            fail (string("truncated BGZF block in file ") + _filename);
+            break;
+        }
+
+        lock.lock();
+        _nbProduced = seq + 1;
+        lock.unlock();
+
+        _condJob.notify_one();
+    }
+
+    fclose (file);
+
+    {
+        std::unique_lock<std::mutex> lock (_mutex);
+        _finished = true;
+    }
+    _condJob.notify_all();
+    _condReady.notify_all();
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE : Worker for BGZF files: inflates the blocks read by the producer
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void GzipReader::consumeBgzf ()
+{
+    z_stream zs;
+    memset (&zs, 0, sizeof(zs));
+
+    /** Raw inflate: we parse the gzip header and trailer ourselves. */
+    if (inflateInit2 (&zs, -15) != Z_OK)  { fail ("unable to initialize zlib");  return; }
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock (_mutex);
+        _condJob.wait (lock, [&] { return _stop || _nbDispatched < _nbProduced || _finished; });
+
+        if (_stop || _nbDispatched >= _nbProduced)  { break; }
+
+        Slot& slot = _slots[(_nbDispatched++) % _slots.size()];
+        lock.unlock();
+
+        const unsigned char* input = (const unsigned char*) slot.input.data();
+        size_t xlen    = readLE16 (input+10);
+        size_t dataLen = slot.input.size() - GZIP_HEADER_SIZE - xlen - GZIP_TRAILER_SIZE;
+
+        u_int32_t crc   = readLE32 (input + slot.input.size() - 8);
+        u_int32_t isize = readLE32 (input + slot.input.size() - 4);
+
+        slot.output.resize (isize);
+
+        /** zlib rejects a null output pointer, even for the empty EOF block. */
+        Bytef dummy;
+
+        inflateReset (&zs);
+        zs.next_in   = (Bytef*) input + GZIP_HEADER_SIZE + xlen;
+        zs.avail_in  = dataLen;
+        zs.next_out  = isize > 0 ? (Bytef*) slot.output.data() : &dummy;
+        zs.avail_out = isize;
+
+        if (inflate (&zs, Z_FINISH) != Z_STREAM_END  ||  zs.total_out != isize
+            ||  crc32 (crc32 (0L, Z_NULL, 0), (const Bytef*) slot.output.data(), isize) != crc)
+        {
+            fail (string("corrupted BGZF block in file ") + _filename);
+            break;
+        }
+
+        lock.lock();
+        slot.status = Slot::READY;
+        lock.unlock();
+
+        _condReady.notify_all();
+    }
+
+    inflateEnd (&zs);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+size_t GzipReader::read (void* buffer, size_t len)
+{
+    if (_started == false)  { start (); }
+
+    size_t total = 0;
+
+    std::unique_lock<std::mutex> lock (_mutex);
+
+    while (total < len)
+    {
+        Slot& slot = _slots[_current % _slots.size()];
+
+        _condReady.wait (lock, [&] {
+            return !_error.empty() || (slot.status == Slot::READY && slot.seq == _current) || (_finished && _current >= _nbProduced);
+        });
+
+        if (!_error.empty())  { throw Exception ("%s", _error.c_str()); }
+
+        /** End of file. */
+        if (slot.status != Slot::READY || slot.seq != _current)  { break; }
+
+        /** The slot is ready, so nobody else uses it: we can copy without the lock. */
+        size_t nb = std::min (len - total, slot.output.size() - _offset);
+        lock.unlock();
+        memcpy ((char*)buffer + total, slot.output.data() + _offset, nb);
+        lock.lock();
+
+        _offset += nb;
+        total   += nb;
+
+        if (_offset >= slot.output.size())
+        {
+            slot.status = Slot::EMPTY;
+            _current++;
+            _offset = 0;
+            _condFree.notify_all();
+        }
+    }
+
+    _position += total;
+
+    return total;
+}
+
+/********************************************************************************/
+} } } } /* end of namespaces. */
+/********************************************************************************/
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/** \file GzipReader.hpp
+ *  \brief Multi-threaded decompression of gzip and BGZF files
+ */
+
+#ifndef _GATB_CORE_BANK_IMPL_GZIP_READER_HPP_
+#define _GATB_CORE_BANK_IMPL_GZIP_READER_HPP_
+
+/********************************************************************************/
+
+#include <gatb/system/api/types.hpp>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/********************************************************************************/
+namespace gatb      {
+namespace core      {
+namespace bank      {
+namespace impl      {
+/********************************************************************************/
+
+/** \brief Decompression of a gzip file ahead of its parsing
+ *
+ * This class provides the decompressed content of a gzip file through a read method
+ * similar to gzread, but the actual decompression is done by other threads:
+ *   - for BGZF files (concatenation of small independent gzip blocks, as produced by bgzip),
+ *     the blocks are read by one thread and inflated in parallel by a pool of workers.
+ *   - for other gzip files (possibly made of several members), one thread decompresses
+ *     the file through zlib ahead of the reader.
+ *
+ * In both cases, the decompressed chunks are stored in a bounded ring of slots and are
+ * provided to the reader in the file order.
+ *
+ * This class is used by BankFasta for its gzipped inputs.
+ */
+class GzipReader
+{
+public:
+
+    /** Tells whether a file is gzipped.
+     * \param[in] filename : path of the file
+     * \return true if the file starts with the gzip magic number. */
+    static bool isGzip (const std::string& filename);
+
+    /** Tells whether a file is in BGZF format.
+     * \param[in] filename : path of the file
+     * \return true if the first gzip member holds the BGZF extra subfield. */
+    static bool isBgzf (const std::string& filename);
+
+    /** \return the default number of inflating threads for BGZF files: a small number of threads,
+     * bounded by the number of cores. */
+    static size_t getDefaultThreads ();
+
+    /** Constructor.
+     * \param[in] filename : path of the gzip file.
+     * \param[in] nbThreads : number of inflating threads for BGZF files (0 means getDefaultThreads).
+     * No thread is started before the first read. */
+    GzipReader (const std::string& filename, size_t nbThreads = 0);
+
+    /** Destructor. */
+    ~GzipReader ();
+
+    /** Copy the next decompressed bytes into a buffer. The buffer is fully filled unless
+     * the end of the file is reached.
+     * \param[out] buffer : buffer to be filled
+     * \param[in] len : size of the buffer
+     * \return number of bytes put into the buffer, 0 at the end of the file. */
+    size_t read (void* buffer, size_t len);
+
+    /** Restart the decompression from the beginning of the file. The threads are stopped
+     * and started again by the next read. */
+    void rewind ();
+
+    /** \return the number of decompressed bytes already provided by read. */
+    u_int64_t tell () const  { return _position; }
+
+    /** \return true if the file is decompressed as a BGZF file. */
+    bool isBgzf () const  { return _bgzf; }
+
+private:
+
+    struct Slot
+    {
+        Slot () : seq(0), status(EMPTY) {}
+
+        enum Status_e { EMPTY, BUSY, READY };
+
+        std::vector<char> input;
+        std::vector<char> output;
+        u_int64_t         seq;
+        Status_e          status;
+    };
+
+    std::string _filename;
+    bool        _bgzf;
+    size_t      _nbThreads;
+
+    std::vector<Slot> _slots;
+
+    std::mutex              _mutex;
+    std::condition_variable _condFree;
+    std::condition_variable _condJob;
+    std::condition_variable _condReady;
+
+    std::thread              _producer;
+    std::vector<std::thread> _workers;
+
+    /** Number of slots pushed by the producer, and number of slots given to the workers. */
+    u_int64_t _nbProduced;
+    u_int64_t _nbDispatched;
+
+    /** Sequence number of the slot currently read, and offset in it. */
+    u_int64_t _current;
+    size_t    _offset;
+
+    u_int64_t _position;
+    bool      _finished;
+    bool      _stop;
+    bool      _started;
+    std::string _error;
+
+    void start ();
+    void stop  ();
+
+    void produceBgzf ();
+    void produceGzip ();
+    void consumeBgzf ();
+
+    /** Wait for the slot of the given sequence number to be free (false if stopped). */
+    bool acquire (u_int64_t seq, std::unique_lock<std::mutex>& lock);
+
+    void fail (const std::string& message);
+};
+
+/********************************************************************************/
+} } } } /* end of namespaces. */
+/********************************************************************************/
+
+#endif /* _GATB_CORE_BANK_IMPL_GZIP_READER_HPP_ */
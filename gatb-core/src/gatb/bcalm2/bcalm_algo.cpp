@@ -15,6 +15,7 @@
 
 #include <atomic>
 #include <thread>
+#include <future>
 
 #include "ThreadPool.h"
 
@@ -108,6 +109,7 @@ static void atomic_double_add(std::atomic<double> &d1, double d2) {
 static atomic_double global_wtime_compactions (0), global_wtime_cdistribution (0), global_wtime_add_nodes (0), global_wtime_create_buckets (0), global_wtime_foreach_bucket (0), global_wtime_lambda (0), global_wtime_parallel (0), global_wtime_longest_lambda (0), global_wtime_best_sched(0);
 
 static bool time_lambdas = true;
+static bool overlap_superbuckets = true; // read the next superbucket while the buckets of the current one are compacted (two superbuckets are then in memory)
 static std::mutex lambda_timing_mutex;
 static size_t nb_threads_simulate=1; // this is somewhat a legacy parameter, i should get rid of (and replace by nb_threads)
 
@@ -369,7 +371,13 @@ void bcalm2(Storage *storage,
     for (unsigned int i = 0; i < nb_partitions; i++)
         traveller_kmers_files[i] = new BankFasta(traveller_kmers_prefix + std::to_string(i));
    
-    Dispatcher dispatcher (nb_threads); // setting up a multi-threaded dispatcher, so I guess we can say that things are getting pretty serious now
+    /* when the next superbucket is read while the current one is compacted, the threads are split between the two:
+     * the dispatcher of the reader gets half of them and the compaction thread pool the other half */
+    bool overlap = overlap_superbuckets && nb_threads > 1;
+    int nb_reader_threads     = overlap ? nb_threads / 2 : nb_threads;
+    int nb_compaction_threads = overlap ? nb_threads - nb_reader_threads : nb_threads;
+
+    Dispatcher dispatcher (nb_reader_threads); // setting up a multi-threaded dispatcher, so I guess we can say that things are getting pretty serious now
 
     // i want to do this but i'm not inside an Algorithm object:
     /*Iterator<int>* it_parts = Algorithm::createIterator<int>(
@@ -396,33 +404,34 @@ void bcalm2(Storage *storage,
     // new version, no longer using a queue-type object.
     typedef std::tuple<uint32_t, Type, uint32_t, uint32_t, uint32_t> tuple_t;
     typedef vector<tuple_t> flat_vector_queue_t;
-    vector<flat_vector_queue_t> flat_bucket_queues(nb_threads);
-       
-    logging("Starting BCALM2");
 
-    /*
-     *
-     * Iteration of partitions
-     *
-     *  main thread is going to read kmers from partitions and insert them into queues
-     *
-    */
-    for (it_parts->first (); !it_parts->isDone(); it_parts->next()) /**FOREACH SUPERBUCKET (= partition) **/
+    /* a superbucket expanded into buckets, ready to be compacted */
+    struct superbucket_t
     {
-        uint32_t p = it_parts->item(); /* partition index */
+        vector<flat_vector_queue_t> flat_bucket_queues; // one per thread of the dispatcher, sorted by minimizer
+        set<uint32_t> set_minimizers;
+        vector<uint64_t> nb_kmers_per_minimizer;
+        vector<vector<uint64_t>> start_minimizers; // position of the first kmer of each minimizer in flat_bucket_queues
+        unsigned long nb_kmers_in_partition, nb_left_min_diff_right_min, nb_traveller_kmers_loaded;
+    };
 
-        bool verbose_partition = verbose && ((p % ((nb_partitions+9)/10)) == 0); // only print verbose information 10 times at most
+    /* creates the buckets of superbucket p: reads the kmers of the partition (all passes) and the traveller kmers saved for it, then sorts them by minimizer.
+     * superbuckets have to be created in order, because creating one saves traveller kmers for the next ones */
+    auto create_buckets = [&partition, &dispatcher, &model, &modelK1, &repart, &traveller_kmers_files, &traveller_kmers_save_mutex, &traveller_kmers_prefix,
+         nb_passes, nb_partitions, nb_reader_threads, kmerSize, abundance_threshold, rg] (uint32_t p, superbucket_t &superbucket)
+    {
+        auto start_createbucket_t=get_wtime();
 
         size_t k = kmerSize;
+        vector<flat_vector_queue_t> &flat_bucket_queues = superbucket.flat_bucket_queues;
+        flat_bucket_queues.resize(nb_reader_threads);
 
         std::atomic<unsigned long> nb_left_min_diff_right_min;
         std::atomic<unsigned long> nb_kmers_in_partition;
         nb_kmers_in_partition = 0;
         nb_left_min_diff_right_min = 0;
         
-        auto start_createbucket_t=get_wtime();
-        
-        InsertIntoQueues<SPAN> insertIntoQueues(flat_bucket_queues, model, modelK1, p, k, nb_threads, abundance_threshold, repart, nb_left_min_diff_right_min, nb_kmers_in_partition, traveller_kmers_files, traveller_kmers_save_mutex);
+        InsertIntoQueues<SPAN> insertIntoQueues(flat_bucket_queues, model, modelK1, p, k, nb_reader_threads, abundance_threshold, repart, nb_left_min_diff_right_min, nb_kmers_in_partition, traveller_kmers_files, traveller_kmers_save_mutex);
 
         /* MAIN FIRST LOOP: expand a superbucket by inserting kmers into queues. this creates buckets */
         // do it for all passes (because the union of passes correspond to a partition)
@@ -434,16 +443,16 @@ void bcalm2(Storage *storage,
             LOCAL (it_kmers);
 
             if (pass_index == 0) // the first time, 
-                for (int i = 0; i < nb_threads; i++) // resize approximately the bucket queues
-                flat_bucket_queues[i].reserve(partition[interm_partition_index].getNbItems()/nb_threads);
+                for (int i = 0; i < nb_reader_threads; i++) // resize approximately the bucket queues
+                flat_bucket_queues[i].reserve(partition[interm_partition_index].getNbItems()/nb_reader_threads);
 
             dispatcher.iterate (it_kmers, insertIntoQueues);
             /*for (it_kmers->first (); !it_kmers->isDone(); it_kmers->next()) // non-dispatcher version
                 insertIntoQueues(it_kmers->item());*/
         }
 
-        if (verbose_partition) 
-            cout << endl << "Iterated " << nb_kmers_in_partition << " kmers, among them " << nb_left_min_diff_right_min << " were doubled" << endl;
+        superbucket.nb_kmers_in_partition = nb_kmers_in_partition;
+        superbucket.nb_left_min_diff_right_min = nb_left_min_diff_right_min;
 
         // also add traveller kmers that were saved to disk from a previous superbucket
         // but why don't we need to examine other partitions for potential traveller kmers?
@@ -516,18 +525,18 @@ void bcalm2(Storage *storage,
 
             dispatcher.iterate(it,insertTravellerKmer);
 
-            if (verbose_partition) 
-                std::cout << "Loaded " << nb_traveller_kmers_loaded << " doubled kmers for partition " << p << endl;
             traveller_kmers_bank.finalize();
             System::file().remove (traveller_kmers_file);
         }
 
+        superbucket.nb_traveller_kmers_loaded = nb_traveller_kmers_loaded;
+
         /* now that we have computed flat_bucket_queues' by each thread,
          * sort them by minimizer */
 
         //logging("begin sorting bucket queues");
-        ThreadPool pool_sort(nb_threads);
-        for (int thread = 0; thread < nb_threads; thread++)
+        ThreadPool pool_sort(nb_reader_threads);
+        for (int thread = 0; thread < nb_reader_threads; thread++)
         {
             auto sort_cmp = [] (tuple_t const &a, tuple_t const &b) -> bool { return get<0>(a) < get<0>(b); };
 
@@ -535,7 +544,7 @@ void bcalm2(Storage *storage,
             auto sort_bucket = [&sort_cmp, &flat_bucket_queues, thread] (int thread_id) 
             {std::sort(flat_bucket_queues[thread].begin(), flat_bucket_queues[thread].end(), sort_cmp);};
 
-            if (nb_threads > 1)
+            if (nb_reader_threads > 1)
                 pool_sort.enqueue(sort_bucket);
             else
                 sort_bucket(0);
@@ -544,18 +553,18 @@ void bcalm2(Storage *storage,
         //logging("end sorting bucket queues");
 
         /* remember which minimizer occurs in flat_bucket_queues' and its start position */
-        set<uint32_t> set_minimizers;
-        vector<uint64_t> nb_kmers_per_minimizer(rg);
-        
-        for (uint64_t i = 0; i < rg; i++)
-            nb_kmers_per_minimizer[i] = 0;
-
-        vector<vector<uint64_t>> start_minimizers(nb_threads);
-        for (int thread = 0; thread < nb_threads; thread++)
+        set<uint32_t> &set_minimizers = superbucket.set_minimizers;
+        vector<uint64_t> &nb_kmers_per_minimizer = superbucket.nb_kmers_per_minimizer;
+        set_minimizers.clear();
+        nb_kmers_per_minimizer.assign(rg, 0);
+
+        vector<vector<uint64_t>> &start_minimizers = superbucket.start_minimizers;
+        start_minimizers.resize(nb_reader_threads);
+        for (int thread = 0; thread < nb_reader_threads; thread++)
         {
             // should be done in parallel possibly, if it takes time.
             set<uint32_t> set_minimizers_thread;
-            start_minimizers[thread].resize(rg);
+            start_minimizers[thread].assign(rg, 0);
             uint64_t pos=0;
             //std:: cout << "iterating flat bucket queues  for thread " << thread << " elts: " << flat_bucket_queues[thread].size() << std::endl;
             for (auto v: flat_bucket_queues[thread])
@@ -575,8 +584,53 @@ void bcalm2(Storage *storage,
         
         auto end_createbucket_t=get_wtime();
         atomic_double_add(global_wtime_create_buckets, diff_wtime(start_createbucket_t, end_createbucket_t));
+    };
+
+    superbucket_t superbuckets[2];
+    std::future<void> next_superbucket;
+       
+    logging("Starting BCALM2");
 
-        ThreadPool pool(nb_threads);
+    /*
+     *
+     * Iteration of partitions
+     *
+     *  a reader thread creates the buckets of the next partition (reading its kmers and inserting them into queues, themselves filled by a dispatcher)
+     *  while the thread pool compacts the buckets of the current partition
+     *
+    */
+    if (overlap && nb_partitions > 0)
+        next_superbucket = std::async(std::launch::async, create_buckets, 0, std::ref(superbuckets[0]));
+
+    for (it_parts->first (); !it_parts->isDone(); it_parts->next()) /**FOREACH SUPERBUCKET (= partition) **/
+    {
+        uint32_t p = it_parts->item(); /* partition index */
+
+        bool verbose_partition = verbose && ((p % ((nb_partitions+9)/10)) == 0); // only print verbose information 10 times at most
+
+        superbucket_t &superbucket = superbuckets[p % 2];
+        if (overlap)
+        {
+            next_superbucket.get(); // also rethrows what happened in the reader thread
+            if (p + 1 < nb_partitions)
+                next_superbucket = std::async(std::launch::async, create_buckets, p + 1, std::ref(superbuckets[(p + 1) % 2]));
+        }
+        else
+            create_buckets(p, superbucket);
+
+        vector<flat_vector_queue_t> &flat_bucket_queues = superbucket.flat_bucket_queues;
+        set<uint32_t> &set_minimizers = superbucket.set_minimizers;
+        vector<uint64_t> &nb_kmers_per_minimizer = superbucket.nb_kmers_per_minimizer;
+        vector<vector<uint64_t>> &start_minimizers = superbucket.start_minimizers;
+
+        if (verbose_partition) 
+        {
+            cout << endl << "Iterated " << superbucket.nb_kmers_in_partition << " kmers, among them " << superbucket.nb_left_min_diff_right_min << " were doubled" << endl;
+            if (superbucket.nb_traveller_kmers_loaded > 0)
+                std::cout << "Loaded " << superbucket.nb_traveller_kmers_loaded << " doubled kmers for partition " << p << endl;
+        }
+
+        ThreadPool pool(nb_compaction_threads);
 
         std::vector<double> lambda_timings;
         auto start_foreach_bucket_t=get_wtime();
@@ -586,7 +640,7 @@ void bcalm2(Storage *storage,
         {
             auto lambdaCompact = [&nb_kmers_per_minimizer, actualMinimizer, &model,
                 &maxBucket, &lambda_timings, &repart, &modelK1, &out_to_glue, &nb_seqs_in_glue, &nb_pretips, kmerSize, minSize,
-                nb_threads, &start_minimizers, &flat_bucket_queues](int thread_id) {
+                nb_reader_threads, &start_minimizers, &flat_bucket_queues](int thread_id) {
                 auto start_nodes_t=get_wtime();
 
                 // (make sure to change other places labelled "// graph3" and "// graph4" as well)
@@ -609,7 +663,7 @@ void bcalm2(Storage *storage,
                      * and iterate a certain minimizer. i dont even need a priority queue! */
 
                 // used to be in a lambda outside of that lambda, there was a bug, decided to put it here but didnt even solve the bug, hmm. i should have been more explicit whether the bug still happens or not, i dunno now.
-                for (int thread = 0; thread < nb_threads; thread++)
+                for (int thread = 0; thread < nb_reader_threads; thread++)
                 {
                     uint64_t pos = start_minimizers[thread][actualMinimizer];
                     unsigned int size = flat_bucket_queues[thread].size();
@@ -694,7 +748,7 @@ void bcalm2(Storage *storage,
 
             }; // end lambda function
 
-            if (nb_threads > 1)
+            if (nb_compaction_threads > 1)
                 pool.enqueue(lambdaCompact);
             else
                 lambdaCompact(0);
@@ -705,11 +759,10 @@ void bcalm2(Storage *storage,
         //logging("done compactions");
             
         // flush glues, clear flat_bucket_queues
-        for (int thread_id = 0; thread_id < nb_threads; thread_id++)
-        {
+        for (int thread_id = 0; thread_id < nb_reader_threads; thread_id++)
             flat_bucket_queues[thread_id].clear();
+        for (int thread_id = 0; thread_id < nb_compaction_threads; thread_id++)
             out_to_glue[thread_id]->flush (); 
-        }
 
         if (partition[p].getNbItems() == 0)
             continue; // no stats to print here
@@ -126,92 +126,64 @@ static string rc(const string &s) {
 }
 
 
-// manipulation of abundance vectors encoded as strings. recent addition (post-publication)
+// abundances arrive as text in the glue comments (e.g. "3 4 4 "); they are parsed once and then kept as uint32's until the final FASTA output
 
-static float get_mean_abundance(const string& list)
+static void parse_abundances(const char* list, std::vector<uint32_t>& abundances)
 {
-    float mean_abundance=0;
-    int n=0;
-    std::stringstream stream(list);
-    while(1) {
-        int a;
-        stream >> a;
-        if(!stream)
-            break;
-        mean_abundance +=a;
-        n++;
-    }
-    return mean_abundance / (float)n;
-}
-
-static uint64_t get_sum_abundance(const string& list)
-{
-    uint64_t sum_abundances=0;
-    std::stringstream stream(list);
-    while(1) {
-        int a;
-        stream >> a;
-        if(!stream)
-            break;
-        sum_abundances +=a;
-    }
-    if (sum_abundances > 2000000000LL) std::cout << "warning, large abundance reached, may have printing problems" << std::endl; // maybe will disrupt optimizing the code of that function, but it's not that critical
-    return sum_abundances;
-}
-
-
-static string reverse_abundances(const string& list)
-{
-    string rev="";
-    std::stringstream stream(list);
-    while(1) {
-        int a;
-        stream >> a;
-        if(!stream)
+    abundances.clear();
+    while (true)
+    {
+        while (*list == ' ')
+            list++;
+        if (*list < '0' || *list > '9')
             break;
-        rev = to_string(a) + " " + rev;
+        uint32_t a = 0;
+        while (*list >= '0' && *list <= '9')
+            a = a * 10 + (*list++ - '0');
+        abundances.push_back(a);
     }
-    return rev;
 }
 
-static string skip_first_abundance(const string& list)
+static string make_header(const int seq_size, const uint32_t* abundances, size_t nb_abundances, bool all_abundance_counts)
 {
-    string res="";
-    std::stringstream stream(list);
-    bool skip = true;
-    while(1) {
-        int a;
-        stream >> a;
-        if(!stream)
-            break;
-        if (skip)
-        {
-            skip = false;
-            continue;
-        }
-        res += to_string(a) + " ";
+    float mean_abundance = 0;
+    uint64_t sum_abundances = 0;
+    for (size_t i = 0; i < nb_abundances; i++)
+    {
+        mean_abundance += abundances[i];
+        sum_abundances += abundances[i];
     }
-    return res;
-}
+    mean_abundance /= (float)nb_abundances;
+    if (sum_abundances > 2000000000LL) std::cout << "warning, large abundance reached, may have printing problems" << std::endl;
 
-static string make_header(const int seq_size, const string& abundances, bool all_abundance_counts)
-{
-    string header;
-    float mean_abundance = get_mean_abundance(abundances);
-    uint64_t sum_abundances = get_sum_abundance(abundances);
+    string header = "LN:i:" + to_string(seq_size);
     if (all_abundance_counts)
     {
         // in this setting, all kmer wabundances are printed in the order of the kmers in the sequence
-        header = "LN:i:" + to_string(seq_size) + " ab:Z:" + abundances;
+        header += " ab:Z:";
+        for (size_t i = 0; i < nb_abundances; i++)
+        {
+            header += to_string(abundances[i]);
+            header += ' ';
+        }
     }
     else
     {
         // km is not a standard GFA field so i'm putting it in lower case as per the spec
-        header = "LN:i:" + to_string(seq_size) + " KC:i:" + to_string(sum_abundances) + " km:f:" + to_string_with_precision(mean_abundance);
+        header += " KC:i:" + to_string(sum_abundances) + " km:f:" + to_string_with_precision(mean_abundance);
     }
     return header;
 }
 
+// a sequence of a glue partition, pointing inside the in-memory copy of the partition file (see GluePartitionWriter for the layout)
+struct glueRecord
+{
+    const char* seq;
+    const char* abundances; // (seq_size - k + 1) uint32's, not necessarily aligned
+    uint32_t seq_size;
+    bool lmark, rmark;
+};
+
 template<int SPAN>
 struct markedSeq
 {
@@ -420,37 +392,40 @@ static void determine_order_sequences(vector<vector<seq_idx_t>> &res, vector<boo
  * sequences should be ordered and in the right orientation
  * so, it's just a matter of chopping of the first kmer of elements i>1 of each chain
  */
-static void glue_sequences(vector<seq_idx_t> &chain, bool is_circular, std::vector<std::string> &sequences, std::vector<std::string> &abundances, int kmerSize, string &res_seq, string &res_abundances)
+static void glue_sequences(vector<seq_idx_t> &chain, bool is_circular, const std::vector<glueRecord> &records, int kmerSize, string &res_seq, std::vector<uint32_t> &res_abundances)
 {
     bool debug=false;
 
     string previous_kmer = "";
     unsigned int k = kmerSize;
+    std::vector<uint32_t> abs;
     
     if (debug) std::cout << "glueing new chain: ";
     for (auto it = chain.begin(); it != chain.end(); it++)
     {
         seq_idx_t idx = *it;
 
-        string seq = sequences[no_rev_index(idx)];
-        string abs = abundances[no_rev_index(idx)];
+        const glueRecord &record = records[no_rev_index(idx)];
+        string seq(record.seq, record.seq_size);
+        abs.resize(record.seq_size - k + 1);
+        memcpy(abs.data(), record.abundances, abs.size() * sizeof(uint32_t));
 
         if (is_rev_index(idx))
         {
             seq = rc(seq);
-            abs = reverse_abundances(abs);
+            std::reverse(abs.begin(), abs.end());
         }
         
         if (previous_kmer.size() == 0) // it's the first element in a chain
         {
             res_seq += seq;
-            res_abundances += abs;
+            res_abundances.insert(res_abundances.end(), abs.begin(), abs.end());
         }
         else
         {
             assert(seq.substr(0, k).compare(previous_kmer) == 0);
-            res_seq += seq.substr(k);
-            res_abundances += skip_first_abundance(abs);
+            res_seq.append(seq, k, string::npos);
+            res_abundances.insert(res_abundances.end(), abs.begin() + 1, abs.end());
         }
     
         if (debug) std::cout << seq << " ";
@@ -461,32 +436,15 @@ static void glue_sequences(vector<seq_idx_t> &chain, bool is_circular, std::vect
     if (is_circular) 
     {
         if (debug) std::cout << "chopping off last nucleotide" << std::endl;
+        // the last kmer is also the first one
+        res_seq.pop_back();
+        res_abundances.pop_back();
         if (debug) std::cout << res_seq << std::endl;
-        if (debug) std::cout << res_abundances << std::endl;
-        // trick: do it with the first kmer instead
-        res_seq = rc(res_seq);
-        res_abundances = reverse_abundances(res_abundances);
-
-        res_seq = res_seq.substr(1);
-        res_abundances = skip_first_abundance(res_abundances);
-
-        res_seq = rc(res_seq);
-        res_abundances = reverse_abundances(res_abundances);
-        if (debug) std::cout << res_seq << std::endl;
-        if (debug) std::cout << res_abundances << std::endl;
     }
     if (debug) std::cout << std::endl;
 }
 
 
-static void output(const string &seq, gatb::core::debruijn::impl::BufferedFasta &out, const string comment = "")
-{
-    out.insert(seq, comment);
-    // BufferedFasta takes care of the flush
-}
-
-
-
  // used to get top N elements of a vector
 template <typename T>
 struct Comp{
@@ -927,38 +885,20 @@ void bglue(Storage *storage,
     if (only_uf) // for debugging
         return;
 
-    /* now we're mirroring the UF to a vector of uint32_t's (uf_class_t), it will take less space, and strictly same information
+    /* now we're turning the UF into a vector of uint32_t's (uf_class_t), it will take less space, and strictly same information
      * this is to get rid of the rank (one uint32) per element in the current UF implementation. 
-     * To do this, we're using the disk to save space of populating one vector from the other in memory. 
-     * (saves having to allocate both vectors at the same time) */
-    
-    BagFile<uf_class_t> *ufkmers_bagf = new BagFile<uf_class_t>(prefix+".glue.uf");  LOCAL(ufkmers_bagf);
-	BagCache<uf_class_t> *ufkmers_bag = new BagCache<uf_class_t>(  ufkmers_bagf, 10000 );   LOCAL(ufkmers_bag);
-
-    for (unsigned long i = 0; i < nb_uf_keys; i++)
-        //ufkmers_vector[i] = ufkmers.find(i); // just in-memory without the disk
-        ufkmers_bag->insert(ufkmers.find(i));
+     * The UF is normalized first (class id = smallest element of the class, so that classes don't depend on how threads interleaved their unions),
+     * then converted in place (saves having to allocate both vectors at the same time) */
 
-    uint64_t size_mdata = sizeof(std::atomic<uint64_t>) * ufkmers.mData.size();
-    free_memory_vector(ufkmers.mData);
+    uint64_t size_mdata = sizeof(std::atomic<uint64_t>) * ufkmers.size();
+    ufkmers.normalize(nb_threads);
+    uf_class_t *ufkmers_vector = ufkmers.release_classes(nb_threads);
 
-    logging("freed original UF (" + to_string(size_mdata/1024/1024) + " MB)");
-
-    ufkmers_bag->flush();
-
-    std::vector<uf_class_t> ufkmers_vector(nb_uf_keys);
-    IteratorFile<uf_class_t> ufkmers_file(prefix+".glue.uf");
-    unsigned long i = 0;
-    for (ufkmers_file.first(); !ufkmers_file.isDone(); ufkmers_file.next())
-            ufkmers_vector[i++] = ufkmers_file.item();
-
-    System::file().remove (prefix+".glue.uf");
-    
-    logging("loaded 32-bit UF (" + to_string(nb_uf_keys*sizeof(uf_class_t)/1024/1024) + " MB)");
+    logging("normalized UF and converted it to 32-bit classes (" + to_string(nb_uf_keys*sizeof(uf_class_t)/1024/1024) + " MB, was " + to_string(size_mdata/1024/1024) + " MB)");
   
     // setup output file
     string output_prefix = prefix;
-    BufferedFasta out (output_prefix, 100000, true);
+    GlueFastaWriter out (output_prefix);
 
     auto get_UFclass = [&modelCanon, &ufkmers_vector, &hasher, &uf_mphf]
         (const string &kmerBegin, const string &kmerEnd,
@@ -996,7 +936,7 @@ void bglue(Storage *storage,
         };
 
     std::mutex outLock; // for the main output file
-    std::vector<BufferedFasta*> gluePartitions(nbGluePartitions);
+    std::vector<GluePartitionWriter*> gluePartitions(nbGluePartitions);
     std::string gluePartition_prefix = output_prefix + ".gluePartition.";
     unsigned int max_buffer = 50000;
     std::vector<std::atomic<unsigned long>> nb_seqs_in_partition(nbGluePartitions);
@@ -1007,7 +947,7 @@ void bglue(Storage *storage,
         string filename = gluePartition_prefix + std::to_string(i);
         if (System::file().doesExist(filename))
            System::file().remove (filename);
-        gluePartitions[i] = new BufferedFasta(filename, max_buffer);
+        gluePartitions[i] = new GluePartitionWriter(filename, max_buffer);
         nb_seqs_in_partition[i] = 0;
     }
 
@@ -1015,10 +955,13 @@ void bglue(Storage *storage,
 
 
     // partition the glue into many files, à la dsk
+    // sequences that don't need to be glued go straight to the output, through a per-thread buffer (the Dispatcher copies this functor for each thread)
+    GlueFastaWriter::Buffer outBuffer(out);
+    std::vector<uint32_t> abundances;
     auto partitionGlue = [k, &modelCanon /* crashes if copied!*/, \
         &get_UFclass, &gluePartitions, all_abundance_counts,
-        &out, &outLock, &nb_seqs_in_partition, nbGluePartitions]
-            (const Sequence& sequence)
+        outBuffer, abundances, &nb_seqs_in_partition, nbGluePartitions]
+            (const Sequence& sequence) mutable
     {
         const string &seq = sequence.toString();
         const string &comment = sequence.getComment();
@@ -1037,11 +980,16 @@ void bglue(Storage *storage,
 
         uint32_t ufclass = get_UFclass(kmerBegin, kmerEnd, lmark, rmark, kmmerBegin, kmmerEnd, found_class);
 
+        parse_abundances(comment.c_str() + 3, abundances);
+
+        // the glue partitions don't store the number of abundances, the reader expects one per kmer
+        if (abundances.size() != seq.size() - k + 1)
+            throw Exception ("bglue: sequence of length %d has %d abundances instead of %d", (int)seq.size(), (int)abundances.size(), (int)(seq.size() - k + 1));
+
         if (!found_class) // this one doesn't need to be glued
         {
-            const string abundances = comment.substr(3);
-            string header = make_header(seq.size(),abundances, all_abundance_counts);
-            output(seq, out, header); 
+            string header = make_header(seq.size(), abundances.data(), abundances.size(), all_abundance_counts);
+            outBuffer.insert(seq, header);
             return;
         }
 
@@ -1049,7 +997,7 @@ void bglue(Storage *storage,
         //stringstream ss1; // to save partition later in the comment. [why? probably to avoid recomputing it]
         //ss1 << blabla;
 
-        output(seq, *gluePartitions[index], comment);
+        gluePartitions[index]->insert(seq.data(), seq.size(), lmark, rmark, abundances.data(), abundances.size());
         nb_seqs_in_partition[index]++;
     };
 
@@ -1064,7 +1012,6 @@ void bglue(Storage *storage,
     for (int i = 0; i < nbGluePartitions; i++)
         delete gluePartitions[i]; // takes care of the final flush (this doesn't delete the file, just closes it)
     free_memory_vector(gluePartitions);
-    out.flush();
  
 
     logging("Done disk partitioning of glue");
@@ -1092,16 +1039,15 @@ void bglue(Storage *storage,
 
     // glue all partitions using a thread pool
     ThreadPool pool(nb_threads);
+    std::vector<GlueFastaWriter::Buffer> outBuffers(nb_threads, outBuffer); // one per thread of the pool
     for (int partition = 0; partition < nbGluePartitions; partition++)
     {
         auto glue_partition = [&modelCanon, &ufkmers, partition, &gluePartition_prefix, nbGluePartitions, &copy_nb_seqs_in_partition,
-        &get_UFclass, &out, &outLock, kmerSize, all_abundance_counts]( int thread_id)
+        &get_UFclass, &outBuffers, &outLock, kmerSize, all_abundance_counts]( int thread_id)
         {
             int k = kmerSize;
 
             string partitionFile = gluePartition_prefix + std::to_string(partition);
-            BankFasta partitionBank (partitionFile); // BankFasta
-            BankFasta::Iterator it (partitionBank); // BankFasta
 
             outLock.lock(); // should use a printlock..
             if (partition % 20 == 0) // sparse printing
@@ -1111,22 +1057,46 @@ void bglue(Storage *storage,
             }
             outLock.unlock();
 
+            // the whole partition is loaded once, then the sequences are read from memory
+            string partition_data;
+            {
+                std::ifstream partitionStream(partitionFile, std::ios::binary);
+                partition_data.assign(std::istreambuf_iterator<char>(partitionStream), std::istreambuf_iterator<char>());
+            }
+
+            vector<glueRecord> records;
+            records.reserve(copy_nb_seqs_in_partition[partition]);
+            for (const char *p = partition_data.data(), *end = p + partition_data.size(); p < end; )
+            {
+                glueRecord record;
+                record.lmark = (*p & 1) != 0;
+                record.rmark = (*p & 2) != 0;
+                p++;
+                memcpy(&record.seq_size, p, sizeof(uint32_t));
+                p += sizeof(uint32_t);
+                record.seq = p;
+                p += record.seq_size;
+                record.abundances = p;
+                p += (record.seq_size - k + 1) * sizeof(uint32_t);
+                if (p > end) // runs in a ThreadPool thread, where an exception wouldn't be caught
+                {  std::cout << "glue partition " << partition << " is truncated or has misaligned records" << std::endl; exit(1);}
+                records.push_back(record);
+            }
+
             unordered_map<int, vector< markedSeq<SPAN> >> msInPart;
-            seq_idx_t seq_index = 0;
 
-            for (it.first(); !it.isDone(); it.next()) // BankFasta
+            for (seq_idx_t seq_index = 0; seq_index < records.size(); seq_index++)
             {
-                const string seq = it->toString();
-                const string comment = it->getComment();
+                const glueRecord &record = records[seq_index];
 
-                const string kmerBegin = seq.substr(0, k );
-                const string kmerEnd = seq.substr(seq.size() - k , k );
+                const string kmerBegin(record.seq, k);
+                const string kmerEnd(record.seq + record.seq_size - k, k);
 
                 uint32_t ufclass = 0;
                 bool found_class = false;
 
-                bool lmark = comment[0] == '1';
-                bool rmark = comment[1] == '1';
+                bool lmark = record.lmark;
+                bool rmark = record.rmark;
 
                 // todo speed improvement: get partition id from sequence header (so, save it previously)
 
@@ -1143,9 +1113,8 @@ void bglue(Storage *storage,
 
                 markedSeq<SPAN> ms(seq_index, lmark, rmark, kmmerBegin.value(), kmmerEnd.value());
 
-                //std::cout << " ufclass " << ufclass << " seq " << seq << " seq index " << seq_index << " " << lmark << rmark << " ks " << kmmerBegin.value() << " ke " << kmmerEnd.value() << std::endl; // debug specific partition
+                //std::cout << " ufclass " << ufclass << " seq " << string(record.seq, record.seq_size) << " seq index " << seq_index << " " << lmark << rmark << " ks " << kmmerBegin.value() << " ke " << kmmerEnd.value() << std::endl; // debug specific partition
                 msInPart[ufclass].push_back(ms);
-                seq_index++;
             }
 
             vector<vector<seq_idx_t>> seqs_to_glue;
@@ -1163,39 +1132,24 @@ void bglue(Storage *storage,
 
             msInPart.clear();
             unordered_map<int,vector<markedSeq<SPAN>>>().swap(msInPart); // free msInPart
-            
-            vector<string> sequences;
-            vector<string> abundances;
-            sequences.reserve(copy_nb_seqs_in_partition[partition]);
-            abundances.reserve(copy_nb_seqs_in_partition[partition]);
-            
-            for (it.first(); !it.isDone(); it.next()) // BankFasta
-            {
-                const string seq = it->toString();
-                const string comment = it->getComment();
-                const string abundance_str = comment.substr(3);
-                sequences.push_back(seq);
-                abundances.push_back(abundance_str);
-            }
 
             uint64_t  nb_seqs_to_glue = seqs_to_glue.size();
             assert(seqs_to_glue_is_circular.size() == nb_seqs_to_glue);
+            string seq;
+            vector<uint32_t> abs;
             for (uint64_t i = 0; i < nb_seqs_to_glue; i++)
             {
-                string seq, abs;
-                glue_sequences(seqs_to_glue[i], seqs_to_glue_is_circular[i], sequences, abundances, kmerSize, seq, abs); // takes as input the indices of ordered sequences, whether that sequence is circular, and the markedSeq's themselves along with their abundances
+                seq.clear();
+                abs.clear();
+                glue_sequences(seqs_to_glue[i], seqs_to_glue_is_circular[i], records, kmerSize, seq, abs); // takes as input the indices of ordered sequences, whether that sequence is circular, and the sequences themselves along with their abundances
 
-                {
-                    string header = make_header(seq.size(),abs, all_abundance_counts);
-                    output(seq, out, header);
-                }
+                string header = make_header(seq.size(), abs.data(), abs.size(), all_abundance_counts);
+                outBuffers[thread_id].insert(seq, header);
             }
                 
             free_memory_vector(seqs_to_glue);
             free_memory_vector(seqs_to_glue_is_circular);
 
-            partitionBank.finalize(); // BankFasta
-
             System::file().remove (partitionFile);
 
         };
@@ -1206,7 +1160,10 @@ void bglue(Storage *storage,
 
     pool.join();
    
-   out.flush(); // not sure if necessary
+    outBuffers.clear(); // flushes the remaining output
+    logging("wrote " + to_string(out.nb_sequences()) + " sequences");
+
+    free(ufkmers_vector);
 
     logging("end");
 
@@ -29,76 +29,165 @@
 #include <vector>
 #include <string>
 #include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 #include <gatb/tools/storage/impl/Storage.hpp>
 
 namespace gatb { namespace core { namespace debruijn { namespace impl  {
 
 
-// buffered and also thread-safe thank to a lock
+// glue partitions: buffered and also thread-safe thank to a lock
+// records are binary, the abundances stay uint32's until the final FASTA output:
+//   uint8_t marks (bit 0: lmark, bit 1: rmark), uint32_t sequence length, the nucleotides, then (length - k + 1) uint32_t abundances
 // not using BankFasta because I dont want to be recording variable-length strings in a std::vector<>, potential memory fragmentation
 // so instead it's in a flat buffer
-class BufferedFasta
+class GluePartitionWriter
 {
         std::mutex mtx;
         std::string buffer;
-        unsigned long buffer_length;
         FILE* _insertHandle;
-        bool needs_consecutive_ids;
-        unsigned long consecutive_id;
 
     public:
         unsigned long max_buffer;
-        bool threadsafe;
 
-        BufferedFasta(const std::string filename, unsigned long given_max_buffer = 50000, bool given_needs_consecutive_ids = false)
+        GluePartitionWriter(const std::string filename, unsigned long given_max_buffer = 50000)
         {
             max_buffer = given_max_buffer; // that much of buffering will be written to the file at once (in bytes)
-            threadsafe = true;
-            buffer_length = 0;
-            consecutive_id = 0;
-            needs_consecutive_ids = given_needs_consecutive_ids;
-            if ((!threadsafe) && needs_consecutive_ids) { std::cout << "error, non-threadsafe bufferedfasta with consecutive ids asked" << std::endl; exit(1);}
             _insertHandle = fopen (filename.c_str(), "w");
             if (!_insertHandle) { std::cout << "error opening " << filename << " for writing." << std::endl; exit(1);}
             buffer.reserve(max_buffer+1000/*security*/);
         }
 
-        ~BufferedFasta()
+        ~GluePartitionWriter()
         {
             flush();
             fclose(_insertHandle);
             std::string().swap(buffer);
         }
 
-        void insert(const std::string &seq, const std::string &comment)
+        void insert(const char* seq, uint32_t seq_size, bool lmark, bool rmark, const uint32_t* abundances, uint32_t nb_abundances)
         {
-            if (threadsafe)
-                mtx.lock();
-            unsigned int insert_size = seq.size() + comment.size() + 3;
-            if (buffer_length + insert_size > max_buffer)
+            std::lock_guard<std::mutex> lock(mtx);
+            size_t insert_size = 1 + sizeof(uint32_t) + seq_size + nb_abundances * sizeof(uint32_t);
+            if (buffer.size() + insert_size > max_buffer)
                 flush();
-            buffer_length += insert_size;
-            buffer += ">";
-            if (needs_consecutive_ids)
-            {
-                buffer += std::to_string(consecutive_id) + " "; 
-                consecutive_id++;
-            }
-            buffer += comment + "\n" + seq + "\n";
-            if (threadsafe)
-                mtx.unlock();
+            buffer += (char) ((lmark ? 1 : 0) | (rmark ? 2 : 0));
+            buffer.append ((const char*) &seq_size, sizeof(uint32_t));
+            buffer.append (seq, seq_size);
+            buffer.append ((const char*) abundances, nb_abundances * sizeof(uint32_t));
         }
 
         void flush()
         {
-            unsigned int res = fprintf (_insertHandle, "%s", buffer.c_str());
-            if (res != buffer.size())            {  std::cout << "couldn't flush, written " << res << " out of " << buffer.size() << std::endl; exit(1);}
-            if (_insertHandle    != 0)  { fflush  (_insertHandle);              }
-            buffer_length = 0;
+            if (buffer.size() && fwrite (buffer.data(), 1, buffer.size(), _insertHandle) != buffer.size())
+            {  std::cout << "couldn't flush glue partition (" << buffer.size() << " bytes)" << std::endl; exit(1);}
             buffer.clear();
         }
 };
 
+// final FASTA output of bglue, written by all threads at the same time. each thread fills its own Buffer; a full Buffer reserves
+// the next sequence ids and the matching range of the file (the only locked part), then is formatted and written there with pwrite().
+// so the sequences have consecutive ids in file order, which LinkTigs and GraphUnitigs rely on
+class GlueFastaWriter
+{
+        std::mutex mtx;
+        int fd;
+        uint64_t next_id, next_offset;
+
+        // total number of digits of the ids [first, first+n)
+        static uint64_t nb_digits(uint64_t first, uint64_t n)
+        {
+            uint64_t total = 0, digits = 1, power = 10, id = first, end = first + n;
+            while (id < end)
+            {
+                while (id >= power) { power *= 10; digits++; }
+                uint64_t upto = std::min(end, power);
+                total += (upto - id) * digits;
+                id = upto;
+            }
+            return total;
+        }
+
+    public:
+        GlueFastaWriter(const std::string filename) : next_id(0), next_offset(0)
+        {
+            fd = open (filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) { std::cout << "error opening " << filename << " for writing." << std::endl; exit(1);}
+        }
+
+        ~GlueFastaWriter()  { close(fd); }
+
+        uint64_t nb_sequences()  { std::lock_guard<std::mutex> lock(mtx); return next_id; }
+
+        class Buffer
+        {
+                GlueFastaWriter& writer;
+                std::string records;        // "header\nsequence\n" of each sequence, without the ">id "
+                std::vector<size_t> starts; // start of each sequence in records
+                std::string text;
+                size_t max_buffer;
+
+            public:
+                Buffer(GlueFastaWriter& writer, size_t max_buffer = 1 << 20) : writer(writer), max_buffer(max_buffer) {}
+
+                // a copy (e.g. of a functor given to a Dispatcher) is a new, empty, buffer of the same writer
+                Buffer(const Buffer& other) : writer(other.writer), max_buffer(other.max_buffer) {}
+
+                ~Buffer()  { flush(); }
+
+                void insert(const std::string& seq, const std::string& header)
+                {
+                    starts.push_back(records.size());
+                    records += header;
+                    records += '\n';
+                    records += seq;
+                    records += '\n';
+                    if (records.size() > max_buffer)
+                        flush();
+                }
+
+                void flush()
+                {
+                    uint64_t n = starts.size();
+                    if (n == 0)
+                        return;
+
+                    uint64_t first_id, offset, size;
+                    {
+                        std::lock_guard<std::mutex> lock(writer.mtx);
+                        first_id = writer.next_id;
+                        size = records.size() + 2 * n /* '>' and ' ' */ + nb_digits(first_id, n);
+                        offset = writer.next_offset;
+                        writer.next_id += n;
+                        writer.next_offset += size;
+                    }
+
+                    text.clear();
+                    text.reserve(size);
+                    starts.push_back(records.size());
+                    for (uint64_t i = 0; i < n; i++)
+                    {
+                        text += '>';
+                        text += std::to_string(first_id + i);
+                        text += ' ';
+                        text.append(records, starts[i], starts[i+1] - starts[i]);
+                    }
+
+                    for (uint64_t written = 0; written < size; )
+                    {
+                        ssize_t res = pwrite(writer.fd, text.data() + written, size - written, offset + written);
+                        if (res <= 0) { std::cout << "couldn't write glue output, " << written << " out of " << size << " bytes written" << std::endl; exit(1);}
+                        written += res;
+                    }
+
+                    records.clear();
+                    starts.clear();
+                }
+        };
+};
+
 // not using BankFasta because I suspect that it does some funky memory fragmentation. so this one is unbuffered
 class UnbufferedFastaIterator 
 {
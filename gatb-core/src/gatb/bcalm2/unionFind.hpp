@@ -4,9 +4,14 @@
 #include <vector>
 #include <set>
 #include <atomic>
+#include <thread>
 #include <iostream>
 #include <fstream>
 #include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 
 /**
  * Lock-free parallel disjoint set data structure (aka UNION-FIND)
@@ -22,27 +27,38 @@
  * of disjoint sets and a combined unite+unlock operation.
  *
  * \author Wenzel Jakob
+ *
+ * Each element is a single 64-bit word, parent in the low 32 bits and rank in the high 32 bits.
+ * find() is wait-free and does path halving, union_() is lock-free.
+ * The words are in a malloc'ed array so that, once all unions are done, normalize() and release_classes()
+ * can turn it in place into the 32-bit class vector used by bglue (no second array, no temporary file).
  */
 class unionFind { 
 public:
-    unionFind(uint32_t size) : mData(size) {
-        //max_rank = 0;
+    unionFind(uint32_t size) : mSize(size) {
+        mData = (std::atomic<uint64_t>*) malloc(std::max<uint64_t>(size, 1) * sizeof(std::atomic<uint64_t>));
+        if (mData == NULL) { std::cout << "error: could not allocate a union-find of " << size << " elements" << std::endl; exit(1); }
         for (uint32_t i=0; i<size; ++i)
-            mData[i] = (uint32_t) i;
+            new (&mData[i]) std::atomic<uint64_t>((uint64_t) i);
     }
 
+    ~unionFind() { free(mData); }
+
+    unionFind(const unionFind&) = delete;
+    unionFind& operator=(const unionFind&) = delete;
+
     uint32_t find(uint32_t id) const {
-        while (id != parent(id)) {
+        for (;;) {
             uint64_t value = mData[id];
-            uint32_t new_parent = parent((uint32_t) value);
-            uint64_t new_value =
-                (value & 0xFFFFFFFF00000000ULL) | new_parent;
-            /* Try to update parent (may fail, that's ok) */
-            if (value != new_value)
-                mData[id].compare_exchange_weak(value, new_value);
+            uint32_t p = (uint32_t) value;
+            if (p == id)
+                return id;
+            uint32_t new_parent = parent(p);
+            /* Path halving: try to point id to its grandparent (may fail, that's ok) */
+            if (new_parent != p)
+                mData[id].compare_exchange_weak(value, (value & 0xFFFFFFFF00000000ULL) | new_parent);
             id = new_parent;
         }
-        return id;
     }
 
     bool same(uint32_t id1, uint32_t id2) const {
@@ -89,7 +105,7 @@ public:
         return id2;
     }
 
-    uint32_t size() const { return (uint32_t) mData.size(); }
+    uint32_t size() const { return mSize; }
 
     //uint32_t max_rank;
     uint32_t rank(uint32_t id) {
@@ -124,31 +140,75 @@ public:
         if (reverseData.size() > 0)
             mean /= reverseData.size();
         getNumSets = reverseData.size();
-        getNumKeys = mData.size();
+        getNumKeys = size();
         std::cout << prefix + " data structure has " << getNumKeys << " inserted elements, and made " << getNumSets << " partitions." << std::endl;
         std::cout << "mean/max number of elements in partitions: " << mean << "/" << max << std::endl;
         std::cout << "raw space of UF hash data: " << ( 2*getNumKeys * sizeof(uint32_t)  ) /1024/1024 << " MB" << std::endl; // 2x because each key of type T is associated to a value of type T, and here T=uint32_t
     }
 
-    // normalize the UF first: the class id is the element of the smallest id
-    // added to make the UF deterministic when populated by multiple threads
-    // requires 3xUF memory while doing this operation, so i'm not enabling it by default
-    void normalize()
+    // normalize the UF: afterwards each element points directly to the smallest element of its class, which is the class id
+    // added to make the UF deterministic when populated by multiple threads. must not be called concurrently with union_()
+    // done in place, in parallel passes over the elements; the high (rank) bits of the words are used as scratch space:
+    //  1) the high bits of each root are set to UINT32_MAX
+    //  2) each element lowers the high bits of its root to its own id. roots keep their parent bits, so concurrent find()'s are unaffected
+    //  3) each non-root element copies the high bits of its root (the smallest element of the class) into its own high bits.
+    //     find() only reads the high bits of roots, and its path halving CAS keeps the high bits it read, or fails
+    //  4) parent := high bits, rank := 0
+    void normalize(int nb_threads = 1)
     {
-        std::vector<uint32_t> smallest_elt_in_class(size());
-        std::vector<uint32_t> mDataMirror(size());
-        for (uint32_t i=0; i<size(); ++i)
+        parallel_for(0, size(), nb_threads, [this] (uint32_t i)
         {
-            smallest_elt_in_class[find(i)] = size();
-            mDataMirror[i] = mData[i]; 
-        }
-        for (uint32_t i=0; i<size(); ++i)
-            smallest_elt_in_class[find(i)] = std::min(smallest_elt_in_class[find(i)],i);
-        for (uint32_t i=0; i<size(); ++i)
-            //mData[i] = smallest_for_class[find(i)]; // this is fishy to modify mData at same time we do the find
-            mDataMirror[i] = smallest_elt_in_class[find(i)]; // this is fishy to modify mData at same time we do the find
-        for (uint32_t i=0; i<size(); ++i)
-            mData[i] = mDataMirror[i];
+            if (parent(i) == i)
+                mData[i] = (0xFFFFFFFFULL << 32) | i;
+        });
+
+        parallel_for(0, size(), nb_threads, [this] (uint32_t i)
+        {
+            uint32_t root = find(i);
+            uint64_t value = mData[root];
+            while ((value >> 32) > i && !mData[root].compare_exchange_weak(value, ((uint64_t) i << 32) | (uint32_t) value)) {}
+        });
+
+        parallel_for(0, size(), nb_threads, [this] (uint32_t i)
+        {
+            uint32_t root = find(i);
+            if (root == i)
+                return;
+            uint64_t smallest = mData[root] >> 32;
+            uint64_t value = mData[i];
+            while (!mData[i].compare_exchange_weak(value, (smallest << 32) | (uint32_t) value)) {}
+        });
+
+        parallel_for(0, size(), nb_threads, [this] (uint32_t i)
+        {
+            mData[i] = mData[i] >> 32;
+        });
+    }
+
+    // hands over the parent of each element (its class id, after normalize()) as an array of size() uint32_t's, to be free()'d by the caller.
+    // the union-find is empty afterwards. the conversion reuses the storage of the union-find: parent i moves from bytes [8i,8i+8) to [4i,4i+4),
+    // so the elements of [L,2L) only overwrite elements of [L/2,L); the ranges [1,2), [2,4), [4,8), .. are converted one after the other, each in parallel
+    uint32_t* release_classes(int nb_threads = 1)
+    {
+        char* buffer = (char*) mData;
+        auto convert = [buffer] (uint32_t i)
+        {
+            uint64_t value;
+            memcpy(&value, buffer + 8*(uint64_t)i, sizeof(value));
+            uint32_t parent = (uint32_t) value;
+            memcpy(buffer + 4*(uint64_t)i, &parent, sizeof(parent));
+        };
+        if (size() > 0)
+            convert(0);
+        for (uint64_t L = 1; L < size(); L *= 2)
+            parallel_for(L, std::min<uint64_t>(2*L, size()), nb_threads, convert);
+
+        uint32_t* classes = (uint32_t*) realloc(buffer, std::max<uint64_t>(size(), 1) * sizeof(uint32_t));
+        if (classes == NULL) // can't shrink, keep the whole buffer
+            classes = (uint32_t*) buffer;
+        mData = NULL;
+        mSize = 0;
+        return classes;
     }
 
     void dump(std::string file)
@@ -175,13 +235,39 @@ public:
         }
     }
 
+private:
 
+    // runs f(i) for i in [begin,end), in contiguous chunks over nb_threads threads (in the calling thread for small ranges)
+    template <typename F>
+    static void parallel_for(uint64_t begin, uint64_t end, int nb_threads, F f)
+    {
+        if (nb_threads <= 1 || end - begin < 65536)
+        {
+            for (uint64_t i = begin; i < end; i++)
+                f((uint32_t) i);
+            return;
+        }
+        uint64_t chunk = (end - begin + nb_threads - 1) / nb_threads;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nb_threads; t++)
+        {
+            uint64_t chunk_begin = begin + t * chunk, chunk_end = std::min(end, chunk_begin + chunk);
+            threads.emplace_back([chunk_begin, chunk_end, &f] () {
+                for (uint64_t i = chunk_begin; i < chunk_end; i++)
+                    f((uint32_t) i);
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
 
-    mutable std::vector<std::atomic<uint64_t>> mData;
+    mutable std::atomic<uint64_t>* mData;
+    uint32_t mSize;
 };
 
 #endif /* __UNIONFIND_H */
 
+
 // this one below works fine but uses an unordered_map; so two problem:
 // - memory usage
 // - has locks
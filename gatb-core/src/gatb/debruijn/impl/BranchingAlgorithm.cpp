@@ -133,28 +133,55 @@ struct FunctorNodes
     typedef typename kmer::impl::Kmer<span>::Type           Type;
     typedef typename kmer::impl::Kmer<span>::Count          Count;
 
+    /** Number of nodes whose neighbors are queried in a single batch. */
+    static const size_t BATCH_SIZE = 256;
+
     const Graph* graph;
     ThreadObject<FunctorData<Count,Type> >& functorData;
 
+    std::vector<Node>          nodes;
+    std::vector<unsigned char> masks;
+
     FunctorNodes (const Graph* graph, ThreadObject<FunctorData<Count,Type> >& functorData)
         : graph(graph), functorData(functorData)  {}
 
+    FunctorNodes (const FunctorNodes& f) : graph(f.graph), functorData(f.functorData)  {}
+
+    /** The remaining nodes are processed when the functor of the thread is deleted, ie. at the end of its iteration. */
+    ~FunctorNodes ()  {  flush();  }
+
     void operator() (Node& node)
     {
-        // We get branching nodes neighbors for the current node.
-        GraphVector<Node> successors   = graph->successors   (node);
-        GraphVector<Node> predecessors = graph->predecessors (node);
+        // The neighbors are queried by batches of nodes, so the memory latencies of the queries overlap.
+        nodes.push_back (node);
 
-        if ( ! (successors.size()==1 && predecessors.size()==1) )
-        {
-            // the node is branching
+        if (nodes.size() >= BATCH_SIZE)  {  flush();  }
+    }
+
+    void flush ()
+    {
+        if (nodes.empty())  { return; }
+
+        // We get the neighbors of the current nodes.
+        graph->neighborsMasks (nodes, masks);
 
-        	FunctorData<Count,Type>& data = functorData();
+        FunctorData<Count,Type>& data = functorData();
 
-        	data.branchingNodes.push_back (Count (node.template getKmer<Type>(), node.abundance));
+        for (size_t i=0; i<nodes.size(); i++)
+        {
+            size_t nbSuccessors   = __builtin_popcount (masks[i] & 0xF);
+            size_t nbPredecessors = __builtin_popcount (masks[i] >> 4);
 
-        	data.topology [make_pair(predecessors.size(), successors.size())] ++;
+            if ( ! (nbSuccessors==1 && nbPredecessors==1) )
+            {
+                // the node is branching
+                data.branchingNodes.push_back (Count (nodes[i].template getKmer<Type>(), nodes[i].abundance));
+
+                data.topology [make_pair(nbPredecessors, nbSuccessors)] ++;
+            }
         }
+
+        nodes.clear();
     }
 };
 
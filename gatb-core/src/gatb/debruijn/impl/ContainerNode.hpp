@@ -73,6 +73,9 @@ public:
     /** \copydoc IContainerNode::contains */
     bool contains (const Item& item)  {  return (_bloom->contains(item) && !_falsePositives->contains(item));  }
 
+    /** \copydoc Container::prefetch */
+    void prefetch (const Item& item)  {  _bloom->prefetch (item);  }
+
 protected:
 
     tools::collections::Container<Item>* _bloom;
@@ -150,6 +153,9 @@ public:
     /** \copydoc IContainerNode::contains */
     bool contains (const Item& item)  {  return (_bloom->contains(item) && ! containsCFP(item));  }
 
+    /** \copydoc Container::prefetch */
+    void prefetch (const Item& item)  {  _bloom->prefetch (item);  }
+
 private:
 
     tools::collections::Container<Item>* _bloom;
@@ -1024,6 +1024,145 @@ size_t GraphTemplate<Node, GraphDataVariant>::degree (Node& node, Direction dir)
 template<typename Node, typename GraphDataVariant>
 void GraphTemplate<Node, GraphDataVariant>::degree (Node& node, size_t &in, size_t &out) const  {  countNeighbors(node, in, out);  }
 
+/*********************************************************************
+** METHOD  :
+** PURPOSE : computes the 8 neighbors candidates of a node
+** INPUT   : the kmer of the node and its strand
+** OUTPUT  : canonical values of the successors (nt 0..3) then of the predecessors (nt 0..3), and
+**           a bitmask of the candidates whose canonical value is their reverse complement
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+template<typename Type>
+inline void getNeighborsCandidates (const Type& sourceVal, Strand strand, size_t kmerSize, const Type& mask, Type* candidates, unsigned char& revcompMask)
+{
+    /* one revcomp for the source; the revcomp of each candidate is derived from it by a shift */
+    Type rc = revcomp (sourceVal, kmerSize);
+
+    /* the kmer we're extending may be actually a revcomp sequence in the bidirected debruijn graph node */
+    const Type& graine     = (strand == STRAND_FORWARD) ?  sourceVal : rc;
+    const Type& antigraine = (strand == STRAND_FORWARD) ?  rc : sourceVal;
+
+    size_t shift = (kmerSize-1)*2;
+
+    revcompMask = 0;
+
+    /** IMPORTANT !!! Since we have hugely shift the nt value, we make sure to use a long enough integer. */
+    for (u_int64_t nt=0; nt<4; nt++)
+    {
+        Type single_nt;   single_nt.setVal  (nt);
+        Type single_cnt;  single_cnt.setVal (nt ^ 2);  /* complement: A<->T, C<->G */
+
+        Type outForward = ( (graine << 2 )  + single_nt) & mask;
+        Type outReverse = (antigraine >> 2) + (single_cnt << shift);
+        Type inForward  = (graine >> 2) + (single_nt << shift); /* previous kmer */
+        Type inReverse  = ( (antigraine << 2 )  + single_cnt) & mask;
+
+        if (outForward < outReverse)  {  candidates[nt]   = outForward;  }
+        else                          {  candidates[nt]   = outReverse;  revcompMask |= (1 << nt);     }
+
+        if (inForward < inReverse)    {  candidates[4+nt] = inForward;   }
+        else                          {  candidates[4+nt] = inReverse;   revcompMask |= (1 << (4+nt)); }
+    }
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE : neighbors of a node according to its adjacency byte
+** INPUT   : the adjacency byte (for the forward strand) and the strand of the node
+** OUTPUT  :
+** RETURN  : a mask; bits 0-3 for the successors, bits 4-7 for the predecessors (bit i&3 = transition nt)
+** REMARKS :
+*********************************************************************/
+inline unsigned char getAdjacencyMask (unsigned char value, Strand strand)
+{
+    if (strand == STRAND_FORWARD)  { return value; }
+
+    /* swap the directions and revcomp the nt's: instead of GTCA (high bits to low), make it CAGT */
+    unsigned char out = (value >> 4) & 0xF, in = value & 0xF;
+    out = ((out & 3) << 2) | ((out >> 2) & 3);
+    in  = ((in  & 3) << 2) | ((in  >> 2) & 3);
+    return out | (in << 4);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE : computes the neighbors of several nodes
+** INPUT   : nodes and direction of the neighbors
+** OUTPUT  : a mask per node; bits 0-3 for the successors, bits 4-7 for the predecessors (bit i&3 = transition nt)
+** RETURN  :
+** REMARKS : the candidates of NEIGHBORS_NODES_BATCH nodes are resolved together by the batched
+**           GraphData::contains, so the Bloom and MPHF probes of different nodes overlap in memory.
+*********************************************************************/
+static const size_t NEIGHBORS_NODES_BATCH = 8;
+
+template<size_t span, typename Node>
+void getNeighborsMasks (const GraphData<span>& data, Node* sources, size_t nbSources, Direction direction, bool hasAdjacency, unsigned char* masks)
+{
+    /** Shortcut. */
+    typedef typename Kmer<span>::Type Type;
+
+    unsigned char wanted = ((direction & DIR_OUTCOMING) ? 0x0F : 0) | ((direction & DIR_INCOMING) ? 0xF0 : 0);
+
+    /* use adjacency information when available, because it's faster than bloom */
+    if (hasAdjacency)
+    {
+        for (size_t i=0; i<nbSources; i++)
+        {
+            if (sources[i].mphfIndex == 0)  {  data._abundance->prefetchCode (sources[i].template getKmer<Type>());  }
+        }
+
+        for (size_t i=0; i<nbSources; i++)
+        {
+            unsigned long hashIndex = getNodeIndex<span>(data, sources[i]);
+            if (hashIndex != ULLONG_MAX)  {  __builtin_prefetch (&(*(data._adjacency)).at(hashIndex), 0, 3);  }
+        }
+
+        for (size_t i=0; i<nbSources; i++)
+        {
+            unsigned long hashIndex = getNodeIndex<span>(data, sources[i]);
+            if (hashIndex == ULLONG_MAX)  {  masks[i] = 0;  continue;  } // node was not found in the mphf
+
+            masks[i] = getAdjacencyMask ((*(data._adjacency)).at(hashIndex), sources[i].strand) & wanted;
+        }
+        return;
+    }
+
+    /* else, run classical neighbor queries using the data.contains() operation (bloom filters behind the scenes) */
+
+    /** Shortcuts. */
+    size_t      kmerSize = data._model->getKmerSize();
+    const Type& mask     = data._model->getKmerMax();
+
+    Type          candidates [8*NEIGHBORS_NODES_BATCH];
+    Type          queries    [8*NEIGHBORS_NODES_BATCH];
+    bool          found      [8*NEIGHBORS_NODES_BATCH];
+    unsigned char revcompMask;
+
+    for (size_t j=0; j<nbSources; j+=NEIGHBORS_NODES_BATCH)
+    {
+        size_t n = std::min (nbSources-j, NEIGHBORS_NODES_BATCH);
+        size_t nbQueries = 0;
+
+        for (size_t i=0; i<n; i++)
+        {
+            Type sourceVal = sources[j+i].template getKmer<Type>();
+            getNeighborsCandidates (sourceVal, sources[j+i].strand, kmerSize, mask, candidates + 8*i, revcompMask);
+
+            for (size_t b=0; b<8; b++)  {  if (wanted & (1 << b))  {  queries[nbQueries++] = candidates[8*i+b];  }  }
+        }
+
+        data.contains (queries, nbQueries, found);
+
+        nbQueries = 0;
+        for (size_t i=0; i<n; i++)
+        {
+            masks[j+i] = 0;
+            for (size_t b=0; b<8; b++)  {  if ((wanted & (1 << b)) && found[nbQueries++])  {  masks[j+i] |= (1 << b);  }  }
+        }
+    }
+}
+
 /*********************************************************************
 ** METHOD  :
 ** PURPOSE :
@@ -1047,190 +1186,68 @@ struct getItems_visitor : public visitor_base<GraphVector<Item> >    {
         typedef typename Kmer<span>::Type Type;
 
         GraphVector<Item> items;
-        GraphVector<Item> itemsAdj;
 
         size_t idx = 0;
-        size_t idxAdj = 0;
-
-        /** We get the specific typed value from the generic typed value. */
-        Type sourceVal = source.template getKmer<Type>();
 
         /** Shortcuts. */
         size_t      kmerSize = data._model->getKmerSize();
         const Type& mask     = data._model->getKmerMax();
 
-        /* the kmer we're extending may be actually a revcomp sequence in the bidirected debruijn graph node */
-        Type graine = ((source.strand == STRAND_FORWARD) ?  sourceVal :  revcomp (sourceVal, kmerSize) );
-        /* TODO opt: in some cases we may skip computing graine, e.g. whenever there are no neighbors */
+        /* the successors are candidates 0..3 and the predecessors 4..7 */
+        size_t first = (direction & DIR_OUTCOMING) ? 0 : 4;
+        size_t last  = (direction & DIR_INCOMING)  ? 8 : 4;
+
+        bool found[8];
+
+        /* indexes of the successor and of the predecessor, when known (0 otherwise) */
+        u_int64_t indexes[2] = { 0, 0 };
 
-        bool debug = false;
         /* use adjacency information when available, because it's faster than bloom */
         if (hasAdjacency)
         {
             unsigned long hashIndex = getNodeIndex<span>(data, source);
-			if(hashIndex == ULLONG_MAX) return itemsAdj;
+			if(hashIndex == ULLONG_MAX) return items;
 
-            unsigned char &value = (*(data._adjacency)).at(hashIndex);
-
-            bool forwardStrand = (source.strand == STRAND_FORWARD);
-
-            unsigned char bitmask;
-         
- 
-            if (direction & DIR_OUTCOMING)
-            {
-                if (forwardStrand)
-                    bitmask = value & 0xF;
-                else
-                {
-                    bitmask = (value >> 4) & 0xF;
+            unsigned char bitmask = getAdjacencyMask ((*(data._adjacency)).at(hashIndex), source.strand);
 
-                    /* also revcomp the nt's: instead of GTCA (high bits to low), make it CAGT */
-                    bitmask = ((bitmask & 3) << 2) | ((bitmask >> 2) & 3);
-                }
+            /* no need to compute the candidates when there are no neighbors */
+            if (bitmask == 0)  {  return items;  }
 
-                //std::cout << "getItems OUTCOMING: forward strand?" << forwardStrand << "; adjacency value: " << to_string((int)value) << " hashindex " << hashIndex << " dir " << direction << " bitmask " << (int)bitmask << std::endl;
-           
-                for (u_int64_t nt=0; nt<4; nt++)
-                {
-                    if (bitmask & (1 << nt))
-                    {
-                        typename Node::Value dest_value;
-                        Strand dest_strand = STRAND_FORWARD;
-                        Nucleotide dest_nt = (Nucleotide)nt;
-                        Type forward, reverse;
-                        Type single_nt; single_nt.setVal(nt);
+            for (size_t b=first; b<last; b++)  {  found[b] = bitmask & (1 << b);  }
 
-                        forward = ( (graine << 2 )  + single_nt ) & mask; /* for speedup's, there is much we could precompute here */
-                        reverse = revcomp (forward, kmerSize);
-
-                        if (forward < reverse)
-                            dest_value = forward;
-                        else
-                        {
-                            dest_value = reverse;
-                            dest_strand = STRAND_REVCOMP;
-                        }
-
-                        if (debug) std::cout << "adj, found OUT " << (dest_strand==STRAND_REVCOMP ? "REV" : "FWD") << " nt=" << nt << std::endl;
-                        fct (itemsAdj, idxAdj++, source.kmer, source.strand, dest_value, dest_strand, dest_nt, DIR_OUTCOMING);
-                    }
-                }
-            }
-
-            if (direction & DIR_INCOMING)
+            /* within a simple path, the layout gives the index of the neighbor (it is then the only one in its direction) */
+            if (data._layout != nullptr)
             {
-                if (forwardStrand)
-                    bitmask = (value >> 4) & 0xF;
-                else
-                {
-                    bitmask = value & 0xF;
-
-                    /* also revcomp the nt's: instead of GTCA (high bits to low), make it CAGT */
-                    bitmask = ((bitmask & 3) << 2) | ((bitmask >> 2) & 3);
-                }
-
-                //std::cout << "getItems INCOMING: forward strand?" << forwardStrand << "; adjacency value: " << to_string((int)value) << " hashindex " << hashIndex << " dir " << direction << " bitmask " << (int)bitmask << std::endl;
-
-                /** IMPORTANT !!! Since we have hugely shift the nt value, we make sure to use a long enough integer. */
-                for (u_int64_t nt=0; nt<4; nt++)
-                {
-
-                    if (bitmask & (1 << nt))
-                    {
-                        typename Node::Value dest_value;
-                        Strand dest_strand = STRAND_FORWARD;
-                        Nucleotide dest_nt = (Nucleotide)nt;
-                        Type forward, reverse;
-                        Type single_nt; single_nt.setVal(nt);
-
-                        forward = ( (graine >> 2 )  + ( single_nt << ((kmerSize-1)*2)) ) & mask; /* previous kmer */
-                        reverse = revcomp (forward, kmerSize);
-
-                        if (forward < reverse)
-                            dest_value = forward;
-                        else
-                        {
-                            dest_value = reverse;
-                            dest_strand = STRAND_REVCOMP;
-                        }
-
-                        if (debug) std::cout << "adj, found INC " << (dest_strand==STRAND_REVCOMP ? "REV" : "FWD") << " nt=" << nt << std::endl;
-                        fct (itemsAdj, idxAdj++, source.kmer, source.strand, dest_value, dest_strand, dest_nt, DIR_INCOMING);
-                    }
-                }
+                indexes[0] = data._layout->neighbor (hashIndex, source.strand, DIR_OUTCOMING);
+                indexes[1] = data._layout->neighbor (hashIndex, source.strand, DIR_INCOMING);
             }
+        }
 
-            /** We update the size of the container according to the number of found items. */
-            itemsAdj.resize (idxAdj);
+        /** We get the specific typed value from the generic typed value. */
+        const Type& sourceVal = source.template getKmer<Type>();
 
-            /** We return the result. */
-            return itemsAdj;
-        }
+        Type          candidates[8];
+        unsigned char revcompMask;
 
-        /* else, run classical neighbor queries using the data.contains() operation (bloom filters behind the scenes) */
+        getNeighborsCandidates (sourceVal, source.strand, kmerSize, mask, candidates, revcompMask);
 
-        if (direction & DIR_OUTCOMING)
-        {
-            for (u_int64_t nt=0; nt<4; nt++)
-            {
-                typename Node::Value dest_value;
-                Type forward = ( (graine << 2 )  + nt) & mask;
-                Type reverse = revcomp (forward, kmerSize);
+        /* else, run classical neighbor queries using the data.contains() operation (bloom filters behind the scenes);
+         * all the candidates are probed at once */
+        if (!hasAdjacency)  {  data.contains (candidates + first, last - first, found + first);  }
 
-                if (forward < reverse)
-                {
-                    if (data.contains (forward))
-                    {
-                        dest_value = forward;
-                        if (debug) std::cout << "kmer  "<< sourceVal << " found OUT FWD nt=" << nt << std::endl;
-                        fct (items, idx++, source.kmer, source.strand, dest_value, STRAND_FORWARD, (Nucleotide)nt, DIR_OUTCOMING);
-                    }
-                }
-                else
-                {
-                    if (data.contains (reverse))
-                    {
-                        dest_value = reverse;
-                        if (debug) std::cout << "found OUT REV nt=" << nt << std::endl;
-                        fct (items, idx++, source.kmer, source.strand, dest_value, STRAND_REVCOMP, (Nucleotide)nt, DIR_OUTCOMING);
-                    }
-                }
-            }
-        }
+        bool debug = false;
 
-        if (direction & DIR_INCOMING)
+        for (size_t b=first; b<last; b++)
         {
-            /** IMPORTANT !!! Since we have hugely shift the nt value, we make sure to use a long enough integer. */
-            for (u_int64_t nt=0; nt<4; nt++)
-            {
-                Type single_nt;
-                single_nt.setVal(nt);
-                single_nt <<=  ((kmerSize-1)*2);
-                typename Node::Value dest_value;
-                Type forward = ((graine >> 2 )  + single_nt ) & mask; /* previous kmer */
-                Type reverse = revcomp (forward, kmerSize);
+            if (!found[b])  { continue; }
 
-                if (forward < reverse)
-                {
-                    if (data.contains (forward))
-                    {
-                        dest_value = forward;
-                        if (debug) std::cout << "found INC FWD nt=" << nt << std::endl;
-                        // It used to be that "nt" was source[0] (in forward strand) and reverse(source[k-1]) in reverse, but i think it was wrong, so i changed it. TODO: delete this line if neighbors(..,DIR_INCOMING) causes no trouble for anyone, as it is now.
-                        fct (items, idx++, source.kmer, source.strand, dest_value, STRAND_FORWARD, (Nucleotide)nt, DIR_INCOMING);
-                    }
-                }
-                else
-                {
-                    if (data.contains (reverse))
-                    {
-                        dest_value = reverse;
-                        if (debug) std::cout << "found INC REV nt=" << nt << std::endl;
-                        fct (items, idx++, source.kmer, source.strand, dest_value, STRAND_REVCOMP, (Nucleotide)nt, DIR_INCOMING);
-                    }
-                }
-            }
+            typename Node::Value dest_value;
+            dest_value = candidates[b];
+            Strand    dest_strand = (revcompMask & (1 << b)) ? STRAND_REVCOMP : STRAND_FORWARD;
+            Direction dest_dir    = b < 4 ? DIR_OUTCOMING : DIR_INCOMING;
+
+            if (debug) std::cout << "kmer  "<< sourceVal << " found " << toString(dest_dir) << " " << (dest_strand==STRAND_REVCOMP ? "REV" : "FWD") << " nt=" << (b&3) << std::endl;
+            fct (items, idx++, source.kmer, source.strand, dest_value, dest_strand, indexes[b < 4 ? 0 : 1], (Nucleotide)(b&3), dest_dir);
         }
 
         /** We update the size of the container according to the number of found items. */
@@ -1250,11 +1267,13 @@ struct Functor_getEdges {   void operator() (
     kmer::Strand         strand_from,
     const typename Node::Value&   kmer_to,
     kmer::Strand         strand_to,
+    u_int64_t            index_to,
     kmer::Nucleotide     nt,
     Direction            dir
 ) const
 {
-    items[idx++].set (kmer_from, strand_from, kmer_to, strand_to, nt, dir);
+    items[idx].set (kmer_from, strand_from, kmer_to, strand_to, nt, dir);
+    items[idx].to.mphfIndex = index_to;
 }};
 
 /* TODO: so in principle, when Node is a NodeFast, we should be able to call the getItems_visitor 
@@ -1276,11 +1295,13 @@ struct Functor_getNodes {  void operator() (
     kmer::Strand         strand_from,
     const typename Node::Value&   kmer_to,
     kmer::Strand         strand_to,
+    u_int64_t            index_to,
     kmer::Nucleotide     nt,
     Direction            dir
 ) const
 {
-    items[idx++].set (kmer_to, strand_to);
+    items[idx].set (kmer_to, strand_to);
+    items[idx].mphfIndex = index_to;
 }};
 
 template<typename Node, typename GraphDataVariant>
@@ -1342,73 +1363,11 @@ struct countNeighbors_visitor : public visitor_base<void>    {
 
         /* else, run classical neighbor queries using the data.contains() operation (bloom filters behind the scenes) */
 
-        /** Shortcut. */
-        typedef typename Kmer<span>::Type Type;
-
-        /** We get the specific typed value from the generic typed value. */
-        Type sourceVal = source.template getKmer<Type>();
-
-        /** Shortcuts. */
-        size_t      kmerSize = data._model->getKmerSize();
-        const Type& mask     = data._model->getKmerMax();
-
-
-        /* the kmer we're extending may be actually a revcomp sequence in the bidirected debruijn graph node */
-        Type graine = ((source.strand == STRAND_FORWARD) ?  sourceVal :  revcomp (sourceVal, kmerSize) );
-        /* TODO opt: in some cases we may skip computing graine, e.g. whenever there are no neighbors */
-
-
-        if (direction & DIR_OUTCOMING)
-        {
-            for (u_int64_t nt=0; nt<4; nt++)
-            {
-                Type forward = ( (graine << 2 )  + nt) & mask;
-                Type reverse = revcomp (forward, kmerSize);
-
-                if (forward < reverse)
-                {
-                    if (data.contains (forward))
-                    {
-                        outdegree++;
-                    }
-                }
-                else
-                {
-                    if (data.contains (reverse))
-                    {
-                        outdegree++;
-                    }
-                }
-            }
-        }
+        unsigned char neighbors;
+        getNeighborsMasks<span> (data, &source, 1, direction, false, &neighbors);
 
-        if (direction & DIR_INCOMING)
-        {
-            /** IMPORTANT !!! Since we have hugely shift the nt value, we make sure to use a long enough integer. */
-            for (u_int64_t nt=0; nt<4; nt++)
-            {
-                Type single_nt;
-                single_nt.setVal(nt);
-                single_nt <<=  ((kmerSize-1)*2);
-                Type forward = ((graine >> 2 )  + single_nt ) & mask; /* previous kmer */
-                Type reverse = revcomp (forward, kmerSize);
-
-                if (forward < reverse)
-                {
-                    if (data.contains (forward))
-                    {
-                        indegree++;
-                    }
-                }
-                else
-                {
-                    if (data.contains (reverse))
-                    {
-                        indegree++;
-                    }
-                }
-            }
-        }
+        outdegree = __builtin_popcount (neighbors & 0xF);
+        indegree  = __builtin_popcount (neighbors >> 4);
     }
 };
 
@@ -1431,6 +1390,54 @@ void GraphTemplate<Node, GraphDataVariant>::countNeighbors (Node &source, size_t
     visit_data(countNeighbors_visitor<Node, GraphDataVariant >(source, DIR_END, hasAdjacency, in, out));
 }
 
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS : batched version of getNodes/countNeighbors, see getNeighborsMasks
+*********************************************************************/
+template<typename Node, typename GraphDataVariant>
+struct neighborsMasks_visitor : public visitor_base<void>    {
+
+    std::vector<Node>& sources;  Direction direction;
+    bool hasAdjacency;
+    std::vector<unsigned char>& masks;
+
+    neighborsMasks_visitor (std::vector<Node>& aSources, Direction aDirection, bool hasAdjacency, std::vector<unsigned char>& masks)
+        : sources(aSources), direction(aDirection), hasAdjacency(hasAdjacency), masks(masks) {}
+
+    template<size_t span>  void operator() (const GraphData<span>& data) const
+    {
+        masks.resize (sources.size());
+        if (sources.empty())  { return; }
+
+        getNeighborsMasks<span> (data, sources.data(), sources.size(), direction, hasAdjacency, masks.data());
+    }
+};
+
+template<typename Node, typename GraphDataVariant>
+void GraphTemplate<Node, GraphDataVariant>::neighborsMasks (std::vector<Node>& nodes, std::vector<unsigned char>& masks, Direction direction)  const
+{
+    bool hasAdjacency = getState() & GraphTemplate<Node, GraphDataVariant>::STATE_ADJACENCY_DONE;
+    visit_data(neighborsMasks_visitor<Node, GraphDataVariant >(nodes, direction, hasAdjacency, masks));
+}
+
+template<typename Node, typename GraphDataVariant>
+void GraphTemplate<Node, GraphDataVariant>::degree (std::vector<Node>& nodes, std::vector<size_t>& in, std::vector<size_t>& out)  const
+{
+    std::vector<unsigned char> masks;
+    neighborsMasks (nodes, masks, DIR_END);
+
+    in.resize (nodes.size());  out.resize (nodes.size());
+    for (size_t i=0; i<masks.size(); i++)
+    {
+        out[i] = __builtin_popcount (masks[i] & 0xF);
+        in [i] = __builtin_popcount (masks[i] >> 4);
+    }
+}
+
 
 /*********************************************************************
 ** METHOD  :
@@ -1767,186 +1774,52 @@ struct getItem_visitor : public visitor_base<Item>    {
         typedef typename Kmer<span>::Type Type;
 
         Item item;
-        Item itemAdj;
-
-        /** We get the specific typed value from the generic typed value. */
-        const Type& sourceVal = source.template getKmer<Type>();
 
         /** Shortcuts. */
         size_t      kmerSize = data._model->getKmerSize();
         const Type& mask     = data._model->getKmerMax();
 
-        /* the kmer we're extending may be actually a revcomp sequence in the bidirected debruijn graph node */
-        Type graine = ((source.strand == STRAND_FORWARD) ?  sourceVal :  revcomp (sourceVal, kmerSize) );
-
-
         // this is basically the code in getItems_visitor without a loop on nt
-        bool debug = false;
+        unsigned char bitmask = 0;
+        u_int64_t     indexes[2] = { 0, 0 };
+
+        /* use adjacency information when available, because it's faster than bloom */
         if (hasAdjacency)
         {
             unsigned long hashIndex = getNodeIndex<span>(data, source);
-			if(hashIndex == ULLONG_MAX) {exists = false; return itemAdj;} // node was not found in the mphf 
-
-            unsigned char &value = (*(data._adjacency)).at(hashIndex);
+			if(hashIndex == ULLONG_MAX) {exists = false; return item;} // node was not found in the mphf 
 
-            bool forwardStrand = (source.strand == STRAND_FORWARD);
-
-            unsigned char bitmask;
+            bitmask = getAdjacencyMask ((*(data._adjacency)).at(hashIndex), source.strand);
 
-            if (direction & DIR_OUTCOMING)
+            /* within a simple path, the layout gives the index of the neighbor (it is then the only one in its direction) */
+            if (data._layout != nullptr)
             {
-                if (forwardStrand)
-                    bitmask = value & 0xF;
-                else
-                {
-                    bitmask = (value >> 4) & 0xF;
-
-                    /* also revcomp the nt's: instead of GTCA (high bits to low), make it CAGT */
-                    bitmask = ((bitmask & 3) << 2) | ((bitmask >> 2) & 3);
-                }
-
-                //std::cout << "getItems OUTCOMING: forward strand?" << forwardStrand << "; adjacency value: " << to_string((int)value) << " hashindex " << hashIndex << " dir " << direction << " bitmask " << (int)bitmask << std::endl;
-
-                if (bitmask & (1 << nt))
-                {
-                    typename Node::Value dest_value;
-                    Strand dest_strand = STRAND_FORWARD;
-                    Nucleotide dest_nt = (Nucleotide)nt;
-                    Type forward, reverse;
-                    Type single_nt; single_nt.setVal(nt);
-
-                    forward = ( (graine << 2 )  + single_nt ) & mask; /* for speedup's, there is much we could precompute here */
-                    reverse = revcomp (forward, kmerSize);
-
-                    if (forward < reverse)
-                        dest_value = forward;
-                    else
-                    {
-                        dest_value = reverse;
-                        dest_strand = STRAND_REVCOMP;
-                    }
-
-                    if (debug) std::cout << "getItem adj, found OUT " << (dest_strand==STRAND_REVCOMP ? "REV" : "FWD") << " nt=" << nt << std::endl;
-                    fct (item, source.kmer, source.strand, dest_value, dest_strand, dest_nt, DIR_OUTCOMING);
-                    exists = true;
-                }
-                else
-                    exists = false;
-            }
-
-            if (direction & DIR_INCOMING)
-            {
-                if (forwardStrand)
-                    bitmask = (value >> 4) & 0xF;
-                else
-                {
-                    bitmask = value & 0xF;
-
-                    /* also revcomp the nt's: instead of GTCA (high bits to low), make it CAGT */
-                    bitmask = ((bitmask & 3) << 2) | ((bitmask >> 2) & 3);
-                }
-
-                //std::cout << "getItems INCOMING: forward strand?" << forwardStrand << "; adjacency value: " << to_string((int)value) << " hashindex " << hashIndex << " dir " << direction << " bitmask " << (int)bitmask << std::endl;
-
-                if (bitmask & (1 << nt))
-                {
-                    typename Node::Value dest_value;
-                    Strand dest_strand = STRAND_FORWARD;
-                    Nucleotide dest_nt = (Nucleotide)nt;
-                    Type forward, reverse;
-                    Type single_nt; single_nt.setVal(nt);
-
-                    forward = ( (graine >> 2 )  + ( single_nt << ((kmerSize-1)*2)) ) & mask; /* previous kmer */
-                    reverse = revcomp (forward, kmerSize);
-
-                    if (forward < reverse)
-                        dest_value = forward;
-                    else
-                    {
-                        dest_value = reverse;
-                        dest_strand = STRAND_REVCOMP;
-                    }
-
-                    if (debug) std::cout << "getItem adj, found INC " << (dest_strand==STRAND_REVCOMP ? "REV" : "FWD") << " nt=" << nt << std::endl;
-                    fct (item, source.kmer, source.strand, dest_value, dest_strand, dest_nt, DIR_INCOMING);
-                    exists = true;
-                }
-                else
-                    exists = false;
+                indexes[0] = data._layout->neighbor (hashIndex, source.strand, DIR_OUTCOMING);
+                indexes[1] = data._layout->neighbor (hashIndex, source.strand, DIR_INCOMING);
             }
-
-            /** We return the result. */
-            return item;
         }
 
-        if (direction & DIR_OUTCOMING)
-        {
-            typename Node::Value dest_value;
-            Type forward = ( (graine << 2 )  + nt) & mask;
-            Type reverse = revcomp (forward, kmerSize);
+        Type          candidates[8];
+        unsigned char revcompMask;
 
-            if (forward < reverse)
-            {
-                if (data.contains (forward))
-                {
-                    dest_value = forward;
-                    fct (item, source.kmer, source.strand, dest_value, STRAND_FORWARD, (Nucleotide)nt, DIR_OUTCOMING);
-                    exists = true;
-                }
-                else
-                {
-                    exists = false;
-                }
-            }
-            else
-            {
-                if (data.contains (reverse))
-                {
-                    dest_value = reverse;
-                    fct (item, source.kmer, source.strand, dest_value, STRAND_REVCOMP, (Nucleotide)nt, DIR_OUTCOMING);
-                    exists = true;
-                }
-                else
-                {
-                    exists = false;
-                }
-            }
-        }
+        getNeighborsCandidates (source.template getKmer<Type>(), source.strand, kmerSize, mask, candidates, revcompMask);
 
-        if (direction & DIR_INCOMING)
+        /* successor through nt is candidate nt, predecessor through nt is candidate 4+nt */
+        for (size_t b=nt; b<8; b+=4)
         {
-            Type single_nt;
-            single_nt.setVal(nt);
-            single_nt <<= ((kmerSize-1)*2);
-            typename Node::Value dest_value;
-            Type forward = ((graine >> 2 )  + single_nt ) & mask; /* previous kmer */
-            Type reverse = revcomp (forward, kmerSize);
+            Direction dest_dir = b < 4 ? DIR_OUTCOMING : DIR_INCOMING;
+            if ((direction & dest_dir) == 0)  { continue; }
 
-            if (forward < reverse)
-            {
-                if (data.contains (forward))
-                {
-                    dest_value = forward;
-                    fct (item, source.kmer, source.strand, dest_value, STRAND_FORWARD, (Nucleotide)nt, DIR_INCOMING);
-                    exists = true;
-                }
-                else
-                {
-                    exists = false;
-                }
-            }
-            else
+            /* else, run classical neighbor queries using the data.contains() operation (bloom filters behind the scenes) */
+            exists = hasAdjacency ? (bitmask & (1 << b)) != 0 : data.contains (candidates[b]);
+
+            if (exists)
             {
-                if (data.contains (reverse))
-                {
-                    dest_value = reverse;
-                    fct (item, source.kmer, source.strand, dest_value, STRAND_REVCOMP, (Nucleotide)nt, DIR_INCOMING);
-                    exists = true;
-                }
-                else
-                {
-                    exists = false;
-                }
+                typename Node::Value dest_value;
+                dest_value = candidates[b];
+                Strand dest_strand = (revcompMask & (1 << b)) ? STRAND_REVCOMP : STRAND_FORWARD;
+
+                fct (item, source.kmer, source.strand, dest_value, dest_strand, indexes[b < 4 ? 0 : 1], (Nucleotide)nt, dest_dir);
             }
         }
 
@@ -1962,11 +1835,13 @@ struct Functor_getNode {  void operator() (
     kmer::Strand         strand_from,
     const typename Node::Value&   kmer_to,
     kmer::Strand         strand_to,
+    u_int64_t            index_to,
     kmer::Nucleotide     nt,
     Direction            dir
 ) const
 {
     item.set (kmer_to, strand_to);
+    item.mphfIndex = index_to;
 }};
 
 
@@ -3114,7 +2989,7 @@ unsigned long getNodeIndex (const GraphData<span>& data, Node_in& node)
 #endif
 
     // we use _abundance as the mphf. we could also use _nodestate but it might be null if disabled by disableNodeState()
-    unsigned long hashIndex = data._abundance->getCode(value);
+    unsigned long hashIndex = data.index (data._abundance->getCode(value));
 
     node.mphfIndex = hashIndex;
     
@@ -3205,20 +3080,22 @@ struct setNodeState_visitor : public visitor_base<int>    {
         unsigned long hashIndex = getNodeIndex<span>(data, node);
     	if(hashIndex == ULLONG_MAX) return 0; // node was not found in the mphf 
 
-        unsigned char &value = (*(data._nodestate)).at(hashIndex / 2);
+        unsigned char* value = &(*(data._nodestate)).at(hashIndex / 2);
 
-        int maskedState = state & 0xF;
+        unsigned char maskedState = state & 0xF;
 
-        if (hashIndex % 2 == 1)
-        {
-            value &= 0xF;
-            value |= (maskedState << 4);
-        }
-        else
+        /* the byte holds the states of two nodes, which may be set at the same time by other threads:
+         * the nibble of the node is replaced with a compare-and-swap, so that no update of the other nibble is lost */
+        unsigned char oldValue, newValue;
+        do
         {
-            value &= 0xF0;
-            value |= maskedState;
+            oldValue = *value;
+            if (hashIndex % 2 == 1)
+                newValue = (oldValue & 0xF)  | (maskedState << 4);
+            else
+                newValue = (oldValue & 0xF0) | maskedState;
         }
+        while (__sync_bool_compare_and_swap (value, oldValue, newValue) == false);
 
         return 0;
     }
@@ -3371,15 +3248,124 @@ struct allocateAdjacency_visitor : public visitor_base<void>    {
 };
 
 
+/* renumber the nodes: moves the abundance, state and adjacency information of each node from its
+ * index in the current layout to its index in the new one (null layouts mean the MPHF codes) */
+template<typename Node, typename GraphDataVariant>
+struct setLayout_visitor : public visitor_base<void>    {
+
+    NodeLayout* layout;
+
+    setLayout_visitor (NodeLayout* layout) : layout(layout) {}
+
+    template<size_t span> void operator() (GraphData<span>& data) const
+    {
+        if (data._layout == layout)  { return; }
+
+        u_int64_t nbNodes = data._abundance->size();
+
+        std::vector<u_int8_t> tmp (nbNodes);
+
+        /* index of the node of MPHF code 'code', in the current and in the new layout */
+        auto from = [&] (u_int64_t code)  {  return data._layout == nullptr ? code : data._layout->index(code);  };
+        auto to   = [&] (u_int64_t code)  {  return layout       == nullptr ? code : layout->index(code);        };
+
+        for (u_int64_t code=0; code<nbNodes; code++)  {  tmp[to(code)] = data._abundance->at(from(code));  }
+        for (u_int64_t i=0; i<nbNodes; i++)           {  data._abundance->at(i) = tmp[i];  }
+
+        /* the adjacency map shares the MPHF of the abundance map once allocated */
+        if (data._adjacency != nullptr && data._adjacency->size() == nbNodes)
+        {
+            for (u_int64_t code=0; code<nbNodes; code++)  {  tmp[to(code)] = data._adjacency->at(from(code));  }
+            for (u_int64_t i=0; i<nbNodes; i++)           {  data._adjacency->at(i) = tmp[i];  }
+        }
+
+        /* node states are 4 bits, two per byte */
+        if (data._nodestate != nullptr)
+        {
+            for (u_int64_t code=0; code<nbNodes; code++)
+            {
+                u_int64_t i = from(code);
+                tmp[to(code)] = (data._nodestate->at(i / 2) >> (4 * (i % 2))) & 0xF;
+            }
+            for (u_int64_t i=0; i<nbNodes; i+=2)
+            {
+                data._nodestate->at(i / 2) = tmp[i] | ((i+1 < nbNodes ? tmp[i+1] : 0) << 4);
+            }
+        }
+
+        data.setLayout (layout);
+    }
+};
+
+/* lay the nodes out along the simple paths of the graph: each path is walked from its first node,
+ * and its nodes get consecutive indexes. Requires the adjacency information (in MPHF order). */
+template<typename Node, typename GraphDataVariant>
+NodeLayout* GraphTemplate<Node, GraphDataVariant>::buildLayout (bool verbose)
+{
+    GraphIterator<Node> nodes = iterator();
+    u_int64_t nbNodes = nodes.size();
+
+    NodeLayout* layout = new NodeLayout (nbNodes);
+
+    /* visited[code]: the node got its index */
+    std::vector<bool> visited (nbNodes, false);
+    u_int64_t next = 0;
+
+    ProgressGraphIteratorTemplate<Node, ProgressTimerAndSystem> itNode (nodes, "laying out nodes", verbose);
+
+    for (itNode.first(); !itNode.isDone(); itNode.next())
+    {
+        Node start = itNode.item();
+        if (visited[nodeMPHFIndex(start)])  { continue; }
+
+        /* two nodes are consecutive in a simple path if each one is the only neighbor of the other
+         * (the adjacency of a deleted node may still list nodes that don't list it back) */
+        auto single = [&] (Node& from, Direction dir, Node& to)
+        {
+            GraphVector<Node> neighbors = this->neighbors (from, dir);
+            if (neighbors.size() != 1)  { return false; }
+            to = neighbors[0];
+            GraphVector<Node> back = this->neighbors (to, impl::reverse(dir));
+            return back.size() == 1 && back[0].kmer == from.kmer && back[0].strand == from.strand;
+        };
+
+        /* go back to the first node of the simple path (stop on a cycle) */
+        Node node = start, other;
+        while (single (node, DIR_INCOMING, other) && other.kmer != start.kmer && !visited[nodeMPHFIndex(other)])
+        {
+            node = other;
+        }
+
+        /* walk the path forward */
+        for (;;)
+        {
+            u_int64_t code = nodeMPHFIndex (node);
+            visited[code] = true;
+            layout->set (code, next++, node.strand);
+
+            if (!single (node, DIR_OUTCOMING, other) || visited[nodeMPHFIndex(other)])  { break; }
+
+            layout->link (next-1);
+            node = other;
+        }
+    }
+
+    if (next != nbNodes)
+    {
+        delete layout;
+        throw system::Exception ("Node layout covers %lld nodes out of %lld", next, nbNodes);
+    }
+
+    return layout;
+}
+
 /* precompute the graph adjacency information using the MPHF
  * this should be much faster than querying the bloom filter
  * also, maybe one day, it will replace it
  */
 template<typename Node, typename GraphDataVariant>
-void GraphTemplate<Node, GraphDataVariant>::precomputeAdjacency(unsigned int nbCores, bool verbose)
+void GraphTemplate<Node, GraphDataVariant>::precomputeAdjacency(unsigned int nbCores, bool verbose, tools::misc::AdjacencyKind kind)
 {
-    ProgressGraphIteratorTemplate<Node, ProgressTimerAndSystem> itNode (iterator(), "precomputing adjacency", verbose);
-    
     bool hasMPHF = getState() & GraphTemplate<Node, GraphDataVariant>::STATE_MPHF_DONE;
     if (!hasMPHF)
     {
@@ -3387,6 +3373,12 @@ void GraphTemplate<Node, GraphDataVariant>::precomputeAdjacency(unsigned int nbC
         return;
     }
 
+    /* the adjacency is computed in MPHF order: drop a previous layout */
+    visit_data(setLayout_visitor<Node, GraphDataVariant>(nullptr));
+    unsetState(GraphTemplate<Node, GraphDataVariant>::STATE_ADJACENCY_DONE);
+
+    ProgressGraphIteratorTemplate<Node, ProgressTimerAndSystem> itNode (iterator(), "precomputing adjacency", verbose);
+
     /* allocate the adjacency map */
     visit_data(allocateAdjacency_visitor<Node, GraphDataVariant>());
 
@@ -3403,24 +3395,24 @@ void GraphTemplate<Node, GraphDataVariant>::precomputeAdjacency(unsigned int nbC
             unsigned char &value = visit_data(getAdjacency_visitor<Node, GraphDataVariant>(node));
             value = 0;
 
-            // in both directions
-            for (Direction dir=DIR_OUTCOMING; dir<DIR_END; dir = (Direction)((int)dir + 1) )
+            // in both directions, all the candidates being probed at once
+            GraphVector<Edge> neighbors = this->neighborsEdge(node, DIR_END);
+            for (unsigned int i = 0; i < neighbors.size(); i++)
             {
-                GraphVector<Edge> neighbors = this->neighborsEdge(node, dir);
-                for (unsigned int i = 0; i < neighbors.size(); i++)
-                {
-                    u_int8_t bit = nt2bit[neighbors[i].nt];
-                    value |= bit << (dir == DIR_INCOMING ? 4 : 0);
-                    //std::cout << "setting bit " << (int)bit << " shifted " << ((int)bit << (dir == DIR_INCOMING ? 4 : 0)) << " for nt " << (int)(neighbors[i].nt) << std::endl;
-                }
-
-
-                //std::cout << "node " << this->toString(node) << " has " << neighbors.size() << " neighbors in direction " << (dir == DIR_INCOMING ? "incoming" : "outcoming") << " value is now " << (int)value <<  std::endl;
+                u_int8_t bit = nt2bit[neighbors[i].nt];
+                value |= bit << (neighbors[i].direction == DIR_INCOMING ? 4 : 0);
+                //std::cout << "setting bit " << (int)bit << " shifted " << ((int)bit << (neighbors[i].direction == DIR_INCOMING ? 4 : 0)) << " for nt " << (int)(neighbors[i].nt) << std::endl;
             }
             
     }); // end of parallel node iterate
 
     setState(GraphTemplate<Node, GraphDataVariant>::STATE_ADJACENCY_DONE);
+
+    if (kind == tools::misc::ADJACENCY_LOCALITY)
+    {
+        visit_data(setLayout_visitor<Node, GraphDataVariant>(buildLayout (verbose)));
+    }
+
     
     // do a sanity check, to see if adjacency information matches bloom information 
     bool adjSanityCheck = false;
@@ -3505,7 +3497,8 @@ void GraphTemplate<Node, GraphDataVariant>::deleteNode (Node& node)
                             std::cout << "Error while deleting node " <<  this->toString(node) << ": neighbor" << ((neighbor.strand==STRAND_REVCOMP) ? "(r)":"")<<" " << this->toString(neighbor) << " --(nt=" << nt << ")--> neigh_of_neigh"  << ((neigh_of_neigh.strand==STRAND_REVCOMP) ? "(r)":"")<< " " << this->toString(neigh_of_neigh) << " and dir :" << (dir == DIR_INCOMING ? "incoming": "outcoming") << ", value " << (int)value << std::endl;
                             exit(1);
                         }
-                        value ^= (bit << shift);
+                        // neighbors of other deleted nodes may be updated concurrently (see NodesDeleter)
+                        __sync_fetch_and_and (&value, (unsigned char) ~(bit << shift));
                         
                         deleted = true;
                     }
@@ -3594,8 +3587,9 @@ bool GraphTemplate<Node, GraphDataVariant>::debugCompareNeighborhoods(Node& node
 
 // TODO: it makes sense someday to introduce a graph._nbCore parameter, because this function, simplify() and precomputeAdjacency() all want it
 template<typename Node, typename GraphDataVariant>
-void GraphTemplate<Node, GraphDataVariant>::deleteNodesByIndex(vector<bool> &bitmap, int nbCores, gatb::core::system::ISynchronizer* synchro)
+void GraphTemplate<Node, GraphDataVariant>::deleteNodesByIndex(const vector<u_int64_t> &bitmap, int nbCores, gatb::core::system::ISynchronizer* synchro)
 {
+    bool cacheNonSimpleNodes = getState() & GraphTemplate<Node, GraphDataVariant>::STATE_NONSIMPLE_CACHE;
     GraphIterator<Node> itNode = this->iterator();
     Dispatcher dispatcher (nbCores); 
 
@@ -3603,15 +3597,15 @@ void GraphTemplate<Node, GraphDataVariant>::deleteNodesByIndex(vector<bool> &bit
 
         unsigned long i = this->nodeMPHFIndex(node); 
 
-        if (bitmap[i])
+        if ((bitmap[i / 64] >> (i % 64)) & 1)
         {
-            // make this deletion atomic with respect to other node deletions
-            if (synchro)
+            // node states and adjacency are updated atomically by deleteNode; only the cache of non-simple nodes is not thread-safe
+            if (synchro && cacheNonSimpleNodes)
                 synchro->lock();
 
             this->deleteNode(node);
 
-            if (synchro)
+            if (synchro && cacheNonSimpleNodes)
                 synchro->unlock();
         }
     }); // end of parallel node iteration
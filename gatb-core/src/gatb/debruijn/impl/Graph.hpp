@@ -29,6 +29,8 @@
 /********************************************************************************/
 #include <vector>
 #include <set>
+#include <algorithm>
+#include <limits>
 
 #include <unordered_map>
 
@@ -515,6 +517,8 @@ template<typename ResultType=void> struct visitor_base {};
 template<size_t span=KMER_DEFAULT_SPAN>
 struct GraphData;
 
+class NodeLayout;
+
 class GraphBase {
 public:
     GraphBase(const std::string& name="") : _name(name) {};
@@ -970,6 +974,21 @@ public:
      * takes advantage of adjacency
      */
     void degree    (Node& node, size_t& in, size_t &out) const;
+
+    /** Get the neighbors of several nodes in a single call, as masks of transition nucleotides:
+     * bit nt (0..3) is set when the successor through nt exists, bit 4+nt when the predecessor
+     * through nt exists. The Bloom and MPHF probes of all the nodes are interleaved, which hides
+     * most of the memory latency when many nodes have to be looked at.
+     * \param[in] nodes : the source nodes
+     * \param[out] masks : the neighbors mask of each node (resized to nodes.size())
+     * \param[in] dir : direction of the neighbors to look for; bits of the other direction are 0 */
+    void neighborsMasks (std::vector<Node>& nodes, std::vector<unsigned char>& masks, Direction dir=DIR_END) const;
+
+    /** Get the in and out degrees of several nodes in a single call (see neighborsMasks).
+     * \param[in] nodes : the nodes
+     * \param[out] in : indegree of each node
+     * \param[out] out : outdegree of each node */
+    void degree    (std::vector<Node>& nodes, std::vector<size_t>& in, std::vector<size_t>& out) const;
     
     /**********************************************************************/
     /*                      SIMPLIFICATION METHODS                        */
@@ -1086,13 +1105,19 @@ public:
      * \param[in] node : the node or a node index (unsigned long) from the MPHF
      * \return the abundance */
     int queryNodeState (Node& node) const;
+    /** Set the state of a node. The state is updated atomically, so several threads may set node states concurrently.
+     * \param[in] node : the node
+     * \param[in] state : the new state (4 bits) */
     void setNodeState (Node& node, int state);
     void resetNodeState () ;
     void disableNodeState () ; // see Graph.cpp for explanation
 
     // deleted nodes, related to NodeState above
+    // deleteNode updates the node states and the adjacency atomically; it may be called from several threads at once,
+    // provided the non-simple nodes cache (STATE_NONSIMPLE_CACHE) is not maintained or is protected by a lock.
     void deleteNode (Node& node);
-    void deleteNodesByIndex(std::vector<bool> &bitmap, int nbCores = 1, system::ISynchronizer* synchro=NULL);
+    // bitmap has one bit per MPHF index (bit i%64 of word i/64); synchro is only used when the non-simple nodes are cached
+    void deleteNodesByIndex(const std::vector<u_int64_t> &bitmap, int nbCores = 1, system::ISynchronizer* synchro=NULL);
     bool isNodeDeleted(Node& node) const;
 
     // a direct query to the MPHF data strcuture
@@ -1187,9 +1212,13 @@ public:
      * \return the reverted edge. */
     Edge reverse (const Edge& edge) const;
 
-    /** cache adjacency information from the Bloom filter to an array, 8 bits per node, for faster traversal queries*/
-    void precomputeAdjacency(unsigned int nbCores = 1, bool verbose = true);
+    /** cache adjacency information from the Bloom filter to an array, 8 bits per node, for faster traversal queries.
+     * With the ADJACENCY_LOCALITY kind, the nodes are also renumbered so that the nodes of a simple path
+     * have consecutive indexes (see NodeLayout); nodeMPHFIndex then returns these indexes, and Node objects
+     * obtained before the call must not be used with their cached index. */
+    void precomputeAdjacency(unsigned int nbCores = 1, bool verbose = true, tools::misc::AdjacencyKind kind = tools::misc::ADJACENCY_MPHF);
     unsigned int nt2bit[256]; 
+    NodeLayout* buildLayout (bool verbose); // lays the nodes out along the simple paths, see precomputeAdjacency
     bool debugCompareNeighborhoods(Node& node, Direction dir, std::string prefix) const; // debug
 
 
@@ -1279,6 +1308,71 @@ class NodeHasher
 
 /********************************************************************************/
 
+/** \brief Locality-preserving renumbering of the nodes of the graph
+ *
+ * The MPHF spreads the nodes uniformly on [0..N-1], so the adjacency information of a node and
+ * the one of its neighbors land on unrelated cache lines. NodeLayout renumbers the nodes so that
+ * the nodes of a simple path get consecutive indexes, in the order of the path: the information
+ * of a node and of its successors then share cache lines, and the index of the next node of a
+ * simple path is known from the index of the current one, without any MPHF query.
+ *
+ * The path order is recorded by two bits per index: whether the node at index i+1 follows the
+ * node at index i in the path, and on which strand the node was read when the path was laid out.
+ *
+ * See Graph::precomputeAdjacency with the ADJACENCY_LOCALITY kind.
+ */
+class NodeLayout : public system::SmartPointer
+{
+public:
+
+    /** Constructor.
+     * \param[in] nbNodes : number of nodes of the graph */
+    NodeLayout (u_int64_t nbNodes) : _index(nbNodes), _links(nbNodes, 0)
+    {
+        if (nbNodes > (u_int64_t)std::numeric_limits<u_int32_t>::max())
+            throw system::Exception ("Node layout supports up to %u nodes (%lld given)", std::numeric_limits<u_int32_t>::max(), nbNodes);
+    }
+
+    /** Get the index of a node from its MPHF code. */
+    u_int64_t index (u_int64_t code) const  {  return _index[code];  }
+
+    /** Set the index of a node, and the strand it was read on when laid out. */
+    void set (u_int64_t code, u_int64_t index, kmer::Strand strand)
+    {
+        _index[code] = index;
+        if (strand == kmer::STRAND_REVCOMP)  { _links[index] |= LINK_REVCOMP; }
+    }
+
+    /** Record that the node at index+1 follows the node at index in a simple path. */
+    void link (u_int64_t index)  {  _links[index] |= LINK_NEXT;  }
+
+    /** Get the index of the neighbor of a node in a direction, when it is known from the layout.
+     * \param[in] index : index of the node
+     * \param[in] strand : strand of the node
+     * \param[in] dir : direction of the neighbor
+     * \return the index of the neighbor, 0 if the layout doesn't tell (as for Node::mphfIndex). */
+    u_int64_t neighbor (u_int64_t index, kmer::Strand strand, Direction dir) const
+    {
+        /* the path is laid out forward if the node is read on its layout strand and we look at its successors */
+        bool forward = ((strand == kmer::STRAND_REVCOMP) == ((_links[index] & LINK_REVCOMP) != 0)) == (dir == DIR_OUTCOMING);
+
+        if (forward)  {  return (_links[index] & LINK_NEXT) ? index+1 : 0;  }
+        else          {  return (index > 0 && (_links[index-1] & LINK_NEXT)) ? index-1 : 0;  }
+    }
+
+    /** Get the number of nodes. */
+    u_int64_t size () const  {  return _index.size();  }
+
+private:
+
+    enum { LINK_NEXT = 1, LINK_REVCOMP = 2 };
+
+    std::vector<u_int32_t> _index;
+    std::vector<u_int8_t>  _links;
+};
+
+/********************************************************************************/
+
 
 
 /* We define a structure that holds all the necessary stuff for implementing the graph API.
@@ -1312,6 +1406,7 @@ struct GraphData
         setAbundance (0);
         setNodeState (0);
         setAdjacency (0);
+        setLayout    (0);
         setNodeCache (0);
     }
 
@@ -1330,6 +1425,7 @@ struct GraphData
             setAbundance (d._abundance);
             setNodeState (d._nodestate);
             setAdjacency (d._adjacency);
+            setLayout    (d._layout);
             setNodeCache (d._nodecache);
         }
         return *this;
@@ -1351,6 +1447,7 @@ struct GraphData
             std::swap(_abundance, d._abundance);
             std::swap(_nodestate, d._nodestate);
             std::swap(_adjacency, d._adjacency);
+            std::swap(_layout, d._layout);
             std::swap(_nodecache, d._nodecache);
         }
         return *this;
@@ -1364,6 +1461,7 @@ struct GraphData
     AbundanceMap*         _abundance = nullptr;
     NodeStateMap*         _nodestate = nullptr;
     AdjacencyMap*         _adjacency = nullptr;
+    NodeLayout*           _layout = nullptr; // renumbering of the nodes, null when the MPHF codes are used directly
     NodeCacheMap*         _nodecache = nullptr; // so, nodecache also records branching node, but also more stuff. i'm keeping _branching for historical reasons.
 
     /** Setters. */
@@ -1374,6 +1472,10 @@ struct GraphData
     void setAbundance   (AbundanceMap*          abundance)  { SP_SETATTR (abundance); }
     void setNodeState   (NodeStateMap*          nodestate)  { SP_SETATTR (nodestate); }
     void setAdjacency   (AdjacencyMap*          adjacency)  { SP_SETATTR (adjacency); }
+    void setLayout      (NodeLayout*            layout)     { SP_SETATTR (layout);    }
+
+    /** Get the index of a node in the abundance, state and adjacency arrays from its MPHF code. */
+    unsigned long index (unsigned long code)  const  {  return (_layout == nullptr || code == ULLONG_MAX) ? code : _layout->index (code);  }
     void setNodeCache   (NodeCacheMap*          nodecache)  { _nodecache = nodecache; /* would like to do "SP_SETATTR (nodecache)" but nodecache is an unordered_map, not some type that derives from a smartpointer. so one day, address this. I'm not sure if it's important though. Anyway I'm phasing out NodeCache in favor of GraphUnitigs. */; }
 
     /** Shortcut. */
@@ -1389,7 +1491,7 @@ struct GraphData
         // NOTE: this does a MPHF query for each bloom contains that answer true. costly!
         if (_nodestate != NULL)
         {
-            unsigned long hashIndex = ((_nodestate))->getCode(item);
+            unsigned long hashIndex = index (((_nodestate))->getCode(item));
 			if(hashIndex == ULLONG_MAX) return false;
             unsigned char value = ((_nodestate))->at(hashIndex / 2);
             if ((hashIndex % 2) == 1)
@@ -1402,6 +1504,50 @@ struct GraphData
         return true;
     }
 
+    /** Batched version of contains: tells for each of the nb items whether it is in the graph.
+     * The Bloom blocks of all the items are prefetched before any of them is tested, then the MPHF
+     * buckets and node states of the items found in the Bloom filter, so the memory latencies overlap.
+     * \param[in] items : the items to look for
+     * \param[in] nb : number of items
+     * \param[out] found : presence of each item */
+    void contains (const Type* items, size_t nb, bool* found)  const
+    {
+        for (size_t i=0; i<nb; i++)  {  _container->prefetch (items[i]);  }
+        for (size_t i=0; i<nb; i++)  {  found[i] = _container->contains (items[i]);  }
+
+        if (_nodestate == NULL)  { return; }
+
+        unsigned long codes[NEIGHBORS_BATCH_SIZE];
+
+        for (size_t j=0; j<nb; j+=NEIGHBORS_BATCH_SIZE)
+        {
+            size_t n = std::min (nb-j, (size_t)NEIGHBORS_BATCH_SIZE);
+
+            for (size_t i=0; i<n; i++)  {  if (found[j+i])  { _nodestate->prefetchCode (items[j+i]); }  }
+
+            for (size_t i=0; i<n; i++)
+            {
+                if (!found[j+i])  { continue; }
+                codes[i] = index (_nodestate->getCode (items[j+i]));
+                if (codes[i] != ULLONG_MAX)  {  __builtin_prefetch (&_nodestate->at (codes[i] / 2), 0, 3);  }
+            }
+
+            for (size_t i=0; i<n; i++)
+            {
+                if (!found[j+i])  { continue; }
+                if (codes[i] == ULLONG_MAX)  { found[j+i] = false;  continue; }
+                unsigned char value = _nodestate->at (codes[i] / 2);
+                if ((codes[i] % 2) == 1)
+                    value >>= 4;
+                if (((value >> 1) & 1) == 1)
+                    found[j+i] = false;
+            }
+        }
+    }
+
+    /** Number of items whose MPHF lookups are interleaved by the batched contains. */
+    static const size_t NEIGHBORS_BATCH_SIZE = 64;
+
     // Simulate Visitable when there is no variant wrapper
     template<typename F> auto apply_visitor(F&& f) -> decltype(f(*this)) { return f(*this); }
     template<typename F> auto apply_visitor(F&& f) const -> decltype(f(*this)) { return f(*this); }
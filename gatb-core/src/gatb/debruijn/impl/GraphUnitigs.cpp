@@ -51,6 +51,13 @@
 #include <cctype>
 #include <locale>
 
+// for the binary unitigs file
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 using namespace std;
 
 using namespace gatb::core::system::impl;
@@ -239,6 +246,62 @@ static inline string revcomp (const string &s) {
 	return rc;
 }
 
+/* binary unitigs file: an image of the structures filled by load_unitigs, so that the FASTA headers don't have to be parsed again.
+ * Layout, all sections starting on 8-byte boundaries:
+ *     UnitigsBinaryHeader
+ *     incoming, outcoming                     (uint64_t, mapped in place)
+ *     unitigs_sizes, unitigs_mean_abundance   (uint32_t and float, one per unitig, copied)
+ *     packed_unitigs                          (2-bit packed nucleotides, mapped in place)
+ *     dag_incoming_map, dag_outcoming_map, packed_unitigs_sizes (dag_vector::save format, copied)
+ * The size and modification time of the unitigs FASTA file are recorded, so that a binary file is only used with the FASTA it was made from.
+ */
+static const char     unitigs_binary_magic[8] = {'G','A','T','B','U','T','G','S'};
+static const uint64_t unitigs_binary_version  = 1;
+
+struct UnitigsBinaryHeader
+{
+    char     magic[8];
+    uint64_t version;
+    uint64_t file_size;
+    uint64_t kmer_size;
+    uint64_t fasta_size, fasta_mtime_sec, fasta_mtime_nsec;
+    uint64_t nb_unitigs, nb_unitigs_extremities;
+    uint64_t incoming_size, outcoming_size;
+    uint64_t packed_unitigs_size;
+};
+
+struct UnitigsMapping
+{
+    UnitigsMapping (void* addr, size_t length) : addr(addr), length(length), packed_unitigs(0), incoming(0), outcoming(0), incoming_size(0), outcoming_size(0) {}
+    ~UnitigsMapping ()  { munmap (addr, length); }
+
+    void*           addr;
+    size_t          length;
+    const char*     packed_unitigs;
+    const uint64_t* incoming;
+    const uint64_t* outcoming;
+    uint64_t        incoming_size, outcoming_size;
+};
+
+static inline uint64_t unitigs_binary_align (uint64_t n)  { return (n + 7) & ~(uint64_t)7; }
+
+static inline void unitigs_fasta_mtime (const struct stat& st, uint64_t& sec, uint64_t& nsec)
+{
+#ifdef __APPLE__
+    sec = st.st_mtimespec.tv_sec;  nsec = st.st_mtimespec.tv_nsec;
+#else
+    sec = st.st_mtim.tv_sec;       nsec = st.st_mtim.tv_nsec;
+#endif
+}
+
+static inline string unitigs_binary_filename (const string& unitigs_filename)
+{
+    string suffix = ".fa";
+    if (unitigs_filename.size() > suffix.size() && unitigs_filename.compare(unitigs_filename.size() - suffix.size(), suffix.size(), suffix) == 0)
+        return unitigs_filename.substr(0, unitigs_filename.size() - suffix.size()) + ".bin";
+    return unitigs_filename + ".bin";
+}
+
 template<size_t span>
 void GraphUnitigsTemplate<span>::build_unitigs_postsolid(std::string unitigs_filename, tools::misc::IProperties* props)
 {
@@ -284,6 +347,11 @@ void GraphUnitigsTemplate<span>::build_unitigs_postsolid(std::string unitigs_fil
     
         nb_unitigs = unitigs_algo.nb_unitigs;
         BaseGraph::getGroup().setProperty ("nb_unitigs",     Stringify::format("%d", nb_unitigs));
+
+        // the unitigs file was rewritten, a binary image made from the previous one is stale
+        string binary_filename = unitigs_binary_filename(unitigs_filename);
+        if (System::file().doesExist(binary_filename))
+            System::file().remove(binary_filename);
         
         setState(STATE_BCALM2_DONE);
     }
@@ -407,22 +475,22 @@ class range {
     Iter end() { return e; }
 };
 
-template <class Container>
-static inline range<typename Container::const_iterator>
-make_range(Container& c, size_t b, size_t e) {
-    return range<typename Container::const_iterator> (c.begin()+b, c.begin()+e);
+// navigational vectors are either in std::vector's or in a mapped binary unitigs file, so they are accessed through plain pointers
+static inline range<const uint64_t*>
+make_range(const uint64_t* v, size_t b, size_t e) {
+    return range<const uint64_t*> (v+b, v+e);
 }
 
 
 /* returns an iterator of all incoming or outcoming edges from an unitig */
 static inline
-range<std::vector<uint64_t>::const_iterator >
-get_from_navigational_vector(const std::vector<uint64_t> &v, uint64_t utig, const std::vector<uint64_t> &v_map) 
+range<const uint64_t*>
+get_from_navigational_vector(const uint64_t* v, uint64_t v_size, uint64_t utig, const std::vector<uint64_t> &v_map) 
 {
     if (utig == v_map.size() /*total number of unitigs*/ - 1)
     {
         //std::cout << "get from nav vector " << to_string(utig) << " " << to_string(v_map[utig]) << " " <<  to_string(v.size()) << " last unitig" << std::endl;
-        return make_range(v,v_map[utig],v.size());
+        return make_range(v,v_map[utig],v_size);
     }
     else
     {
@@ -434,13 +502,13 @@ get_from_navigational_vector(const std::vector<uint64_t> &v, uint64_t utig, cons
 
 /* compressed counterpart of the function above */
 static inline
-range<std::vector<uint64_t>::const_iterator >
-get_from_compressed_navigational_vector(const std::vector<uint64_t> &v, uint64_t utig, const dag::dag_vector &v_map) 
+range<const uint64_t*>
+get_from_compressed_navigational_vector(const uint64_t* v, uint64_t v_size, uint64_t utig, const dag::dag_vector &v_map) 
 {
     if (utig == v_map.size() /*total number of unitigs*/ - 1)
     {
         //std::cout << "get from nav vector " << to_string(utig) << " " << to_string(v_map[utig]) << " " <<  to_string(v.size()) << " last unitig" << std::endl;
-        return make_range(v,v_map.prefix_sum(utig),v.size());
+        return make_range(v,v_map.prefix_sum(utig),v_size);
     }
     else
     {
@@ -526,6 +594,17 @@ void GraphUnitigsTemplate<span>::load_unitigs(string unitigs_filename)
     compress_navigational_vectors = true; //only a 10% speed hit but 2x less incoming/outcoming/incoming_map/outcoming_map memory usage, so, quite worth it.
     pack_unitigs = true;
 
+    if (load_unitigs_binary(unitigs_filename))
+    {
+        unitigs_traversed.resize(0);
+        unitigs_traversed.resize(nb_unitigs, false);
+        unitigs_deleted.resize(0);
+        unitigs_deleted.resize(nb_unitigs, false);
+        if (verbose)
+            std::cout << "mapped " << nb_unitigs << " unitigs from " << unitigs_binary_filename(unitigs_filename) << std::endl;
+        return;
+    }
+
     nb_unitigs_extremities = 0; // will be used by NodeIterator (getNodes)
     uint64_t nb_utigs_nucl = 0;
     uint64_t nb_utigs_nucl_mem = 0;
@@ -594,6 +673,147 @@ void GraphUnitigsTemplate<span>::load_unitigs(string unitigs_filename)
     // an estimation of memory usage
     if (verbose)
         print_unitigs_mem_stats(incoming_size, outcoming_size, total_unitigs_size, nb_utigs_nucl, nb_utigs_nucl_mem);
+
+    save_unitigs_binary(unitigs_filename);
+}
+
+/* writes the binary unitigs file next to the FASTA one (see UnitigsBinaryHeader for the layout).
+ * it's written under a temporary name then renamed, so that concurrent loaders never map a partial file.
+ * failing to write it (e.g. read-only directory) is not an error, the FASTA will just be parsed again next time */
+template<size_t span>
+void GraphUnitigsTemplate<span>::save_unitigs_binary(string unitigs_filename) const
+{
+    struct stat fasta_st;
+    if (stat (unitigs_filename.c_str(), &fasta_st) != 0)
+        return;
+
+    string binary_filename = unitigs_binary_filename(unitigs_filename);
+    string tmp_filename = Stringify::format ("%s.%d", binary_filename.c_str(), (int)getpid());
+
+    UnitigsBinaryHeader header;
+    memset (&header, 0, sizeof(header));
+    memcpy (header.magic, unitigs_binary_magic, sizeof(header.magic));
+    header.version                = unitigs_binary_version;
+    header.kmer_size              = BaseGraph::_kmerSize;
+    header.fasta_size             = fasta_st.st_size;
+    unitigs_fasta_mtime (fasta_st, header.fasta_mtime_sec, header.fasta_mtime_nsec);
+    header.nb_unitigs             = nb_unitigs;
+    header.nb_unitigs_extremities = nb_unitigs_extremities;
+    header.incoming_size          = incoming.size();
+    header.outcoming_size         = outcoming.size();
+    header.packed_unitigs_size    = packed_unitigs.size();
+
+    const char padding[8] = {0,0,0,0,0,0,0,0};
+    std::ofstream os (tmp_filename.c_str(), std::ios::binary);
+    os.write ((const char*)&header, sizeof(header)); // file_size is patched below
+    os.write ((const char*)incoming.data(),  incoming.size()  * sizeof(uint64_t));
+    os.write ((const char*)outcoming.data(), outcoming.size() * sizeof(uint64_t));
+    os.write ((const char*)unitigs_sizes.data(), nb_unitigs * sizeof(uint32_t));
+    os.write (padding, unitigs_binary_align(nb_unitigs * sizeof(uint32_t)) - nb_unitigs * sizeof(uint32_t));
+    os.write ((const char*)unitigs_mean_abundance.data(), nb_unitigs * sizeof(float));
+    os.write (padding, unitigs_binary_align(nb_unitigs * sizeof(float)) - nb_unitigs * sizeof(float));
+    os.write (packed_unitigs.data(), packed_unitigs.size());
+    os.write (padding, unitigs_binary_align(packed_unitigs.size()) - packed_unitigs.size());
+    dag_incoming_map.save(os);
+    dag_outcoming_map.save(os);
+    packed_unitigs_sizes.save(os);
+
+    header.file_size = os.tellp();
+    os.seekp (0);
+    os.write ((const char*)&header, sizeof(header));
+    os.close();
+
+    if (!os || System::file().rename (tmp_filename, binary_filename) != 0)
+        System::file().remove (tmp_filename);
+}
+
+/* maps a binary unitigs file written by save_unitigs_binary, if there is one for that exact FASTA file.
+ * the packed unitigs and the navigational vectors stay in the (read-only, shared) mapping, the other structures are small and are copied */
+template<size_t span>
+bool GraphUnitigsTemplate<span>::load_unitigs_binary(string unitigs_filename)
+{
+    string binary_filename = unitigs_binary_filename(unitigs_filename);
+
+    struct stat fasta_st, binary_st;
+    if (stat (unitigs_filename.c_str(), &fasta_st) != 0 || stat (binary_filename.c_str(), &binary_st) != 0)
+        return false;
+    if ((uint64_t)binary_st.st_size < sizeof(UnitigsBinaryHeader))
+        return false;
+
+    int fd = open (binary_filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    void* addr = mmap (0, binary_st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (addr == MAP_FAILED)
+        return false;
+    std::shared_ptr<UnitigsMapping> mapping (new UnitigsMapping (addr, binary_st.st_size));
+
+    const UnitigsBinaryHeader& header = *(const UnitigsBinaryHeader*)addr;
+    uint64_t fasta_mtime_sec, fasta_mtime_nsec;
+    unitigs_fasta_mtime (fasta_st, fasta_mtime_sec, fasta_mtime_nsec);
+    if (memcmp (header.magic, unitigs_binary_magic, sizeof(header.magic)) != 0
+        || header.version          != unitigs_binary_version
+        || header.file_size        != (uint64_t)binary_st.st_size
+        || header.kmer_size        != BaseGraph::_kmerSize
+        || header.fasta_size       != (uint64_t)fasta_st.st_size
+        || header.fasta_mtime_sec  != fasta_mtime_sec
+        || header.fasta_mtime_nsec != fasta_mtime_nsec)
+        return false;
+
+    const char* p   = (const char*)addr + sizeof(header);
+    const char* end = (const char*)addr + header.file_size;
+
+    /* the sizes of the sections come from the file: each section is checked against the end of the mapping before being used.
+     * returns the start of a section of nb items and moves p past it (and past its padding), or 0 if it doesn't fit */
+    auto section = [&p, end] (uint64_t nb, uint64_t item_size) -> const char*
+    {
+        uint64_t left = end - p;
+        if (nb > left / item_size || unitigs_binary_align (nb * item_size) > left)
+            return 0;
+        const char* result = p;
+        p += unitigs_binary_align (nb * item_size);
+        return result;
+    };
+
+    const char* incoming_section  = section (header.incoming_size,  sizeof(uint64_t));
+    const char* outcoming_section = incoming_section  ? section (header.outcoming_size, sizeof(uint64_t)) : 0;
+    const char* sizes_section     = outcoming_section ? section (header.nb_unitigs,     sizeof(uint32_t)) : 0;
+    const char* abundance_section = sizes_section     ? section (header.nb_unitigs,     sizeof(float))    : 0;
+    const char* packed_section    = abundance_section ? section (header.packed_unitigs_size, 1)           : 0;
+
+    /* the dag vectors index the other sections: their sizes and sums must match them */
+    bool consistent = packed_section
+        && dag_incoming_map.load(p, end) && dag_outcoming_map.load(p, end) && packed_unitigs_sizes.load(p, end)
+        && dag_incoming_map.size()     == header.nb_unitigs && dag_incoming_map.sum()     == header.incoming_size
+        && dag_outcoming_map.size()    == header.nb_unitigs && dag_outcoming_map.sum()    == header.outcoming_size
+        && packed_unitigs_sizes.size() == header.nb_unitigs && packed_unitigs_sizes.sum() == header.packed_unitigs_size
+        && p == end;
+
+    if (consistent)
+    {
+        nb_unitigs             = header.nb_unitigs;
+        nb_unitigs_extremities = header.nb_unitigs_extremities;
+
+        mapping->incoming       = (const uint64_t*)incoming_section;
+        mapping->incoming_size  = header.incoming_size;
+        mapping->outcoming      = (const uint64_t*)outcoming_section;
+        mapping->outcoming_size = header.outcoming_size;
+        mapping->packed_unitigs = packed_section;
+
+        unitigs_sizes.assign ((const uint32_t*)sizes_section, (const uint32_t*)sizes_section + nb_unitigs);
+        unitigs_mean_abundance.assign ((const float*)abundance_section, (const float*)abundance_section + nb_unitigs);
+    }
+    else
+    {
+        std::cout << "warning: inconsistent binary unitigs file " << binary_filename << ", parsing " << unitigs_filename << " instead" << std::endl;
+        unitigs_sizes.clear();  unitigs_mean_abundance.clear();
+        dag_incoming_map = dag::dag_vector();  dag_outcoming_map = dag::dag_vector();  packed_unitigs_sizes = dag::dag_vector();
+        return false;
+    }
+
+    unitigs_mapping = mapping;
+    return true;
 }
 
 //https://stackoverflow.com/questions/216823/whats-the-best-way-to-trim-stdstring
@@ -1049,7 +1269,7 @@ GraphUnitigsBase::EdgeVector GraphUnitigsTemplate<span>::getEdges (const Node& s
     // otherwise, that extremity kmer has neighbors at are also extremities.
     // so, mutate to get all 4 outneighrs, and test for their existence in the utigs_map
     
-    auto functor = [&](range<std::vector<uint64_t>::const_iterator >&& edges, Direction dir)
+    auto functor = [&](range<const uint64_t*>&& edges, Direction dir)
     {
         auto it = edges.begin();
         if (it == edges.end()) return;
@@ -1094,19 +1314,23 @@ GraphUnitigsBase::EdgeVector GraphUnitigsTemplate<span>::getEdges (const Node& s
     {
         // nodes to the right of a unitig (outcoming)
         Direction dir = same_orientation?DIR_OUTCOMING:DIR_INCOMING;
+        const uint64_t* v      = unitigs_mapping ? unitigs_mapping->outcoming      : outcoming.data();
+        uint64_t        v_size = unitigs_mapping ? unitigs_mapping->outcoming_size : outcoming.size();
         if (compress_navigational_vectors) 
-            functor(get_from_compressed_navigational_vector(outcoming, source.unitig, dag_outcoming_map), dir);
+            functor(get_from_compressed_navigational_vector(v, v_size, source.unitig, dag_outcoming_map), dir);
         else
-            functor(get_from_navigational_vector(outcoming, source.unitig, outcoming_map), dir);
+            functor(get_from_navigational_vector(v, v_size, source.unitig, outcoming_map), dir);
     }
     if (pos_begin && (((direction & DIR_INCOMING) && same_orientation) || ( (!same_orientation) && (direction & DIR_OUTCOMING)) ))
     {
         // nodes to the left of a unitig (incoming)
         Direction dir = same_orientation?DIR_INCOMING:DIR_OUTCOMING;
+        const uint64_t* v      = unitigs_mapping ? unitigs_mapping->incoming      : incoming.data();
+        uint64_t        v_size = unitigs_mapping ? unitigs_mapping->incoming_size : incoming.size();
         if (compress_navigational_vectors) 
-            functor(get_from_compressed_navigational_vector(incoming, source.unitig, dag_incoming_map), dir);
+            functor(get_from_compressed_navigational_vector(v, v_size, source.unitig, dag_incoming_map), dir);
         else
-            functor(get_from_navigational_vector(incoming, source.unitig, incoming_map), dir);
+            functor(get_from_navigational_vector(v, v_size, source.unitig, incoming_map), dir);
     }
 
     // sanity check on output, due to limitation on GraphVector nmber of elements
@@ -1266,7 +1490,7 @@ void GraphUnitigsTemplate<span>::cacheNonSimpleNodes(unsigned int nbCores, bool
 }
  
 template<size_t span>
-void GraphUnitigsTemplate<span>::deleteNodesByIndex(vector<bool> &bitmap, int nbCores, gatb::core::system::ISynchronizer* synchro) const
+void GraphUnitigsTemplate<span>::deleteNodesByIndex(const vector<u_int64_t> &bitmap, int nbCores, gatb::core::system::ISynchronizer* synchro) const
 {
     std::cout << "deleteNodesByIndex called, shouldn't be." << std::endl; 
     exit(1);
@@ -1911,7 +2135,12 @@ template<size_t span>
 std::string GraphUnitigsTemplate<span>::internal_get_unitig_sequence(unsigned int id) const
 {
     std::string unitig_seq;
-    if (pack_unitigs)
+    if (unitigs_mapping)
+    {
+       uint64_t ps = (id == 0) ? 0 : packed_unitigs_sizes.prefix_sum(id);
+       unitig_seq.assign(unitigs_mapping->packed_unitigs + ps, (unitigs_sizes[id]+3)/4);
+    }
+    else if (pack_unitigs)
     {
        if (id == 0)
            unitig_seq = packed_unitigs.substr(0, packed_unitigs_sizes[0]);
@@ -23,6 +23,7 @@
 /********************************************************************************/
 #include <vector>
 #include <set>
+#include <memory>
 
 #include <gatb/debruijn/impl/Graph.hpp>
 #include <gatb/debruijn/impl/UnitigsConstructionAlgorithm.hpp>
@@ -41,7 +42,8 @@ namespace impl      {
 
 /********************************************************************************/
 
-
+/* read-only mapping of a binary unitigs file, see GraphUnitigsTemplate::save_unitigs_binary */
+struct UnitigsMapping;
 
 /********************************************************************************
                  #####   ######      #     ######   #     #
@@ -341,7 +343,7 @@ public:
     void setNodeState (const Node& node, int state) const;
     void resetNodeState () const ;
     void disableNodeState () const ;
-    void deleteNodesByIndex(std::vector<bool> &bitmap, int nbCores = 1, gatb::core::system::ISynchronizer* synchro=NULL) const;
+    void deleteNodesByIndex(const std::vector<u_int64_t> &bitmap, int nbCores = 1, gatb::core::system::ISynchronizer* synchro=NULL) const;
     unsigned long nodeMPHFIndex(const Node& node) const;
     void cacheNonSimpleNodes(unsigned int nbCores, bool verbose); 
 
@@ -422,6 +424,10 @@ protected:
     void build_unitigs_postsolid(std::string unitigs_filename, tools::misc::IProperties* props);
     void load_unitigs(std::string unitigs_filename);
 
+    // binary image of what load_unitigs computes, mmap'ed on subsequent loads of the same unitigs file
+    bool load_unitigs_binary(std::string unitigs_filename);
+    void save_unitigs_binary(std::string unitigs_filename) const;
+
     void load_unitigs_from_gfa(std::string gfa_filename, unsigned int& kmerSize);
     void print_unitigs_mem_stats(uint64_t avg_incoming_size, uint64_t avg_outcoming_size, uint64_t total_unitigs_size, uint64_t nb_utigs_nucl = 0, uint64_t nb_utigs_nucl_mem = 0);
 
@@ -450,6 +456,7 @@ protected:
     uint64_t nb_unitigs, nb_unitigs_extremities;
     bool compress_navigational_vectors;
     bool pack_unitigs;
+    std::shared_ptr<UnitigsMapping> unitigs_mapping; // when set, packed unitigs and incoming/outcoming are read from it instead of the vectors above
 };
 
 /********************************************************************************/
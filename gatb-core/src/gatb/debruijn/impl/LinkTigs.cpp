@@ -5,13 +5,18 @@
 #include <gatb/bank/impl/Banks.hpp>
 #include <gatb/bank/impl/BankHelpers.hpp>
 #include <gatb/bcalm2/logging.hpp>
+#include <gatb/bcalm2/ThreadPool.h>
 #include <gatb/debruijn/impl/ExtremityInfo.hpp>
 #include <gatb/debruijn/impl/LinkTigs.hpp>
 #include <gatb/kmer/impl/Model.hpp> // for revcomp_4NT
+#include <gatb/tools/collections/impl/BagPartition.hpp>
+#include <gatb/tools/collections/impl/IteratorFile.hpp>
+#include <gatb/tools/designpattern/impl/Command.hpp>
+#include <gatb/tools/math/RadixSort.hpp>
 
-#include <queue>
+#include <algorithm>
+#include <atomic>
 #include <string>
-#include <unordered_map>
 
 
 using namespace std;
@@ -22,6 +27,9 @@ using namespace gatb::core::debruijn::impl;
 using namespace gatb::core::kmer;
 using namespace gatb::core::kmer::impl;
 
+using namespace gatb::core::tools::collections;
+using namespace gatb::core::tools::collections::impl;
+using namespace gatb::core::tools::dp::impl;
 using namespace gatb::core::tools::misc;
 using namespace gatb::core::tools::misc::impl;
 using namespace gatb::core::system;
@@ -30,48 +38,295 @@ using namespace gatb::core::system::impl;
 namespace gatb { namespace core { namespace debruijn { namespace impl  {
 
     static constexpr int nb_passes = 8;
-    static void write_final_output(const string& unitigs_filename, bool verbose, BankFasta* out, uint64_t &nb_unitigs, bool renumber_unitigs);
-    static bool get_link_from_file(std::ifstream& input, std::string &link, uint64_t &unitig_id);
 
-/* this procedure finds the overlaps between unitigs, using a hash table of all extremity (k-1)-mers
+    /* an extremity of a unitig: rank of the unitig in the file, and packed ExtremityInfo (unitig id, rc, pos) */
+    struct ExtremityPayload
+    {
+        uint64_t index;
+        uint64_t packed;
+    };
+
+    template<typename Type>
+    struct ExtremityRecord
+    {
+        Type             kmer; // canonical (k-1)-mer
+        ExtremityPayload extremity;
+    };
+
+    /* a link from the extremity of the unitig of rank 'index' to the unitig of rank 'neighbor'.
+     * packed is ExtremityInfo(neighbor unitig id, rc flag of the link, extremity of the 'index' unitig) */
+    struct LinkRecord
+    {
+        uint64_t index;
+        uint64_t neighbor;
+        uint64_t packed;
+    };
+
+    template<size_t span>
+    uint64_t emit_extremities(const string& unitigs_filename, const int kmerSize, Dispatcher& dispatcher, BagFilePartition<ExtremityRecord<typename Kmer<span>::Type> >& extremities, ISynchronizer* synchro, const bool renumber_unitigs);
+
+    template<size_t span>
+    void link_unitigs_pass(const string unitigs_filename, bool verbose, const int pass, const int kmerSize, const int nb_threads, const uint64_t nb_unitigs, std::vector<BagCachePartition<LinkRecord>*>& links_caches);
+
+    static void write_final_output(const string& unitigs_filename, BankFasta* out, const int kmerSize, const int nb_threads, const uint64_t nb_unitigs, bool edge_km_representation, bool renumber_unitigs);
+
+/* this procedure finds the overlaps between unitigs, i.e. the unitigs extremities sharing the same (k-1)-mer.
  * I guess it's like AdjList in ABySS. It's also like contigs_to_fastg in MEGAHIT.
- * 
- * could be optimized by keeping edges during the BCALM step and tracking kmers in unitigs, but it's not the case for now, because would need to modify ograph 
  *
- * it uses the disk to store the links for extremities until they're merged into the final unitigs file. 
+ * could be optimized by keeping edges during the BCALM step and tracking kmers in unitigs, but it's not the case for now, because would need to modify ograph
  *
- * so the memory usage is just that of the hash tables that record kmers, not of the links
+ * it's an external sort-based join:
+ *  step 1: the threads parse the unitigs and write (canonical (k-1)-mer, unitig, extremity) records to disk, partitioned by (k-1)-mer hash
+ *  step 2: for each partition, the records are split by hash among the threads, radix-sorted by (k-1)-mer, and the links are
+ *          found by a linear scan of the equal (k-1)-mers. links are written to disk, partitioned by unitig rank
+ *  step 3: for each partition, the links are sorted by unitig, and merged with the unitigs file into the final output
+ *
+ * so the memory usage is that of the records of one partition (about 1/nb_passes of the extremities, or of the links)
  *
  *  Two modes of operation:
- *  
+ *
  *  renumber_unitigs == true: FASTA header can be anything. Useful for any program that has removed some unitigs, e.g. merci.
  *  LinkTigs will take the header and split it into space-separated fields, remove the first field and keep the remaining ones.
- *  The first field will be replaced by numbered IDs in consecutive order, between 0 and |nb_unitigs|-1. 
+ *  The first field will be replaced by numbered IDs in consecutive order, between 0 and |nb_unitigs|-1.
  *
- *  renumber_unitigs == false: then FASTA headers of unitigs _needs_ to start with a unique number (unitig ID). 
+ *  renumber_unitigs == false: then FASTA headers of unitigs _needs_ to start with a unique number (unitig ID).
  *  Normally bcalm outputs consecutive unitig ID's but LinkTigs can also work with non-consecutive, non-sorted IDs
  */
 template<size_t span>
 void link_tigs(string unitigs_filename, int kmerSize, int nb_threads, uint64_t &nb_unitigs, bool verbose,  bool edge_km_representation, bool renumber_unitigs)
 {
+    typedef typename kmer::impl::Kmer<span>::Type Type;
+
     bcalm_logging = verbose;
-    BankFasta* out = new BankFasta(unitigs_filename+".linked");
     if (kmerSize < 4) { std::cout << "error, link_unitigs doesn't support k<5, sorry. Contact a developer if you really need k<4 support (alternatively: construct that tiny dBG using Python :)" << std::endl; exit(1); }
     logging("Finding links between unitigs");
 
-    for (int pass = 0; pass < nb_passes; pass++)
-        link_unitigs_pass<span>(unitigs_filename, verbose, pass, kmerSize, edge_km_representation, renumber_unitigs );
+    Dispatcher dispatcher (nb_threads);
+    nb_threads = dispatcher.getExecutionUnitsNumber();
+
+    ISynchronizer* synchro = System::thread().newSynchronizer();
+    LOCAL (synchro);
+
+    {
+        BagFilePartition<ExtremityRecord<Type> > extremities (nb_passes, unitigs_filename + ".extremities.%lu");
+        nb_unitigs = emit_extremities<span>(unitigs_filename, kmerSize, dispatcher, extremities, synchro, renumber_unitigs);
+    }
+
+    logging("step 1 done (" + to_string(nb_unitigs) + " unitigs)");
+
+    {
+        BagFilePartition<LinkRecord> links (nb_passes, unitigs_filename + ".links.%lu");
+
+        std::vector<BagCachePartition<LinkRecord>*> links_caches (nb_threads);
+        for (int i = 0; i < nb_threads; i++)
+            links_caches[i] = new BagCachePartition<LinkRecord> (links, synchro);
 
-    write_final_output(unitigs_filename, verbose, out, nb_unitigs, renumber_unitigs);
-   
+        for (int pass = 0; pass < nb_passes; pass++)
+            link_unitigs_pass<span>(unitigs_filename, verbose, pass, kmerSize, nb_threads, nb_unitigs, links_caches);
+
+        for (int i = 0; i < nb_threads; i++)
+            delete links_caches[i];
+    }
+
+    BankFasta* out = new BankFasta(unitigs_filename+".linked");
+    write_final_output(unitigs_filename, out, kmerSize, nb_threads, nb_unitigs, edge_km_representation, renumber_unitigs);
     delete out;
-    system::impl::System::file().remove (unitigs_filename);
-    system::impl::System::file().rename (unitigs_filename+".linked", unitigs_filename);
+
+    // nothing is written (not even an empty file) when there are no unitigs; the input is then kept as it is
+    if (nb_unitigs > 0)
+    {
+        system::impl::System::file().remove (unitigs_filename);
+        system::impl::System::file().rename (unitigs_filename+".linked", unitigs_filename);
+    }
 
     logging("Done finding links between unitigs");
 }
 
 
+/* step 1: parses the unitigs (multi-threaded) and writes their extremities in the partition of their (k-1)-mer hash.
+ * returns the number of unitigs */
+template<size_t span>
+uint64_t emit_extremities(const string& unitigs_filename, const int kmerSize, Dispatcher& dispatcher, BagFilePartition<ExtremityRecord<typename Kmer<span>::Type> >& extremities, ISynchronizer* synchro, const bool renumber_unitigs)
+{
+    typedef typename kmer::impl::Kmer<span>::ModelCanonical Model;
+    typedef typename kmer::impl::Kmer<span>::Type           Type;
+
+    /* each thread has its own copy of the functor, hence its own cache of the partition files */
+    class EmitExtremities
+    {
+        int kmerSize;
+        bool renumber_unitigs;
+        Model modelKminusOne; // it's canonical (defined in the .hpp file)
+        BagCachePartition<ExtremityRecord<Type> > cache;
+        std::atomic<uint64_t> &nb_unitigs;
+
+        void emit(const char* kmerSeq, uint64_t index, uint64_t utig_id, Unitig_pos pos)
+        {
+            typename Model::Kmer kmer = modelKminusOne.codeSeed(kmerSeq, Data::ASCII);
+            bool inSameOrientation = kmer.value() == kmer.forward();
+
+            ExtremityRecord<Type> record;
+            record.kmer = kmer.value();
+            record.extremity.index  = index;
+            record.extremity.packed = ExtremityInfo(utig_id, !inSameOrientation /* because we record rc*/, pos).pack();
+
+            cache[oahash(record.kmer) % nb_passes]->insert(record);
+        }
+
+        public:
+        EmitExtremities(int kmerSize, bool renumber_unitigs, BagFilePartition<ExtremityRecord<Type> >& extremities, ISynchronizer* synchro, std::atomic<uint64_t> &nb_unitigs) :
+            kmerSize(kmerSize), renumber_unitigs(renumber_unitigs), modelKminusOne(kmerSize - 1), cache(extremities, synchro), nb_unitigs(nb_unitigs)
+        {}
+
+        void operator() (const Sequence& sequence)
+        {
+            const string seq = sequence.toString();
+            uint64_t index = sequence.getIndex();
+            uint64_t utig_id = index;
+
+            if (!renumber_unitigs)
+            {
+                const string& comment = sequence.getComment();
+                utig_id = std::stoul(comment.substr(0, comment.find(' ')));
+            }
+
+            emit(seq.c_str(),                            index, utig_id, UNITIG_BEGIN);
+            emit(seq.c_str() + seq.size() - kmerSize + 1, index, utig_id, UNITIG_END);
+            // there is no UNITIG_BOTH here because we're taking (k-1)-mers.
+
+            nb_unitigs++;
+        }
+    };
+
+    std::atomic<uint64_t> nb_unitigs(0);
+
+    BankFasta inputBank (unitigs_filename);
+    dispatcher.iterate (inputBank.iterator(), EmitExtremities(kmerSize, renumber_unitigs, extremities, synchro, nb_unitigs));
+
+    return nb_unitigs;
+}
+
+
+/* step 2, for one partition of the extremities: sorts them by (k-1)-mer and writes the links between the extremities
+ * sharing a (k-1)-mer, in the partition of the unitig rank (multi-threaded) */
+template<size_t span>
+void link_unitigs_pass(const string unitigs_filename, bool verbose, const int pass, const int kmerSize, const int nb_threads, const uint64_t nb_unitigs, std::vector<BagCachePartition<LinkRecord>*>& links_caches)
+{
+    typedef typename kmer::impl::Kmer<span>::Type Type;
+
+    bool debug = false;
+    uint64_t unitigs_per_partition = std::max((uint64_t)1, (nb_unitigs + nb_passes - 1) / nb_passes);
+
+    /* the records are distributed among the threads by (k-1)-mer hash, so that equal (k-1)-mers are sorted by the same thread */
+    std::vector<std::vector<Type> >             kmers (nb_threads);
+    std::vector<std::vector<ExtremityPayload> > extremities (nb_threads);
+
+    string extremities_filename = unitigs_filename + ".extremities." + to_string(pass);
+    {
+        IteratorFile<ExtremityRecord<Type> > file (extremities_filename);
+        for (file.first(); !file.isDone(); file.next())
+        {
+            const ExtremityRecord<Type>& record = file.item();
+            int thread = (oahash(record.kmer) / nb_passes) % nb_threads;
+            kmers[thread].push_back(record.kmer);
+            extremities[thread].push_back(record.extremity);
+        }
+    }
+    system::impl::System::file().remove (extremities_filename);
+
+    uint64_t nb_extremities = 0;
+    for (int i = 0; i < nb_threads; i++)
+        nb_extremities += kmers[i].size();
+
+    logging("step 2 pass " + to_string(pass) + " (" + to_string(nb_extremities) + " extremities)");
+
+    ThreadPool pool(nb_threads);
+
+    for (int i = 0; i < nb_threads; i++)
+    {
+        auto sort_and_link = [&, i] (int thread_id)
+        {
+            std::vector<Type>             &kmer = kmers[i];
+            std::vector<ExtremityPayload> &ext  = extremities[i];
+            BagCachePartition<LinkRecord> &links = *links_caches[thread_id];
+            size_t n = kmer.size();
+
+            tools::math::radixSort (kmer.data(), ext.data(), n);
+
+            for (size_t begin = 0, end = 0; begin < n; begin = end)
+            {
+                for (end = begin + 1; end < n && kmer[end] == kmer[begin]; end++) ;
+
+                // the neighbors are listed in the order of the unitigs file, beginning before end
+                std::sort(ext.begin() + begin, ext.begin() + end, [] (const ExtremityPayload& a, const ExtremityPayload& b)
+                        { return a.index < b.index || (a.index == b.index && (a.packed & 1) < (b.packed & 1)); });
+
+                // treat special palindromic kmer cases
+                bool nevermindOrientation = (((kmerSize - 1) % 2) == 0) && (revcomp(kmer[begin], kmerSize - 1) == kmer[begin]);
+
+                for (size_t x = begin; x < end; x++)
+                {
+                    ExtremityInfo e_cur(ext[x].packed);
+                    bool curInSameOrientation = !e_cur.rc;
+
+                    for (size_t y = begin; y < end; y++)
+                    {
+                        ExtremityInfo e_nb(ext[y].packed);
+
+                        if (debug) std::cout << "extremity " << e_cur.toString() << " potential neighbor: " << e_nb.toString();
+
+                        bool nbIsEndInSameOrientation = (e_nb.pos == UNITIG_END) ^ e_nb.rc;
+                        bool valid;
+
+                        if (e_cur.pos == UNITIG_BEGIN)
+                        {
+                            // in-neighbors, what we want are these four cases:
+                            //  ------[end same orientation] -> [begin same orientation]----
+                            //  [begin diff orientation]---- -> [begin same orientation]----
+                            //  ------[end diff orientation] -> [begin diff orientation]----
+                            //  [begin same orientation]---- -> [begin diff orientation]----
+                            valid = (curInSameOrientation == nbIsEndInSameOrientation);
+                        }
+                        else
+                        {
+                            // out-neighbors, what we want are these four cases:
+                            //  ------[end same orientation] -> [begin same orientation]----
+                            //  ------[end same orientation] -> ------[end diff orientation]
+                            //  ------[end diff orientation] -> [begin diff orientation]----
+                            //  ------[end diff orientation] -> ------[end same orientation]
+                            valid = (curInSameOrientation != nbIsEndInSameOrientation);
+                        }
+
+                        /* what to do when the (k-1)-mer is same as forward and reverse?
+                         there isn't anything to do actually, the reverse direction of the other sequence won't have the same
+                         extremity k-1-mer, even if it is just k-long. so any orientation is valid. */
+                        if (valid || nevermindOrientation)
+                        {
+                            bool rc = e_nb.pos == UNITIG_END; // a better way to determine the rc flag is just looking at position of the neighbor k-1-mer
+
+                            LinkRecord link;
+                            link.index    = ext[x].index;
+                            link.neighbor = ext[y].index;
+                            link.packed   = ExtremityInfo(e_nb.unitig, rc, e_cur.pos).pack();
+                            links[link.index / unitigs_per_partition]->insert(link);
+
+                            if (debug) std::cout << " [valid] ";
+                        }
+                        if (debug) std::cout << std::endl;
+                    }
+                }
+            }
+
+            std::vector<Type>().swap(kmer);
+            std::vector<ExtremityPayload>().swap(ext);
+        };
+        pool.enqueue(sort_and_link);
+    }
+
+    pool.join();
+}
+
+
 /* strip L:'s from a comment line*/
 static string remove_previous_links(string &header)
 {
@@ -103,108 +358,6 @@ static string strip_first_field(string &header)
     return header.substr(header.find(' ')+1);
 }
 
-
-/*
- * takes all the prefix.links.* files, sorted by unitigs.
- * do a n-way merge to gather the links for each unitig in unitig order
- * (single-threaded)
- */
-
-
-static void write_final_output(const string& unitigs_filename, bool verbose, BankFasta* out, uint64_t &nb_unitigs, bool renumber_unitigs)
-{
-    logging("gathering links from disk");
-    std::ifstream* inputLinks[nb_passes];
-
-    bitset<nb_passes> finished;
-    typedef std::tuple<uint64_t /*unitig id*/, int /*pass*/, std::string /*links */> pq_elt_t;
-    priority_queue<pq_elt_t, vector<pq_elt_t>, std::greater<pq_elt_t> > pq;
-    
-    BankFasta inputBank (unitigs_filename);
-    BankFasta::Iterator itSeq (inputBank);
-    itSeq.first(); 
-    string cur_links, seq, comment;
-    seq = itSeq->toString();
-    comment = itSeq->getComment();
-	comment = remove_previous_links(comment);
-
-    for (int pass = 0; pass < nb_passes; pass++)
-    {
-        string link; uint64_t unitig;
-        inputLinks[pass] = new std::ifstream(unitigs_filename+ ".links." + to_string(pass));
-        // prime the pq with the first element in the file
-        if (get_link_from_file(*inputLinks[pass], link, unitig))
-            pq.emplace(make_tuple(unitig, pass, link));
-        else
-            finished[pass] = true;
-    }
-
-    uint64_t last_unitig = 0;
-    nb_unitigs = 0; // passed variable
-    bool first_one = true;
-    if (renumber_unitigs) 
-        comment = to_string(nb_unitigs) + " " + strip_first_field(comment);
- 
-
-    // nb_passes-way merge sort
-    while ((!finished.all()) || pq.size() > 0)
-    {
-        pq_elt_t cur = pq.top(); pq.pop();
-        int pass = get<1>(cur);
-        uint64_t unitig = get<0>(cur);
-
-        if (first_one) // handles the case where first unitig isn't labeled 0
-        {
-            last_unitig = unitig;
-            first_one = false;
-        }
-
-        if (unitig != last_unitig)
-        {
-            Sequence s (Data::ASCII);
-            s.getData().setRef ((char*)seq.c_str(), seq.size());
-            s._comment = comment + " " + cur_links;
-            out->insert(s);
-            
-            cur_links = "";
-            nb_unitigs++;
-            last_unitig = unitig;
-            itSeq.next();
-            seq = itSeq->toString();
-            comment = itSeq->getComment();
-	        comment = remove_previous_links(comment);
-            if (renumber_unitigs) 
-                comment = to_string(nb_unitigs) + " " + strip_first_field(comment);
-        }
-            
-        cur_links += get<2>(cur);
-        //if (unitig < 10)  std::cout << " popped " << pass << " " << unitig << " " << cur_links << std::endl; // debug
-
-        // read next entry in the inputLinks[pass] file that we just popped
-        if (finished[pass])
-            continue;
-        string link;
-        if (get_link_from_file(*inputLinks[pass], link, unitig))
-            pq.emplace(make_tuple(unitig, pass, link));
-        else
-            finished[pass] = true;
-
-    }
-    // write the last element
-    Sequence s (Data::ASCII);
-    s.getData().setRef ((char*)seq.c_str(), seq.size());
-    s._comment = comment + " " + cur_links;
-    out->insert(s);
-    nb_unitigs++;
-
-    for (int pass = 0; pass < nb_passes; pass++)
-    {
-        system::impl::System::file().remove (unitigs_filename + ".links." + to_string(pass));
-        delete inputLinks[pass];
-    }
-}
-
-
 // well well, some potential code duplication with Model.hpp in here (or rather, specialization), but sshh
 static inline int nt2int(char nt)
 {
@@ -215,7 +368,6 @@ static inline int nt2int(char nt)
     return 0;
 }
 
-/* that code doesn't support more than 8 passes*/
 static int normalized_smallmer(const unsigned char c1, const unsigned char c2, const unsigned char c3, const unsigned char c4)
 {
     unsigned char smallmer = (nt2int(c1)<<6) + (nt2int(c2)<<4) + (nt2int(c3)<<2) + nt2int(c4);
@@ -225,234 +377,104 @@ static int normalized_smallmer(const unsigned char c1, const unsigned char c2, c
     return smallmer;
 }
 
-static bool
-is_in_pass (const std::string &seq, int pass, Unitig_pos p, int kmerSize) // TODO this is so un-even. should do more proper hashing..
+/* the links of the two extremities of a unitig are written in the order of that key (beginning first if equal).
+ * it was the pass of the extremity in the former hash table-based implementation, it's kept so that the output doesn't change */
+static int extremity_order(const std::string &seq, Unitig_pos p, int kmerSize)
 {
     int e = 0;
     if (p == UNITIG_END)
         e = seq.size()-(kmerSize-1);
-    // x = 0123456789
-    // k = 5, k-1=4
-    // seq.size()-1-(k-1) = 10-4 = 6
-    return (normalized_smallmer(seq[e],seq[e+1],seq[e+kmerSize-1-1-1],seq[e+kmerSize-1-1]) % nb_passes) == pass;
+    return normalized_smallmer(seq[e],seq[e+1],seq[e+kmerSize-1-1-1],seq[e+kmerSize-1-1]) % nb_passes;
 }
 
-/* returns true if it has read an element, false otherwise */
-static bool get_link_from_file(std::ifstream& input, std::string &link, uint64_t &unitig_id)
+static string link_text(const ExtremityInfo& link, bool edge_km_representation)
 {
-    string line;
-    if (std::getline(input, line))
-    {
-        unitig_id = stoull(line);
-    }
-    else
-        return false;
-    if (std::getline(input, link))
+    string id = to_string(link.unitig);
+
+    if (link.pos == UNITIG_BEGIN)
     {
+        if (edge_km_representation)
+            return "J:0:" + id + ":" + (link.rc?"1":"0") + " ";
+        return "L:-:" + id + ":" + (link.rc?"-":"+") + " ";
     }
-    else
-        return false;
-    return true;
-}
 
+    if (edge_km_representation)
+        return "J:1:" + id + ":" + (link.rc?"1":"0") + " ";
+    return "L:+:" + id + ":" + (link.rc?"-":"+") + " ";
+}
 
-static void record_links(uint64_t utig_id, int pass, const string &link, std::ofstream &links_file)
+static bool link_less(const LinkRecord& a, const LinkRecord& b)
 {
-    // maybe do a buffered thing here but it's not clear if it is bottleneck. in CAMI-medium it took 6 mins without if i don't write the links_file and 8 mins if i do..
-    links_file << to_string(utig_id) << "\n";
-    links_file << link << "\n";
+    if (a.index != b.index) return a.index < b.index;
+    if ((a.packed & 1) != (b.packed & 1)) return (a.packed & 1) < (b.packed & 1); // beginning before end
+    if (a.neighbor != b.neighbor) return a.neighbor < b.neighbor;
+    return (a.packed & 2) < (b.packed & 2); // neighbor beginning before end
 }
 
-
-template<size_t span>
-void link_unitigs_pass(const string unitigs_filename, bool verbose, const int pass, const int kmerSize, bool edge_km_representation, const bool renumber_unitigs)
+/*
+ * step 3: takes the prefix.links.* files, each holding the links of a range of unitigs.
+ * the links of each file are sorted (multi-threaded), then merged with the unitigs into the output file
+ */
+static void write_final_output(const string& unitigs_filename, BankFasta* out, const int kmerSize, const int nb_threads, const uint64_t nb_unitigs, bool edge_km_representation, bool renumber_unitigs)
 {
-    typedef typename kmer::impl::Kmer<span>::ModelCanonical Model;
-    typedef typename kmer::impl::Kmer<span>::Type           Type;
+    logging("gathering links from disk");
 
-    bool debug = false;
-    uint64_t utig_counter = 0;
+    uint64_t unitigs_per_partition = std::max((uint64_t)1, (nb_unitigs + nb_passes - 1) / nb_passes);
+    uint64_t unitigs_per_bucket    = (unitigs_per_partition + nb_threads - 1) / nb_threads;
 
     BankFasta inputBank (unitigs_filename);
     BankFasta::Iterator itSeq (inputBank);
-    
-    Model modelKminusOne(kmerSize - 1); // it's canonical (defined in the .hpp file)
-    
-    typedef typename std::unordered_map<Type, std::vector<uint64_t>> NodeLinksMap;
-
-    NodeLinksMap utigs_links_map;
+    itSeq.first();
 
-    logging("step 1 pass " + to_string(pass));
+    uint64_t index = 0;
 
-    // this is the memory-limiting step, but can be lowered with larger nb_pass
-    for (itSeq.first(); !itSeq.isDone(); itSeq.next()) 
+    for (int pass = 0; pass < nb_passes; pass++)
     {
-        const string& seq = itSeq->toString();
-        if (debug) std::cout << "unitig: " << seq << std::endl;
-
-        const string& comment = itSeq->getComment();        
-        unsigned long utig_id = std::stoul(comment.substr(0, comment.find(' ')));
-
-        if (renumber_unitigs) utig_id = utig_counter;
-        
-        if (is_in_pass(seq, pass, UNITIG_BEGIN, kmerSize))
-        { 
-            if (debug) std::cout << "pass " << pass << " examining beginning" << std::endl;
-            typename Model::Kmer kmerBegin = modelKminusOne.codeSeed(seq.substr(0, kmerSize-1).c_str(), Data::ASCII);
-            bool beginInSameOrientation = modelKminusOne.toString(kmerBegin.value()) == seq.substr(0,kmerSize-1);
-            ExtremityInfo eBegin(utig_id, !beginInSameOrientation /* because we record rc*/, UNITIG_BEGIN);
-            utigs_links_map[kmerBegin.value()].push_back(eBegin.pack());
-        }
-        if (is_in_pass(seq, pass, UNITIG_END, kmerSize))
-        {
-            if (debug) std::cout << "pass " << pass << " examining end" << std::endl;
-            typename Model::Kmer kmerEnd = modelKminusOne.codeSeed(seq.substr(seq.size() - kmerSize+1).c_str(), Data::ASCII);
-            bool endInSameOrientation = modelKminusOne.toString(kmerEnd.value()) == seq.substr(seq.size() - kmerSize+1);
-            ExtremityInfo eEnd(  utig_id, !endInSameOrientation,                             UNITIG_END);
-            utigs_links_map[kmerEnd.value()].push_back(eEnd.pack());
-            // there is no UNITIG_BOTH here because we're taking (k-1)-mers.
-        }
-
-        utig_counter++;
-    }
-
-    std::ofstream links_file(unitigs_filename+".links." +to_string(pass));
-
-    uint64_t nb_hashed_entries = 0;
-    for (auto v : utigs_links_map)
-        nb_hashed_entries += v.second.size(); 
-
-    utig_counter = 0;
+        uint64_t first_unitig = pass * unitigs_per_partition;
 
-    logging("step 2 (" + to_string(utigs_links_map.size()) + "kmers/" + to_string(nb_hashed_entries) + "extremities)");
+        // the links of the partition are split by unitig rank, so that each thread sorts a contiguous range of unitigs
+        std::vector<std::vector<LinkRecord> > buckets (nb_threads);
 
-    for (itSeq.first(); !itSeq.isDone(); itSeq.next()) 
-    {
-        const string& seq = itSeq->toString();
-        const string& comment = itSeq->getComment();        
-        unsigned long utig_id = std::stoul(comment.substr(0, comment.find(' ')));
-        
-        if (renumber_unitigs) utig_id = utig_counter;
-
-        if (debug) std::cout << "unitig "  << std::to_string(utig_id)  << " : " << seq << std::endl;
- 
-        if (is_in_pass(seq, pass, UNITIG_BEGIN, kmerSize))
+        string links_filename = unitigs_filename + ".links." + to_string(pass);
         {
-            if (debug) std::cout << "pass " << pass << " examining beginning" << std::endl;
-            typename Model::Kmer kmerBegin = modelKminusOne.codeSeed(seq.substr(0, kmerSize-1).c_str(), Data::ASCII);
-            bool beginInSameOrientation =  modelKminusOne.toString(kmerBegin.value()) == seq.substr(0,kmerSize-1); // that could be optimized, revcomp was already computed during codeSeed
-            // treat special palindromic kmer cases
-            bool nevermindInOrientation = false;
-            if (((kmerSize - 1) % 2) == 0) 
-                if (kmerBegin.isPalindrome()) nevermindInOrientation = true;
-
-            string in_links = " "; // necessary placeholder to indicate we have links for that unitig
-
-            // in-neighbors
-            // so, the current kmer is kmerBegin, and we're iterating all potential in-neighbors as e_in objects
-            for (auto in_packed : utigs_links_map[kmerBegin.value()])
-            {
-                ExtremityInfo e_in(in_packed);
-
-                if (debug) std::cout << "extremity " << modelKminusOne.toString(kmerBegin.value()) << " ";
-                if (debug) std::cout << "potential in-neighbor: " << e_in.toString() << " beginSameOrientation " << beginInSameOrientation;
-
-                // what we want are these four cases:
-                //  ------[end same orientation] -> [begin same orientation]----
-                //  [begin diff orientation]---- -> [begin same orientation]----
-                //  ------[end diff orientation] -> [begin diff orientation]----
-                //  [begin same orientation]---- -> [begin diff orientation]----
-                if ((       ((beginInSameOrientation) &&    (e_in.pos == UNITIG_END  ) && (e_in.rc == false)) ||
-                            ((beginInSameOrientation) &&    (e_in.pos == UNITIG_BEGIN) && (e_in.rc == true)) ||
-                            (((!beginInSameOrientation)) && (e_in.pos == UNITIG_END  ) && (e_in.rc == true)) ||
-                            (((!beginInSameOrientation)) && (e_in.pos == UNITIG_BEGIN) && (e_in.rc == false)))
-                        || nevermindInOrientation)
-                {
-                    
-                    // this was for when i was wanting to save space while storing links in memory. now storing on disk
-                    //LinkInfo li(e_in.unitig, e_in.rc ^ beginInSameOrientation);
-                    //incoming[utig_number].push_back(li.pack());
-
-                    //bool rc = e_in.rc ^ (!beginInSameOrientation); // "rc" sets the destination strand // i don't think it's the right formula because of k-1-mers that are their self revcomp. see the mikko bug in the test folder, that provides a nice illustration of that 
-                    bool rc = e_in.pos == UNITIG_END; // a better way to determine the rc flag is just looking at position of e_in k-1-mer 
-
-                    
-                    if(edge_km_representation){
-                        in_links += "J:0:" + to_string(e_in.unitig) + ":" + (rc?"1":"0") + " "; 
-                    }else{
-                        in_links += "L:-:" + to_string(e_in.unitig) + ":" + (rc?"-":"+") + " "; 
-                    }
-
-                    /* what to do when kmerBegin is same as forward and reverse?
-                     used to have this:
-                        if (nevermindInOrientation)
-                          in_links += "L:-:" + to_string(e_in.unitig) + ":" + ((!rc)?"+":"-") + " "; // in that case, there is also another link with the reverse direction
-                     but it's bogus, because the reverse direction of the other sequence won't have the same start k-1-mer, even if it is just k-long
-                     so there isn't anything to do actually. the case is handled by the "|| nevermindInOrientation )" in the if above */
-                     
-
-                    if (debug) std::cout << " [valid] ";
-                }
-                if (debug) std::cout << std::endl;
-            }
-            
-            record_links(utig_id, pass, in_links, links_file);
+            IteratorFile<LinkRecord> file (links_filename);
+            for (file.first(); !file.isDone(); file.next())
+                buckets[(file.item().index - first_unitig) / unitigs_per_bucket].push_back(file.item());
         }
+        system::impl::System::file().remove (links_filename);
 
+        ThreadPool pool(nb_threads);
+        for (int i = 0; i < nb_threads; i++)
+            pool.enqueue([&buckets, i] (int thread_id) { std::sort(buckets[i].begin(), buckets[i].end(), link_less); });
+        pool.join();
 
-        if (is_in_pass(seq, pass, UNITIG_END, kmerSize))
-        {
-            if (debug) std::cout << "pass " << pass << " examining end" << std::endl;
-            typename Model::Kmer kmerEnd = modelKminusOne.codeSeed(seq.substr(seq.size() - kmerSize+1).c_str(), Data::ASCII);
-            bool endInSameOrientation =  modelKminusOne.toString(kmerEnd.value()) == seq.substr(seq.size() - kmerSize+1);
+        std::vector<size_t> cursor (nb_threads, 0);
 
-            bool nevermindOutOrientation = false;
-            if (((kmerSize - 1) % 2) == 0) 
-                if (kmerEnd.isPalindrome())   nevermindOutOrientation = true;
+        for ( ; index < std::min(first_unitig + unitigs_per_partition, nb_unitigs); index++, itSeq.next())
+        {
+            const string& seq = itSeq->toString();
+            string comment = itSeq->getComment();
+            comment = remove_previous_links(comment);
+            if (renumber_unitigs)
+                comment = to_string(index) + " " + strip_first_field(comment);
 
-            string out_links = " "; // necessary placeholder to indicate we have links for that unitig
+            string links[2] = {" ", " "}; // necessary placeholder to indicate we have links for that extremity
 
-            // out-neighbors
-            for (auto out_packed : utigs_links_map[kmerEnd.value()])
+            std::vector<LinkRecord>& bucket = buckets[(index - first_unitig) / unitigs_per_bucket];
+            size_t& i = cursor[(index - first_unitig) / unitigs_per_bucket];
+            for ( ; i < bucket.size() && bucket[i].index == index; i++)
             {
-                ExtremityInfo e_out(out_packed);
-
-                if (debug) std::cout << "extremity " << modelKminusOne.toString(kmerEnd.value()) << " ";
-                if (debug) std::cout << "potential out-neighbor: " << e_out.toString();
-
-                // what we want are these four cases:
-                //  ------[end same orientation] -> [begin same orientation]----
-                //  ------[end same orientation] -> ------[end diff orientation]
-                //  ------[end diff orientation] -> [begin diff orientation]----
-                //  ------[end diff orientation] -> ------[end same orientation]
-                if ((((endInSameOrientation) && (e_out.pos == UNITIG_BEGIN) && (e_out.rc == false)) ||
-                            ((endInSameOrientation) && (e_out.pos == UNITIG_END  ) && (e_out.rc == true)) ||
-                            (((!endInSameOrientation)) && (e_out.pos == UNITIG_BEGIN) && (e_out.rc == true)) ||
-                            (((!endInSameOrientation)) && (e_out.pos == UNITIG_END  ) && (e_out.rc == false)))
-                        ||nevermindOutOrientation)
-                {
-
-                    //LinkInfo li(e_out.unitig, e_out.rc ^ endInSameOrientation);
-                    //outcoming[utig_number].push_back(li.pack());
-                    
-                    bool rc = e_out.pos == UNITIG_END; // a better way to determine the rc flag is just looking at position of e_in k-1-mer 
-
-                    if(edge_km_representation){
-                        out_links += "J:1:" + to_string(e_out.unitig) + ":" + (rc?"1":"0") + " "; 
-                    }else{
-                        out_links += "L:+:" + to_string(e_out.unitig) + ":" + (rc?"-":"+") + " "; 
-                    }
-                    
+                ExtremityInfo link(bucket[i].packed);
+                links[link.pos == UNITIG_END] += link_text(link, edge_km_representation);
+            }
 
+            bool endFirst = extremity_order(seq, UNITIG_END, kmerSize) < extremity_order(seq, UNITIG_BEGIN, kmerSize);
 
-                    if (debug) std::cout << " [valid] ";
-                }
-                if (debug) std::cout << std::endl;
-            }
-            record_links(utig_id, pass, out_links, links_file);
+            Sequence s (Data::ASCII);
+            s.getData().setRef ((char*)seq.c_str(), seq.size());
+            s._comment = comment + " " + (endFirst ? links[1] + links[0] : links[0] + links[1]);
+            out->insert(s);
         }
-
-        utig_counter++;
     }
 }
 
@@ -27,9 +27,11 @@
 
 #include <gatb/debruijn/impl/Graph.hpp>
 #include <gatb/system/impl/System.hpp>
+#include <gatb/tools/misc/api/Range.hpp>
 #include <vector>
 #include <set>
 #include <string>
+#include <atomic>
 
 /********************************************************************************/
 namespace gatb {  namespace core {  namespace debruijn {  namespace impl {
@@ -42,24 +44,28 @@ class NodesDeleter
     using Node = typename Graph::Node;
     using Edge = typename Graph::Edge;
 
+    /* nodes of the explicit list are stored in chunks, allocated when a thread first needs them */
+    static const uint64_t CHUNK_SIZE = 1 << 16;
+
     public:
         uint64_t nbNodes;
-        std::vector<bool> nodesToDelete; // don't delete while parallel traversal, do it afterwards
-        std::set<Node> setNodesToDelete; 
+        std::vector<u_int64_t> nodesToDelete; // don't delete while parallel traversal, do it afterwards. 1 bit per node, set atomically
+        std::set<Node> setNodesToDelete; // only in onlyListMethod mode (GraphUnitigs nodes have no MPHF index)
+        std::vector<Node*> listChunks; // explicit list of the nodes to delete, filled without locks
+        uint64_t listSize;
         Graph &  _graph;
         int _nbCores;
         bool _verbose;
-        bool useList, onlyListMethod;
+        std::atomic<bool> useList; // cleared by markToDelete (from any thread) when the explicit list is full
+        bool onlyListMethod;
         unsigned long explicitLimit;
         system::ISynchronizer* synchro;
 
-    NodesDeleter(Graph&  graph, uint64_t nbNodes, int nbCores, bool verbose=true) : nbNodes(nbNodes), _graph(graph), _nbCores(nbCores), _verbose(verbose)
+    NodesDeleter(Graph&  graph, uint64_t nbNodes, int nbCores, bool verbose=true) : nbNodes(nbNodes), listSize(0), _graph(graph), _nbCores(nbCores), _verbose(verbose)
     {
-        nodesToDelete.resize(nbNodes); // number of graph nodes // (!) this will alloc 1 bit per kmer.
-        for (unsigned long i = 0; i < nbNodes; i++)
-            nodesToDelete[i] = false;
+        nodesToDelete.resize((nbNodes + 63) / 64, 0); // number of graph nodes // (!) this will alloc 1 bit per kmer.
 
-        /* use explicit set of nodes as long as we don't have more than 10 M nodes ok? 
+        /* use explicit list of nodes as long as we don't have more than 10 M nodes ok? 
          * else resort to bit array
          * 10M nodes, assuming 128 bytes per nodes (generous), is 1 gig.
          * for k=21 it's actually closer to 24 bytes per node.
@@ -76,22 +82,30 @@ class NodesDeleter
         // for bacteria it's 10M
         // for human it's roughly 20M
         // for spruce it's roughly 300M
+
+        listChunks.resize(explicitLimit / CHUNK_SIZE + 1, 0);
   
-        // set insertions aren't thread safe, so let's use a synchronizer
+        // set insertions aren't thread safe, so let's use a synchronizer (onlyListMethod mode, and non-simple nodes cache updates in flush)
         synchro = system::impl::System::thread().newSynchronizer();
     }
 
-    ~NodesDeleter ()  { delete synchro; }
+    ~NodesDeleter ()
+    {
+        for (size_t i = 0; i < listChunks.size(); i++)
+            delete[] listChunks[i];
+        delete synchro;
+    }
 
     bool get(uint64_t index)
     {
-        return nodesToDelete[index];
+        return (nodesToDelete[index / 64] >> (index % 64)) & 1;
     }
     
     bool get(Node &node)
     {
-        if (useList)
+        if (onlyListMethod)
         {
+            system::LocalSynchronizer ls (synchro);
             return (setNodesToDelete.find(node) != setNodesToDelete.end());
         }
         //else
@@ -101,40 +115,94 @@ class NodesDeleter
         }
     }
 
+    /* may be called by several threads at once: the node is marked with an atomic bit operation,
+     * and recorded in the explicit list at a slot reserved with an atomic increment */
     void markToDelete(Node &node)
     {
-        if (!onlyListMethod)
+        if (onlyListMethod)
         {
-            unsigned long index =_graph.nodeMPHFIndex(node);
-            nodesToDelete[index] = true;
+            system::LocalSynchronizer ls (synchro);
+            setNodesToDelete.insert(node);
+            return;
         }
 
-        if (useList)
+        unsigned long index =_graph.nodeMPHFIndex(node);
+        u_int64_t bit = (u_int64_t)1 << (index % 64);
+
+        // only the thread that sets the bit records the node, so that it is listed once
+        if (__sync_fetch_and_or(&nodesToDelete[index / 64], bit) & bit)
+            return;
+
+        if (!useList)
+            return;
+
+        uint64_t slot = __sync_fetch_and_add(&listSize, 1);
+        if (slot >= explicitLimit)
         {
-            synchro->lock();
-            setNodesToDelete.insert(node);
-            synchro->unlock();
+            useList = false;
+            return;
         }
 
-        if ((!onlyListMethod) && (setNodesToDelete.size() > explicitLimit))
-            useList = false;
+        Node*& chunk = listChunks[slot / CHUNK_SIZE];
+        if (chunk == 0)
+        {
+            Node* newChunk = new Node[CHUNK_SIZE];
+            if (!__sync_bool_compare_and_swap(&chunk, (Node*)0, newChunk))
+                delete[] newChunk; // another thread allocated it first
+        }
+        chunk[slot % CHUNK_SIZE] = node;
+    }
+
+    /* calls f on each node marked for deletion, or returns false if these nodes weren't listed
+     * (too many of them, and only the bit array was kept) */
+    template<typename Functor> bool foreachMarked(const Functor& f)
+    {
+        if (onlyListMethod || !useList)
+            return false;
 
+        for (uint64_t slot = 0; slot < listSize; slot++)
+            f(listChunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]);
+        return true;
     }
 
    // TODO speed: tell graph whenever all the neighbors of a node will be deleted too, that way, don't need to update their adjacency! 
     void flush()
     {
-        if (useList)
+        if (onlyListMethod)
         {
             if (_verbose)
                 std::cout << "NodesDeleter mem usage prior to flush: " << (setNodesToDelete.size() * sizeof(Node)) / 1024 / 1024 << " MB" << std::endl;
-            // sequential nodes deletion (no need for parallel here, as deleteNode() needs to be atomic anyway
+            // sequential nodes deletion
             for (typename std::set<Node>::iterator it = setNodesToDelete.begin(); it != setNodesToDelete.end(); it++)
             {
                 Node node = *it; // remove this line when (if ever?) deleteNode is const Node&
                 _graph.deleteNode(node);
             }
         }
+        else if (useList)
+        {
+            if (_verbose)
+                std::cout << "NodesDeleter mem usage prior to flush: " << (listSize * sizeof(Node)) / 1024 / 1024 << " MB" << std::endl;
+            if (listSize == 0)
+                return;
+
+            // parallel nodes deletion: deleteNode() is atomic with respect to other node deletions,
+            // except for the updates of the non-simple nodes cache
+            bool cacheNonSimpleNodes = _graph.getState() & Graph::STATE_NONSIMPLE_CACHE;
+            tools::dp::impl::Dispatcher dispatcher (_nbCores);
+            dispatcher.iterate (tools::misc::Range<uint64_t>::Iterator (0, listSize - 1), [&] (uint64_t slot)
+            {
+                Node& node = listChunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE];
+
+                if (cacheNonSimpleNodes)
+                    synchro->lock();
+
+                _graph.deleteNode(node);
+
+                if (cacheNonSimpleNodes)
+                    synchro->unlock();
+            });
+        }
         else
         {
             _graph.deleteNodesByIndex(nodesToDelete, _nbCores, synchro);
@@ -73,6 +73,9 @@ Simplifications<GraphType>::Simplifications(GraphType *graph, int nbCores, bool
 {
     // by default; do everything
     _doTipRemoval = _doBulgeRemoval = _doECRemoval = true;
+    _incrementalPasses = true;
+    for (int kind = 0; kind < NB_KINDS; kind++)
+        _changedNodesKnown[kind] = false;
 
     if (graph) // may be called with graph==null in order just to get parameters
     {
@@ -351,6 +354,214 @@ bool Simplifications<GraphType>::satisfyRCTC(double pathAbundance, Node& node, d
     return isRCTC;
 }
 
+/* iterates a list of nodes (the nodes around the previous deletions, see nodesToExamine) */
+template<typename Node>
+class NodesVectorIterator : public tools::dp::ISmartIterator<Node>
+{
+public:
+    NodesVectorIterator (std::vector<Node>& nodes) : _rank(0)  {  _nodes.swap(nodes);  }
+
+    void first()  {  _rank = 0;  update();  }
+    void next()   {  _rank++;    update();  }
+    bool isDone() {  return _rank >= _nodes.size();  }
+    Node& item () {  return *(this->_item);  }
+
+    u_int64_t size () const  {  return _nodes.size();  }
+    u_int64_t rank () const  {  return _rank;  }
+
+private:
+    void update()  {  if (_rank < _nodes.size())  {  *(this->_item) = _nodes[_rank];  }  }
+
+    std::vector<Node> _nodes;
+    u_int64_t         _rank;
+};
+
+/* nodes to examine in a pass of a simplification.
+ * the first pass iterates all the nodes, the next ones the cached non-simple nodes.
+ * a simplification only depends on the graph in a limited neighborhood of the examined node, so once it has
+ * examined all the cached nodes, its next passes only examine the non-simple nodes around the nodes whose
+ * neighborhood changed since (see nodesAround), unless there are too many of them. */
+template<typename GraphType>
+GraphIterator<typename GraphType::Node> Simplifications<GraphType>::nodesToExamine(Kind kind)
+{
+    bool changedNodesKnown = _changedNodesKnown[kind];
+    std::vector<Node> changedNodes;
+    changedNodes.swap(_changedNodes[kind]);
+
+    // from now on, record the deletions for the next pass of that simplification
+    _changedNodesKnown[kind] = true;
+
+    if (_firstNodeIteration)
+    {
+        GraphIterator<Node> itNode = _graph.GraphType::iterator();
+        if (_verbose)
+            std::cout << "iterating on " << itNode.size() << " nodes on disk" << std::endl;
+        return itNode;
+    }
+
+    GraphIterator<Node> itCached = _graph.GraphType::iteratorCachedNodes();
+
+    if (_incrementalPasses && changedNodesKnown)
+    {
+        // the farthest a simplification looks from the examined node, in nucleotides:
+        // tips (RCTC) and EC paths, and bulge paths followed by their alternative path
+        unsigned int k = _graph.getKmerSize();
+        unsigned int maxBulgeLength = std::max((unsigned int)((double)k * _bulgeLen_kMult), (unsigned int)(k + _bulgeLen_kAdd));
+        unsigned int horizon = std::max(std::max((unsigned int)(k * _tipLen_RCTC_kMult), (unsigned int)((float)k * _ecLen_kMult)),
+                                        (unsigned int)(2.1 * maxBulgeLength) + 3);
+
+        std::vector<Node> nodes;
+        if (nodesAround(changedNodes, horizon, itCached.size() / 2, nodes))
+        {
+            if (_verbose)
+                std::cout << "iterating on " << nodes.size() << " nodes around " << changedNodes.size() << " changed nodes" << std::endl;
+            return GraphIterator<Node> (new NodesVectorIterator<Node> (nodes));
+        }
+    }
+
+    if (_verbose)
+        std::cout << "iterating on " << itCached.size() << " cached nodes" << std::endl;
+    return itCached;
+}
+
+/* after the deletions of a pass: records their surviving neighbors, for the next passes of each simplification */
+template<typename GraphType>
+void Simplifications<GraphType>::recordDeletions(NodesDeleter<GraphType>& nodesDeleter)
+{
+    std::vector<Node> changedNodes;
+
+    // deleted nodes keep their adjacency, so their neighbors are still found
+    bool listed = nodesDeleter.foreachMarked([&] (Node& node)
+    {
+        GraphVector<Edge> neighbors = _graph.neighborsEdge(node);
+        for (size_t i = 0; i < neighbors.size(); i++)
+            if (!_graph.isNodeDeleted(neighbors[i].to))
+                changedNodes.push_back(neighbors[i].to);
+    });
+
+    for (int kind = 0; kind < NB_KINDS; kind++)
+    {
+        if (!_changedNodesKnown[kind])
+            continue;
+
+        // beyond 1% of the nodes, the next pass will iterate all the cached nodes anyway
+        if (!listed || _changedNodes[kind].size() + changedNodes.size() > nbNodes / 100)
+        {
+            _changedNodesKnown[kind] = false;
+            std::vector<Node>().swap(_changedNodes[kind]);
+            continue;
+        }
+        _changedNodes[kind].insert(_changedNodes[kind].end(), changedNodes.begin(), changedNodes.end());
+    }
+}
+
+/* follows the simple path that starts with the edge, up to its first non-simple node. */
+template<typename GraphType>
+typename GraphType::Node Simplifications<GraphType>::unitigEnd(const Edge& edge, unsigned int& length)
+{
+    Node node = edge.to;
+    length = 1;
+    while (length <= nbNodes)
+    {
+        GraphVector<Edge> neighbors = _graph.neighborsEdge(node);
+        if (neighbors.size() != 2 || neighbors[0].direction == neighbors[1].direction)
+            break; // in or out branching, or deadend
+
+        Edge& next = (neighbors[0].direction == edge.direction) ? neighbors[0] : neighbors[1];
+        if (next.to == edge.from)
+            break; // circular simple path
+
+        node = next.to;
+        length++;
+    }
+    return node;
+}
+
+/* lists the non-simple nodes whose simplification may have changed since the nodes of changedNodes changed.
+ *
+ * a simplification examines the node, the simple paths around it (followed entirely, e.g. for their mean abundance),
+ * the nodes they lead to and the simple paths around these, and may follow paths up to horizon nucleotides long
+ * (e.g. alternative paths of bulges). so from the changed nodes, the search follows the simple paths around them for free,
+ * then the next simple paths as long as less than two simple paths or less than horizon nucleotides were followed.
+ *
+ * the search goes breadth-first from all the changed nodes at once, so that each node is expanded once (unless reached
+ * again by a shorter way); the nodes of a level are dispatched to the threads, which follow their simple paths.
+ * returns false if more than maxNodes nodes were found. */
+template<typename GraphType>
+bool Simplifications<GraphType>::nodesAround(const std::vector<Node>& changedNodes, unsigned int horizon, uint64_t maxNodes, std::vector<Node>& nodes)
+{
+    struct Reach { Node node; unsigned int nbPaths; unsigned int length; };
+
+    // smallest (number of simple paths, length) each node was reached with
+    std::unordered_map<unsigned long, std::pair<unsigned int, unsigned int> > reached;
+
+    std::vector<Reach> level;
+    for (size_t i = 0; i < changedNodes.size(); i++)
+        level.push_back(Reach { changedNodes[i], 0, 0 });
+
+    Dispatcher dispatcher (_nbCores);
+
+    while (level.size() > 0)
+    {
+        /* keep the nodes that weren't reached by a shorter way */
+        std::vector<Reach> expand;
+        for (size_t i = 0; i < level.size(); i++)
+        {
+            Reach& cur = level[i];
+            unsigned long index = _graph.nodeMPHFIndex(cur.node);
+            auto it = reached.find(index);
+            if (it == reached.end())
+            {
+                reached[index] = std::make_pair(cur.nbPaths, cur.length);
+
+                Node node = cur.node;
+                node.strand = kmer::STRAND_FORWARD; // as the cached nodes
+                nodes.push_back(node);
+                if (nodes.size() > maxNodes)
+                    return false;
+            }
+            else if (it->second.first <= cur.nbPaths && it->second.second <= cur.length)
+                continue;
+            else
+            {
+                it->second.first  = std::min(it->second.first,  cur.nbPaths);
+                it->second.second = std::min(it->second.second, cur.length);
+            }
+
+            if (cur.nbPaths < 2 || cur.length <= horizon)
+                expand.push_back(cur);
+        }
+
+        /* follow the simple paths around these nodes, in parallel */
+        ThreadObject<std::vector<Reach> > threadLevels;
+        if (expand.size() > 0)
+        {
+            dispatcher.iterate (tools::misc::Range<u_int64_t>::Iterator (0, expand.size() - 1), [&] (u_int64_t idx)
+            {
+                std::vector<Reach>& localLevel = threadLevels();
+                Reach& cur = expand[idx];
+                unsigned int length;
+
+                GraphVector<Edge> neighbors = _graph.neighborsEdge(cur.node);
+                for (size_t i = 0; i < neighbors.size(); i++)
+                {
+                    Node end = unitigEnd(neighbors[i], length);
+                    // the simple paths around the changed nodes are followed for free
+                    localLevel.push_back(Reach { end, cur.nbPaths + 1, cur.length + (cur.nbPaths == 0 ? 0 : length) });
+                }
+            }, 1);
+        }
+
+        level.clear();
+        threadLevels.foreach([&] (const std::vector<Reach>& localLevel)
+        {
+            level.insert(level.end(), localLevel.begin(), localLevel.end());
+        });
+    }
+
+    return true;
+}
+
 /* this function removes tips in the graph, using an algorithm designed in SPAdes
  *
  * here is an in-depth analysis of SPAdes 3.5 tip clipping conditions: (following graph_simplifications.hpp and simplifications.info)
@@ -401,21 +612,9 @@ unsigned long Simplifications<GraphType>::removeTips()
     char buffer[128];
     sprintf(buffer, simplprogressFormat0, ++_nbTipRemovalPasses);
     /** We get an iterator over all nodes */
-    /* in case of pass > 1, only over cached branching nodes */
+    /* in case of pass > 1, only over cached branching nodes (around the previous deletions, see nodesToExamine) */
     // because in later iterations, we have cached non-simple nodes, so iterate on them
-    ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem> *itNode; 
-    if (_firstNodeIteration )
-    {
-        itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(_graph.GraphType::iterator(), buffer, _verbose);
-        if (_verbose)
-            std::cout << "iterating on " << itNode->size() << " nodes on disk" << std::endl;
-    }
-    else
-    {
-        itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(_graph.GraphType::iteratorCachedNodes(), buffer, _verbose);
-        if (_verbose)
-            std::cout << "iterating on " << itNode->size() << " cached nodes" << std::endl;
-    }
+    ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem> *itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(nodesToExamine(TIPS), buffer, _verbose);
 
     // parallel stuff: create a dispatcher ; support atomic operations
     Dispatcher dispatcher (_nbCores);
@@ -585,6 +784,7 @@ unsigned long Simplifications<GraphType>::removeTips()
     
     // now delete all nodes, in parallel
     nodesDeleter.flush();
+    recordDeletions(nodesDeleter);
 
     TIME(auto end_nodesdel_t=get_wtime()); 
     TIME(__sync_fetch_and_add(&timeDel, diff_wtime(start_nodesdel_t,end_nodesdel_t)));
@@ -1304,19 +1504,7 @@ unsigned long Simplifications<GraphType>::removeBulges()
     /** We get an iterator over all nodes . */
     char buffer[128];
     sprintf(buffer, simplprogressFormat2, ++_nbBulgeRemovalPasses);
-    ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem> *itNode; 
-    if (_firstNodeIteration )
-    {
-        itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(_graph.GraphType::iterator(), buffer, _verbose);
-        if (_verbose)
-            std::cout << "iterating on " << itNode->size() << " nodes" << std::endl;
-    }
-    else
-    {
-        itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(_graph.GraphType::iteratorCachedNodes(), buffer, _verbose);
-        if (_verbose)
-            std::cout << "iterating on " << itNode->size() << " cached nodes" << std::endl;
-    }
+    ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem> *itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(nodesToExamine(BULGES), buffer, _verbose);
 
 
     // parallel stuff: create a dispatcher ; support atomic operations
@@ -1548,6 +1736,7 @@ unsigned long Simplifications<GraphType>::removeBulges()
     TIME(auto start_nodedelete_t=get_wtime());
 
     nodesDeleter.flush();
+    recordDeletions(nodesDeleter);
 
     TIME(auto end_nodedelete_t=get_wtime());
     TIME(__sync_fetch_and_add(&timeDelete, diff_wtime(start_nodedelete_t,end_nodedelete_t)));
@@ -1627,19 +1816,7 @@ unsigned long Simplifications<GraphType>::removeErroneousConnections()
     /** We get an iterator over all nodes . */
     char buffer[128];
     sprintf(buffer, simplprogressFormat3, ++_nbECRemovalPasses);
-    ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem> *itNode; 
-    if (_firstNodeIteration )
-    {
-        itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(_graph.GraphType::iterator(), buffer, _verbose);
-        if (_verbose)
-            std::cout << "iterating on " << itNode->size() << " nodes on disk" << std::endl;
-    }
-    else
-    {
-        itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(_graph.GraphType::iteratorCachedNodes(), buffer, _verbose);
-        if (_verbose)
-            std::cout << "iterating on " << itNode->size() << " cached nodes" << std::endl;
-    }
+    ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem> *itNode = new ProgressGraphIteratorTemplate<Node,ProgressTimerAndSystem>(nodesToExamine(EC), buffer, _verbose);
 
     // parallel stuff: create a dispatcher ; support atomic operations
     Dispatcher dispatcher (_nbCores);
@@ -1809,6 +1986,7 @@ unsigned long Simplifications<GraphType>::removeErroneousConnections()
     TIME(auto start_nodesdel_t=get_wtime());
 
     nodesDeleter.flush();
+    recordDeletions(nodesDeleter);
 
     TIME(auto end_nodesdel_t=get_wtime()); 
     TIME(__sync_fetch_and_add(&timeDelete, diff_wtime(start_nodesdel_t,end_nodesdel_t)));
@@ -59,6 +59,9 @@ public:
     
     std::string tipRemoval, bubbleRemoval, ECRemoval;
     bool _doTipRemoval, _doBulgeRemoval, _doECRemoval;
+
+    /* after the first pass of a simplification, only examine the nodes around the nodes deleted since its previous pass */
+    bool _incrementalPasses;
    
     /* now exposing some parameters */
     double _tipLen_Topo_kMult;
@@ -82,6 +85,16 @@ protected:
     bool _firstNodeIteration;
     bool _verbose;
 
+    /* incremental passes: surviving neighbors of the nodes deleted since the previous pass of each simplification */
+    enum Kind { TIPS = 0, BULGES = 1, EC = 2, NB_KINDS = 3 };
+    std::vector<Node> _changedNodes[NB_KINDS];
+    bool _changedNodesKnown[NB_KINDS];
+
+    GraphIterator<Node> nodesToExamine (Kind kind);
+    void recordDeletions (NodesDeleter<GraphType>& nodesDeleter);
+    bool nodesAround (const std::vector<Node>& changedNodes, unsigned int horizon, uint64_t maxNodes, std::vector<Node>& nodes);
+    Node unitigEnd (const Edge& edge, unsigned int& length);
+
     std::string path2string(Direction dir, Path_t<Node> p, Node endNode);
     double path2abundance(Direction dir, Path_t<Node> p, Node endNode, unsigned int skip_first = 0, unsigned int skip_last = 0);
 
@@ -157,6 +157,44 @@ public:
     std::swap(max_shift_num_, dagv.max_shift_num_);
   }
 
+  /**
+   * Write the content to a binary stream
+   * @param os the output stream
+   */
+  void save(std::ostream& os) const{
+    uint64_t levels = bitunaries_.size();
+    os.write((const char*)&levels,         sizeof(levels));
+    os.write((const char*)&size_,          sizeof(size_));
+    os.write((const char*)&sum_,           sizeof(sum_));
+    os.write((const char*)&max_shift_num_, sizeof(max_shift_num_));
+    for (size_t i = 0; i < levels; ++i){
+      bitunaries_[i].save(os);
+      bitvals_[i].save(os);
+    }
+  }
+
+  /**
+   * Read a content written by save() from memory
+   * @param p the read position, advanced past the vector
+   * @param end the end of the readable memory
+   * @return false if the content goes past end (p is then undefined)
+   */
+  bool load(const char*& p, const char* end){
+    uint64_t levels;
+    if ((uint64_t)(end - p) < sizeof(levels) + sizeof(size_) + sizeof(sum_) + sizeof(max_shift_num_)) return false;
+    memcpy(&levels,         p, sizeof(levels));         p += sizeof(levels);
+    memcpy(&size_,          p, sizeof(size_));          p += sizeof(size_);
+    memcpy(&sum_,           p, sizeof(sum_));           p += sizeof(sum_);
+    memcpy(&max_shift_num_, p, sizeof(max_shift_num_)); p += sizeof(max_shift_num_);
+    if (levels > 64) return false; // one level per bit of the values at most
+    bitunaries_.resize(levels);
+    bitvals_.resize(levels);
+    for (size_t i = 0; i < levels; ++i){
+      if (!bitunaries_[i].load(p, end) || !bitvals_[i].load(p, end)) return false;
+    }
+    return true;
+  }
+
   /**
    * Clear the content
    */
@@ -22,6 +22,8 @@
 #define RANK_VECTOR_HPP_
 
 #include <vector>
+#include <ostream>
+#include <cstring>
 #include <stdint.h>
 
 namespace dag{
@@ -101,6 +103,32 @@ public:
     std::swap(one_num_, rv.one_num_);
   }
 
+  /**
+   * Write the bit vector and its rank directory to a binary stream
+   * @param os the output stream
+   */
+  void save(std::ostream& os) const{
+    save_array(os, bits_);
+    save_array(os, lblocks_);
+    save_array(os, sblocks_);
+    os.write((const char*)&size_,    sizeof(size_));
+    os.write((const char*)&one_num_, sizeof(one_num_));
+  }
+
+  /**
+   * Read a bit vector written by save() from memory
+   * @param p the read position, advanced past the bit vector
+   * @param end the end of the readable memory
+   * @return false if the content goes past end (p is then undefined)
+   */
+  bool load(const char*& p, const char* end){
+    if (!load_array(p, end, bits_) || !load_array(p, end, lblocks_) || !load_array(p, end, sblocks_)) return false;
+    if ((uint64_t)(end - p) < sizeof(size_) + sizeof(one_num_)) return false;
+    memcpy(&size_,    p, sizeof(size_));    p += sizeof(size_);
+    memcpy(&one_num_, p, sizeof(one_num_)); p += sizeof(one_num_);
+    return true;
+  }
+
  private:
   static const uint64_t LBLOCKSIZE = 256;
   static const uint64_t BLOCKSIZE = 64;
@@ -117,6 +145,24 @@ public:
     bits_.push_back(0LLU);
   }
 
+  template <typename T>
+  static void save_array(std::ostream& os, const std::vector<T>& v){
+    uint64_t n = v.size();
+    os.write((const char*)&n, sizeof(n));
+    os.write((const char*)v.data(), n * sizeof(T));
+  }
+
+  template <typename T>
+  static bool load_array(const char*& p, const char* end, std::vector<T>& v){
+    uint64_t n;
+    if ((uint64_t)(end - p) < sizeof(n)) return false;
+    memcpy(&n, p, sizeof(n)); p += sizeof(n);
+    if (n > (uint64_t)(end - p) / sizeof(T)) return false;
+    v.resize(n);
+    memcpy(v.data(), p, n * sizeof(T)); p += n * sizeof(T);
+    return true;
+  }
+
   inline static uint64_t pop_count(uint64_t x){
     x = x - ((x & 0xAAAAAAAAAAAAAAAALLU) >> 1);
     x = (x & 0x3333333333333333LLU) + ((x >> 2) & 0x3333333333333333LLU);
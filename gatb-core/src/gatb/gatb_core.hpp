@@ -43,6 +43,7 @@
 #include <gatb/tools/collections/impl/Hash16.hpp>
 #include <gatb/tools/collections/impl/IteratorFile.hpp>
 #include <gatb/tools/collections/impl/OAHash.hpp>
+#include <gatb/tools/collections/impl/OAHashConcurrent.hpp>
 #include <gatb/tools/collections/impl/IterableHelpers.hpp>
 
 #include <gatb/tools/storage/impl/Storage.hpp>
@@ -58,6 +59,7 @@
 #include <gatb/tools/misc/impl/StringLine.hpp>
 #include <gatb/tools/misc/impl/LibraryInfo.hpp>
 #include <gatb/tools/misc/impl/Tokenizer.hpp>
+#include <gatb/tools/misc/impl/NucleotideKernels.hpp>
 
 #include <gatb/tools/math/NativeInt64.hpp>
 #include <gatb/tools/math/NativeInt128.hpp>
@@ -19,6 +19,7 @@
 
 #include <gatb/kmer/impl/Configuration.hpp>
 #include <gatb/system/api/IMemory.hpp>
+#include <gatb/tools/math/NativeInt8.hpp>
 
 /********************************************************************************/
 
@@ -75,6 +76,9 @@ Properties Configuration::getProperties() const
     result.add (1, "estimated_kmers_volume",      "%ld", _volume);
     result.add (1, "max_disk_space",    "%ld", _max_disk_space);
     result.add (1, "max_memory",        "%ld", _max_memory);
+    result.add (1, "tmp_compress",      "%d",  _superk_codec);
+    result.add (1, "tmp_memory",        "%d",  _superk_memory);
+    result.add (1, "sort_engine",       "%s",  toString(_sortEngine).c_str());
     result.add (1, "nb_passes",         "%d",  _nb_passes);
     result.add (1, "nb_partitions",     "%d",  _nb_partitions);
     result.add (1, "nb_bits_per_kmer",  "%d",  _nb_bits_per_kmer);
@@ -131,6 +135,17 @@ void Configuration::load (tools::storage::impl::Group& group)
     is.read ((char*)&_nb_banks,           sizeof(_nb_banks));
     is.read ((char*)&_nb_cached_items_per_core_per_part,           sizeof(_nb_cached_items_per_core_per_part));
 
+    /** The next fields were appended later to the blob: a storage saved before doesn't have them,
+     * so they get the values matching the former behavior (no codec, std::sort, superkmers in files). */
+    _superk_codec  = 0;
+    _sortEngine    = tools::misc::SORT_ENGINE_STD;
+    _superk_memory = 0;
+
+    u_int64_t nbBytes = group.getCollection<tools::math::NativeInt8> ("config").getNbItems();
+
+    if ((u_int64_t)is.tellg() + sizeof(_superk_codec)  <= nbBytes)  {  is.read ((char*)&_superk_codec,   sizeof(_superk_codec));   }
+    if ((u_int64_t)is.tellg() + sizeof(_sortEngine)    <= nbBytes)  {  is.read ((char*)&_sortEngine,     sizeof(_sortEngine));     }
+    if ((u_int64_t)is.tellg() + sizeof(_superk_memory) <= nbBytes)  {  is.read ((char*)&_superk_memory,  sizeof(_superk_memory));  }
 
 }
 
@@ -172,6 +187,9 @@ void Configuration::save (tools::storage::impl::Group& group)
     os.write ((const char*)&_nb_bits_per_kmer,           sizeof(_nb_bits_per_kmer));
     os.write ((const char*)&_nb_banks,           sizeof(_nb_banks));
     os.write ((const char*)&_nb_cached_items_per_core_per_part,           sizeof(_nb_cached_items_per_core_per_part));
+    os.write ((const char*)&_superk_codec,           sizeof(_superk_codec));
+    os.write ((const char*)&_sortEngine,           sizeof(_sortEngine));
+    os.write ((const char*)&_superk_memory,           sizeof(_superk_memory));
 
     os.flush();
 
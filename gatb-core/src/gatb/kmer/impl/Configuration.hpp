@@ -42,8 +42,8 @@ public:
     /** */
     Configuration ()
     : _kmerSize(0), _minim_size(0), _repartitionType(0), _minimizerType(0),
-      _solidityKind(tools::misc::KMER_SOLIDITY_SUM),
-      _max_disk_space(0), _max_memory(0),
+      _solidityKind(tools::misc::KMER_SOLIDITY_SUM), _sortEngine(tools::misc::SORT_ENGINE_RADIX),
+      _max_disk_space(0), _max_memory(0), _superk_codec(0), _superk_memory(0),
       _nbCores(0), _nb_partitions_in_parallel(0), _abundanceUserNb(0), _storage_type(tools::storage::impl::STORAGE_HDF5) ,
       _isComputed(false), _nbCores_per_partition(0),
       _estimateSeqNb(0), _estimateSeqTotalSize(0), _estimateSeqMaxSize(0),
@@ -60,9 +60,19 @@ public:
 
     tools::misc::KmerSolidityKind _solidityKind;
 
+    /** Algorithm sorting the kmers of the partitions counted by sorted vector. */
+    tools::misc::SortEngineKind   _sortEngine;
+
     u_int64_t   _max_disk_space;
     u_int32_t   _max_memory;
 
+    /** Codec of the temporary superkmer files (see tools::storage::impl::SuperKmerCodec). */
+    u_int32_t   _superk_codec;
+
+    /** Memory (MB) reserved for keeping the superkmers of a pass in RAM instead of temporary files (0 for files only).
+     * It is taken from _max_memory: the partitions are counted with the rest. */
+    u_int32_t   _superk_memory;
+
     size_t      _nbCores;
     size_t      _nb_partitions_in_parallel;
 
@@ -94,13 +94,13 @@ public:
     /** */
     void operator() (Sequence& sequence)
     {
-        /** We build the kmers from the current sequence. */
-        if (model.build (sequence.getData(), kmers) == false)  {  throw "reached EOF"; return; }
-
-        /** We loop over the kmers. */
-        for (size_t i=0; i<kmers.size(); i++)
+        /** We loop over the kmers of the current sequence; they are directly computed by the model
+         * from the nucleotides buffer, without being stored. */
+        size_t nbKmers = 0;
+        bool found = model.iterate (sequence.getData(), [&] (const KmerType& kmer, size_t idx)
         {
-            linearCounter->add((kmers[i].value()));
+            linearCounter->add((kmer.value()));
+            nbKmers++;
 
 
             // heuristics to stop early, i found that it's inaccurate with low coverage (e.g. on dsk/test/FiftyK.fastq)
@@ -129,8 +129,10 @@ public:
 
             }*/
 
-        }
-        nbProcessedKmers += kmers.size();
+        });
+        if (found == false)  {  throw "reached EOF"; return; }
+
+        nbProcessedKmers += nbKmers;
         nbProcessedReads++;
         //if (nbProcessedReads % 100000 == 0) printf("nb: %ld\n",nbProcessedReads);
 
@@ -170,7 +172,6 @@ private:
     unsigned long nbCurProgressKmers;
     unsigned long nbKmersTotal;
     unsigned long abs_error;
-    vector<KmerType> kmers;
     LinearCounter<span> *linearCounter;
     int eval_every_N_reads;
     unsigned long previous_nb_distinct_kmers, nb_distinct_kmers;
@@ -198,9 +199,11 @@ ConfigurationAlgorithm<span>::ConfigurationAlgorithm (bank::IBank* bank, IProper
     _config._minimizerType      = input->getInt (STR_MINIMIZER_TYPE);
 
     parse (input->getStr (STR_SOLIDITY_KIND), _config._solidityKind);
+    if (input->get(STR_SORT_ENGINE))  {  parse (input->getStr (STR_SORT_ENGINE), _config._sortEngine);  }
 
     _config._max_disk_space     = input->getInt (STR_MAX_DISK);
     _config._max_memory         = input->getInt (STR_MAX_MEMORY);
+    _config._superk_codec       = input->get(STR_TMP_COMPRESS) ? input->getInt(STR_TMP_COMPRESS) : 0;
     _config._nbCores            = input->get(STR_NB_CORES) ? input->getInt(STR_NB_CORES) : 0;
 
     _config._abundance = getSolidityThresholds(input);
@@ -345,6 +348,13 @@ void ConfigurationAlgorithm<span>::execute ()
         }
     }
 
+    /** The superkmers may be kept in RAM instead of temporary files (only with the 'sum' solidity kind, the
+     * other kinds don't use superkmer files). This is done only if the superkmers of a pass fit in half the
+     * max memory; the memory needed for them is then reserved, and the partitions are sized below with
+     * the remaining memory, which is the memory left for counting. */
+    bool superkInMemory = (_input->get(STR_TMP_IN_MEMORY) ? _input->getInt(STR_TMP_IN_MEMORY) != 0 : true)
+        && _config._solidityKind == KMER_SOLIDITY_SUM;
+
     assert (_config._max_disk_space > 0);
 
     _config._nb_passes = ( (_config._volume/4) / _config._max_disk_space ) + 1; //minim, approx volume /switched to approx /4 (was/3) because of more efficient superk storage
@@ -404,8 +414,12 @@ void ConfigurationAlgorithm<span>::execute ()
         assert (_config._max_memory > 0);
         //printf("volume_per_pass %lli  _nbCores %zu _max_memory %i \n",volume_per_pass, _nbCores,_max_memory);
 
+        /** The superkmers take about one byte per kmer (2 bits per nucleotide and a length byte, for a few kmers per superkmer). */
+        u_int64_t superk_volume_per_pass = _config._kmersNb / MBYTE / _config._nb_passes + 1;
+        _config._superk_memory = (superkInMemory && superk_volume_per_pass <= _config._max_memory / 2) ? superk_volume_per_pass : 0;
+
         // _nb_partitions  = ( (volume_per_pass*_nbCores) / _max_memory ) + 1;
-        _config._nb_partitions  = ( ( volume_per_pass* _config._nb_partitions_in_parallel) / _config._max_memory ) + 1;
+        _config._nb_partitions  = ( ( volume_per_pass* _config._nb_partitions_in_parallel) / (_config._max_memory - _config._superk_memory) ) + 1;
 
         //printf("nb passes  %i  (nb part %i / %zu)\n",_nb_passes,_nb_partitions,max_open_files);
         //_nb_partitions = max_open_files; break;
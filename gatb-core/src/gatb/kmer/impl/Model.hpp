@@ -37,6 +37,7 @@
 #include <gatb/tools/designpattern/impl/IteratorHelpers.hpp>
 #include <gatb/tools/misc/api/Data.hpp>
 #include <gatb/tools/misc/api/Abundance.hpp>
+#include <gatb/tools/misc/impl/NucleotideKernels.hpp>
 
 #include <gatb/tools/math/Integer.hpp>
 
@@ -724,6 +725,16 @@ struct Kmer
          */
         template<typename Callback, typename Convert>
         bool iterate (const char* seq, size_t length, Callback callback) const
+        {
+            return iterate<Callback> (seq, length, callback, (Convert*)0);
+        }
+
+        /** Number of nucleotides converted at once by NucleotideKernels when iterating ASCII data. */
+        static const size_t ITERATE_BLOCK_SIZE = 1024;
+
+        /** Generic iteration: the nucleotides are converted one at a time by the Convert class. */
+        template<typename Callback, typename Convert>
+        bool iterate (const char* seq, size_t length, Callback callback, Convert*) const
         {
             /** We compute the number of kmers for the provided data. Note that we have to check that we have
              * enough nucleotides according to the current kmer size. */
@@ -764,6 +775,64 @@ struct Kmer
             return true;
         }
 
+        /** Iteration of ASCII data: the nucleotides are converted by blocks of ITERATE_BLOCK_SIZE with
+         * the SIMD kernels of NucleotideKernels, which also give the invalid nucleotides as a bitmap;
+         * the kmers are then updated from the codes of the block. */
+        template<typename Callback>
+        bool iterate (const char* seq, size_t length, Callback callback, ConvertASCII*) const
+        {
+            int32_t nbKmers = length - _kmerSize + 1;
+            if (nbKmers <= 0)  { return false; }
+
+            typename ModelImpl::Kmer result;
+
+            /** The first kmer is computed as in the generic case. */
+            int indexBadChar = static_cast<const ModelImpl*>(this)->template first<ConvertASCII> (seq, result, 0);
+
+            size_t idxComputed = 0;
+            this->notification<Callback> (result, idxComputed, callback);
+
+            char      codes   [ITERATE_BLOCK_SIZE];
+            u_int64_t invalid [ITERATE_BLOCK_SIZE/64];
+
+            for (size_t start=_kmerSize; start<length; start+=ITERATE_BLOCK_SIZE)
+            {
+                size_t nb = length-start;
+                if (nb > ITERATE_BLOCK_SIZE)  { nb = ITERATE_BLOCK_SIZE; }
+
+                tools::misc::impl::NucleotideKernels::encode (seq+start, nb, codes, invalid);
+
+                for (size_t i=0; i<nb; )
+                {
+                    size_t    end = (i+64 < nb ? i+64 : nb);
+                    u_int64_t bad = invalid[i>>6];
+
+                    if (bad==0 && indexBadChar<0)
+                    {
+                        /** Most of the time, there is no bad nucleotide in the kmers of the 64 nucleotides. */
+                        for ( ; i<end; i++)
+                        {
+                            static_cast<const ModelImpl*>(this)->template next<ConvertASCII> (codes[i], result, true);
+                            this->notification<Callback> (result, ++idxComputed, callback);
+                        }
+                    }
+                    else
+                    {
+                        for ( ; i<end; i++, bad>>=1)
+                        {
+                            if (bad & 1)  { indexBadChar = _kmerSize-1; }
+                            else          { indexBadChar--;     }
+
+                            static_cast<const ModelImpl*>(this)->template next<ConvertASCII> (codes[i], result, indexBadChar<0);
+                            this->notification<Callback> (result, ++idxComputed, callback);
+                        }
+                    }
+                }
+            }
+
+            return true;
+        }
+
         template <class Callcack>
         void  notification (const Kmer& value, size_t idx, Callcack callback) const {  callback (value, idx);  }
 
@@ -0,0 +1,306 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include <gatb/kmer/impl/PartitionScheduler.hpp>
+#include <gatb/system/api/Exception.hpp>
+#include <gatb/system/impl/System.hpp>
+
+#include <algorithm>
+
+// We use the required packages
+using namespace std;
+using namespace gatb::core::system;
+using namespace gatb::core::tools::dp;
+
+#define DEBUG(a)  //printf a
+
+/********************************************************************************/
+namespace gatb  {  namespace core  {   namespace kmer  {   namespace impl {
+/********************************************************************************/
+
+/** Command run by each worker thread. */
+class PartitionScheduler::WorkerCommand : public ICommand, public SmartPointer
+{
+public:
+    WorkerCommand (PartitionScheduler& scheduler) : _scheduler(scheduler)  {}
+    void execute ()  {  _scheduler.work();  }
+private:
+    PartitionScheduler& _scheduler;
+};
+
+/** Comparator putting the tasks needing the most memory first. */
+struct PartitionSchedulerMemoryCmp
+{
+    template<typename T> bool operator() (const T& a, const T& b) const  {  return a.memory > b.memory;  }
+};
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+PartitionScheduler::Stats& PartitionScheduler::Stats::operator+= (const Stats& s)
+{
+    nbParts          += s.nbParts;
+    nbSharedJobs     += s.nbSharedJobs;
+    nbHelps          += s.nbHelps;
+    maxParallelParts  = std::max (maxParallelParts, s.maxParallelParts);
+    maxMemory         = std::max (maxMemory,        s.maxMemory);
+    return *this;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+PartitionScheduler::PartitionScheduler (size_t nbWorkers, u_int64_t maxMemory)
+    : _nbWorkers(std::max (nbWorkers, (size_t)1)), _maxMemory(maxMemory),
+      _nbRunning(0), _exclusiveRunning(false), _usedMemory(0), _aborted(false)
+{
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+PartitionScheduler::~PartitionScheduler ()
+{
+    /** Some commands may not have been run if an exception occurred. */
+    for (list<Task>::iterator it = _pending.begin(); it != _pending.end(); ++it)  {  it->cmd->forget();  }
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void PartitionScheduler::add (ICommand* cmd, u_int64_t memory, bool exclusive)
+{
+    cmd->use();
+
+    Task task = { cmd, memory, exclusive };
+    _pending.push_back (task);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void PartitionScheduler::execute (IDispatcher* dispatcher)
+{
+    /** The biggest partitions are started first, so the small ones fill the gaps at the end.
+     * Note that list::sort is stable, so the partitions of the same size keep their order. */
+    _pending.sort (PartitionSchedulerMemoryCmp());
+
+    vector<ICommand*> cmds;
+    for (size_t i=0; i<_nbWorkers; i++)  {  cmds.push_back (new WorkerCommand (*this));  }
+
+    dispatcher->dispatchCommands (cmds, 0);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void PartitionScheduler::share (Job& job)
+{
+    SharedJob shared;
+    shared.job       = &job;
+    shared.nbWorkers = 0;
+
+    {
+        unique_lock<mutex> lock (_mutex);
+        _jobs.push_back (&shared);
+        _stats.nbSharedJobs++;
+    }
+    _cond.notify_all();
+
+    string error;
+    try                   {  job.work();  }
+    catch (Exception& e)  {  error = e.getMessage();  }
+    catch (exception& e)  {  error = e.what();  }
+
+    unique_lock<mutex> lock (_mutex);
+
+    /** No new worker can join the job now; we wait for the ones still working on it. */
+    _jobs.remove (&shared);
+    _cond.wait (lock, [&shared] { return shared.nbWorkers == 0; });
+
+    if (error.empty())  {  error = shared.error;  }
+    if (!error.empty())  {  throw Exception ("%s", error.c_str());  }
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+bool PartitionScheduler::pickTask (Task& task)
+{
+    if (_exclusiveRunning)  { return false; }
+
+    for (list<Task>::iterator it = _pending.begin(); it != _pending.end(); ++it)
+    {
+        bool ok = false;
+
+        /** An exclusive task waits for the running ones to finish; the next tasks wait for it
+         * (otherwise it could be postponed until the end). */
+        if (it->exclusive)  {  if (_nbRunning == 0) { ok = true; } else { return false; }  }
+        else                {  ok = _nbRunning == 0 || _usedMemory + it->memory <= _maxMemory;  }
+
+        if (ok)
+        {
+            task = *it;
+            _pending.erase (it);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+PartitionScheduler::SharedJob* PartitionScheduler::pickJob ()
+{
+    SharedJob* result = 0;
+
+    /** We help the job with the fewest workers. */
+    for (list<SharedJob*>::iterator it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        if ((*it)->job->hasWork() && (result == 0 || (*it)->nbWorkers < result->nbWorkers))  {  result = *it;  }
+    }
+
+    return result;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void PartitionScheduler::work ()
+{
+    unique_lock<mutex> lock (_mutex);
+
+    while (!_aborted)
+    {
+        Task task;
+
+        if (pickTask (task))
+        {
+            _nbRunning++;
+            _usedMemory += task.memory;
+            _exclusiveRunning = task.exclusive;
+
+            _stats.nbParts++;
+            _stats.maxParallelParts = std::max (_stats.maxParallelParts, (u_int64_t)_nbRunning);
+            _stats.maxMemory        = std::max (_stats.maxMemory,        _usedMemory);
+
+            DEBUG (("PartitionScheduler::work  start task  mem=%lld  running=%d  used=%lld\n", task.memory, _nbRunning, _usedMemory));
+
+            lock.unlock();
+
+            string error;
+            try                   {  task.cmd->execute();  }
+            catch (Exception& e)  {  error = e.getMessage();  }
+            catch (exception& e)  {  error = e.what();  }
+
+            lock.lock();
+
+            /** The command is released here, ie. under the lock (its destructor may update shared information). */
+            task.cmd->forget();
+
+            _nbRunning--;
+            _usedMemory -= task.memory;
+            if (task.exclusive)  { _exclusiveRunning = false; }
+
+            if (!error.empty())  {  _aborted = true;  }
+
+            _cond.notify_all();
+
+            if (!error.empty())  {  throw Exception ("%s", error.c_str());  }
+        }
+        else if (SharedJob* shared = pickJob())
+        {
+            shared->nbWorkers++;
+            _stats.nbHelps++;
+
+            lock.unlock();
+
+            string error;
+            try                   {  shared->job->work();  }
+            catch (Exception& e)  {  error = e.getMessage();  }
+            catch (exception& e)  {  error = e.what();  }
+
+            lock.lock();
+
+            if (!error.empty() && shared->error.empty())  {  shared->error = error;  }
+            shared->nbWorkers--;
+
+            _cond.notify_all();
+        }
+        else if (_pending.empty() && _nbRunning == 0)
+        {
+            break;
+        }
+        else
+        {
+            _cond.wait (lock);
+        }
+    }
+}
+
+/********************************************************************************/
+} } } } /* end of namespaces. */
+/********************************************************************************/
@@ -0,0 +1,195 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/** \file PartitionScheduler.hpp
+ *  \brief Scheduling of the partitions counting between a set of workers
+ */
+
+#ifndef _PARTITION_SCHEDULER_HPP_
+#define _PARTITION_SCHEDULER_HPP_
+
+/********************************************************************************/
+
+#include <gatb/tools/designpattern/api/ICommand.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/********************************************************************************/
+namespace gatb      {
+namespace core      {
+namespace kmer      {
+namespace impl      {
+/********************************************************************************/
+
+/** \brief Scheduler of the partitions counting (fill solid kmers stage of SortingCountAlgorithm)
+ *
+ * The partitions commands are run by a fixed number of workers, the partitions needing the
+ * most memory first. A worker starts a new partition only if its memory fits into what is left
+ * of the memory bound (a partition is always started if nothing else runs). Otherwise, it helps
+ * the running partitions: a partition command may share some phases of its job (reading the
+ * superkmers, sorting the radix buckets) through the 'share' method, and the idle workers then
+ * take tasks of these phases until there is none left.
+ *
+ * So the number of partitions processed in parallel and the number of cores used by each of
+ * them are no more fixed up front, which avoids idle cores waiting for a big partition.
+ */
+class PartitionScheduler
+{
+public:
+
+    /** Part of the job of a partition command that can be done by several workers. */
+    class Job
+    {
+    public:
+
+        /** Destructor. */
+        virtual ~Job() {}
+
+        /** Process tasks of the job until there is none left. This method is called
+         * concurrently by the owner of the job and by the workers helping it. */
+        virtual void work () = 0;
+
+        /** Tell whether a worker joining the job may still find some task.
+         * \return true if some tasks are not taken yet. */
+        virtual bool hasWork () = 0;
+    };
+
+    /** Job made of a known number of independent tasks, picked one by one by the workers. */
+    class IndexedJob : public Job
+    {
+    public:
+
+        /** Constructor.
+         * \param[in] nbTasks : number of tasks of the job. */
+        IndexedJob (size_t nbTasks) : _nbTasks(nbTasks), _next(0)  {}
+
+        /** \copydoc Job::work */
+        void work ()  {  for (size_t idx; (idx = _next++) < _nbTasks; )  { runTask (idx); }  }
+
+        /** \copydoc Job::hasWork */
+        bool hasWork ()  {  return _next < _nbTasks;  }
+
+    protected:
+
+        /** Process one task.
+         * \param[in] idx : index of the task, in [0, nbTasks[ */
+        virtual void runTask (size_t idx) = 0;
+
+    private:
+        size_t              _nbTasks;
+        std::atomic<size_t> _next;
+    };
+
+    /** Statistics of the scheduling. */
+    struct Stats
+    {
+        Stats() : nbParts(0), nbSharedJobs(0), nbHelps(0), maxParallelParts(0), maxMemory(0) {}
+
+        Stats& operator+= (const Stats& s);
+
+        u_int64_t nbParts;           // partitions commands executed
+        u_int64_t nbSharedJobs;      // jobs shared by the partitions commands
+        u_int64_t nbHelps;           // times a worker joined a job of another partition
+        u_int64_t maxParallelParts;  // max number of partitions processed at the same time
+        u_int64_t maxMemory;         // max memory (bytes) reserved by the running partitions
+    };
+
+    /** Constructor.
+     * \param[in] nbWorkers : number of workers
+     * \param[in] maxMemory : memory bound (in bytes) for the partitions run at the same time */
+    PartitionScheduler (size_t nbWorkers, u_int64_t maxMemory);
+
+    /** Destructor. */
+    ~PartitionScheduler ();
+
+    /** Add a partition command to be run.
+     * \param[in] cmd : the command
+     * \param[in] memory : memory (in bytes) needed by the command
+     * \param[in] exclusive : true if the command has to run alone */
+    void add (tools::dp::ICommand* cmd, u_int64_t memory, bool exclusive=false);
+
+    /** Run all the added commands with 'nbWorkers' commands dispatched by the given dispatcher.
+     * The method returns when all the commands are done.
+     * \param[in] dispatcher : dispatcher providing the workers threads. */
+    void execute (tools::dp::IDispatcher* dispatcher);
+
+    /** Called by a running partition command for sharing a job with the idle workers. The calling
+     * thread works on the job too; the method returns when the tasks are done and when all the
+     * workers having joined the job left it.
+     * \param[in] job : the job to be shared */
+    void share (Job& job);
+
+    /** Get the statistics of the scheduling.
+     * \return the statistics */
+    const Stats& getStats() const { return _stats; }
+
+private:
+
+    struct Task
+    {
+        tools::dp::ICommand* cmd;
+        u_int64_t            memory;
+        bool                 exclusive;
+    };
+
+    struct SharedJob
+    {
+        Job*        job;
+        size_t      nbWorkers;
+        std::string error;
+    };
+
+    class WorkerCommand;
+
+    /** Main loop of a worker. */
+    void work ();
+
+    /** Look for a pending task that can be started; the mutex has to be locked. */
+    bool pickTask (Task& task);
+
+    /** Look for a shared job with some work left; the mutex has to be locked. */
+    SharedJob* pickJob ();
+
+    size_t    _nbWorkers;
+    u_int64_t _maxMemory;
+
+    std::mutex              _mutex;
+    std::condition_variable _cond;
+
+    std::list<Task>       _pending;
+    std::list<SharedJob*> _jobs;
+
+    size_t    _nbRunning;
+    bool      _exclusiveRunning;
+    u_int64_t _usedMemory;
+    bool      _aborted;
+
+    Stats _stats;
+};
+
+/********************************************************************************/
+} } } } /* end of namespaces. */
+/********************************************************************************/
+
+#endif /* _PARTITION_SCHEDULER_HPP_ */
@@ -21,6 +21,7 @@
 #include <gatb/tools/collections/impl/OAHash.hpp>
 #include <gatb/tools/collections/impl/Hash16.hpp>
 #include <gatb/tools/misc/impl/Stringify.hpp>
+#include <gatb/tools/math/RadixSort.hpp>
 
 
 using namespace std;
@@ -83,7 +84,8 @@ PartitionsCommand<span>:: PartitionsCommand (
       _pool(pool),
       _globalTimeInfo(timeInfo),
       _processor(0),
-	  _superKstorage(superKstorage)
+	  _superKstorage(superKstorage),
+	  _scheduler(0)
 {
     setProcessor      (processor);
 }
@@ -147,7 +149,8 @@ _kmerSize(kmerSize),
 _cacheSize(cacheSize),
 _pool(pool),
 _globalTimeInfo(timeInfo),
-_processor(0)
+_processor(0),
+_scheduler(0)
 {
 	setProcessor      (processor);
 }
@@ -203,12 +206,34 @@ PartitionsByHashCommand<span>:: PartitionsByHashCommand (
     size_t                  kmerSize,
     MemAllocator&           pool,
     u_int64_t               hashMemory,
-	tools::storage::impl::SuperKmerBinFiles* 		superKstorage
-
+	tools::storage::impl::SuperKmerBinFiles* 		superKstorage,
+    u_int64_t               hashEntries
 )
     : PartitionsCommand<span> (/*partition,*/ processor, cacheSize, progress, timeInfo, pInfo, passi, parti,nbCores,kmerSize,pool,superKstorage),
-     _hashMemory(hashMemory)
+     _hashMemory(hashMemory), _hashEntries(hashEntries)
+{
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+template<size_t span>
+u_int64_t PartitionsByHashCommand<span>::getHashMemory (u_int64_t nbKmers)
 {
+    typedef typename tools::collections::impl::Hash16<Type>::cell cell_t;
+
+    /** The table has a power of 2 of entries; the cells are allocated by chunks of 2^20 cells (see Pool). */
+    static const u_int64_t CELLS_CHUNK = 1 << 20;
+
+    u_int64_t tableSize = 2;
+    while (tableSize < nbKmers)  { tableSize *= 2; }
+
+    return tableSize*sizeof(cell_ptr_t) + (nbKmers/CELLS_CHUNK + 2) * CELLS_CHUNK * sizeof(cell_t);
 }
 
 	
@@ -382,7 +407,10 @@ void PartitionsByHashCommand<span>:: execute ()
 	/** We need a map for storing part of solid kmers. */
 	//OAHash<Type> hash (_hashMemory);
 	
-	Hash16<Type> hash16 (_hashMemory/MBYTE); // now use hash 16 to ensure always finish. needs more ram than OAHash but seems faster
+	// now use hash 16 to ensure always finish. needs more ram than OAHash but seems faster
+	// It is sized from the number of kmers of the partition if known (it is then never dumped), otherwise from the memory.
+	std::unique_ptr< Hash16<Type> > hashHolder (_hashEntries ? new Hash16<Type> (_hashEntries, (u_int64_t*)0) : new Hash16<Type> (_hashMemory/MBYTE));
+	Hash16<Type>& hash16 = *hashHolder;
 	
 
 	
@@ -738,6 +766,372 @@ void PartitionsByHashCommand<span>:: execute ()
 	this->_processor->endPart (this->_pass_num, this->_parti_num);
 };
 
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+/** Decode the superkmers of the blocks of a partition file until its end, calling the functor
+ * for each kmer. Several threads may decode the same file, each block being read by one of them. */
+template<size_t span, typename Functor>
+static void decodeSuperKmers (tools::storage::impl::SuperKmerBinFiles* superKstorage, int fileId, size_t kmerSize, Functor& functor)
+{
+	typedef typename Kmer<span>::Type  Type;
+
+	Type un; un.setVal(1);
+	Type kmerMask = (un << (kmerSize*2)) - un;
+	size_t shift  = 2*(kmerSize-1);
+
+	unsigned char* buffer      = 0;
+	unsigned int   buffer_size = 0;
+	unsigned int   nb_bytes_read;
+
+	while (superKstorage->readBlock (&buffer, &buffer_size, &nb_bytes_read, fileId))
+	{
+		unsigned char* ptr = buffer;
+
+		while (ptr < (buffer+nb_bytes_read)) //decode whole block
+		{
+			//decode a superkmer
+			u_int8_t nbK = *ptr; ptr++;
+			u_int8_t newbyte = 0;
+
+			int rem_size = kmerSize;
+			int nbr = 0;
+
+			Type Tnewbyte, seedk;
+			seedk.setVal(0);
+			while (rem_size >= 4)
+			{
+				newbyte = *ptr; ptr++;
+				Tnewbyte.setVal(newbyte);
+				seedk = seedk | (Tnewbyte << (8*nbr));
+				rem_size -= 4; nbr++;
+			}
+
+			int uid = 4; //uid = nb nt used in current newbyte
+
+			//rest of the seed kmer
+			if (rem_size > 0)
+			{
+				newbyte = *ptr; ptr++;
+				Tnewbyte.setVal(newbyte);
+				seedk = seedk | (Tnewbyte << (8*nbr));
+				uid = rem_size;
+			}
+			seedk = seedk & kmerMask;
+
+			u_int8_t rem = nbK;
+			Type temp = seedk;
+			Type rev_temp = revcomp (temp, kmerSize);
+			Type newnt;
+
+			//iterate over kmers of this superk
+			for (int ii=0; ii< nbK; ii++,rem--)
+			{
+#ifdef NONCANONICAL
+				functor (temp);
+#else
+				functor (std::min (rev_temp, temp));
+#endif
+				if (rem < 2) break; //no more kmers in this superkmer, the last one has just been eaten
+
+				////////now decode next kmer of this superkmer ///////
+				if (uid >= 4) //read next byte
+				{
+					newbyte = *ptr; ptr++;
+					Tnewbyte.setVal(newbyte);
+					uid = 0;
+				}
+
+				newnt = (Tnewbyte >> (2*uid)) & 3; uid++;
+				temp = ((temp << 2) | newnt) & kmerMask;
+
+				newnt.setVal (comp_NT[newnt.getVal()]);
+				rev_temp = ((rev_temp >> 2) | (newnt << shift)) & kmerMask;
+			}
+		}
+	}
+
+	if (buffer != 0)  { free (buffer); }
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+/** Job reading a partition file for PartitionsBySubpartsCommand: it either counts the kmers
+ * per prefix, or puts the kmers of a range of prefixes into their prefix bucket. */
+template<size_t span>
+class SubpartsReadJob : public PartitionScheduler::Job
+{
+public:
+	typedef typename Kmer<span>::Type  Type;
+
+	/** Constructor. */
+	SubpartsReadJob (tools::storage::impl::SuperKmerBinFiles* superKstorage, int fileId, size_t kmerSize, size_t prefixBits,
+					 u_int64_t* hist, size_t lo, size_t hi, u_int64_t* cursors, Type* kmers)
+		: _superKstorage(superKstorage), _fileId(fileId), _kmerSize(kmerSize), _shift(2*kmerSize - prefixBits),
+		  _nbPrefixes(1 << prefixBits), _hist(hist), _lo(lo), _hi(hi), _cursors(cursors), _kmers(kmers), _done(false)  {}
+
+	/** */
+	void work ()
+	{
+		if (_hist)
+		{
+			/** Each worker counts in its own table. */
+			vector<u_int64_t> hist (_nbPrefixes, 0);
+			HistFunctor functor = { hist.data(), _shift };
+			decodeSuperKmers<span> (_superKstorage, _fileId, _kmerSize, functor);
+
+			std::unique_lock<std::mutex> lock (_mutex);
+			for (size_t i=0; i<_nbPrefixes; i++)  { _hist[i] += hist[i]; }
+		}
+		else
+		{
+			FillFunctor functor = { _lo, _hi, _cursors, _kmers, _shift };
+			decodeSuperKmers<span> (_superKstorage, _fileId, _kmerSize, functor);
+		}
+
+		/** We get here only once all the blocks of the file have been taken. */
+		_done = true;
+	}
+
+	/** */
+	bool hasWork ()  { return !_done; }
+
+private:
+
+	struct HistFunctor
+	{
+		u_int64_t* hist;
+		size_t     shift;
+		void operator() (const Type& kmer)  {  hist[(kmer >> shift).getVal()] ++;  }
+	};
+
+	struct FillFunctor
+	{
+		size_t     lo, hi;
+		u_int64_t* cursors;
+		Type*      kmers;
+		size_t     shift;
+		void operator() (const Type& kmer)
+		{
+			size_t prefix = (kmer >> shift).getVal();
+			if (prefix >= lo && prefix < hi)  {  kmers [__sync_fetch_and_add (cursors + prefix, 1)] = kmer;  }
+		}
+	};
+
+	tools::storage::impl::SuperKmerBinFiles* _superKstorage;
+	int        _fileId;
+	size_t     _kmerSize;
+	size_t     _shift;
+	size_t     _nbPrefixes;
+	u_int64_t* _hist;
+	size_t     _lo;
+	size_t     _hi;
+	u_int64_t* _cursors;
+	Type*      _kmers;
+	std::mutex _mutex;
+	std::atomic<bool> _done;
+};
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+/** Job sorting the prefix buckets of a range for PartitionsBySubpartsCommand; each bucket is a task. */
+template<size_t span>
+class SubpartsSortJob : public PartitionScheduler::IndexedJob
+{
+public:
+	typedef typename Kmer<span>::Type  Type;
+
+	/** Constructor. */
+	SubpartsSortJob (Type* kmers, u_int64_t* offsets, size_t lo, size_t hi, SortEngineKind engine)
+		: PartitionScheduler::IndexedJob(hi-lo), _kmers(kmers), _offsets(offsets), _lo(lo), _engine(engine)  {}
+
+protected:
+
+	/** */
+	void runTask (size_t idx)
+	{
+		Type* begin = _kmers + _offsets[_lo+idx];
+		Type* end   = _kmers + _offsets[_lo+idx+1];
+
+		if (_engine == SORT_ENGINE_RADIX)  {  tools::math::radixSort (begin, end-begin);  }
+		else                               {  std::sort (begin, end);                     }
+	}
+
+private:
+	Type*      _kmers;
+	u_int64_t* _offsets;
+	size_t     _lo;
+	SortEngineKind _engine;
+};
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+template<size_t span>
+PartitionsBySubpartsCommand<span>:: PartitionsBySubpartsCommand (
+    CountProcessor*         processor,
+    size_t                  cacheSize,
+    IteratorListener*       progress,
+    TimeInfo&               timeInfo,
+    PartiInfo<5>&           pInfo,
+    int                     passi,
+    int                     parti,
+    size_t                  nbCores,
+    size_t                  kmerSize,
+    MemAllocator&           pool,
+    u_int64_t               memory,
+    tools::storage::impl::SuperKmerBinFiles* superKstorage,
+    SortEngineKind          sortEngine
+)
+    : PartitionsCommand<span> (processor, cacheSize, progress, timeInfo, pInfo, passi, parti,nbCores,kmerSize,pool,superKstorage),
+      _memory(memory), _nbReads(0), _sortEngine(sortEngine)
+{
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+template<size_t span>
+void PartitionsBySubpartsCommand<span>::read (u_int64_t* hist, size_t lo, size_t hi, u_int64_t* cursors, Type* kmers)
+{
+    TIME_INFO (this->_timeInfo, "1.read");
+
+    this->_superKstorage->openFile ("r", this->_parti_num);
+
+    size_t prefixBits = PREFIX_BITS;
+
+    SubpartsReadJob<span> job (
+        this->_superKstorage, this->_parti_num, this->_kmerSize, std::min (2*this->_kmerSize, prefixBits),
+        hist, lo, hi, cursors, kmers
+    );
+
+    /** The idle workers of the scheduler (if any) help us reading the file. */
+    if (this->_scheduler)  {  this->_scheduler->share (job);  }
+    else                   {  job.work ();                    }
+
+    this->_superKstorage->closeFile (this->_parti_num);
+
+    _nbReads ++;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+template<size_t span>
+void PartitionsBySubpartsCommand<span>::execute ()
+{
+    this->_processor->beginPart (this->_pass_num, this->_parti_num, this->_cacheSize, this->getName());
+
+    size_t prefixBits = PREFIX_BITS;
+    size_t nbPrefixes = (size_t)1 << std::min (2*this->_kmerSize, prefixBits);
+
+    /** FIRST: we count the kmers per prefix. */
+    vector<u_int64_t> hist (nbPrefixes, 0);
+    read (hist.data(), 0, 0, 0, 0);
+
+    /** SECOND: we split the prefixes into ranges whose kmers fit in memory. A prefix holding
+     * more kmers than the memory is alone in its range. */
+    u_int64_t maxItems = std::max (_memory / sizeof(Type), (u_int64_t)1);
+    u_int64_t biggest  = 0;
+
+    vector< pair<size_t,size_t> > ranges;
+    for (size_t lo=0; lo<nbPrefixes; )
+    {
+        u_int64_t nb = hist[lo];
+        size_t    hi = lo+1;
+        while (hi < nbPrefixes && nb + hist[hi] <= maxItems)  { nb += hist[hi++]; }
+
+        if (nb > 0)  { ranges.push_back (make_pair (lo, hi)); }
+        biggest = std::max (biggest, nb);
+        lo = hi;
+    }
+
+    DEBUG (("PartitionsBySubpartsCommand::execute:  parti %d  mem %lld MB  %d ranges  biggest %lld kmers\n",
+        this->_parti_num, _memory/MBYTE, ranges.size(), biggest
+    ));
+
+    /** The pool is sized from the biggest range; it exceeds the memory only if a prefix holds too many kmers. */
+    this->_pool.reserve (biggest * sizeof(Type));
+    Type* kmers = (Type*) this->_pool.pool_malloc (biggest * sizeof(Type), "subparts kmers alloc");
+
+    vector<u_int64_t> offsets (nbPrefixes+1, 0);
+    vector<u_int64_t> cursors (nbPrefixes,   0);
+
+    CounterBuilder solidCounter;
+
+    /** THIRD: for each range, we read the kmers into their prefix bucket, sort the buckets and dump the counts. */
+    for (size_t r=0; r<ranges.size(); r++)
+    {
+        size_t lo = ranges[r].first;
+        size_t hi = ranges[r].second;
+
+        u_int64_t nb = 0;
+        for (size_t p=lo; p<hi; p++)  {  offsets[p] = cursors[p] = nb;  nb += hist[p];  }
+        offsets[hi] = nb;
+
+        read (0, lo, hi, cursors.data(), kmers);
+
+        {
+            TIME_INFO (this->_timeInfo, "2.sort");
+
+            SubpartsSortJob<span> job (kmers, offsets.data(), lo, hi, _sortEngine);
+            if (this->_scheduler)  {  this->_scheduler->share (job);  }
+            else                   {  job.work ();                    }
+        }
+
+        {
+            TIME_INFO (this->_timeInfo, "3.dump");
+
+            for (u_int64_t i=0; i<nb; )
+            {
+                u_int64_t j = i+1;
+                while (j < nb && kmers[j] == kmers[i])  { j++; }
+
+                solidCounter.set (j-i);
+                this->insert (kmers[i], solidCounter);
+                i = j;
+            }
+        }
+    }
+
+    /** We update the progress bar. */
+    this->_progress->inc (this->_pInfo.getNbKmer(this->_parti_num));
+
+    this->_processor->endPart (this->_pass_num, this->_parti_num);
+}
+
 /*********************************************************************
         #     #  #######   #####   #######  #######  ######
         #     #  #        #     #     #     #     #  #     #
@@ -1149,6 +1543,50 @@ private:
 	
 };
 	
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+/** Job reading the superkmers file of a partition when the partition is run by a PartitionScheduler.
+ * Each worker joining the job decodes blocks of the file until its end. */
+template<size_t span>
+class ReadSuperKJob : public PartitionScheduler::Job
+{
+public:
+    typedef typename Kmer<span>::Type  Type;
+
+    /** Constructor. */
+    ReadSuperKJob (tools::storage::impl::SuperKmerBinFiles* superKstorage, int fileId, int kmerSize,
+                   uint64_t * r_idx, Type** radix_kmers, uint64_t* radix_sizes)
+        : _superKstorage(superKstorage), _fileId(fileId), _kmerSize(kmerSize),
+          _r_idx(r_idx), _radix_kmers(radix_kmers), _radix_sizes(radix_sizes), _done(false) {}
+
+    /** */
+    void work ()
+    {
+        ReadSuperKCommand<span> (_superKstorage, _fileId, _kmerSize, _r_idx, _radix_kmers, _radix_sizes, 0).execute ();
+
+        /** We get here only once all the blocks of the file have been taken. */
+        _done = true;
+    }
+
+    /** */
+    bool hasWork ()  { return !_done; }
+
+private:
+    tools::storage::impl::SuperKmerBinFiles* _superKstorage;
+    int        _fileId;
+    int        _kmerSize;
+    uint64_t*  _r_idx;
+    Type**     _radix_kmers;
+    uint64_t*  _radix_sizes;
+    std::atomic<bool> _done;
+};
+
 /*********************************************************************
 ** METHOD  :
 ** PURPOSE :
@@ -1172,10 +1610,11 @@ PartitionsByVectorCommand<span>:: PartitionsByVectorCommand (
     size_t              kmerSize,
     MemAllocator&       pool,
     vector<size_t>&     offsets,
-	tools::storage::impl::SuperKmerBinFiles* 		superKstorage
+	tools::storage::impl::SuperKmerBinFiles* 		superKstorage,
+	SortEngineKind      sortEngine
 )
     : PartitionsCommand<span> (/*partition,*/ processor, cacheSize,  progress, timeInfo, pInfo, passi, parti,nbCores,kmerSize,pool,superKstorage),
-        _radix_kmers (0), _bankIdMatrix(0), _radix_sizes(0), _r_idx(0), _nbItemsPerBankPerPart(offsets)
+        _radix_kmers (0), _bankIdMatrix(0), _radix_sizes(0), _r_idx(0), _sortEngine(sortEngine), _nbItemsPerBankPerPart(offsets)
 {
     _dispatcher = new Dispatcher (this->_nbCores);
 }
@@ -1352,6 +1791,14 @@ void PartitionsByVectorCommand<span>::executeRead ()
     {
         /** We iterate the superkmers. */
 
+		if (this->_scheduler)
+		{
+			/** The idle workers of the scheduler help us reading the file. */
+			ReadSuperKJob<span> job (this->_superKstorage, this->_parti_num, this->_kmerSize, _r_idx, _radix_kmers, _radix_sizes);
+			this->_scheduler->share (job);
+		}
+		else
+		{
 			vector<ICommand*> cmds;
 			for (size_t tid=0; tid < this->_nbCores; tid++)
 			{
@@ -1365,8 +1812,7 @@ void PartitionsByVectorCommand<span>::executeRead ()
 			}
 			
 			_dispatcher->dispatchCommands (cmds, 0);
-
-		
+		}
 		
 
 //		printf("-----done ReadSuperKCommand ---\n");
@@ -1393,8 +1839,8 @@ public:
     typedef typename Kmer<span>::Type  Type;
 
     /** Constructor. */
-    SortCommand (Type** kmervec, bank::BankIdType** bankIdMatrix, int begin, int end, uint64_t* radix_sizes)
-        : _deb(begin), _fin(end), _radix_kmers(kmervec), _bankIdMatrix(bankIdMatrix), _radix_sizes(radix_sizes) {}
+    SortCommand (Type** kmervec, bank::BankIdType** bankIdMatrix, int begin, int end, uint64_t* radix_sizes, SortEngineKind engine)
+        : _deb(begin), _fin(end), _radix_kmers(kmervec), _bankIdMatrix(bankIdMatrix), _radix_sizes(radix_sizes), _engine(engine) {}
 
     /** */
     void execute ()
@@ -1409,7 +1855,13 @@ public:
                 /** Shortcuts. */
                 Type* kmers = _radix_kmers  [ii];
 
-                if (_bankIdMatrix)
+                if (_engine == SORT_ENGINE_RADIX)
+                {
+                    /** The bank ids (if any) are moved along with the kmers, no index vector is needed. */
+                    if (_bankIdMatrix)  {  tools::math::radixSort (kmers, _bankIdMatrix[ii], _radix_sizes[ii]);  }
+                    else                {  tools::math::radixSort (kmers, _radix_sizes[ii]);                     }
+                }
+                else if (_bankIdMatrix)
                 {
                     /** NOT OPTIMAL AT ALL... in particular we have to use 'idx' and 'tmp' vectors
                      * which may use (a lot of ?) memory. */
@@ -1460,6 +1912,57 @@ private :
     Type**     _radix_kmers;
     bank::BankIdType** _bankIdMatrix;
     uint64_t*  _radix_sizes;
+    SortEngineKind _engine;
+};
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+/** Job sorting the radix buckets of a partition when the partition is run by a PartitionScheduler.
+ * Each bucket is a task, the biggest buckets being taken first by the workers. */
+template<size_t span>
+class SortJob : public PartitionScheduler::IndexedJob
+{
+public:
+    typedef typename Kmer<span>::Type  Type;
+
+    /** Constructor. */
+    SortJob (Type** kmervec, bank::BankIdType** bankIdMatrix, uint64_t* radix_sizes, size_t nbBuckets, SortEngineKind engine)
+        : PartitionScheduler::IndexedJob(nbBuckets), _radix_kmers(kmervec), _bankIdMatrix(bankIdMatrix),
+          _radix_sizes(radix_sizes), _engine(engine), _order(nbBuckets)
+    {
+        for (size_t i=0; i<_order.size(); i++)  { _order[i] = i; }
+        std::sort (_order.begin(), _order.end(), BiggerFirst(radix_sizes));
+    }
+
+protected:
+
+    /** */
+    void runTask (size_t idx)
+    {
+        int ii = _order[idx];
+        SortCommand<span> (_radix_kmers, _bankIdMatrix, ii, ii, _radix_sizes, _engine).execute ();
+    }
+
+private:
+
+    struct BiggerFirst
+    {
+        uint64_t* _sizes;
+        BiggerFirst (uint64_t* sizes) : _sizes(sizes) {}
+        bool operator() (int a, int b)  { return _sizes[a] > _sizes[b]; }
+    };
+
+    Type**     _radix_kmers;
+    bank::BankIdType** _bankIdMatrix;
+    uint64_t*  _radix_sizes;
+    SortEngineKind _engine;
+    vector<int> _order;
 };
 
 /*********************************************************************
@@ -1475,6 +1978,14 @@ void PartitionsByVectorCommand<span>::executeSort ()
 {
     TIME_INFO (this->_timeInfo, "2.sort");
 
+    if (this->_scheduler)
+    {
+        /** The idle workers of the scheduler help us sorting the radix buckets. */
+        SortJob<span> job (_radix_kmers, _bankIdMatrix, _radix_sizes, 256*(KX+1), _sortEngine);
+        this->_scheduler->share (job);
+        return;
+    }
+
     vector<ICommand*> cmds;
 
     int nwork = 256 / this->_nbCores;
@@ -1495,7 +2006,8 @@ void PartitionsByVectorCommand<span>::executeSort ()
                 _radix_kmers+ IX(xx,0),
                 (_bankIdMatrix ? _bankIdMatrix+ IX(xx,0) : 0),
                 deb, fin,
-                _radix_sizes + IX(xx,0)
+                _radix_sizes + IX(xx,0),
+                _sortEngine
             ));
         }
 
@@ -1821,10 +2333,11 @@ PartitionsByVectorCommand_multibank<span>:: PartitionsByVectorCommand_multibank
 																				 size_t              nbCores,
 																				 size_t              kmerSize,
 																				 MemAllocator&       pool,
-																				 vector<size_t>&     offsets
+																				 vector<size_t>&     offsets,
+																				 SortEngineKind      sortEngine
 																				 )
 : PartitionsCommand_multibank<span> (partition, processor, cacheSize,  progress, timeInfo, pInfo, passi, parti,nbCores,kmerSize,pool),
-_radix_kmers (0), _bankIdMatrix(0), _radix_sizes(0), _r_idx(0), _nbItemsPerBankPerPart(offsets)
+_radix_kmers (0), _bankIdMatrix(0), _radix_sizes(0), _r_idx(0), _sortEngine(sortEngine), _nbItemsPerBankPerPart(offsets)
 {
 	_dispatcher = new Dispatcher (this->_nbCores);
 }
@@ -2001,6 +2514,14 @@ void PartitionsByVectorCommand_multibank<span>::executeSort ()
 {
 	TIME_INFO (this->_timeInfo, "2.sort");
 	
+	if (this->_scheduler)
+	{
+		/** The idle workers of the scheduler help us sorting the radix buckets. */
+		SortJob<span> job (_radix_kmers, _bankIdMatrix, _radix_sizes, 256*(KX+1), _sortEngine);
+		this->_scheduler->share (job);
+		return;
+	}
+	
 	vector<ICommand*> cmds;
 	
 	int nwork = 256 / this->_nbCores;
@@ -2021,7 +2542,8 @@ void PartitionsByVectorCommand_multibank<span>::executeSort ()
 			_radix_kmers+ IX(xx,0),
 			(_bankIdMatrix ? _bankIdMatrix+ IX(xx,0) : 0),
 			deb, fin,
-			_radix_sizes + IX(xx,0)
+			_radix_sizes + IX(xx,0),
+			_sortEngine
 												   ));
 		}
 		
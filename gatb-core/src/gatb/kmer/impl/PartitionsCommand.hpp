@@ -25,6 +25,7 @@
 #include <gatb/bank/api/IBank.hpp>
 
 #include <gatb/kmer/impl/PartiInfo.hpp>
+#include <gatb/kmer/impl/PartitionScheduler.hpp>
 #include <gatb/kmer/api/ICountProcessor.hpp>
 
 #include <gatb/tools/collections/api/Iterable.hpp>
@@ -104,6 +105,18 @@ private:
 	// -- another implem with the old storage (2 kmer per superKmer) that supports multi-bank counting
 	//todo : multi bank kmer counting with new storage or do multi-bank couting externally (merge results like in simka)
 	
+/********************************************************************************/
+/** Ways of counting the kmers of a partition. */
+enum PartitionCountKind
+{
+    /** The kxmers of the partition are sorted in memory (PartitionsByVectorCommand). */
+    PARTITION_COUNT_VECTOR,
+    /** The kmers are inserted in a hash table; it is dumped into sorted temporary files when full (PartitionsByHashCommand). */
+    PARTITION_COUNT_HASH,
+    /** The partition is read several times, the kmers of a range of prefixes being sorted at each pass (PartitionsBySubpartsCommand). */
+    PARTITION_COUNT_SUBPARTS
+};
+
 /********************************************************************************/
 template<size_t span>
 class PartitionsCommand : public gatb::core::tools::dp::ICommand, public system::SmartPointer
@@ -137,6 +150,15 @@ public:
     /** Get the class name (for statistics). */
     virtual const char* getName() const = 0;
 
+    /** Get the number of times the partition file has been read (for statistics).
+     * \return the number of reads. */
+    virtual size_t getNbReads() const { return 1; }
+
+    /** Set the scheduler running the command. If set, the read and sort phases are shared
+     * with the idle workers of the scheduler instead of being dispatched on 'nbCores' threads.
+     * \param[in] scheduler : the scheduler running the command. */
+    void setScheduler (PartitionScheduler* scheduler)  { _scheduler = scheduler; }
+
 protected:
  //   gatb::core::tools::collections::Iterable<Type>&         _partition;
     gatb::core::tools::dp::IteratorListener*                _progress;
@@ -158,6 +180,7 @@ protected:
 	
 	tools::storage::impl::SuperKmerBinFiles* 				_superKstorage;
 
+	PartitionScheduler*                                     _scheduler;
 };
 
 /********************************************************************************/
@@ -186,7 +209,8 @@ public:
         size_t                                          kmerSize,
         gatb::core::tools::misc::impl::MemAllocator&    pool,
         u_int64_t                                       hashMemory,
-		tools::storage::impl::SuperKmerBinFiles* 		superKstorage
+		tools::storage::impl::SuperKmerBinFiles* 		superKstorage,
+        u_int64_t                                       hashEntries = 0
     );
 
     /** Get the class name (for statistics). */
@@ -195,8 +219,80 @@ public:
     /** */
     void execute ();
 
+    /** Get the memory needed by a hash table holding a given number of kmers without
+     * being dumped into temporary files (ie. when sized with the 'hashEntries' argument).
+     * \param[in] nbKmers : number of kmers
+     * \return the memory size in bytes. */
+    static u_int64_t getHashMemory (u_int64_t nbKmers);
+
 private:
     u_int64_t _hashMemory;
+    u_int64_t _hashEntries;
+};
+
+/********************************************************************************/
+/** Command counting a partition that doesn't fit in memory without dumping temporary files:
+ * the partition is read a first time for getting the number of kmers per prefix, then
+ * once for each range of prefixes whose kmers fit in the given memory. The kmers of a
+ * range are sorted by prefix bucket, so the counts are output in sorted order.
+ */
+template<size_t span>
+class PartitionsBySubpartsCommand : public PartitionsCommand<span>
+{
+public:
+
+    /** Shortcut. */
+    typedef typename Kmer<span>::Type           Type;
+    typedef typename Kmer<span>::Count          Count;
+    typedef ICountProcessor<span> CountProcessor;
+
+    /** Number of bits of the prefixes (ie. 8 nucleotides). */
+    static const size_t PREFIX_BITS = 16;
+
+    /** Constructor. */
+    PartitionsBySubpartsCommand (
+        CountProcessor*                                 processor,
+        size_t                                          cacheSize,
+        gatb::core::tools::dp::IteratorListener*        progress,
+        tools::misc::impl::TimeInfo&                    timeInfo,
+        PartiInfo<5>&                                   pInfo,
+        int                                             passi,
+        int                                             parti,
+        size_t                                          nbCores,
+        size_t                                          kmerSize,
+        gatb::core::tools::misc::impl::MemAllocator&    pool,
+        u_int64_t                                       memory,
+        tools::storage::impl::SuperKmerBinFiles*        superKstorage,
+        tools::misc::SortEngineKind                     sortEngine = tools::misc::SORT_ENGINE_RADIX
+    );
+
+    /** Get the class name (for statistics). */
+    const char* getName() const { return "subparts"; }
+
+    /** \copydoc PartitionsCommand::getNbReads */
+    size_t getNbReads() const { return _nbReads; }
+
+    /** */
+    void execute ();
+
+    /** Get the number of reads of a partition file, ie. 1 + the number of ranges of prefixes,
+     * assuming that the kmers are evenly spread over the prefixes.
+     * \param[in] nbKmers : number of kmers of the partition
+     * \param[in] memory : memory for sorting the kmers of a range
+     * \return the estimated number of reads. */
+    static size_t getNbReadsEstimate (u_int64_t nbKmers, u_int64_t memory)  {  return 1 + (nbKmers*sizeof(Type) + memory - 1) / memory;  }
+
+private:
+
+    /** Read the partition file, by all the workers of the scheduler if any.
+     * \param[in] hist : if not null, count of kmers per prefix to be filled
+     * \param[in] lo, hi : range of prefixes [lo,hi[ whose kmers are put in the 'kmers' table
+     * \param[in] cursors : for each prefix of the range, next index in the 'kmers' table */
+    void read (u_int64_t* hist, size_t lo, size_t hi, u_int64_t* cursors, Type* kmers);
+
+    u_int64_t _memory;
+    size_t    _nbReads;
+    tools::misc::SortEngineKind _sortEngine;
 };
 		
 /********************************************************************************/
@@ -239,8 +335,8 @@ public:
 							   size_t                                          kmerSize,
 							   gatb::core::tools::misc::impl::MemAllocator&    pool,
 							   std::vector<size_t>&                            offsets,
-							   tools::storage::impl::SuperKmerBinFiles* 		superKstorage
-							   
+							   tools::storage::impl::SuperKmerBinFiles* 		superKstorage,
+							   tools::misc::SortEngineKind                     sortEngine = tools::misc::SORT_ENGINE_RADIX
 							   );
 	
 	/** Destructor. */
@@ -260,6 +356,8 @@ private:
 	uint64_t*          _r_idx;
 	
 	tools::dp::IDispatcher* _dispatcher;
+
+	tools::misc::SortEngineKind _sortEngine;
 	
 	void executeRead   ();
 	void executeSort   ();
@@ -308,6 +406,10 @@ public:
 	/** Get the class name (for statistics). */
 	virtual const char* getName() const = 0;
 	
+	/** Set the scheduler running the command (the sort phase is then shared with its idle workers).
+	 * \param[in] scheduler : the scheduler running the command. */
+	void setScheduler (PartitionScheduler* scheduler)  { _scheduler = scheduler; }
+	
 protected:
 	gatb::core::tools::collections::Iterable<Type>&         _partition;
 	gatb::core::tools::dp::IteratorListener*                _progress;
@@ -326,6 +428,8 @@ protected:
 	
 	CountProcessor* _processor;
 	void setProcessor (CountProcessor* processor)  { SP_SETATTR(processor); }
+	
+	PartitionScheduler* _scheduler;
 };
 
 
@@ -360,7 +464,8 @@ public:
 										 size_t                                          nbCores,
 										 size_t                                          kmerSize,
 										 gatb::core::tools::misc::impl::MemAllocator&    pool,
-										 std::vector<size_t>&                            offsets
+										 std::vector<size_t>&                            offsets,
+										 tools::misc::SortEngineKind                     sortEngine = tools::misc::SORT_ENGINE_RADIX
 										 );
 	
 	/** Destructor. */
@@ -380,6 +485,8 @@ private:
 	uint64_t*          _r_idx;
 	
 	tools::dp::IDispatcher* _dispatcher;
+
+	tools::misc::SortEngineKind _sortEngine;
 	
 	void executeRead   ();
 	void executeSort   ();
@@ -95,7 +95,8 @@ template<size_t span>
 SortingCountAlgorithm<span>::SortingCountAlgorithm (IProperties* params)
   : Algorithm("dsk", -1, params),
     _bank(0), _repartitor(0),
-    _progress (0), _tmpPartitionsStorage(0), _tmpPartitions(0), _storage(0),_superKstorage(0)
+    _progress (0), _tmpPartitionsStorage(0), _tmpPartitions(0), _storage(0),_superKstorage(0),
+    _superKrawBytes(0), _superKwrittenBytes(0), _superKreadBytes(0), _superKmemoryBytes(0), _superKspilledParts(0)
 {
 }
 
@@ -111,7 +112,8 @@ template<size_t span>
 SortingCountAlgorithm<span>::SortingCountAlgorithm (IBank* bank, IProperties* params)
   : Algorithm("dsk", -1, params),
     _bank(0), _repartitor(0),
-    _progress (0),_tmpPartitionsStorage(0), _tmpPartitions(0), _storage(0),_superKstorage(0)
+    _progress (0),_tmpPartitionsStorage(0), _tmpPartitions(0), _storage(0),_superKstorage(0),
+    _superKrawBytes(0), _superKwrittenBytes(0), _superKreadBytes(0), _superKmemoryBytes(0), _superKspilledParts(0)
 {
     setBank (bank);
 }
@@ -135,7 +137,8 @@ SortingCountAlgorithm<span>::SortingCountAlgorithm (
 )
   : Algorithm("dsk", config._nbCores, params),
     _config(config), _bank(0), _repartitor(0),
-    _progress (0),_tmpPartitionsStorage(0), _tmpPartitions(0), _storage(0),_superKstorage(0)
+    _progress (0),_tmpPartitionsStorage(0), _tmpPartitions(0), _storage(0),_superKstorage(0),
+    _superKrawBytes(0), _superKwrittenBytes(0), _superKreadBytes(0), _superKmemoryBytes(0), _superKspilledParts(0)
 {
     setBank       (bank);
     setRepartitor (repartitor);
@@ -229,6 +232,9 @@ IOptionsParser* SortingCountAlgorithm<span>::getOptionsParser (bool mandatory)
     devParser->push_back (new OptionOneParam (STR_MINIMIZER_TYPE,    "minimizer type (0=lexi, 1=freq)",                false, "0"));
     devParser->push_back (new OptionOneParam (STR_MINIMIZER_SIZE,    "size of a minimizer",                            false, "10"));
     devParser->push_back (new OptionOneParam (STR_REPARTITION_TYPE,  "minimizer repartition (0=unordered, 1=ordered)", false, "0"));
+    devParser->push_back (new OptionOneParam (STR_TMP_COMPRESS,      "compression of temporary superkmer files (0=none, 1=deflate)", false, "0"));
+    devParser->push_back (new OptionOneParam (STR_SORT_ENGINE,       "sort of the partitions kmers (std, radix)",      false, "radix"));
+    devParser->push_back (new OptionOneParam (STR_TMP_IN_MEMORY,     "keep the superkmers in RAM instead of temporary files when they fit in half the max memory (0=no, 1=yes)", false, "1"));
     parser->push_back (devParser);
 
     return parser;
@@ -677,6 +683,10 @@ void SortingCountAlgorithm<span>::execute ()
 	if(_config._solidityKind == KMER_SOLIDITY_SUM)
 		_superKstorage->getFilesStats(totaltmp,biggesttmp,smallesttmp, meantmp);
 
+	/** The bytes of the temporary files are summed over the passes (the files of the last pass are still there). */
+	if(_superKstorage!=0)
+		addCodecStats();
+
 
 	if(_superKstorage!=0)
 	{
@@ -726,7 +736,38 @@ void SortingCountAlgorithm<span>::execute ()
 		getInfo()->add (3, "tmp_file_biggest_(MB)","%lld",biggesttmp/1024LL/1024LL);
 		getInfo()->add (3, "tmp_file_smallest_(MB)","%lld",smallesttmp/1024LL/1024LL);
 		getInfo()->add (3, "tmp_file_mean_(MB)","%.1f",meantmp/1024LL/1024LL);
+
+		getInfo()->add (3, "codec",              "%s",   _config._superk_codec == SUPERK_CODEC_DEFLATE ? "deflate" : "none");
+		getInfo()->add (3, "raw_bytes",          "%lld", _superKrawBytes);
+		getInfo()->add (3, "written_bytes",      "%lld", _superKwrittenBytes);
+		getInfo()->add (3, "read_bytes",         "%lld", _superKreadBytes);
+		getInfo()->add (3, "in_memory_(MB)",     "%.1f", _superKmemoryBytes / (float)MBYTE);
+		getInfo()->add (3, "nb_spilled_parts",   "%lld", _superKspilledParts);
+
+		getInfo()->add (2, "temp_files_writer");
+		getInfo()->add (3, "nb_blocks",           "%lld", _superKwriterStats.nbBlocks);
+		getInfo()->add (3, "queue_depth_max",     "%lld", _superKwriterStats.maxQueueDepth);
+		getInfo()->add (3, "queue_depth_mean",    "%.1f", _superKwriterStats.nbBlocks ? _superKwriterStats.sumQueueDepth / (float)_superKwriterStats.nbBlocks : 0);
+		getInfo()->add (3, "nb_stalls",           "%lld", _superKwriterStats.nbStalls);
+		getInfo()->add (3, "stall_time_(ms)",     "%lld", _superKwriterStats.stallTime / 1000);
+		getInfo()->add (3, "write_time_(ms)",     "%lld", _superKwriterStats.writeTime / 1000);
+	}
+	getInfo()->add (2, "partitions_counting");
+	for (size_t i=0; i<_partitionsStats.size(); i++)
+	{
+		PartitionCountStats& ps = _partitionsStats[i];
+		getInfo()->add (3, Stringify::format ("part_%d", i), "%-8s  mem_(MB) %8.1f  reads %2d  time_(ms) %lld",
+			ps.name, ps.memory/(float)MBYTE, ps.nbReads, ps.time
+		);
 	}
+
+	getInfo()->add (2, "partitions_scheduler");
+	getInfo()->add (3, "nb_parts",           "%lld", _schedulerStats.nbParts);
+	getInfo()->add (3, "max_parallel_parts", "%lld", _schedulerStats.maxParallelParts);
+	getInfo()->add (3, "max_memory_(MB)",    "%lld", _schedulerStats.maxMemory/MBYTE);
+	getInfo()->add (3, "nb_shared_jobs",     "%lld", _schedulerStats.nbSharedJobs);
+	getInfo()->add (3, "nb_helps",           "%lld", _schedulerStats.nbHelps);
+
     /** We dump information about count processors. */
     if (_processors.size()==1)  {  getInfo()->add (2, _processors[0]->getProperties()); }
     else
@@ -1206,12 +1247,20 @@ void SortingCountAlgorithm<span>::fillPartitions (size_t pass, Iterator<Sequence
 			
 			if(_superKstorage!=0)
 			{
+				addCodecStats();
 				delete _superKstorage;
 				_superKstorage =0;
 			}
 			
-			_superKstorage = new SuperKmerBinFiles(_tmpStorageName_superK,"superKparts", _config._nb_partitions) ;
-			
+			/** The superkmers of a partition are kept in RAM as long as they fit in their share of the
+			 * configured memory; beyond that, they are written to the temporary file of the partition. */
+			_superKstorage = new SuperKmerBinFiles(_tmpStorageName_superK,"superKparts", _config._nb_partitions, _config._superk_codec,
+				(u_int64_t)_config._superk_memory * MBYTE
+			);
+
+			/** The filled superkmer blocks are written by a background thread, so that the partitioning
+			 * threads only hand off their buffers instead of waiting for the disk. */
+			_superKstorage->startWriters (1, 16 * _config._nbCores);
 		}
 		/** We update the message of the progress bar. */
 		_progress->setMessage (Stringify::format(progressFormat1, pass+1, _config._nb_passes));
@@ -1234,10 +1283,10 @@ void SortingCountAlgorithm<span>::fillPartitions (size_t pass, Iterator<Sequence
 			size_t groupSize = 1000;
 			bool deleteSynchro = true;
 
-			/** We fill the partitions. Each thread will read synchronously and will
-			 * call FillPartitions in a synchronous way (in order to have global
-			 * BanksStats correctly computed). */
-			getDispatcher()->iterate(
+			/** We fill the partitions. Each thread parses its own parts of the bank if it
+			 * can be split, otherwise it reads synchronously; FillPartitions are deleted in a
+			 * synchronous way (in order to have global BanksStats correctly computed). */
+			getDispatcher()->iterateParts(
 				itSeq,
 				FillPartitions<span, true>(
 				    model, _config._nb_passes, pass, _config._nb_partitions,
@@ -1250,6 +1299,8 @@ void SortingCountAlgorithm<span>::fillPartitions (size_t pass, Iterator<Sequence
 
 			_superKstorage->flushFiles();
 			_superKstorage->closeFiles();
+
+			_superKwriterStats += _superKstorage->getWriterStats();
 		} else {
 			/** We may have several input banks instead of a single one. */
 			std::vector<Iterator<Sequence>*> itBanks =  itSeq->getComposition();
@@ -1272,10 +1323,11 @@ void SortingCountAlgorithm<span>::fillPartitions (size_t pass, Iterator<Sequence
 				size_t groupSize   = 1000;
 				bool deleteSynchro = true;
 
-				/** We fill the partitions. Each thread will read synchronously and will call FillPartitions
-				 * in a synchronous way (in order to have global BanksStats correctly computed). */
+				/** We fill the partitions. Each thread parses its own parts of the bank if it can be split,
+				 * otherwise it reads synchronously; FillPartitions are deleted in a synchronous way
+				 * (in order to have global BanksStats correctly computed). */
 
-			getDispatcher()->iterate(
+			getDispatcher()->iterateParts(
 				itBanks[i],
 				FillPartitions<span, false>(
 					model, _config._nb_passes, pass, _config._nb_partitions,
@@ -1320,26 +1372,180 @@ void SortingCountAlgorithm<span>::fillPartitions (size_t pass, Iterator<Sequence
 ** RETURN  :
 ** REMARKS :
 *********************************************************************/
+/** Command counting one partition in the fill solid kmers stage. It is run by a PartitionScheduler;
+ * the count processor clone and the memory pool of the partition only live during its execution. */
 template<size_t span>
-std::vector<size_t> SortingCountAlgorithm<span>::getNbCoresList (PartiInfo<5>& pInfo)
+class SortingCountAlgorithm<span>::FillSolidKmersCommand : public ICommand, public system::SmartPointer
 {
-    std::vector<size_t> result;
+public:
+
+    /** Constructor. */
+    FillSolidKmersCommand (
+        SortingCountAlgorithm<span>& algo, CountProcessor* processor, size_t pass, size_t parti, PartiInfo<5>& pInfo,
+        PartitionCountKind kind, u_int64_t memory, u_int64_t hashEntries, PartitionScheduler* scheduler, std::mutex& mutex
+    )
+        : _algo(algo), _processor(processor), _pass(pass), _parti(parti), _pInfo(pInfo),
+          _kind(kind), _memory(memory), _hashEntries(hashEntries), _scheduler(scheduler), _mutex(mutex)  {}
 
-    for (size_t p=0; p<_config._nb_partitions; )
+    /** */
+    void execute ()
     {
-        u_int64_t ram_total = 0;
-        size_t i=0;
-        for (i=0; i< _config._nb_partitions_in_parallel && p<_config._nb_partitions
-            && (ram_total ==0  || ((ram_total+(pInfo.getNbSuperKmer(p)*getSizeofPerItem()))  <= _config._max_memory*MBYTE)) ; i++, p++)
+        Configuration& config = _algo._config;
+
+        /** The superkmers kept in RAM (see Configuration::_superk_memory) are not available for counting. */
+        u_int64_t maxMemory = (u_int64_t)(config._max_memory - config._superk_memory)*MBYTE;
+
+        /** The memory per partition used for the cache size, as if '_nb_partitions_in_parallel' partitions were counted at once. */
+        u_int64_t mem = maxMemory / std::max (config._nb_partitions_in_parallel, (size_t)1);
+
+        /** We need to cache the solid kmers partitions.
+         *  NOTE : it is important to save solid kmers by big chunks (ie cache size) in each partition.
+         *  Indeed, if we directly iterate the solid kmers through a Partition::iterator() object,
+         *  one partition is iterated after another one, which doesn't reflect the way they are in filesystem,
+         *  (ie by chunks of solid kmers) which may lead to many moves into the global HDF5 file.
+         *  One solution is to make sure that the written chunks of solid kmers are big enough: here
+         *  we accept to provide at most 2% of the max memory, or chunks of 200.000 items.
+         */
+        size_t cacheSize = std::min ((u_int64_t)(200*1000), mem/(50*sizeof(Count)));
+
+        /** We clone the prototype count processor instance for the current kmers partition. */
+        CountProcessor* processorClone = _processor->clone ();
+        processorClone->use();
+
+        /** The memory pool of the partition. */
+        MemAllocator pool (config._nbCores);
+
+        /* Get the memory taken by this partition if loaded for sorting */
+        u_int64_t memoryPartition = (_pInfo.getNbSuperKmer(_parti)*_algo.getSizeofPerItem()); //in bytes
+
+        ICommand*                cmd  = 0;
+        PartitionsCommand<span>* pcmd = 0;
+
+        if (_kind == PARTITION_COUNT_HASH)
         {
-            ram_total += pInfo.getNbSuperKmer(p)*getSizeofPerItem();
+            cmd = pcmd = new PartitionsByHashCommand<span> (
+                processorClone, cacheSize, _algo._progress, _algo._fillTimeInfo,
+                _pInfo, _pass, _parti, config._nbCores_per_partition, config._kmerSize, pool, _memory, _algo._superKstorage,
+                _hashEntries
+            );
         }
+        else if (_kind == PARTITION_COUNT_SUBPARTS)
+        {
+            cmd = pcmd = new PartitionsBySubpartsCommand<span> (
+                processorClone, cacheSize, _algo._progress, _algo._fillTimeInfo,
+                _pInfo, _pass, _parti, config._nbCores_per_partition, config._kmerSize, pool, _memory, _algo._superKstorage,
+                config._sortEngine
+            );
+            pcmd->setScheduler (_scheduler);
+        }
+        else
+        {
+            u_int64_t memoryPoolSize = memoryPartition;
+
+            /** In case of forcing sorted vector (multiple banks counting for instance), we may have a
+             * partition bigger than the max memory. */
+            if (memoryPartition > maxMemory)
+            {
+                static const int EXCEED_FACTOR = 2;
+
+                if (memoryPartition >= EXCEED_FACTOR*maxMemory)
+                {
+                    unsigned long system_mem = System::info().getMemoryPhysicalTotal();
+
+                    if (memoryPoolSize > system_mem*0.95)
+                    {
+                        throw Exception ("memory issue: %lld bytes required, %lld bytes set by command-line limit, %lld bytes in system memory",
+                            memoryPartition, maxMemory, system_mem
+                        );
+                    }
+                    else
+                        cout << "Warning: memory was initially restricted to " << config._max_memory << " MB, but we actually need to allocate " << memoryPoolSize / MBYTE << " MB due to a partition with " << _pInfo.getNbSuperKmer(_parti) << " superkmers." << endl;
+                }
+            }
+
+            pool.reserve (memoryPoolSize);
+
+            /** Recall that we got the following matrix in _nbKmersPerPartitionPerBank
+             *
+             *           part0  part1  part2 ... partJ
+             *   bank0    xxx    xxx    xxx       xxx
+             *   bank1    xxx    xxx    xxx       xxx
+             *    ...
+             *   bankI    xxx    xxx    xxx       xxx
+             *
+             *   Now, for the current partition p, we want the number of items found for each bank.
+             *
+             *              bank0   bank1   ...   bankI
+             *   offsets :   xxx     xxx           xxx
+             */
+            vector<size_t> nbItemsPerBankPerPart;
+            if (config._solidityKind != KMER_SOLIDITY_SUM)
+            {
+                for (size_t i=0; i<_algo._nbKmersPerPartitionPerBank.size(); i++)
+                {
+                    nbItemsPerBankPerPart.push_back (_algo._nbKmersPerPartitionPerBank[i][_parti] - (i==0 ? 0 : _algo._nbKmersPerPartitionPerBank[i-1][_parti]) );
+                }
+            }
+
+            if (config._solidityKind == KMER_SOLIDITY_SUM)
+            {
+                cmd = pcmd = new PartitionsByVectorCommand<span> (
+                    processorClone, cacheSize, _algo._progress, _algo._fillTimeInfo,
+                    _pInfo, _pass, _parti, config._nbCores_per_partition, config._kmerSize, pool, nbItemsPerBankPerPart, _algo._superKstorage,
+                    config._sortEngine
+                );
+                pcmd->setScheduler (_scheduler);
+            }
+            else
+            {
+                PartitionsByVectorCommand_multibank<span>* vcmd = new PartitionsByVectorCommand_multibank<span> (
+                    (*_algo._tmpPartitions)[_parti], processorClone, cacheSize, _algo._progress, _algo._fillTimeInfo,
+                    _pInfo, _pass, _parti, config._nbCores_per_partition, config._kmerSize, pool, nbItemsPerBankPerPart,
+                    config._sortEngine
+                );
+                vcmd->setScheduler (_scheduler);
+                cmd = vcmd;
+            }
+        }
+
+        /** We count the partition. */
+        ITime::Value t0 = System::time().getTimeStamp();
+
+        cmd->use ();
+        cmd->execute ();
+
+        PartitionCountStats stats;
+        stats.name    = pcmd ? pcmd->getName()    : "vector";
+        stats.nbReads = pcmd ? pcmd->getNbReads() : 1;
+        stats.memory  = _memory;
+        stats.time    = System::time().getTimeStamp() - t0;
 
-        result.push_back (i);
+        cmd->forget ();
+
+        {
+            std::unique_lock<std::mutex> lock (_mutex);
+
+            _algo._partitionsStats [_pass*config._nb_partitions + _parti] = stats;
+
+            /** The clone has done its job, we notify the prototype about it and get rid of it. */
+            vector<CountProcessor*> clones (1, processorClone);
+            _processor->finishClones (clones);
+        }
+        processorClone->forget();
     }
 
-    return result;
-}
+private:
+    SortingCountAlgorithm<span>& _algo;
+    CountProcessor*              _processor;
+    size_t                       _pass;
+    size_t                       _parti;
+    PartiInfo<5>&                _pInfo;
+    PartitionCountKind           _kind;
+    u_int64_t                    _memory;
+    u_int64_t                    _hashEntries;
+    PartitionScheduler*          _scheduler;
+    std::mutex&                  _mutex;
+};
 
 /*********************************************************************
 ** METHOD  :
@@ -1383,188 +1589,76 @@ void SortingCountAlgorithm<span>::fillSolidKmers_aux (ICountProcessor<span>* pro
     _progress->setMessage (Stringify::format (progressFormat2, pass+1, _config._nb_passes));
 
 
-    /** We retrieve the list of cores number for dispatching N partitions in N threads.
-     *  We need to know these numbers for allocating the N maps according to the maximum allowed memory.
-     */
-    vector<size_t> coreList = getNbCoresList(pInfo); //uses _nb_partitions_in_parallel
-
-    /** We need a memory allocator. We give the cores number in order to compute an extra memory
-     * allocation for alignment constraints. */
-    MemAllocator pool (_config._nbCores);
+    /** The superkmers kept in RAM are still there while counting: the partitions were sized (see ConfigurationAlgorithm)
+     * with the max memory minus the memory reserved for them. */
+    u_int64_t maxMemory = (u_int64_t)(_config._max_memory - _config._superk_memory)*MBYTE;
 
-    size_t p = 0;
-    for (size_t i=0; i<coreList.size(); i++)
-    {
-        vector<ICommand*> cmds;
+    /** The partitions are counted by a scheduler: it starts the biggest partitions first, as long
+     * as their memory fits into the max memory, and lets the idle cores help the running ones
+     * in their read and sort phases. So the partitions are no more counted by fixed groups of
+     * '_nb_partitions_in_parallel' partitions. */
+    PartitionScheduler scheduler (_config._nbCores, maxMemory);
 
-        /** We use a vector to hold all the current CountProcessor clones. */
-        vector<CountProcessor*> clones;
+    /** The count processor clones notify the prototype one after another, and record the partitions statistics. */
+    std::mutex mutex;
+    _partitionsStats.resize (_config._nb_passes*_config._nb_partitions);
 
-        size_t currentNbCores = coreList[i];
-        assert (currentNbCores > 0);
+    /** If we have several input banks, we may have to compute kmer solidity for each bank, which
+     * can be currently done only with sorted vector. */
+    bool forceVector  =   _nbKmersPerPartitionPerBank.size() > 1 && ( _config._solidityKind != KMER_SOLIDITY_SUM);
 
-        /** We correct the number of memory per map according to the max allowed memory.
-         * Note that _max_memory has initially been divided by the user provided cores number. */
-        u_int64_t mem = (_config._max_memory*MBYTE)/currentNbCores;
+    /** Beyond this number of reads of a partition file, we prefer a hash table dumped into temporary files.
+     * Each read costs about as much as loading the partition for sorting, while the hash table dumps only
+     * its distinct kmers (and none at all on redundant data), so we keep the reads count low. */
+    static const size_t MAX_SUBPARTS_READS = 4;
 
-        /** We need to cache the solid kmers partitions.
-         *  NOTE : it is important to save solid kmers by big chunks (ie cache size) in each partition.
-         *  Indeed, if we directly iterate the solid kmers through a Partition::iterator() object,
-         *  one partition is iterated after another one, which doesn't reflect the way they are in filesystem,
-         *  (ie by chunks of solid kmers) which may lead to many moves into the global HDF5 file.
-         *  One solution is to make sure that the written chunks of solid kmers are big enough: here
-         *  we accept to provide at most 2% of the max memory, or chunks of 200.000 items.
-         */
-        size_t cacheSize = std::min ((u_int64_t)(200*1000), mem/(50*sizeof(Count)));
-
-        DEBUG (("SortingCountAlgorithm::fillSolidKmers:  mem=%d  computing %zu partitions simultaneously , parti : ",
-            mem/MBYTE, currentNbCores
-        ));
-
-        /** We build a list of 'currentNbCores' commands to be dispatched each one in one thread. */
-        for (size_t j=0; j<currentNbCores; j++, p++)
+    for (size_t p=0; p<_config._nb_partitions; p++)
+    {
+        /* Get the memory taken by this partition if loaded for sorting */
+        u_int64_t memoryPartition = (pInfo.getNbSuperKmer(p)*getSizeofPerItem()); //in bytes
+
+        /** We choose how to count the partition from its kxmers and kmers numbers (see PartiInfo):
+         *  - sorting its kxmers in memory, if they fit in the max memory
+         *  - otherwise with a hash table sized from the kmers number, if it fits in the max memory
+         *  - otherwise by reading the partition several times, sorting a range of kmers prefixes at each pass
+         *  - otherwise (too many passes needed) with a hash table dumped into temporary files when full.
+         * The partitions needing the max memory are counted alone (and the forced vectors exceeding it). */
+        PartitionCountKind kind        = PARTITION_COUNT_VECTOR;
+        u_int64_t          memory      = memoryPartition;
+        u_int64_t          hashEntries = 0;
+
+        if (memoryPartition > maxMemory  && !forceVector)
         {
-            ISynchronizer* synchro = System::thread().newSynchronizer();
-            LOCAL (synchro);
-
-            /** We clone the prototype count processor instance for the current 'p' kmers partition. */
-            CountProcessor* processorClone = processor->clone ();
-
-            /** We use and put the clone into a vector. */
-            processorClone->use();
-            clones.push_back (processorClone);
-
-            DEBUG ((" %zu ", p));
-
-            /* Get the memory taken by this partition if loaded for sorting */
-            uint64_t memoryPartition = (pInfo.getNbSuperKmer(p)*getSizeofPerItem()); //in bytes
-            DEBUG (("  (%llu  MB) ",memoryPartition/MBYTE));
-
-            /** If we have several input banks, we may have to compute kmer solidity for each bank, which
-             * can be currently done only with sorted vector. */
-			bool forceVector  =   _nbKmersPerPartitionPerBank.size() > 1 && ( _config._solidityKind != KMER_SOLIDITY_SUM);
-
-
-            ICommand* cmd = 0;
+            u_int64_t nbKmers    = pInfo.getNbKmer(p);
+            u_int64_t hashMemory = PartitionsByHashCommand<span>::getHashMemory (nbKmers);
 
-            //still use hash if by vector would be too large even with single part at a time
-			//I thought it was not possible to have memoryPartition > _max_memory  && currentNbCores>1 , but inf fact it is possible when
-			// some partitions are of size 0 (see getNbCoresList)
-			if ( ((memoryPartition > mem && currentNbCores==1) || ( memoryPartition > (_config._max_memory*MBYTE) ) )  && !forceVector)
+            if (hashMemory <= maxMemory)
             {
-                if (pool.getCapacity() != 0)  {  pool.reserve(0);  }
-
-
-					cmd = new PartitionsByHashCommand<span>   (
-															   processorClone, cacheSize, _progress, _fillTimeInfo,
-															   pInfo, pass, p, _config._nbCores_per_partition, _config._kmerSize, pool, mem,_superKstorage
-															   );
+                kind = PARTITION_COUNT_HASH;  memory = hashMemory;  hashEntries = nbKmers;
+            }
+            else if (PartitionsBySubpartsCommand<span>::getNbReadsEstimate (nbKmers, maxMemory) <= MAX_SUBPARTS_READS)
+            {
+                kind = PARTITION_COUNT_SUBPARTS;  memory = maxMemory;
             }
             else
             {
-                u_int64_t memoryPoolSize = _config._max_memory*MBYTE;
-
-                /** In case of forcing sorted vector (multiple banks counting for instance), we may have a
-                 * partition bigger than the max memory. */
-                if (forceVector  &&  memoryPartition >= memoryPoolSize)
-                {
-                    static const int EXCEED_FACTOR = 2;
-
-                    if (memoryPartition  < EXCEED_FACTOR*memoryPoolSize)
-                    {						
-                        /** We accept in this case to exceed the allowed memory. */
-                        memoryPoolSize = memoryPartition;
-                    }
-                    else
-                    {
-                        bool strict = false;
-
-                        if (strict)
-                        {
-                            /** We launch an exception. */
-                            throw Exception ("memory issue: %lld bytes required and %lld bytes available",
-                                memoryPartition, memoryPoolSize
-                            );
-                        }
-                        else
-                        {
-                            unsigned long system_mem = System::info().getMemoryPhysicalTotal();
-                            memoryPoolSize = memoryPartition; 
-
-                            if (memoryPoolSize > system_mem*0.95)
-                            {
-                                throw Exception ("memory issue: %lld bytes required, %lld bytes set by command-line limit, %lld bytes in system memory",
-                                    memoryPartition, memoryPoolSize, system_mem
-                                );
-                            }
-                            else
-                                cout << "Warning: memory was initially restricted to " << _config._max_memory << " MB, but we actually need to allocate " << memoryPoolSize / MBYTE << " MB due to a partition with " << pInfo.getNbSuperKmer(p) << " superkmers." << endl;
-                        }
-                    }
-                }
-
-               //if capa pool ==0, reserve max memo , pass pool to partibyvec, will be used  for vec kmers
-                if (pool.getCapacity() == 0)  {  pool.reserve (memoryPoolSize); }
-				else if (memoryPoolSize > pool.getCapacity()) { pool.reserve(0); pool.reserve (memoryPoolSize); }
-
-                /** Recall that we got the following matrix in _nbKmersPerPartitionPerBank
-                 *
-                 *           part0  part1  part2 ... partJ
-                 *   bank0    xxx    xxx    xxx       xxx
-                 *   bank1    xxx    xxx    xxx       xxx
-                 *    ...
-                 *   bankI    xxx    xxx    xxx       xxx
-                 *
-                 *   Now, for the current partition p, we want the number of items found for each bank.
-                 *
-                 *              bank0   bank1   ...   bankI
-                 *   offsets :   xxx     xxx           xxx
-                 */
-                vector<size_t> nbItemsPerBankPerPart;
-                if ( _config._solidityKind != KMER_SOLIDITY_SUM)
-                {
-                    for (size_t i=0; i<_nbKmersPerPartitionPerBank.size(); i++)
-                    {
-                        nbItemsPerBankPerPart.push_back (_nbKmersPerPartitionPerBank[i][p] - (i==0 ? 0 : _nbKmersPerPartitionPerBank[i-1][p]) );
-                    }
-                }
-
-				if ( _config._solidityKind == KMER_SOLIDITY_SUM)
-				{
-					cmd = new PartitionsByVectorCommand<span> (
-															   processorClone, cacheSize, _progress, _fillTimeInfo,
-															   pInfo, pass, p, _config._nbCores_per_partition, _config._kmerSize, pool, nbItemsPerBankPerPart,_superKstorage
-															   );
-				}
-				else
-				{
-					cmd = new PartitionsByVectorCommand_multibank<span> (
-															   (*_tmpPartitions)[p], processorClone, cacheSize, _progress, _fillTimeInfo,
-															   pInfo, pass, p, _config._nbCores_per_partition, _config._kmerSize, pool, nbItemsPerBankPerPart
-															   );
-				}
-
+                kind = PARTITION_COUNT_HASH;  memory = maxMemory;
             }
+        }
 
-            cmds.push_back (cmd);
-
-        } /* end of for (size_t j=0; j<currentNbCores... */
+        DEBUG (("SortingCountAlgorithm::fillSolidKmers:  parti %zu  (%llu  MB)  kind %d  mem %llu MB\n", p, memoryPartition/MBYTE, kind, memory/MBYTE));
 
-        DEBUG (("\n"));
+        scheduler.add (
+            new FillSolidKmersCommand (*this, processor, pass, p, pInfo, kind, memory, hashEntries, &scheduler, mutex),
+            memory, memory >= maxMemory
+        );
+    }
 
-        /** We launch the commands through a dispatcher. */
-        getDispatcher()->dispatchCommands (cmds, 0);
+    /** We launch the partitions commands through the scheduler. */
+    scheduler.execute (getDispatcher());
 
-        /** The N CountProcessor clones should have done their job during the 'dispatchCommands'
-         * We can send a notification about it and get rid of them. */
-        processor->finishClones (clones);
-        for (size_t i=0; i<clones.size(); i++)  { clones[i]->forget(); }  clones.clear();
+    _schedulerStats += scheduler.getStats();
 
-        // free internal memory of pool here
-        pool.free_all();
-    }
-	
-	
 	if(_config._solidityKind == KMER_SOLIDITY_SUM)
 		_superKstorage->closeFiles();
 
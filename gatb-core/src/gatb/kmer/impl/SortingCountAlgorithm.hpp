@@ -35,6 +35,7 @@
 #include <gatb/kmer/impl/BankKmers.hpp>
 #include <gatb/kmer/impl/Configuration.hpp>
 #include <gatb/kmer/impl/PartiInfo.hpp>
+#include <gatb/kmer/impl/PartitionScheduler.hpp>
 #include <gatb/tools/storage/impl/Storage.hpp>
 #include <string>
 
@@ -212,8 +213,8 @@ private:
      */
     void fillSolidKmers_aux (ICountProcessor<span>* processor, size_t pass, PartiInfo<5>& pInfo);
 
-    /** */
-    std::vector <size_t> getNbCoresList (PartiInfo<5>& pInfo);
+    /** Command counting one partition, run by the PartitionScheduler of fillSolidKmers_aux. */
+    class FillSolidKmersCommand;
 
     /** Handle on the configuration information. */
     kmer::impl::Configuration _config;
@@ -260,6 +261,48 @@ private:
 	//superkmer efficient storage
 	tools::storage::impl::SuperKmerBinFiles* _superKstorage;
 	std::string _tmpStorageName_superK;
+
+	//statistics of the partitions scheduler of the fill solid kmers stage, summed over the passes and the count processors
+	PartitionScheduler::Stats _schedulerStats;
+
+	//how each partition (of each pass) has been counted
+	struct PartitionCountStats
+	{
+		PartitionCountStats() : name(""), memory(0), nbReads(0), time(0) {}
+
+		const char* name;     // name of the counting command (vector, hash, subparts)
+		u_int64_t   memory;   // memory (bytes) reserved for the partition
+		size_t      nbReads;  // number of reads of the partition file
+		u_int64_t   time;     // counting time (ms)
+	};
+	std::vector<PartitionCountStats> _partitionsStats;
+
+	//statistics of the superkmer files background writers, summed over the passes
+	tools::storage::impl::SuperKmerBinFiles::WriterStats _superKwriterStats;
+
+	//bytes of the superkmer files (before encoding, written, read), summed over the passes
+	u_int64_t _superKrawBytes;
+	u_int64_t _superKwrittenBytes;
+	u_int64_t _superKreadBytes;
+
+	//superkmers kept in RAM (max over the passes) and partitions spilled to disk (summed over the passes)
+	u_int64_t _superKmemoryBytes;
+	u_int64_t _superKspilledParts;
+
+	void addCodecStats ()
+	{
+		u_int64_t raw, written, read;
+		_superKstorage->getCodecStats (raw, written, read);
+		_superKrawBytes     += raw;
+		_superKwrittenBytes += written;
+		_superKreadBytes    += read;
+
+		u_int64_t memory;
+		int       spilled;
+		_superKstorage->getMemoryStats (memory, spilled);
+		_superKmemoryBytes   = std::max (_superKmemoryBytes, memory);
+		_superKspilledParts += spilled;
+	}
 };
 
 /********************************************************************************/
@@ -53,6 +53,11 @@ public:
     /** Tells whether an item exists or not
      * \return true if the item exists, false otherwise */
     virtual bool contains (const Item& item) = 0;
+
+    /** Hints that the given item is going to be asked through 'contains' soon, so that the
+     * implementation can start loading the memory needed for the answer. Does nothing by default.
+     * \param[in] item : the item to be looked up soon. */
+    virtual void prefetch (const Item& item)  {}
 };
 
 /********************************************************************************/
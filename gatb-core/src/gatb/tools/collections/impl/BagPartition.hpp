@@ -31,6 +31,7 @@
 #include <gatb/tools/collections/impl/BagFile.hpp>
 #include <gatb/tools/collections/impl/BagCache.hpp>
 #include <gatb/system/impl/System.hpp>
+#include <gatb/tools/misc/impl/Stringify.hpp>
 
 #include <string>
 #include <vector>
@@ -79,8 +80,7 @@ private:
 
     std::string getFilename (size_t idx)
     {
-        char filename[128];  snprintf (filename, sizeof(filename), _uriFormat.c_str(), idx);
-        return std::string(filename);
+        return misc::impl::Stringify::format (_uriFormat.c_str(), idx);
     }
 
     std::vector<Bag<Item>*> _partitions;
@@ -35,6 +35,12 @@
 #include <gatb/system/api/types.hpp>
 #include <gatb/tools/misc/api/Enums.hpp>
 #include <bitset>
+#include <algorithm>
+#include <stdlib.h>
+
+#if defined(__AVX2__) || defined(__AVX512F__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 /********************************************************************************/
 namespace gatb          {
@@ -233,6 +239,13 @@ public:
         return true;
     }
 
+    /** \copydoc Container::prefetch. */
+    void prefetch (const Item& item)
+    {
+        u_int64_t h0 = isSizePowOf2 ? _hash (item,0) & tai : _hash (item,0) % tai;
+        __builtin_prefetch (&(blooma [h0 >> 3]), 0, 3);
+    }
+
     /** \copydoc IBloom::contains4. */
 	virtual std::bitset<4> contains4 (const Item& item, bool right)
     {   throw system::ExceptionNotImplemented ();  }
@@ -488,6 +501,13 @@ public:
         }
         return true;
     }
+
+    /** \copydoc Container::prefetch. */
+    void prefetch (const Item& item)
+    {
+        u_int64_t h0 = this->_hash (item,0) % _reduced_tai;
+        __builtin_prefetch (&(this->blooma [h0 >> 3]), 0, 3);
+    }
     
     /** \copydoc IBloom::weight*/
     unsigned long weight()
@@ -641,6 +661,10 @@ public:
         return true;
     }
 
+    /** \copydoc Container::prefetch.
+     * Nothing to do: the neighbors of a kmer share the same block, which contains() already prefetches. */
+    void prefetch (const Item& item)  {}
+
     /** \copydoc IBloom::contains4*/
     std::bitset<4> contains4 (const Item& item, bool right)
     {
@@ -908,6 +932,9 @@ public:
     /** \copydoc IBloom::getName*/
     std::string  getName () const { return "neighbor2"; }
 
+    /** \copydoc Container::prefetch. */
+    void prefetch (const Item& item)  {}
+
     /** \copydoc IBloom::getBitSize*/
     u_int64_t  getBitSize   ()  { return this->_reduced_tai;    }
 
@@ -1234,6 +1261,198 @@ private:
 	
 /********************************************************************************/
 
+/** \brief Blocked Bloom filter implementation
+ *
+ * Each item is mapped to one block of 512 bits (ie. one 64 bytes CPU cache line), so a
+ * query costs at most one cache miss whatever the number of hash functions.
+ *
+ * The block is chosen by the first hash function; the nbHash bit positions inside the block
+ * are derived from a single remix of this hash (double hashing on 9 bits). A query builds the
+ * 512 bits mask of the item and tests it against the block in one go with SSE4.1, AVX2 or
+ * AVX-512 instructions according to the compilation flags (plain 64 bits words otherwise).
+ *
+ * When the items are kmers, contains4 and contains8 compute the blocks of all the (canonical)
+ * neighbors first, so their cache lines are fetched together before being tested.
+ *
+ * The bitset is 64 bytes aligned and its layout does not depend on the address of the array,
+ * so a filter saved through getArray/getSize can be reloaded with the same getBitSize.
+ */
+template <typename Item> class BloomBlocked : public Bloom<Item>
+{
+public:
+
+    /** Constructor.
+     * \param[in] tai_bloom : size (in bits) of the bloom filter (rounded up to a multiple of 512).
+     * \param[in] kmersize : kmer size (used only by contains4 and contains8)
+     * \param[in] nbHash : number of hash functions to use */
+    BloomBlocked (u_int64_t tai_bloom, size_t kmersize, size_t nbHash = 4)
+        : Bloom<Item> (getNbBlocks(tai_bloom)*BLOCK_BITS, nbHash), _nbBlocks(getNbBlocks(tai_bloom)), _kmerSize(kmersize)
+    {
+        /** We replace the array allocated by BloomContainer by a cache line aligned one. */
+        system::impl::System::memory().free (this->blooma);
+
+        void* ptr = 0;
+        if (posix_memalign (&ptr, BLOCK_BITS/8, this->nchar) != 0)  { throw system::Exception ("no memory for blocked Bloom filter"); }
+
+        this->blooma = (u_int8_t*) ptr;
+        system::impl::System::memory().memset (this->blooma, 0, this->nchar);
+
+        Item un;  un.setVal(1);
+        _kmerMask = (un << (_kmerSize*2)) - un;
+    }
+
+    /** Destructor. The array comes from posix_memalign, not from System::memory() (which may be a
+     * MemorySizeStore with a size header before each block): it is released here, and BloomContainer
+     * is left with nothing to free. */
+    ~BloomBlocked ()
+    {
+        ::free (this->blooma);
+        this->blooma = 0;
+    }
+
+    /** \copydoc Bag::insert. */
+    void insert (const Item& item)
+    {
+        u_int64_t  mask[BLOCK_WORDS];
+        u_int64_t* block = getBlock (item, mask);
+
+        for (size_t w=0; w<BLOCK_WORDS; w++)
+        {
+            if (mask[w] && (block[w] & mask[w]) != mask[w])  {  __sync_fetch_and_or (block + w, mask[w]);  }
+        }
+    }
+
+    /** \copydoc Container::contains. */
+    bool contains (const Item& item)
+    {
+        u_int64_t  mask[BLOCK_WORDS];
+        u_int64_t* block = getBlock (item, mask);
+        return testBlock (block, mask);
+    }
+
+    /** \copydoc Container::prefetch. */
+    void prefetch (const Item& item)
+    {
+        __builtin_prefetch ((u_int64_t*) this->blooma + (this->_hash (item,0) % _nbBlocks) * BLOCK_WORDS, 0, 3);
+    }
+
+    /** \copydoc IBloom::contains4*/
+    std::bitset<4> contains4 (const Item& item, bool right)
+    {
+        /** Same neighbors order as BloomNeighborCoherent::contains4 */
+        u_int64_t  mask[4][BLOCK_WORDS];
+        u_int64_t* block[4];
+
+        Item   elem   = right ? (item << 2) & _kmerMask : (item >> 2);
+        size_t shifts = right ? 0 : (_kmerSize-1)*2;
+
+        for (size_t j=0; j<4; j++)
+        {
+            Item nt;  nt.setVal(j);
+            Item neighbor = elem | (nt << shifts);
+            Item rev      = revcomp (neighbor, _kmerSize);
+            if (rev < neighbor)  { neighbor = rev; }
+
+            block[j] = getBlock (neighbor, mask[j]);
+        }
+
+        std::bitset<4> resu;
+        for (size_t j=0; j<4; j++)  {  resu.set (j, testBlock (block[j], mask[j]));  }
+        return resu;
+    }
+
+    /** \copydoc IBloom::contains8*/
+    std::bitset<8> contains8 (const Item& item)
+    {
+        std::bitset<4> resultRight = this->contains4 (item, true);
+        std::bitset<4> resultLeft  = this->contains4 (item, false);
+        std::bitset<8> result;
+        size_t i=0;
+        for (size_t j=0; j<4; j++)  { result.set (i++, resultRight[j]); }
+        for (size_t j=0; j<4; j++)  { result.set (i++, resultLeft [j]); }
+        return result;
+    }
+
+    /** \copydoc IBloom::getName*/
+    std::string  getName () const { return "blocked"; }
+
+    /** \copydoc IBloom::getBitSize*/
+    u_int64_t  getBitSize   ()  { return _nbBlocks*BLOCK_BITS; }
+
+    /** \copydoc IBloom::weight*/
+    unsigned long weight()
+    {
+        const u_int64_t* words = (const u_int64_t*) this->blooma;
+        unsigned long    result = 0;
+        for (u_int64_t i=0; i<_nbBlocks*BLOCK_WORDS; i++)  {  result += __builtin_popcountll (words[i]);  }
+        return result;
+    }
+
+private:
+
+    static const size_t BLOCK_BITS  = 512;
+    static const size_t BLOCK_WORDS = BLOCK_BITS / 64;
+
+    static u_int64_t getNbBlocks (u_int64_t tai_bloom)  {  return std::max ((tai_bloom + BLOCK_BITS - 1) / BLOCK_BITS, (u_int64_t)1);  }
+
+    /** Get the block of the item and fill the mask of its bits in the block. */
+    u_int64_t* getBlock (const Item& item, u_int64_t* mask)
+    {
+        u_int64_t h = this->_hash (item,0);
+
+        u_int64_t* block = (u_int64_t*) this->blooma + (h % _nbBlocks) * BLOCK_WORDS;
+        __builtin_prefetch (block, 0, 3);
+
+        /** The bit positions come from a remix of the hash (murmur3 finalizer), so they
+         * are not correlated to the block index. */
+        u_int64_t g = h;
+        g ^= g >> 33;  g *= 0xff51afd7ed558ccdULL;
+        g ^= g >> 33;  g *= 0xc4ceb9fe1a85ec53ULL;
+        g ^= g >> 33;
+
+        u_int32_t pos  = (u_int32_t) g;
+        u_int32_t step = (u_int32_t) (g >> 32) | 1;
+
+        for (size_t w=0; w<BLOCK_WORDS; w++)  { mask[w] = 0; }
+
+        for (size_t i=0; i<this->n_hash_func; i++, pos += step)
+        {
+            u_int32_t bit = pos & (BLOCK_BITS-1);
+            mask[bit >> 6] |= (u_int64_t)1 << (bit & 63);
+        }
+
+        return block;
+    }
+
+    /** Tell whether all the bits of the mask are set in the block. */
+    static bool testBlock (const u_int64_t* block, const u_int64_t* mask)
+    {
+#if defined(__AVX512F__)
+        __m512i m = _mm512_loadu_si512 (mask);
+        __m512i b = _mm512_load_si512  (block);
+        return _mm512_test_epi64_mask (_mm512_andnot_si512 (b, m), m) == 0;
+#elif defined(__AVX2__)
+        return _mm256_testc_si256 (_mm256_load_si256 ((const __m256i*) (block+0)), _mm256_loadu_si256 ((const __m256i*) (mask+0)))
+            &  _mm256_testc_si256 (_mm256_load_si256 ((const __m256i*) (block+4)), _mm256_loadu_si256 ((const __m256i*) (mask+4)));
+#elif defined(__SSE4_1__)
+        return _mm_testc_si128 (_mm_load_si128 ((const __m128i*) (block+0)), _mm_loadu_si128 ((const __m128i*) (mask+0)))
+            &  _mm_testc_si128 (_mm_load_si128 ((const __m128i*) (block+2)), _mm_loadu_si128 ((const __m128i*) (mask+2)))
+            &  _mm_testc_si128 (_mm_load_si128 ((const __m128i*) (block+4)), _mm_loadu_si128 ((const __m128i*) (mask+4)))
+            &  _mm_testc_si128 (_mm_load_si128 ((const __m128i*) (block+6)), _mm_loadu_si128 ((const __m128i*) (mask+6)));
+#else
+        u_int64_t missing = 0;
+        for (size_t w=0; w<BLOCK_WORDS; w++)  {  missing |= mask[w] & ~block[w];  }
+        return missing == 0;
+#endif
+    }
+
+    u_int64_t _nbBlocks;
+    size_t    _kmerSize;
+    Item      _kmerMask;
+};
+
+/********************************************************************************/
+
 /** \brief Factory that creates IBloom instances
  *
  */
@@ -1259,6 +1478,7 @@ public:
             case tools::misc::BLOOM_BASIC:     return new BloomSynchronized<T>     (tai_bloom, nbHash);
             case tools::misc::BLOOM_CACHE:     return new BloomCacheCoherent<T>    (tai_bloom, nbHash);
 			case tools::misc::BLOOM_NEIGHBOR:  return new BloomNeighborCoherent<T> (tai_bloom, kmersize, nbHash);
+            case tools::misc::BLOOM_BLOCKED:   return new BloomBlocked<T>          (tai_bloom, kmersize, nbHash);
             case tools::misc::BLOOM_DEFAULT:   return new BloomCacheCoherent<T>    (tai_bloom, nbHash);
             default:        throw system::Exception ("bad Bloom kind %d in createBloom", kind);
         }
@@ -303,6 +303,13 @@ public:
         return bphf.lookup (key);
     }
 
+    /** Prefetches the memory read by a later call to operator() for the given key.
+     * \param[in] key : the key to be hashed soon */
+    void prefetch (const Key& key)
+    {
+        bphf.prefetch (key);
+    }
+
     /** Returns the number of keys.
      * \return keys number */
     size_t size() const { return bphf.nbKeys(); }
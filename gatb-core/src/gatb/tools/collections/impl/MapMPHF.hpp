@@ -220,6 +220,9 @@ namespace gatb        {
 						
 						/** Get the hash code of the given key. */
 						typename Hash::Code getCode (const Key& key) { return hash(key); }
+
+						/** Prefetch the memory needed by a later getCode of the given key. */
+						void prefetchCode (const Key& key) { hash.prefetch(key); }
 						
 						/** Get the number of keys.
 						 * \return keys number. */
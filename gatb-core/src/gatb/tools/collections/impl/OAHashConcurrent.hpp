@@ -0,0 +1,238 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/** \file OAHashConcurrent.hpp
+ *  \brief Open addressing hash table supporting concurrent lookups and insertions
+ */
+
+#ifndef _GATB_CORE_TOOLS_COLLECTIONS_IMPL_OAHASH_CONCURRENT_HPP_
+#define _GATB_CORE_TOOLS_COLLECTIONS_IMPL_OAHASH_CONCURRENT_HPP_
+
+/********************************************************************************/
+
+#include <gatb/system/impl/System.hpp>
+#include <gatb/tools/math/LargeInt.hpp>
+#include <vector>
+
+/********************************************************************************/
+namespace gatb          {
+namespace core          {
+namespace tools         {
+namespace collections   {
+namespace impl          {
+/********************************************************************************/
+
+/** \brief Open addressing hash table with lock-free lookups and insertions.
+ *
+ * The value of a key is its insertion rank: the n-th inserted key gets the value n-1,
+ * so the values are dense and the keys can be retrieved in insertion order (see getKeys).
+ *
+ * Each slot holds a key and a 32 bits state word; a slot is claimed by a CAS on its state
+ * (empty -> busy), the key is written and the state is then published with the rank.
+ * Readers that meet a busy slot wait for the rank to be published.
+ *
+ * The table never rehashes: when the last level reaches half of its capacity, a new level
+ * twice as large is appended and receives the subsequent insertions. Lookups scan the
+ * levels in order. A key may end up in two levels if it is inserted concurrently while a
+ * level gets full; each copy has its own rank, which is harmless as long as the caller
+ * only relies on the key <-> rank association.
+ */
+template <typename Item> class OAHashConcurrent
+{
+public:
+
+    /** Constructor.
+     * \param[in] nbItems : expected number of items (used to size the first level). */
+    OAHashConcurrent (u_int64_t nbItems) : _nbItems(0), _memory(system::impl::System::memory())
+    {
+        for (size_t i=0; i<MAX_LEVELS; i++)  { _levels[i] = 0; }
+
+        u_int64_t capacity = 1024;
+        while (capacity < 2*nbItems)  { capacity *= 2; }
+
+        _levels[0] = newLevel (capacity);
+    }
+
+    /** Destructor. */
+    ~OAHashConcurrent ()
+    {
+        for (size_t i=0; i<MAX_LEVELS && _levels[i]!=0; i++)  { deleteLevel (_levels[i]); }
+    }
+
+    /** Get the value (ie. insertion rank) of a key. Safe to call during insertions.
+     * \param[in] key : key to look for
+     * \param[out] val : value of the key, if found
+     * \return true if the key is found, false otherwise. */
+    bool get (const Item& key, u_int32_t* val) const
+    {
+        u_int64_t h = hash1 (key, 0);
+
+        for (size_t l=0; l<MAX_LEVELS; l++)
+        {
+            Level* level = _levels[l];
+            if (level == 0)  { break; }
+
+            for (u_int64_t i=h & level->mask; ; i = (i+1) & level->mask)
+            {
+                u_int32_t state = waitPublished (level->states + i);
+                if (state == EMPTY)  { break; }
+                if (level->keys[i] == key)  {  *val = state;  return true;  }
+            }
+        }
+        return false;
+    }
+
+    /** Insert a key if it is not already in the table.
+     * \param[in] key : key to insert
+     * \param[out] val : value of the key, either the newly allocated rank or the existing one
+     * \return true if the key has been inserted by this call, false if it was already present. */
+    bool insertIfAbsent (const Item& key, u_int32_t* val)
+    {
+        u_int64_t h = hash1 (key, 0);
+
+        for (size_t l=0; l<MAX_LEVELS; l++)
+        {
+            Level* level = _levels[l];
+
+            if (level == 0)
+            {
+                /** The previous level is full: we append a new one, unless another thread did it. */
+                Level* newOne = newLevel (2*(_levels[l-1]->mask+1));
+                if (! __sync_bool_compare_and_swap (&_levels[l], (Level*)0, newOne))  {  deleteLevel (newOne);  }
+                level = _levels[l];
+            }
+
+            for (u_int64_t i=h & level->mask; ; i = (i+1) & level->mask)
+            {
+                u_int32_t state = waitPublished (level->states + i);
+
+                if (state == EMPTY)
+                {
+                    /** The key is not in this level; we go to the next one if this one is full. */
+                    if (level->nbItems >= (level->mask+1)/2)  { break; }
+
+                    if (! __sync_bool_compare_and_swap (level->states + i, EMPTY, BUSY))
+                    {
+                        /** Another thread claimed the slot first: we check its key. */
+                        state = waitPublished (level->states + i);
+                        if (level->keys[i] == key)  {  *val = state;  return false;  }
+                        continue;
+                    }
+
+                    level->keys[i] = key;
+                    __sync_fetch_and_add (&level->nbItems, 1);
+
+                    *val = __sync_fetch_and_add (&_nbItems, 1);
+                    __sync_lock_test_and_set (level->states + i, *val);
+                    return true;
+                }
+
+                if (level->keys[i] == key)  {  *val = state;  return false;  }
+            }
+        }
+
+        throw system::Exception ("OAHashConcurrent: too many levels");
+    }
+
+    /** Get the number of inserted items.
+     * \return the number of items. */
+    u_int32_t size () const  { return _nbItems; }
+
+    /** Get the keys in insertion order, ie. keys[v] is the key of value v.
+     * Must not be called concurrently with insertions.
+     * \param[out] keys : the keys of the table. */
+    void getKeys (std::vector<Item>& keys) const
+    {
+        keys.resize (_nbItems);
+
+        for (size_t l=0; l<MAX_LEVELS && _levels[l]!=0; l++)
+        {
+            Level* level = _levels[l];
+            for (u_int64_t i=0; i<=level->mask; i++)
+            {
+                if (level->states[i] != EMPTY)  {  keys[level->states[i]] = level->keys[i];  }
+            }
+        }
+    }
+
+    /** Get the memory used by the table.
+     * \return the size in bytes. */
+    u_int64_t getByteSize () const
+    {
+        u_int64_t result = 0;
+        for (size_t l=0; l<MAX_LEVELS && _levels[l]!=0; l++)
+        {
+            result += (_levels[l]->mask+1) * (sizeof(Item) + sizeof(u_int32_t));
+        }
+        return result;
+    }
+
+private:
+
+    static const u_int32_t EMPTY = ~0u;
+    static const u_int32_t BUSY  = ~0u - 1;
+
+    static const size_t MAX_LEVELS = 32;
+
+    struct Level
+    {
+        u_int64_t           mask;
+        Item*               keys;
+        volatile u_int32_t* states;
+        u_int64_t           nbItems;
+    };
+
+    Level* newLevel (u_int64_t capacity)
+    {
+        Level* level   = new Level;
+        level->mask    = capacity - 1;
+        level->keys    = (Item*)      _memory.calloc (capacity, sizeof(Item));
+        level->states  = (u_int32_t*) _memory.calloc (capacity, sizeof(u_int32_t));
+        level->nbItems = 0;
+        _memory.memset ((void*)level->states, 0xFF, capacity*sizeof(u_int32_t));
+        return level;
+    }
+
+    void deleteLevel (Level* level)
+    {
+        _memory.free (level->keys);
+        _memory.free ((void*)level->states);
+        delete level;
+    }
+
+    /** Read a slot state, waiting for its owner to publish it if it is being inserted. */
+    static u_int32_t waitPublished (volatile u_int32_t* state)
+    {
+        u_int32_t result;
+        while ((result = *state) == BUSY)  {}
+        __sync_synchronize ();
+        return result;
+    }
+
+    Level* volatile  _levels[MAX_LEVELS];
+    u_int32_t        _nbItems;
+
+    system::IMemory& _memory;
+};
+
+/********************************************************************************/
+} } } } } /* end of namespaces. */
+/********************************************************************************/
+
+#endif /* _GATB_CORE_TOOLS_COLLECTIONS_IMPL_OAHASH_CONCURRENT_HPP_ */
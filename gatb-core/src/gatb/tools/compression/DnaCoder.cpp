@@ -332,7 +332,11 @@ void DnaEncoder::writeBlock(){
 	
 	if(! _leon->_isFasta)
 	{
-		_leon->writeBlockLena((u_int8_t*) _bufferQuals, _bufferQuals_idx ,_processedSequenceCount, blockId);
+		if(_leon->_qualContextModel)
+			_qualCoder.encode(_bufferQuals, _bufferQuals_idx, _qualBlock);
+		else
+			Leon::deflateQualBlock(_bufferQuals, _bufferQuals_idx, _qualBlock);
+		_leon->writeBlockQual(&_qualBlock[0], _qualBlock.size(), _bufferQuals_idx, blockId);
 		_bufferQuals_idx = 0;
 	}
 	
@@ -1287,6 +1291,14 @@ void QualDecoder::execute(){
 	
 	if(!_inputStream->good()) printf("inputstream E bad \n");
 
+	//blocks of older files are deflate streams
+	if(_blockSize > 0 && (u_int8_t) _inbuffer[0] == QualCoder::CODEC_ID)
+	{
+		_qualCoder.decode(_inbuffer, _blockSize, _buffer);
+		_finished = true;
+		return;
+	}
+
 	//_inputFile->read(_inbuffer,_blockSize );
 	
 	//printf("----Begin decomp of Block     ----\n");
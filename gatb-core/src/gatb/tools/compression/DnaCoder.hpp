@@ -25,6 +25,7 @@
 #include <gatb/gatb_core.hpp>
 //#include "RangeCoder.hpp"
 #include "Leon.hpp"
+#include "QualCoder.hpp"
 //#include "CompressionUtils.hpp"
 
 //#define PRINT_DISTRIB
@@ -149,6 +150,9 @@ class DnaEncoder : AbstractDnaCoder
 	char * _bufferQuals;
 	unsigned int _bufferQuals_idx;
 	unsigned int _bufferQuals_size;
+
+	QualCoder _qualCoder;
+	vector<u_int8_t> _qualBlock;
 	
 #ifdef PRINT_DISTRIB
 	vector<Sequence*> _sequences;
@@ -289,6 +293,8 @@ private:
 	
 	char * _inbuffer;
 	//ifstream* _inputFile;
+
+	QualCoder _qualCoder;
 	
 	tools::storage::impl::Storage::istream *_inputStream;
 
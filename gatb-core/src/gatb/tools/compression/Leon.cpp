@@ -37,6 +37,7 @@ const char* Leon::STR_TEST_DECOMPRESSED_FILE = "-test-file";
 const char* Leon::STR_DNA_ONLY = "-seq-only";
 const char* Leon::STR_NOHEADER = "-noheader";
 const char* Leon::STR_NOQUAL = "-noqual";
+const char* Leon::STR_QUAL_CONTEXT = "-qual-context";
 
 const char* Leon::STR_DATA_INFO = "Info";
 const char* Leon::STR_INIT_ITER = "-init-iterator";
@@ -86,8 +87,10 @@ _progress_decode(0),_generalModel(256),_inputBank(0),_anchorDictModel(5)
 	_compressed_qualSize = _anchorDictSize = _MCmultipleSolid = _anchorAdressSize = _readWithoutAnchorCount = _anchorPosSize = 0;
 	_input_qualSize = _total_nb_quals_smoothed = _otherSize =  _readSizeSize =  _bifurcationSize =  _noAnchorSize = 0;
 	_lossless = false;
+	_qualContextModel = false;
 	_storageH5file = 0;
 	_bloom = 0;
+	_decompressionSetupDone = false;
 	
 	_isFasta = true;
 	_maxSequenceSize = 0;
@@ -127,6 +130,7 @@ _progress_decode(0),_generalModel(256),_inputBank(0),_anchorDictModel(5)
 
 	compressionParser->push_back (new OptionNoParam (Leon::STR_NOHEADER, "discard header", false));
 	compressionParser->push_back (new OptionNoParam (Leon::STR_NOQUAL, "discard quality scores", false));
+	compressionParser->push_back (new OptionNoParam (Leon::STR_QUAL_CONTEXT, "code quality scores with an order-2 context model instead of deflate (about 28% smaller, but decompression is about 15x slower)", false));
 
     IOptionsParser* decompressionParser = new OptionsParser ("decompression");
     decompressionParser->push_back (new OptionNoParam (Leon::STR_TEST_DECOMPRESSED_FILE, "check if decompressed file is the same as original file (both files must be in the same folder)", false));
@@ -139,9 +143,9 @@ _progress_decode(0),_generalModel(256),_inputBank(0),_anchorDictModel(5)
     getParser()->push_back (compressionParser);
     getParser()->push_back (decompressionParser, 0, false);
 
-	pthread_mutex_init(&findAndInsert_mutex, NULL);
 	pthread_mutex_init(&writeblock_mutex, NULL);
 	pthread_mutex_init(&minmax_mutex, NULL);
+	pthread_mutex_init(&decodeblock_mutex, NULL);
 
 	
 }
@@ -169,6 +173,9 @@ void Leon::execute()
 	
 	if(getParser()->saw ("-lossless"))
 		_lossless = true;
+
+	if(getParser()->saw (Leon::STR_QUAL_CONTEXT))
+		_qualContextModel = true;
 		
     _compress = false;
     _decompress = false;
@@ -578,62 +585,49 @@ void Leon::endQualCompression(){
 }
 
 
-void Leon::writeBlockLena(u_int8_t* data, u_int64_t size, int encodedSequenceCount,u_int64_t blockID){
-
+void Leon::deflateQualBlock(const char* quals, u_int64_t size, vector<u_int8_t>& output){
 
 	z_stream zs;
 	memset(&zs, 0, sizeof(zs));
 	
-	//deflateinit2 to be able to gunzip it fro mterminal
-	
-	//if(deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
-		//			(15+16), 8, Z_DEFAULT_STRATEGY) != Z_OK)
-	
-	
-			if (deflateInit(&zs, Z_BEST_COMPRESSION) != Z_OK)
+	if (deflateInit(&zs, Z_BEST_COMPRESSION) != Z_OK)
 		throw Exception ("deflateInit failed while compressing.");
 	
-	zs.next_in = (Bytef*) data ;
-	zs.avail_in = size ;           // set the z_stream's input
+	output.resize(deflateBound(&zs, size));
 	
-	int ret;
-	char outbuffer[32768];
-	std::string outstring;
-	
-	// retrieve the compressed bytes blockwise
-	do {
-		zs.next_out = reinterpret_cast<Bytef*>(outbuffer);
-		zs.avail_out = sizeof(outbuffer);
-		
-		ret = deflate(&zs, Z_FINISH);
-		
-		if (outstring.size() < zs.total_out) {
-			// append the block to the output string
-			outstring.append(outbuffer,
-							 zs.total_out - outstring.size());
-		}
-	} while (ret == Z_OK);
+	zs.next_in = (Bytef*) quals;
+	zs.avail_in = size;
+	zs.next_out = (Bytef*) &output[0];
+	zs.avail_out = output.size();
 	
+	//the output is sized by deflateBound: a single call compresses the whole block
+	int ret = deflate(&zs, Z_FINISH);
 	deflateEnd(&zs);
 	
-	/////////////////
-
+	if (ret != Z_STREAM_END)
+		throw Exception ("deflate failed while compressing.");
 	
+	output.resize(zs.total_out);
+}
+
+
+void Leon::writeBlockQual(u_int8_t* data, u_int64_t size, u_int64_t inputSize, u_int64_t blockID){
+
 	pthread_mutex_lock(&writeblock_mutex);
 	
 	std::string datasetname = Stringify::format ("qual_%i",blockID);
 	
 	tools::storage::impl::Storage::ostream os (*_subgroupQual, datasetname);
-	os.write (reinterpret_cast<char const*>( outstring.data()), outstring.size());
+	os.write (reinterpret_cast<char const*>(data), size);
 	os.flush();
 
-	std::string dsize = Stringify::format ("%i",outstring.size());
+	std::string dsize = Stringify::format ("%i",(int)size);
 	auto _tempcollec = & _subgroupQual->getCollection<math::NativeInt8> (datasetname);
 	_tempcollec->addProperty ("size",dsize);
 
 	
-	_input_qualSize += size;
-	_compressed_qualSize +=  outstring.size();
+	_input_qualSize += inputSize;
+	_compressed_qualSize +=  size;
 	
 //	if ((2*(blockID+1)) > _qualBlockSizes.size() )
 //	{
@@ -673,7 +667,7 @@ void Leon::writeBlock(u_int8_t* data, u_int64_t size, int encodedSequenceCount,u
 		os.write (reinterpret_cast<char const*>( data), size);
 		os.flush();
 		
-		std::string dsize = Stringify::format ("%i",size);
+		std::string dsize = Stringify::format ("%i",(int)size);
 		auto _tempcollec = & _subgroupHeader->getCollection<math::NativeInt8> (datasetname);
 		_tempcollec->addProperty ("size",dsize);
 	}
@@ -687,7 +681,7 @@ void Leon::writeBlock(u_int8_t* data, u_int64_t size, int encodedSequenceCount,u
 		os.write (reinterpret_cast<char const*>( data), size);
 		os.flush();
 		
-		std::string dsize = Stringify::format ("%i",size);
+		std::string dsize = Stringify::format ("%i",(int)size);
 		auto _tempcollec = & _subgroupDNA->getCollection<math::NativeInt8> (datasetname);
 		_tempcollec->addProperty ("size",dsize);
 	}
@@ -916,8 +910,9 @@ void Leon::startDnaCompression(){
 
 
 //	_anchorKmers = new Hash16<kmer_type, u_int32_t > ( (nbestimated/10) *  sizeof(u_int32_t)  *10LL /1024LL / 1024LL ); // hmm  Hash16 would need a constructor with sizeof main entry //maybe *2 for low coverage dataset
-	u_int64_t nbcreated ;
-	_anchorKmers = new Hash16<kmer_type, u_int32_t > ( nbestimated/10 , &nbcreated ); //creator with nb entries given
+	//u_int64_t nbcreated ;
+	//_anchorKmers = new Hash16<kmer_type, u_int32_t > ( nbestimated/10 , &nbcreated ); //creator with nb entries given
+	_anchorKmers = new OAHashConcurrent<kmer_type> ( nbestimated/10 ); //grows by itself if the estimate is too low
 //	printf("asked %lli entries, got %llu \n",nbestimated/10 ,nbcreated);
 	
     Iterator<Sequence>* itSeq = createIterator<Sequence> (
@@ -1033,6 +1028,15 @@ void Leon::writeBloom(){
 
 void Leon::writeAnchorDict(){
 
+	//the anchors are written in the dict in adress order, the decoder numbers them by position
+	vector<kmer_type> anchors;
+	_anchorKmers->getKeys(anchors);
+	_anchorAdress = anchors.size();
+
+	for(u_int32_t i=0; i<anchors.size(); i++){
+		encodeInsertedAnchor(anchors[i]);
+	}
+
 	_anchorRangeEncoder.flush();
 	
 	//todo check if the tempfile _dictAnchorFile may be avoided (with the use of hdf5 ?)
@@ -1104,7 +1108,8 @@ void Leon::updateMinMaxSequenceSize(int newMin, int newMax)
 
 int Leon::findAndInsertAnchor(const vector<kmer_type>& kmers, u_int32_t* anchorAdress){
 	
-	pthread_mutex_lock(&findAndInsert_mutex);
+	//no lock: the anchor dict is a concurrent hash table, and the anchors are encoded in the dict file
+	//in adress order at the end of the compression (see writeAnchorDict)
 
 		
 	//cout << "\tSearching and insert anchor" << endl;
@@ -1214,20 +1219,11 @@ int Leon::findAndInsertAnchor(const vector<kmer_type>& kmers, u_int32_t* anchorA
 	
 	if(maxAbundance == -1)
 	{
-		pthread_mutex_unlock(&findAndInsert_mutex);
 		return -1;
 	}
 
-	encodeInsertedAnchor(bestKmer);
-	
-	_anchorKmers->insert(bestKmer,_anchorAdress); //with Hash16
-	//_anchorKmers[bestKmer] = _anchorAdress;
-	//_anchorKmers.insert(bestKmer, _anchorAdress);
-		
-	
-	*anchorAdress = _anchorAdress;
-	//_anchorKmerCount += 1;
-	_anchorAdress += 1;
+	//if another thread inserted the same anchor meanwhile, we get its adress
+	_anchorKmers->insertIfAbsent(bestKmer, anchorAdress);
 	
 	/*
 	int val;
@@ -1238,7 +1234,6 @@ int Leon::findAndInsertAnchor(const vector<kmer_type>& kmers, u_int32_t* anchorA
 		//_kmerAbundance->insert(kmerMin, val-1);
 	}*/
 
-	pthread_mutex_unlock(&findAndInsert_mutex);
 	return bestPos;
 }
 
@@ -1563,6 +1558,14 @@ void Leon::startDecompression_setup(){
 	is.read (reinterpret_cast<char *>(_dnaBlockSizes.data()), _dnaBlockSizes.size()*sizeof(u_int64_t));
 	////
 	
+	//block index, from the read count of each block
+	_blockFirstRead.resize(_dnaBlockSizes.size()/2 + 1);
+	_blockFirstRead[0] = 0;
+	for(unsigned int ii=0; ii<_dnaBlockSizes.size()/2; ii++)
+	{
+		_blockFirstRead[ii+1] = _blockFirstRead[ii] + _dnaBlockSizes[2*ii+1];
+	}
+	
 	_kmerModel = new KmerModel(_kmerSize);
 	
 	decodeBloom();
@@ -1575,6 +1578,22 @@ void Leon::startDecompression_setup(){
 	}
 	///////////////
 	
+	_decompressionSetupDone = true;
+}
+
+void Leon::startDecompression_setupOnce(){
+	
+	pthread_mutex_lock(&decodeblock_mutex);
+	
+	if(! _decompressionSetupDone)
+		startDecompression_setup();
+	
+	pthread_mutex_unlock(&decodeblock_mutex);
+}
+
+unsigned int Leon::getBlockOfRead(u_int64_t readIndex){
+	
+	return std::upper_bound(_blockFirstRead.begin(), _blockFirstRead.end(), readIndex) - _blockFirstRead.begin() - 1;
 }
 
 
@@ -1694,6 +1713,33 @@ void Leon::decompressionDecodeBlocks(unsigned int & idx, int & livingThreadCount
 			this->_progress_decode->inc(1);
 	}
 }
+void Leon::decodeBlock(unsigned int blockId, HeaderDecoder* hdecoder, DnaDecoder* ddecoder, QualDecoder* qdecoder){
+	
+	unsigned int idx = 2*blockId;
+	
+	//the setup opens the hdf5 datasets of the block, which must not be done concurrently
+	//(block positions are only informative, each block is a separate dataset)
+	pthread_mutex_lock(&decodeblock_mutex);
+	
+	if(hdecoder != NULL)
+		hdecoder->setup(0, _headerBlockSizes[idx], _headerBlockSizes[idx+1], blockId);
+	
+	ddecoder->setup(0, _dnaBlockSizes[idx], _dnaBlockSizes[idx+1], blockId);
+	
+	if(qdecoder != NULL)
+		qdecoder->setup(blockId);
+	
+	pthread_mutex_unlock(&decodeblock_mutex);
+	
+	if(qdecoder != NULL)
+		qdecoder->execute();
+	
+	if(hdecoder != NULL)
+		hdecoder->execute();
+	
+	ddecoder->execute();
+}
+
 void Leon::startDecompressionAllStreams(){
 	
 
@@ -2119,12 +2165,31 @@ void Leon::endDecompression(){
 
 
 Leon::LeonIterator::LeonIterator( Leon& refl)
-: _leon(refl), _isDone(true) , _isInitialized(false)
+: _leon(refl), _isDone(true) , _isInitialized(false), _isRange(false), _firstRead(0), _endRead(0)
 {
 	_stream_qual = _stream_header = _stream_dna = NULL ;
 
 }
 
+Leon::LeonIterator::LeonIterator( Leon& refl, u_int64_t firstRead, u_int64_t endRead)
+: _leon(refl), _isDone(true) , _isInitialized(false), _isRange(true), _firstRead(firstRead), _endRead(endRead)
+{
+	_stream_qual = _stream_header = _stream_dna = NULL ;
+	
+	//done here rather than in first() since range iterators are typically iterated concurrently
+	_leon.startDecompression_setupOnce();
+	
+	_endRead = std::min(_endRead, _leon._blockFirstRead.back());
+	_firstRead = std::min(_firstRead, _endRead);
+	
+	//own decoders, the ones of the Leon instance are used by the non range iterator
+	_hdecoder = _leon._noHeader ? NULL : new HeaderDecoder(&_leon, _leon._inputFilename, _leon._subgroupHeader);
+	_qdecoder = _leon._isFasta ? NULL : new QualDecoder(&_leon, "qualities", _leon._subgroupQual);
+	_ddecoder = new DnaDecoder(&_leon, _leon._inputFilename, _leon._subgroupDNA);
+	
+	_isInitialized = true;
+}
+
 void Leon::LeonIterator::first()
 {
 	//printf("iter first\n");
@@ -2139,6 +2204,25 @@ void Leon::LeonIterator::first()
 	if(_stream_qual!= NULL) delete  _stream_qual;
 	if(_stream_header!= NULL) delete  _stream_header;
 	if(_stream_dna!= NULL) delete  _stream_dna;
+	_stream_qual = _stream_header = _stream_dna = NULL ;
+	
+	if(_isRange)
+	{
+		_readid = _firstRead;
+		_currentBlock = _leon.getBlockOfRead(_firstRead);
+		_endBlock = _firstRead < _endRead ? _leon.getBlockOfRead(_endRead-1)+1 : _currentBlock;
+		
+		if(! readNextRangeBlock()) { _isDone = true; return; }
+		
+		//skip the reads of the first block before _firstRead
+		std::string line;
+		for(u_int64_t i=_leon._blockFirstRead[_currentBlock-1]; i<_firstRead; i++)
+		{
+			if(_stream_header != NULL) getline(*_stream_header, line);
+			if(_stream_qual != NULL) getline(*_stream_qual, line);
+			getline(*_stream_dna, line);
+		}
+	}
 	
 	next();
 
@@ -2148,18 +2232,27 @@ void Leon::LeonIterator::next()
 {
 //	printf("---------- iter next ------------\n");
 
-	if(_livingThreadCount==0 ||
-	   (( _currentTID>= _livingThreadCount) && !_readingThreadBlock )
-	   )
+	if(_isRange)
 	{
-		readNextBlocks();
-		if(_isDone) return;
+		if(_readid >= _endRead) { _isDone = true; return; }
+		
+		if(!_readingThreadBlock && !readNextRangeBlock()) { _isDone = true; return; }
 	}
-	
-	if(!_readingThreadBlock)
+	else
 	{
-		//  assert (_currentTID < _livingThreadCount)
-		readNextThreadBock();
+		if(_livingThreadCount==0 ||
+		   (( _currentTID>= _livingThreadCount) && !_readingThreadBlock )
+		   )
+		{
+			readNextBlocks();
+			if(_isDone) return;
+		}
+		
+		if(!_readingThreadBlock)
+		{
+			//  assert (_currentTID < _livingThreadCount)
+			readNextThreadBock();
+		}
 	}
 	
 	assert(_readingThreadBlock);
@@ -2185,8 +2278,6 @@ void Leon::LeonIterator::next()
 	else
 	{
 		current_comment += sint.str() ;
-		
-		_readid++;
 	}
 	
 	
@@ -2218,6 +2309,8 @@ void Leon::LeonIterator::next()
 		// huum casting const char * to char *; not nice, could be fixed with strdup but want to avoid unnecessary copy,
 		//the set() method *should* take a const anyway
 		currentSeq->getData().set((char *)current_dna.c_str(), current_dna.size()  );
+		
+		_readid++;
 	}
 	else  //reached end of current thread block, try to advance to next block
 	{
@@ -2259,7 +2352,30 @@ void Leon::LeonIterator::readNextThreadBock()
 	_qdecoder = NULL;
 	_ddecoder = _leon._dnadecoders[_currentTID];
 	
+	if(! _leon._isFasta)
+		_qdecoder = _leon._qualdecoders[_currentTID];
+	
+	if(! _leon._noHeader)
+		_hdecoder = _leon._headerdecoders[_currentTID];
+	
+	setStreams();
+	
+	
+	//std::string output_buff;
+	//output_buff.reserve(READ_PER_BLOCK * 500);
+	
+	_currentTID++;
+
 	
+//	printf("___ done iter readNextThreadBock  %i %i ---\n",_currentTID,_livingThreadCount);
+
+
+///	u_int64_t readid=0;
+}
+
+//put the buffers of the current decoders in stream_qual,stream_header and _stream_dna
+void Leon::LeonIterator::setStreams()
+{
 	if(_stream_qual!= NULL) delete  _stream_qual;
 	if(_stream_header!= NULL) delete  _stream_header;
 	if(_stream_dna!= NULL) delete  _stream_dna;
@@ -2268,16 +2384,14 @@ void Leon::LeonIterator::readNextThreadBock()
 	_stream_header = NULL;
 	_stream_dna = NULL;
 	
-	if(! _leon._isFasta)
+	if(_qdecoder != NULL)
 	{
-		_qdecoder = _leon._qualdecoders[_currentTID];
 		_stream_qual = new std::istringstream (_qdecoder->_buffer);
 		_qdecoder->_buffer.clear();
 	}
 	
-	if(! _leon._noHeader)
+	if(_hdecoder != NULL)
 	{
-		_hdecoder = _leon._headerdecoders[_currentTID];
 		_stream_header = new std::istringstream (_hdecoder->_buffer);
 		_hdecoder->_buffer.clear();
 	}
@@ -2285,23 +2399,70 @@ void Leon::LeonIterator::readNextThreadBock()
 	_stream_dna = new std::istringstream (_ddecoder->_buffer);
 	_ddecoder->_buffer.clear();
 	
-	
-	//std::string output_buff;
-	//output_buff.reserve(READ_PER_BLOCK * 500);
-	
 	_readingThreadBlock = true;
-	_currentTID++;
+}
 
+//range mode: decode the next block of the range in the calling thread
+bool Leon::LeonIterator::readNextRangeBlock()
+{
+	if(_currentBlock >= _endBlock) return false;
 	
-//	printf("___ done iter readNextThreadBock  %i %i ---\n",_currentTID,_livingThreadCount);
-
+	_leon.decodeBlock(_currentBlock, _hdecoder, _ddecoder, _qdecoder);
+	_currentBlock++;
+	
+	setStreams();
+	return true;
+}
 
-///	u_int64_t readid=0;
+std::vector<tools::dp::Iterator<Sequence>*> Leon::LeonIterator::split (size_t nbParts)
+{
+	std::vector<tools::dp::Iterator<Sequence>*> result;
+	
+	if(! _isRange)
+	{
+		//only the block index is needed here, not the decoders of init()
+		_leon.startDecompression_setupOnce();
+		_firstRead = 0;
+		_endRead = _leon._blockFirstRead.back();
+	}
+	
+	if(_firstRead >= _endRead) return result;
+	
+	//the parts are made of whole blocks, so no block is decoded twice
+	unsigned int firstBlock = _leon.getBlockOfRead(_firstRead);
+	unsigned int nbBlocks = _leon.getBlockOfRead(_endRead-1) + 1 - firstBlock;
+	
+	nbParts = std::min(nbParts, (size_t) nbBlocks);
+	if(nbParts <= 1) return result;
+	
+	for(size_t i=0; i<nbParts; i++)
+	{
+		u_int64_t begin = std::max(_firstRead, _leon._blockFirstRead[firstBlock + (nbBlocks*i)/nbParts]);
+		u_int64_t end   = std::min(_endRead,   _leon._blockFirstRead[firstBlock + (nbBlocks*(i+1))/nbParts]);
+		
+		if(end > begin)
+			result.push_back(new LeonIterator(_leon, begin, end));
+	}
+	
+	return result;
 }
 
 Leon::LeonIterator::~LeonIterator ()
 {
-	_leon.decoders_cleanup();
+	if(_stream_qual!= NULL) delete  _stream_qual;
+	if(_stream_header!= NULL) delete  _stream_header;
+	if(_stream_dna!= NULL) delete  _stream_dna;
+	
+	if(_isRange)
+	{
+		if(_hdecoder != NULL) delete _hdecoder;
+		if(_qdecoder != NULL) delete _qdecoder;
+		delete _ddecoder;
+	}
+	else
+	{
+		_leon.decoders_cleanup();
+	}
 }
 
 
@@ -2315,6 +2476,11 @@ void Leon::LeonIterator::estimate(u_int64_t& number, u_int64_t& totalSize, u_int
 	readDataset(_leon._subgroupInfo,"maxSequenceSize",maxsizei);
 	maxSize = maxsizei;
 
+	if(_isRange && number > 0)
+	{
+		totalSize = (totalSize * (_endRead - _firstRead)) / number;
+		number = _endRead - _firstRead;
+	}
 }
 
 void Leon::LeonIterator::init()
@@ -2323,7 +2489,7 @@ void Leon::LeonIterator::init()
 
 	///printf("iter init\n");
 
-	_leon.startDecompression_setup();
+	_leon.startDecompression_setupOnce();
 	_leon.decoders_setup();
 	
 	
@@ -2378,6 +2544,11 @@ u_int64_t BankLeon::getSize ()
 	return System::file().getSize (_fname);
 }
 
+tools::dp::Iterator<Sequence>* BankLeon::iterator (u_int64_t firstRead, u_int64_t nbReads)
+{
+	return new Leon::LeonIterator (*_leon, firstRead, firstRead + nbReads);
+}
+
 int64_t BankLeon::getNbItems () {
 	u_int64_t number;
 	readDataset(_leon->_subgroupInfo,"readcount",number);
@@ -98,6 +98,7 @@ class Leon : public misc::impl::Tool
 		static const char* STR_DNA_ONLY;
 		static const char* STR_NOHEADER;
 		static const char* STR_NOQUAL;
+		static const char* STR_QUAL_CONTEXT;
 		static const char* STR_INIT_ITER;
 
 	static const char* STR_DATA_INFO;
@@ -116,7 +117,11 @@ class Leon : public misc::impl::Tool
 		//Global compression
 		void writeBlock(u_int8_t* data, u_int64_t size, int encodedSequenceCount,u_int64_t blockID, bool Header);
 	
-		void writeBlockLena(u_int8_t* data, u_int64_t size, int encodedSequenceCount,u_int64_t blockID);
+		//deflates a block of qualities, the compressed block replaces the content of 'output'
+		static void deflateQualBlock(const char* quals, u_int64_t size, vector<u_int8_t>& output);
+
+		//writes a block of encoded qualities (deflated, or coded by a QualCoder), inputSize is the size of the raw qualities
+		void writeBlockQual(u_int8_t* data, u_int64_t size, u_int64_t inputSize, u_int64_t blockID);
 
 		//Header compression
 		string _firstHeader;
@@ -151,6 +156,8 @@ class Leon : public misc::impl::Tool
 		bool _noHeader;
 
 	bool _lossless;
+	//code the qualities with QualCoder instead of deflate
+	bool _qualContextModel;
 	//for qual compression
 		u_int64_t _total_nb_quals_smoothed ;
 		u_int64_t _input_qualSize;
@@ -267,6 +274,11 @@ class Leon : public misc::impl::Tool
 		vector<u_int64_t> _headerBlockSizes;
 		vector<u_int64_t> _dnaBlockSizes;
 
+		//block index: _blockFirstRead[b] is the index of the first read of block b, last entry is the read count
+		//(header, dna and qual blocks share the same numbering)
+		vector<u_int64_t> _blockFirstRead;
+		unsigned int getBlockOfRead(u_int64_t readIndex);
+
 		IBank* _inputBank;
 		void setInputBank (IBank* inputBank) { SP_SETATTR(inputBank); }
 
@@ -317,16 +329,17 @@ class Leon : public misc::impl::Tool
 		
 		//map<kmer_type, u_int32_t> _anchorKmers; //uses 46 B per elem inserted
 		//OAHash<kmer_type> _anchorKmers;
-		Hash16<kmer_type, u_int32_t >  * _anchorKmers ; //will  use approx 20B per elem inserted
+		//Hash16<kmer_type, u_int32_t >  * _anchorKmers ; //will  use approx 20B per elem inserted
+		OAHashConcurrent<kmer_type>  * _anchorKmers ; //anchor adress is the insertion rank, lock-free
 
 		//Header decompression
 	
 		string _headerOutputFilename;
 	
 	  // 	int _auto_cutoff;
-		pthread_mutex_t findAndInsert_mutex;
 		pthread_mutex_t writeblock_mutex;
 		pthread_mutex_t minmax_mutex;
+		pthread_mutex_t decodeblock_mutex;
 
 		//DNA Decompression
 		void decodeBloom();
@@ -343,8 +356,14 @@ class Leon : public misc::impl::Tool
 		//IFile* _outputFile;
 	
 	void startDecompression_setup();
+	//does the setup once, it may be called concurrently by several iterators (under decodeblock_mutex)
+	void startDecompression_setupOnce();
 	void decoders_setup();
 	void decoders_cleanup();
+	bool _decompressionSetupDone;
+
+	//decode one block in the calling thread, the block data is left in the decoders buffers
+	void decodeBlock(unsigned int blockId, HeaderDecoder* hdecoder, DnaDecoder* ddecoder, QualDecoder* qdecoder);
 
 	vector<QualDecoder*> _qualdecoders;
 	vector<DnaDecoder*> _dnadecoders;
@@ -365,6 +384,12 @@ class Leon : public misc::impl::Tool
 		
 		LeonIterator (Leon& ref);
 		
+		/** Iterator over the reads [firstRead, endRead) only; the blocks are decoded in the calling thread.
+		 * \param[in] ref : the Leon instance
+		 * \param[in] firstRead : index of the first read
+		 * \param[in] endRead : index after the last read */
+		LeonIterator (Leon& ref, u_int64_t firstRead, u_int64_t endRead);
+		
 		/** Destructor */
 		~LeonIterator ();
 		
@@ -383,6 +408,10 @@ class Leon : public misc::impl::Tool
 		/** Estimation of the sequences information */
 		void estimate (u_int64_t& number, u_int64_t& totalSize, u_int64_t& maxSize);
 		
+		/** Split the reads along the block index; each part decodes its own blocks.
+		 * \copydoc tools::dp::Iterator::split */
+		std::vector<tools::dp::Iterator<Sequence>*> split (size_t nbParts);
+		
 	private:
 		
 		/** Reference to the underlying Leon instance. */
@@ -421,6 +450,16 @@ class Leon : public misc::impl::Tool
 		bool _readingThreadBlock;
 		u_int64_t _readid;
 
+		void setStreams();
+
+		/** Range mode: reads [_firstRead, _endRead) in blocks [_currentBlock, _endBlock), decoded by this iterator. */
+		bool _isRange;
+		u_int64_t _firstRead;
+		u_int64_t _endRead;
+		unsigned int _currentBlock;
+		unsigned int _endBlock;
+
+		bool readNextRangeBlock();
 	};
 };
 
@@ -446,6 +485,12 @@ public:
 	/** \copydoc IBank::iterator */
 	tools::dp::Iterator<Sequence>* iterator ()  { return new Leon::LeonIterator (*_leon); }
 	
+	/** Get an iterator starting at a given read; only the blocks holding the requested reads are decoded.
+	 * \param[in] firstRead : index of the first read to iterate
+	 * \param[in] nbReads : number of reads to iterate
+	 * \return the iterator */
+	tools::dp::Iterator<Sequence>* iterator (u_int64_t firstRead, u_int64_t nbReads);
+	
 	/** */
 	int64_t getNbItems () ;
 	
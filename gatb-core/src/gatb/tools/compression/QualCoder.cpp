@@ -0,0 +1,140 @@
+/*****************************************************************************
+ *   Leon: reference free compression for NGS reads
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: G.Benoit, G.Rizk, C.Lemaitre
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "QualCoder.hpp"
+#include "CompressionUtils.hpp"
+
+using namespace std;
+
+//====================================================================================
+// ** QualCoder
+//====================================================================================
+QualCoder::QualCoder() : _nbContextSymbols(0), _sameSizeModel(2)
+{
+	for(int i=0; i<CompressionUtils::NB_MODELS_PER_NUMERIC; i++){
+		_numericModel.push_back(Order0Model(256));
+	}
+}
+
+QualCoder::~QualCoder(){
+	setSymbolCount(0);
+}
+
+void QualCoder::reset(){
+	for(unsigned int i=0; i<_numericModel.size(); i++){
+		_numericModel[i].clear();
+	}
+	_sameSizeModel.clear();
+}
+
+void QualCoder::setSymbolCount(unsigned int nbSymbols){
+
+	for(unsigned int i=0; i<_models.size(); i++){
+		delete _models[i];
+	}
+
+	_nbContextSymbols = nbSymbols + 1;
+	_models.assign(_nbContextSymbols * _nbContextSymbols * NB_POS_BUCKETS, (Order0Model*) NULL);
+}
+
+void QualCoder::encode(const char* quals, u_int64_t size, vector<u_int8_t>& output){
+
+	u_int8_t minQual = 255, maxQual = 0;
+	u_int64_t nbReads = 0;
+
+	for(u_int64_t i=0; i<size; i++){
+		u_int8_t c = quals[i];
+		if(c == '\n') { nbReads++; continue; }
+		minQual = std::min(minQual, c);
+		maxQual = std::max(maxQual, c);
+	}
+	if(minQual > maxQual) minQual = maxQual; //no quality at all
+
+	unsigned int nbSymbols = maxQual - minQual + 1;
+	reset();
+	setSymbolCount(nbSymbols);
+
+	_rangeEncoder.clear();
+	CompressionUtils::encodeNumeric(_rangeEncoder, _numericModel, nbReads);
+	CompressionUtils::encodeNumeric(_rangeEncoder, _numericModel, minQual);
+	CompressionUtils::encodeNumeric(_rangeEncoder, _numericModel, nbSymbols);
+
+	u_int64_t prevSize = 0;
+	const char* qual = quals;
+
+	for(u_int64_t r=0; r<nbReads; r++){
+
+		const char* end = qual;
+		while(*end != '\n') end++;
+		u_int64_t readSize = end - qual;
+
+		//most of the time, the reads have the same size as the previous one
+		_rangeEncoder.encode(_sameSizeModel, readSize == prevSize);
+		if(readSize != prevSize)
+			CompressionUtils::encodeNumeric(_rangeEncoder, _numericModel, readSize);
+		prevSize = readSize;
+
+		unsigned int q1 = nbSymbols, q2 = nbSymbols;
+		for(u_int64_t pos=0; pos<readSize; pos++){
+			unsigned int q = (u_int8_t) qual[pos] - minQual;
+			_rangeEncoder.encode(model(q1, q2, pos), q);
+			q2 = q1;
+			q1 = q;
+		}
+
+		qual = end + 1;
+	}
+
+	_rangeEncoder.flush();
+
+	output.resize(1 + _rangeEncoder.getBufferSize());
+	output[0] = CODEC_ID;
+	std::copy(_rangeEncoder.getBuffer(), _rangeEncoder.getBuffer() + _rangeEncoder.getBufferSize(), output.begin() + 1);
+	_rangeEncoder.clear();
+}
+
+void QualCoder::decode(const char* data, u_int64_t size, string& quals){
+
+	//skip the codec byte
+	_rangeDecoder.setInputBuffer((const u_int8_t*) data + 1, (const u_int8_t*) data + size);
+
+	reset();
+	u_int64_t nbReads = CompressionUtils::decodeNumeric(_rangeDecoder, _numericModel);
+	u_int8_t minQual = CompressionUtils::decodeNumeric(_rangeDecoder, _numericModel);
+	unsigned int nbSymbols = CompressionUtils::decodeNumeric(_rangeDecoder, _numericModel);
+	setSymbolCount(nbSymbols);
+
+	u_int64_t readSize = 0;
+
+	for(u_int64_t r=0; r<nbReads; r++){
+
+		if(_rangeDecoder.nextByte(_sameSizeModel) == 0)
+			readSize = CompressionUtils::decodeNumeric(_rangeDecoder, _numericModel);
+
+		unsigned int q1 = nbSymbols, q2 = nbSymbols;
+		for(u_int64_t pos=0; pos<readSize; pos++){
+			unsigned int q = _rangeDecoder.nextByte(model(q1, q2, pos));
+			quals += (char) (q + minQual);
+			q2 = q1;
+			q1 = q;
+		}
+		quals += '\n';
+	}
+}
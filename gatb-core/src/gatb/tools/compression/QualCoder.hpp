@@ -0,0 +1,97 @@
+/*****************************************************************************
+ *   Leon: reference free compression for NGS reads
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: G.Benoit, G.Rizk, C.Lemaitre
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _QUALCODER_HPP_
+#define _QUALCODER_HPP_
+
+#include <string>
+#include <vector>
+#include "RangeCoder.hpp"
+
+//====================================================================================
+// ** QualCoder
+//====================================================================================
+/* Order-2 context model for the quality scores of a block of reads.
+ * Each quality is range coded with an adaptive model chosen by the two previous
+ * qualities of the read and by a bucket of its position in the read.
+ *
+ * The models are reset at each block, so that the blocks can be decoded independently;
+ * each encoder/decoder thread uses its own QualCoder.
+ *
+ * An encoded block starts with the byte CODEC_ID. Blocks of older leon files, and the
+ * blocks written without '-qual-context', are deflate streams, whose first byte is always 0x78.
+ *
+ * This codec is opt-in (leon -qual-context), because its decoding is slower than deflate:
+ * the output is about 28% smaller than deflate -9 and the encoding is faster, but the
+ * decoding is about 15x slower than inflate (one adaptive model lookup per quality,
+ * mostly cache misses over the context models). It does not decode at least as fast as
+ * deflate, so deflate stays the default.
+ */
+class QualCoder
+{
+	public:
+
+		QualCoder();
+		~QualCoder();
+
+		static const u_int8_t CODEC_ID = 2;
+
+		//encode a block of quality strings, each one ended by '\n'; the encoded block replaces the content of 'output'
+		void encode(const char* quals, u_int64_t size, std::vector<u_int8_t>& output);
+
+		//decode a block produced by 'encode', the quality strings are appended to 'quals'
+		void decode(const char* data, u_int64_t size, std::string& quals);
+
+	private:
+
+		//the models are owned by the coder
+		QualCoder(const QualCoder&);
+		QualCoder& operator=(const QualCoder&);
+
+		static const unsigned int NB_POS_BUCKETS = 8;
+		static const unsigned int POS_BUCKET_SIZE = 16;
+
+		//number of distinct quality symbols in the block, plus one for the absent previous qualities at read start
+		unsigned int _nbContextSymbols;
+		std::vector<Order0Model*> _models;
+
+		std::vector<Order0Model> _numericModel;
+		Order0Model _sameSizeModel;
+
+		RangeEncoder _rangeEncoder;
+		RangeDecoder _rangeDecoder;
+
+		//reset the models of the numerics and of the read sizes
+		void reset();
+		//discard the context models, and size them for a new alphabet of qualities
+		void setSymbolCount(unsigned int nbSymbols);
+
+		Order0Model& model(unsigned int q1, unsigned int q2, unsigned int pos){
+
+			unsigned int bucket = pos / POS_BUCKET_SIZE;
+			if(bucket >= NB_POS_BUCKETS) bucket = NB_POS_BUCKETS-1;
+
+			Order0Model*& result = _models[((q1 * _nbContextSymbols) + q2) * NB_POS_BUCKETS + bucket];
+			if(result == NULL) result = new Order0Model(_nbContextSymbols-1);
+			return *result;
+		}
+};
+
+#endif /* _QUALCODER_HPP_ */
@@ -177,7 +177,7 @@ u_int64_t RangeEncoder::getBufferSize(){
 //====================================================================================
 // ** RangeDecoder
 //====================================================================================
-RangeDecoder::RangeDecoder()
+RangeDecoder::RangeDecoder() : _inputFile(0), _inputBuffer(0), _inputBufferEnd(0)
 {
 }
 
@@ -189,6 +189,19 @@ void RangeDecoder::setInputFile(istream* inputFile, bool reversed){
 	_reversed = reversed;
 	clear();
 	_inputFile = inputFile;
+	_inputBuffer = _inputBufferEnd = 0;
+	
+	for(int i=0; i<8; i++){
+		_code = (_code << 8) | getNextByte();
+	}
+}
+
+void RangeDecoder::setInputBuffer(const u_int8_t* begin, const u_int8_t* end){
+	_reversed = false;
+	clear();
+	_inputFile = 0;
+	_inputBuffer = begin;
+	_inputBufferEnd = end;
 	
 	for(int i=0; i<8; i++){
 		_code = (_code << 8) | getNextByte();
@@ -197,8 +210,15 @@ void RangeDecoder::setInputFile(istream* inputFile, bool reversed){
 
 uint8_t RangeDecoder::nextByte(Order0Model& model){
 	u_int64_t count = getCurrentCount(model);
-	uint8_t c;
-	for(c=model.charCount()-2; model.rangeLow(c) > count; c--);
+
+	//the ranges are increasing: binary search of the last char whose low range is <= count
+	unsigned int lo = 0, hi = model.charCount()-2;
+	while(lo < hi){
+		unsigned int mid = (lo + hi + 1) / 2;
+		if(model.rangeLow(mid) > count) hi = mid - 1;
+		else lo = mid;
+	}
+	uint8_t c = lo;
 
 	removeRange(model, c);
 
@@ -236,6 +256,11 @@ void RangeDecoder::clear(){
 u_int8_t RangeDecoder::getNextByte(){
 	u_int8_t byte;
 	
+	//past the end, a stream returns EOF: same byte here
+	if(_inputFile == 0){
+		return _inputBuffer < _inputBufferEnd ? *_inputBuffer++ : (u_int8_t) EOF;
+	}
+	
 	if(_reversed){
 		_inputFile->seekg(-1, _inputFile->cur);
 	}
@@ -114,12 +114,16 @@ class RangeDecoder : AbstractRangeCoder
 		~RangeDecoder();
 		
 		void setInputFile(std::istream* inputFile, bool reversed=false);
+		//reads the coded bytes directly from memory, without going through a stream
+		void setInputBuffer(const u_int8_t* begin, const u_int8_t* end);
 		u_int8_t nextByte(Order0Model& model);
 		void clear();
 		
 	private:
 		
 		std::istream* _inputFile;
+		const u_int8_t* _inputBuffer;
+		const u_int8_t* _inputBufferEnd;
 		u_int64_t _code;
 		bool _reversed;
 		
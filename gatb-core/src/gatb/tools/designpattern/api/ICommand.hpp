@@ -222,6 +222,67 @@ public:
         return status;
     }
 
+    /** Iterate a provided instance like 'iterate', but if the iterator can be split (see Iterator::split),
+     * each thread iterates whole parts of it without any synchronization on the iteration. This removes
+     * the bottleneck of a single iterator shared by all the threads (for instance a parsed file).
+     *
+     * Note that the items are then provided neither in the iteration order nor with their iteration index.
+     * If the iterator can't be split, this method behaves like 'iterate'.
+     *
+     * \param[in] iterator : the iterator to be iterated
+     * \param[in] functor : functor object to be cloned N times, one per thread
+     * \param[in] groupSize : number of items to be retrieved in a single lock/unlock block (if not split)
+     *  \param[in] deleteSynchro : if false, destructor of functors are called in each thread; if true, destructor of functors are called synchronously
+     */
+    template <typename Item, typename Functor>
+    Status iterateParts (Iterator<Item>* iterator, const Functor& functor, size_t groupSize = 1000, bool deleteSynchro = false)
+    {
+        Status status;
+
+        /** As for 'iterate', the iterator is released here if the caller doesn't hold it. */
+        iterator->use();
+
+        /** We use several parts per thread, so threads finishing early can take remaining parts. */
+        std::vector<Iterator<Item>*> parts;
+        if (getExecutionUnitsNumber() > 1)  { parts = iterator->split (PARTS_PER_UNIT * getExecutionUnitsNumber()); }
+
+        if (parts.empty())
+        {
+            status = iterate (iterator, functor, groupSize, deleteSynchro);
+            iterator->forget();
+            return status;
+        }
+
+        for (size_t i=0; i<parts.size(); i++)  { parts[i]->use(); }
+
+        /** We create a common synchronizer and the shared index of the next part to be iterated. */
+        system::ISynchronizer* synchro = newSynchro();
+        size_t nextPart = 0;
+
+        /** We create N IteratorPartsCommand instances with their own functor. */
+        std::vector<Functor*>  functors (getExecutionUnitsNumber());
+        std::vector<ICommand*> commands;
+        for (size_t i=0; i<functors.size(); i++)
+        {
+            functors[i] = new Functor (functor);  // will be deleted by IteratorPartsCommand
+            commands.push_back (new IteratorPartsCommand<Item,Functor> (parts, nextPart, functors[i], *synchro, deleteSynchro));
+        }
+
+        /** We dispatch the commands. */
+        status.time = dispatchCommands (commands);
+
+        for (size_t i=0; i<parts.size(); i++)  { parts[i]->forget(); }
+
+        delete synchro;
+
+        iterator->forget();
+
+        status.nbCores   = commands.size();
+        status.groupSize = 0;
+
+        return status;
+    }
+
     /** Set the number of items to be retrieved from the iterator by one thread in a synchronized way.
      * \param[in] groupSize : number of items to be retrieved. */
     virtual void   setGroupSize (size_t groupSize) = 0;
@@ -287,6 +348,54 @@ protected:
         return status;
     }
 
+    /** Number of parts per execution unit requested by iterateParts. */
+    static const size_t PARTS_PER_UNIT = 4;
+
+    /* We need some inner class for iterating whole parts of a split iterator in one thread. */
+    template <typename Item, typename Functor> class IteratorPartsCommand : public ICommand, public system::SmartPointer
+    {
+    public:
+        /** Constructor.
+         * \param[in] parts : parts of the split iterator (shared by several IteratorPartsCommand instances)
+         * \param[in] nextPart : index of the next part to be iterated (shared)
+         * \param[in] fct : functor fed with the iterated items
+         * \param[in] synchro : shared synchronizer for accessing the next part index
+         */
+        IteratorPartsCommand (std::vector<Iterator<Item>*>& parts, size_t& nextPart, Functor*& fct, system::ISynchronizer& synchro, bool deleteSynchro)
+            : _parts(parts), _nextPart(nextPart), _fct(fct), _synchro(synchro), _deleteSynchro(deleteSynchro)  {}
+
+        /** Implementation of the ICommand interface.*/
+        void execute ()
+        {
+            while (true)
+            {
+                /** We take the next part to be iterated. */
+                _synchro.lock ();
+                size_t idx = _nextPart++;
+                _synchro.unlock ();
+
+                if (idx >= _parts.size())  { break; }
+
+                /** We iterate the whole part without synchronization. */
+                Iterator<Item>* it = _parts[idx];
+                for (it->first(); !it->isDone(); it->next())  {  (*_fct) (it->item());  }
+                it->finalize ();
+            }
+
+            /** We do not need the functor after that, delete it here to have parallel delete */
+            if (_deleteSynchro)  { _synchro.lock (); }
+            delete _fct;
+            if (_deleteSynchro)  { _synchro.unlock (); }
+        }
+
+    private:
+        std::vector<Iterator<Item>*>& _parts;
+        size_t&                       _nextPart;
+        Functor*&                     _fct;
+        system::ISynchronizer&        _synchro;
+        bool                          _deleteSynchro;
+    };
+
     /* We need some inner class for iterate some iterator in one thread. */
     template <typename Item, typename Functor> class IteratorCommand : public ICommand, public system::SmartPointer
     {
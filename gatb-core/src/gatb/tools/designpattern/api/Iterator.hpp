@@ -196,6 +196,14 @@ public:
     /** Get a vector holding the composite structure of the iterator. */
     virtual std::vector<Iterator<Item>*> getComposition()   {   std::vector<Iterator<Item>*> res;  res.push_back (this);  return res;    }
 
+    /** Split the iteration into independent iterators that can be iterated concurrently without
+     * synchronization. Together, they iterate the same items as this iterator, but not necessarily
+     * in the same order. The returned iterators are to be released by the caller (see use/forget).
+     * By default, an iterator can't be split and an empty vector is returned.
+     * \param[in] nbParts : maximum number of parts
+     * \return the parts, or an empty vector if the iterator can't be split. */
+    virtual std::vector<Iterator<Item>*> split (size_t nbParts)  {  return std::vector<Iterator<Item>*>();  }
+
 protected:
     Item* _item;
 
@@ -42,6 +42,10 @@
 #include <gatb/tools/math/NativeInt64.hpp>
 #include <gatb/tools/math/FastMinimizer.hpp>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #ifndef ASSERTS
 #define assertLI(x) {} // disable asserts for large int; those asserts make sure that with PRECISION == [1 or 2], all is correct
 #else
@@ -83,6 +87,9 @@ namespace math  {
  *  This template class may have a specialization for precision=2. If the used operating
  *  system allows it, native 128 bits integers are used.
  *
+ *  When compiled with AVX2 support, revcomp, hash1 and oahash of precision=3 and precision=4
+ *  are specialized with 256 bits registers.
+ *
  *  In the other cases, the LargeInt provides a generic integer calculus class. Note that
  *  such an implementation could be optimized in several ways, including direct assembly
  *  code for maximum speed.
@@ -137,6 +144,12 @@ public:
     inline void      setVal(u_int64_t val) { this->value[0] = val; for (int i = 1; i < precision; i++)  {  this->value[i] = 0;}  }
     inline void      setVal(const LargeInt& other) { for (int i = 0; i < precision; i++)  {  this->value[i] = other.value[i];}  }
 
+    /** Get the byte idx of the LargeInt object (0 being the less significant one), used as radix sort digit.
+     * \param[in] idx : index of the byte, in [0..getSize()/8[
+     * \return the byte value.
+     */
+    u_int8_t getByte (size_t idx) const  { return this->value[idx >> 3] >> (8*(idx & 7)); }
+
     /** Get the size of an instance of the class
      * \return the size of an object (in bits).
      */
@@ -882,6 +895,11 @@ template<int precision> inline void justSweepForAA(const LargeInt<precision>& x,
 /********************************************************************************/
 #include <gatb/tools/math/LargeInt2.pri> 
 
+/********************************************************************************/
+/****************     SPECIALIZATION FOR precision=3 and 4 (AVX2)    ***************/
+/********************************************************************************/
+#include <gatb/tools/math/LargeIntAVX2.pri>
+
 /********************************************************************************/
 } } } } /* end of namespaces. */
 /********************************************************************************/
@@ -47,6 +47,9 @@ public:
      inline void setVal (u_int64_t val) { value = val; }
      inline void setVal (const LargeInt<1>& other) { value = other.value; }
 
+    /** Get the byte idx (0 being the less significant one), used as radix sort digit */
+    u_int8_t getByte (size_t idx) const  { return value >> (8*idx); }
+
     static const char* getName ()  { return "LargeInt<1>"; }
 
     static const size_t getSize ()  { return 8*sizeof(u_int64_t); }
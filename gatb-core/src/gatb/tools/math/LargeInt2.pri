@@ -44,6 +44,9 @@ public:
      inline void setVal (const u_int64_t &c) { value = c; }
      inline void setVal (const LargeInt<2>& c) { value = c.value; }
 
+    /** Get the byte idx (0 being the less significant one), used as radix sort digit */
+    u_int8_t getByte (size_t idx) const  { return value >> (8*idx); }
+
     static const char* getName ()  { return "LargeInt<2>"; }
 
     static const size_t getSize ()  { return 8*sizeof(__uint128_t); }
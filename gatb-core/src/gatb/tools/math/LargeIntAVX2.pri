@@ -0,0 +1,185 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/** \file LargeIntAVX2.pri
+ *  \brief AVX2 specializations of LargeInt<3> and LargeInt<4> (64 < k <= 128)
+ *
+ * The value is processed in one 256 bits register, the limb i being in the 64 bits lane i.
+ * A LargeInt<3> uses the 3 lower lanes; the upper lane is 0 when loaded and is never stored,
+ * so the memory layout (and the on disk format) is the same as the generic one.
+ *
+ * Only revcomp, hash1 and oahash are specialized. The shifts, bitwise operations and comparisons
+ * keep the generic implementation: once inlined in the kmer loops, its unrolled limbs stay in
+ * general purpose registers, whereas mixing 256 bits operations with the scalar ones (+, getVal...)
+ * costs a round trip through memory at each operation, which made kmer iteration and sorting
+ * slower (see test/benchmark/bench_largeint.cpp).
+ */
+
+/********************************************************************************/
+#ifdef __AVX2__
+/********************************************************************************/
+
+template<int precision>  struct LargeIntAVX2
+{
+    static __m256i load (const u_int64_t* v)
+    {
+        if (precision == 4)  {  return _mm256_loadu_si256 ((const __m256i*) v);  }
+
+        return _mm256_inserti128_si256 (
+            _mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i*) v)),
+            _mm_loadl_epi64 ((const __m128i*) (v+2)), 1
+        );
+    }
+
+    static void store (u_int64_t* v, __m256i x)
+    {
+        if (precision == 4)  {  _mm256_storeu_si256 ((__m256i*) v, x);  return;  }
+
+        _mm_storeu_si128 ((__m128i*) v,     _mm256_castsi256_si128    (x));
+        _mm_storel_epi64 ((__m128i*) (v+2), _mm256_extracti128_si256 (x, 1));
+    }
+
+    /** Move the limbs n lanes down (n>=0), shifting in zeros. */
+    static __m256i limbsDown (__m256i x, int n)
+    {
+        const __m256i lanes = _mm256_setr_epi32 (0,1,2,3,4,5,6,7);
+        __m256i shift = _mm256_set1_epi32 (2*n);
+        __m256i keep  = _mm256_cmpgt_epi32 (_mm256_set1_epi32 (8-2*n), lanes);
+        return _mm256_and_si256 (_mm256_permutevar8x32_epi32 (x, _mm256_add_epi32 (lanes, shift)), keep);
+    }
+
+    /** Right shift of the whole 256 bits; AVX2 shifts by 64 or more give 0, so small_shift==0 needs no special case. */
+    static __m256i shiftRight (__m256i x, int coeff)
+    {
+        int large_shift = coeff / 64;
+        int small_shift = coeff % 64;
+
+        return _mm256_or_si256 (
+            _mm256_srl_epi64 (limbsDown (x, large_shift),   _mm_cvtsi32_si128 (small_shift)),
+            _mm256_sll_epi64 (limbsDown (x, large_shift+1), _mm_cvtsi32_si128 (64-small_shift))
+        );
+    }
+
+    /** Reverse complement of the 128 nucleotides of the register. The limbs are reversed, then the bytes
+     * of each limb; the 4 nucleotides of each byte are reversed and complemented through two nibble tables. */
+    static __m256i revcomp (__m256i x)
+    {
+        const __m256i bytes  = _mm256_setr_epi8 (7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8,
+                                                 7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8);
+        // rc of the 2 nucleotides of a nibble, to be put in the low (resp. high) nibble of the result
+        const __m256i rcLow  = _mm256_setr_epi8 (0x0A,0x0E,0x02,0x06, 0x0B,0x0F,0x03,0x07, 0x08,0x0C,0x00,0x04, 0x09,0x0D,0x01,0x05,
+                                                 0x0A,0x0E,0x02,0x06, 0x0B,0x0F,0x03,0x07, 0x08,0x0C,0x00,0x04, 0x09,0x0D,0x01,0x05);
+        const __m256i rcHigh = _mm256_slli_epi16 (rcLow, 4);
+        const __m256i nibble = _mm256_set1_epi8 (0x0F);
+
+        x = _mm256_shuffle_epi8 (_mm256_permute4x64_epi64 (x, 0x1B), bytes);
+
+        __m256i lo = _mm256_and_si256 (x, nibble);
+        __m256i hi = _mm256_and_si256 (_mm256_srli_epi16 (x, 4), nibble);
+
+        return _mm256_or_si256 (_mm256_shuffle_epi8 (rcHigh, lo), _mm256_shuffle_epi8 (rcLow, hi));
+    }
+
+    /** 64 bits multiplication of each lane by a scalar (there is no AVX2 instruction for it). */
+    static __m256i mul64 (__m256i a, u_int64_t b)
+    {
+        __m256i bb    = _mm256_set1_epi64x (b);
+        __m256i low   = _mm256_mul_epu32 (a, bb);
+        __m256i cross = _mm256_add_epi64 (_mm256_mul_epu32 (_mm256_srli_epi64 (a, 32), bb),
+                                          _mm256_mul_epu32 (a, _mm256_srli_epi64 (bb, 32)));
+        return _mm256_add_epi64 (low, _mm256_slli_epi64 (cross, 32));
+    }
+
+    /** XOR of the 'precision' lower lanes. */
+    static u_int64_t reduce (__m256i x)
+    {
+        if (precision == 3)  {  x = _mm256_blend_epi32 (x, _mm256_setzero_si256(), 0xC0);  }
+
+        __m128i y = _mm_xor_si128 (_mm256_castsi256_si128 (x), _mm256_extracti128_si256 (x, 1));
+        return _mm_cvtsi128_si64 (y) ^ _mm_extract_epi64 (y, 1);
+    }
+
+    /** NativeInt64::hash64 of each lane. */
+    static u_int64_t hash1 (__m256i key, u_int64_t seed)
+    {
+        const __m256i ones = _mm256_set1_epi64x (-1);
+
+        /** First step, where the seed is the same for all the lanes. */
+        __m256i hash = _mm256_xor_si256 (
+            _mm256_set1_epi64x (seed ^ (seed << 7)),
+            _mm256_xor_si256 (
+                mul64 (key, seed >> 3),
+                _mm256_xor_si256 (ones, _mm256_add_epi64 (_mm256_set1_epi64x (seed << 11), _mm256_xor_si256 (key, _mm256_set1_epi64x (seed >> 5))))
+            )
+        );
+
+        hash = _mm256_add_epi64 (_mm256_xor_si256 (hash, ones), _mm256_slli_epi64 (hash, 21));
+        hash = _mm256_xor_si256 (hash, _mm256_srli_epi64 (hash, 24));
+        hash = _mm256_add_epi64 (_mm256_add_epi64 (hash, _mm256_slli_epi64 (hash, 3)), _mm256_slli_epi64 (hash, 8));
+        hash = _mm256_xor_si256 (hash, _mm256_srli_epi64 (hash, 14));
+        hash = _mm256_add_epi64 (_mm256_add_epi64 (hash, _mm256_slli_epi64 (hash, 2)), _mm256_slli_epi64 (hash, 4));
+        hash = _mm256_xor_si256 (hash, _mm256_srli_epi64 (hash, 28));
+        hash = _mm256_add_epi64 (hash, _mm256_slli_epi64 (hash, 31));
+
+        return reduce (hash);
+    }
+
+    /** NativeInt64::oahash64 of each lane. */
+    static u_int64_t oahash (__m256i code)
+    {
+        code = _mm256_xor_si256 (code, _mm256_srli_epi64 (code, 14));
+        code = _mm256_add_epi64 (_mm256_xor_si256 (code, _mm256_set1_epi64x (-1)), _mm256_slli_epi64 (code, 18));
+        code = _mm256_xor_si256 (code, _mm256_srli_epi64 (code, 31));
+        code = _mm256_add_epi64 (_mm256_add_epi64 (code, _mm256_slli_epi64 (code, 2)), _mm256_slli_epi64 (code, 4)); // code * 21
+        code = _mm256_xor_si256 (code, _mm256_srli_epi64 (code, 11));
+        code = _mm256_add_epi64 (code, _mm256_slli_epi64 (code, 6));
+        code = _mm256_xor_si256 (code, _mm256_srli_epi64 (code, 22));
+
+        return reduce (code);
+    }
+};
+
+/********************************************************************************/
+/** The reverse complement is computed on 128 nucleotides, then shifted; for a LargeInt<3>, the complement
+ * of the zero upper lane goes in the lowest lane, which is always shifted out since sizeKmer <= 96. */
+template<>  inline LargeInt<3> revcomp (const LargeInt<3>& x, size_t sizeKmer)
+{
+    LargeInt<3> res;
+    LargeIntAVX2<3>::store (res.value, LargeIntAVX2<3>::shiftRight (LargeIntAVX2<3>::revcomp (LargeIntAVX2<3>::load (x.value)), 2*(128-sizeKmer)));
+    return res;
+}
+
+template<>  inline LargeInt<4> revcomp (const LargeInt<4>& x, size_t sizeKmer)
+{
+    LargeInt<4> res;
+    LargeIntAVX2<4>::store (res.value, LargeIntAVX2<4>::shiftRight (LargeIntAVX2<4>::revcomp (LargeIntAVX2<4>::load (x.value)), 2*(128-sizeKmer)));
+    return res;
+}
+
+/********************************************************************************/
+template<>  inline u_int64_t hash1 (const LargeInt<3>& elem, u_int64_t seed)  {  return LargeIntAVX2<3>::hash1 (LargeIntAVX2<3>::load (elem.value), seed);  }
+template<>  inline u_int64_t hash1 (const LargeInt<4>& elem, u_int64_t seed)  {  return LargeIntAVX2<4>::hash1 (LargeIntAVX2<4>::load (elem.value), seed);  }
+
+/********************************************************************************/
+template<>  inline u_int64_t oahash (const LargeInt<3>& elem)  {  return LargeIntAVX2<3>::oahash (LargeIntAVX2<3>::load (elem.value));  }
+template<>  inline u_int64_t oahash (const LargeInt<4>& elem)  {  return LargeIntAVX2<4>::oahash (LargeIntAVX2<4>::load (elem.value));  }
+
+/********************************************************************************/
+#endif //__AVX2__
+/********************************************************************************/
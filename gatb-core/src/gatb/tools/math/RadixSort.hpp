@@ -0,0 +1,185 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/** \file RadixSort.hpp
+ *  \brief In place radix sort of LargeInt arrays
+ */
+
+#ifndef _GATB_CORE_TOOLS_MATH_RADIX_SORT_HPP_
+#define _GATB_CORE_TOOLS_MATH_RADIX_SORT_HPP_
+
+/********************************************************************************/
+
+#include <gatb/system/api/types.hpp>
+#include <algorithm>
+#include <cstring>
+
+/********************************************************************************/
+namespace gatb  {
+namespace core  {
+namespace tools {
+namespace math  {
+/********************************************************************************/
+
+/** \brief In place MSD radix sort (American flag sort) of integers.
+ *
+ * The items are sorted byte per byte, from the most significant byte that is not
+ * null for all the items, down to the less significant one. For each byte, the items
+ * are permuted in place into 256 buckets, then each bucket is sorted on the next byte.
+ * Small buckets are sorted by insertion.
+ *
+ * The item type T must provide getSize() (in bits), getByte(idx) and the | and <
+ * operators (see LargeInt); getByte is specialized for each LargeInt precision, so no
+ * multi word shift is done for getting the digits.
+ *
+ * An optional payload array can be given; its items are moved along with the keys, so
+ * that payload[i] still matches keys[i] after the sort.
+ */
+template<typename T, typename P=u_int8_t>
+class RadixSort
+{
+public:
+
+    /** Sort the keys (and the payload if not null).
+     * \param[in] keys : items to be sorted
+     * \param[in] payload : items moved as the keys (may be null)
+     * \param[in] n : number of items */
+    static void sort (T* keys, P* payload, size_t n)
+    {
+        if (n < 2)  { return; }
+
+        /** We look for the most significant byte used by the items. */
+        T acc = keys[0];
+        for (size_t i=1; i<n; i++)  { acc = acc | keys[i]; }
+
+        int byte = T::getSize()/8 - 1;
+        while (byte > 0 && acc.getByte(byte) == 0)  { byte--; }
+
+        sort (keys, payload, n, byte);
+    }
+
+private:
+
+    /** Buckets smaller than this are sorted by insertion. */
+    static const size_t SMALL_SIZE = 32;
+
+    static void insertionSort (T* keys, P* payload, size_t n)
+    {
+        for (size_t i=1; i<n; i++)
+        {
+            T k = keys[i];
+            size_t j = i;
+
+            if (payload)
+            {
+                P p = payload[i];
+                for ( ; j>0 && k < keys[j-1]; j--)  { keys[j] = keys[j-1];  payload[j] = payload[j-1]; }
+                payload[j] = p;
+            }
+            else
+            {
+                for ( ; j>0 && k < keys[j-1]; j--)  { keys[j] = keys[j-1]; }
+            }
+
+            keys[j] = k;
+        }
+    }
+
+    static void sort (T* keys, P* payload, size_t n, int byte)
+    {
+        while (true)
+        {
+            if (n <= SMALL_SIZE)  { insertionSort (keys, payload, n);  return; }
+
+            size_t count[256];
+            memset (count, 0, sizeof(count));
+
+            for (size_t i=0; i<n; i++)  { count[keys[i].getByte(byte)]++; }
+
+            /** All the items share the same digit: we go directly to the next one. */
+            if (count[keys[0].getByte(byte)] == n)
+            {
+                if (byte == 0)  { return; }
+                byte--;
+                continue;
+            }
+
+            size_t start[256];
+            size_t next [256];
+            size_t offset = 0;
+            for (size_t b=0; b<256; b++)  { start[b] = next[b] = offset;  offset += count[b]; }
+
+            /** We move each item to its bucket, by following the permutation cycles. */
+            for (size_t b=0; b<256; b++)
+            {
+                size_t end = start[b] + count[b];
+
+                while (next[b] < end)
+                {
+                    T        k = keys[next[b]];
+                    u_int8_t d = k.getByte(byte);
+
+                    if (d == b)  { next[b]++;  continue; }
+
+                    P p = payload ? payload[next[b]] : P();
+
+                    do
+                    {
+                        size_t dest = next[d]++;
+                        std::swap (k, keys[dest]);
+                        if (payload)  { std::swap (p, payload[dest]); }
+                        d = k.getByte(byte);
+                    }
+                    while (d != b);
+
+                    keys[next[b]] = k;
+                    if (payload)  { payload[next[b]] = p; }
+                    next[b]++;
+                }
+            }
+
+            if (byte == 0)  { return; }
+
+            for (size_t b=0; b<256; b++)
+            {
+                if (count[b] > 1)  { sort (keys + start[b], payload ? payload + start[b] : 0, count[b], byte-1); }
+            }
+            return;
+        }
+    }
+};
+
+/** Sort an array of integers with RadixSort.
+ * \param[in] keys : items to be sorted
+ * \param[in] n : number of items */
+template<typename T>
+inline void radixSort (T* keys, size_t n)  {  RadixSort<T>::sort (keys, 0, n);  }
+
+/** Sort an array of integers with RadixSort, moving the payload items along with the keys.
+ * \param[in] keys : items to be sorted
+ * \param[in] payload : items moved as the keys
+ * \param[in] n : number of items */
+template<typename T, typename P>
+inline void radixSort (T* keys, P* payload, size_t n)  {  RadixSort<T,P>::sort (keys, payload, n);  }
+
+/********************************************************************************/
+} } } } /* end of namespaces. */
+/********************************************************************************/
+
+#endif /* _GATB_CORE_TOOLS_MATH_RADIX_SORT_HPP_ */
@@ -77,6 +77,8 @@ enum BloomKind
     BLOOM_CACHE,
     /** Implementation of Bloom filters improving CPU cache management. */
     BLOOM_NEIGHBOR,
+    /** Implementation of Bloom filters mapping each item to a single CPU cache line. */
+    BLOOM_BLOCKED,
     BLOOM_DEFAULT
 };
 
@@ -89,6 +91,7 @@ static void parse (const std::string& s, BloomKind& kind)
     else if (s == "basic")       { kind = BLOOM_BASIC;  }
     else if (s == "cache")       { kind = BLOOM_CACHE; }
 	else if (s == "neighbor")    { kind = BLOOM_NEIGHBOR; }
+    else if (s == "blocked")     { kind = BLOOM_BLOCKED; }
     else if (s == "default")     { kind = BLOOM_CACHE; }
     else   { throw system::Exception ("bad Bloom kind '%s'", s.c_str()); }
 }
@@ -104,6 +107,7 @@ static const char* toString (BloomKind kind)
         case BLOOM_BASIC:     return "basic";
         case BLOOM_CACHE:     return "cache";
 		case BLOOM_NEIGHBOR:  return "neighbor";
+        case BLOOM_BLOCKED:   return "blocked";
         case BLOOM_DEFAULT:   return "cache";
         default:        throw system::Exception ("bad Bloom kind %d", kind);
     }
@@ -223,6 +227,40 @@ static std::string toString (BranchingKind kind)
 
 /********************************************************************************/
 
+/** Enumeration for the different layouts of the adjacency information (see Graph::precomputeAdjacency). */
+enum AdjacencyKind
+{
+    /** one byte per node, at the index given by the MPHF */
+    ADJACENCY_MPHF,
+    /** nodes renumbered so that the nodes of a simple path have consecutive indexes */
+    ADJACENCY_LOCALITY
+};
+
+/** Get the enum from a string.
+ * \param[in] s : string to be parsed
+ * \param[out] kind : enum to be set from the string parsing. */
+static void parse (const std::string& s, AdjacencyKind& kind)
+{
+         if (s == "mphf")       { kind = ADJACENCY_MPHF;      }
+    else if (s == "locality")   { kind = ADJACENCY_LOCALITY;  }
+    else   { throw system::Exception ("bad adjacency kind '%s'", s.c_str()); }
+}
+
+/** Get the string associated to an enum
+ * \param[in] kind : the enum value
+ * \return the associated string */
+static std::string toString (AdjacencyKind kind)
+{
+    switch (kind)
+    {
+        case ADJACENCY_MPHF:       return "mphf";
+        case ADJACENCY_LOCALITY:   return "locality";
+        default:        throw system::Exception ("bad adjacency kind %d", kind);
+    }
+}
+
+/********************************************************************************/
+
 /** Enumeration for the different kinds of kmer solidity criteria supported in GATB. */
 enum KmerSolidityKind
 {
@@ -275,6 +313,43 @@ static std::string toString (KmerSolidityKind kind)
 
 /********************************************************************************/
 
+/** Enumeration for the different algorithms sorting the kmers of a partition. */
+enum SortEngineKind
+{
+    /** comparison sort (std::sort) */
+    SORT_ENGINE_STD,
+    /** in place radix sort (see tools::math::RadixSort) */
+    SORT_ENGINE_RADIX,
+    SORT_ENGINE_DEFAULT
+};
+
+/** Get the enum from a string.
+ * \param[in] s : string to be parsed
+ * \param[out] kind : enum to be set from the string parsing. */
+static void parse (const std::string& s, SortEngineKind& kind)
+{
+         if (s == "std")       { kind = SORT_ENGINE_STD;    }
+    else if (s == "radix")     { kind = SORT_ENGINE_RADIX;  }
+    else if (s == "default")   { kind = SORT_ENGINE_RADIX;  }
+    else   { throw system::Exception ("bad sort engine '%s'", s.c_str()); }
+}
+
+/** Get the string associated to an enum
+ * \param[in] kind : the enum value
+ * \return the associated string */
+static std::string toString (SortEngineKind kind)
+{
+    switch (kind)
+    {
+        case SORT_ENGINE_STD:      return "std";
+        case SORT_ENGINE_RADIX:    return "radix";
+        case SORT_ENGINE_DEFAULT:  return "radix";
+        default:    throw system::Exception ("bad sort engine %d", kind);
+    }
+}
+
+/********************************************************************************/
+
 /** Enumeration of different kinds of graph traversal. */
 enum TraversalKind
 {
@@ -122,6 +122,9 @@ public:
     const char* minimizer_type ()  { return "-minimizer-type"; }
     const char* repartition_type() { return "-repartition-type"; }
     const char* compress_level()   { return "-out-compress"; }
+    const char* tmp_compress()     { return "-tmp-compress"; }
+    const char* sort_engine()      { return "-sort-engine"; }
+    const char* tmp_in_memory()    { return "-tmp-in-memory"; }
     const char* config_only()      { return "-config-only"; }
     const char* storage_type()     { return "-storage-type"; }
 
@@ -179,6 +182,9 @@ public:
 #define STR_MINIMIZER_TYPE      gatb::core::tools::misc::StringRepository::singleton().minimizer_type()
 #define STR_REPARTITION_TYPE    gatb::core::tools::misc::StringRepository::singleton().repartition_type()
 #define STR_COMPRESS_LEVEL      gatb::core::tools::misc::StringRepository::singleton().compress_level()
+#define STR_TMP_COMPRESS        gatb::core::tools::misc::StringRepository::singleton().tmp_compress()
+#define STR_SORT_ENGINE         gatb::core::tools::misc::StringRepository::singleton().sort_engine()
+#define STR_TMP_IN_MEMORY       gatb::core::tools::misc::StringRepository::singleton().tmp_in_memory()
 #define STR_CONFIG_ONLY         gatb::core::tools::misc::StringRepository::singleton().config_only()
 #define STR_STORAGE_TYPE        gatb::core::tools::misc::StringRepository::singleton().storage_type ()
 
@@ -115,6 +115,9 @@ public:
      * \param[in] length : size of the data */
     void setRef (T* buffer, size_t length)
     {
+        /** We release the buffer we may own, otherwise it would leak. */
+        if (_isAllocated && _buffer && _buffer != buffer)  { FREE (_buffer); }
+
         _buffer      = buffer;
         _size        = length;
         _isAllocated = false;
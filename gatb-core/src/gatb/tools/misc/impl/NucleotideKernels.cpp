@@ -0,0 +1,295 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include <gatb/tools/misc/impl/NucleotideKernels.hpp>
+#include <gatb/tools/misc/api/Data.hpp>
+
+#include <string.h>
+#include <algorithm>
+
+/** The SIMD kernels are compiled with per function target attributes, so that they don't
+ * depend on the -m flags given to the whole library; they are only called if the CPU supports them.
+ * This only matters for builds configured with -DNO_AVX2=1 (or NO_SSE), the default build on an
+ * AVX2 host being compiled with -mavx2 everywhere. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GATB_NUCLEOTIDE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/********************************************************************************/
+namespace gatb {  namespace core { namespace tools {  namespace misc {  namespace impl {
+/********************************************************************************/
+
+typedef void (*EncodeFct) (const char* ascii, size_t length, char* codes, u_int64_t* invalid);
+typedef void (*PackFct)   (const char* ascii, size_t length, u_int8_t* packed);
+
+/*********************************************************************
+** Generic implementation; also used for the tails of the SIMD ones.
+*********************************************************************/
+static void encode_generic (const char* ascii, size_t from, size_t length, char* codes, u_int64_t* invalid)
+{
+    /** The bitmap is built by words of 64 nucleotides; 'from' may be inside a word already partly set. */
+    for (size_t i=from; i<length; )
+    {
+        size_t    end = std::min ((i|63)+1, length);
+        u_int64_t bad = 0;
+
+        for ( ; i<end; i++)
+        {
+            unsigned char c = ascii[i];
+            codes[i] = (c>>1) & 3;
+            bad |= (u_int64_t) Data::validNucleotide[c] << (i&63);
+        }
+
+        invalid[(end-1)>>6] |= bad;
+    }
+}
+
+static void encode_generic (const char* ascii, size_t length, char* codes, u_int64_t* invalid)
+{
+    memset (invalid, 0, ((length+63)/64) * sizeof(u_int64_t));
+    encode_generic (ascii, 0, length, codes, invalid);
+}
+
+static void pack_generic (const char* ascii, size_t from, size_t length, u_int8_t* packed)
+{
+    for (size_t i=from; i<length; i+=4)
+    {
+        u_int8_t x = 0;
+        for (size_t j=i; j<i+4; j++)  {  x = (x << 2) | (j<length ? (ascii[j]>>1) & 3 : 0);  }
+        packed[i>>2] = x;
+    }
+}
+
+static void pack_generic (const char* ascii, size_t length, u_int8_t* packed)
+{
+    pack_generic (ascii, 0, length, packed);
+}
+
+#ifdef GATB_NUCLEOTIDE_KERNELS_X86
+
+/*********************************************************************
+** SSE4.2 implementation, 16 nucleotides per step.
+*********************************************************************/
+__attribute__((target("sse4.2")))
+static void encode_sse (const char* ascii, size_t length, char* codes, u_int64_t* invalid)
+{
+    memset (invalid, 0, ((length+63)/64) * sizeof(u_int64_t));
+
+    const __m128i three = _mm_set1_epi8 (3);
+    const __m128i lower = _mm_set1_epi8 (0x20);
+    const __m128i a = _mm_set1_epi8 ('a'),  c = _mm_set1_epi8 ('c'),  g = _mm_set1_epi8 ('g'),  t = _mm_set1_epi8 ('t');
+
+    size_t i=0;
+    for ( ; i+16<=length; i+=16)
+    {
+        __m128i x = _mm_loadu_si128 ((const __m128i*) (ascii+i));
+
+        /** The bit shifted from the next byte is removed by the mask. */
+        _mm_storeu_si128 ((__m128i*) (codes+i), _mm_and_si128 (_mm_srli_epi16 (x, 1), three));
+
+        __m128i l  = _mm_or_si128 (x, lower);
+        __m128i ok = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (l,a), _mm_cmpeq_epi8 (l,c)),
+                                   _mm_or_si128 (_mm_cmpeq_epi8 (l,g), _mm_cmpeq_epi8 (l,t)));
+
+        invalid[i>>6] |= (u_int64_t) (~_mm_movemask_epi8 (ok) & 0xFFFF) << (i&63);
+    }
+
+    encode_generic (ascii, i, length, codes, invalid);
+}
+
+__attribute__((target("sse4.2")))
+static void pack_sse (const char* ascii, size_t length, u_int8_t* packed)
+{
+    const __m128i three   = _mm_set1_epi8 (3);
+    const __m128i weight2 = _mm_set1_epi16 (0x0104);       // 4*c0 + c1
+    const __m128i weight4 = _mm_set1_epi32 (0x00010010);   // 16*(4*c0+c1) + (4*c2+c3)
+    const __m128i gather  = _mm_setr_epi8 (0,4,8,12, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1);
+
+    size_t i=0;
+    for ( ; i+16<=length; i+=16)
+    {
+        __m128i x = _mm_and_si128 (_mm_srli_epi16 (_mm_loadu_si128 ((const __m128i*) (ascii+i)), 1), three);
+        x = _mm_madd_epi16 (_mm_maddubs_epi16 (x, weight2), weight4);
+
+        u_int32_t word = _mm_cvtsi128_si32 (_mm_shuffle_epi8 (x, gather));
+        memcpy (packed + (i>>2), &word, sizeof(word));
+    }
+
+    pack_generic (ascii, i, length, packed);
+}
+
+/*********************************************************************
+** AVX2 implementation, 32 nucleotides per step.
+*********************************************************************/
+__attribute__((target("avx2")))
+static void encode_avx2 (const char* ascii, size_t length, char* codes, u_int64_t* invalid)
+{
+    memset (invalid, 0, ((length+63)/64) * sizeof(u_int64_t));
+
+    const __m256i three = _mm256_set1_epi8 (3);
+    const __m256i lower = _mm256_set1_epi8 (0x20);
+    const __m256i a = _mm256_set1_epi8 ('a'),  c = _mm256_set1_epi8 ('c'),  g = _mm256_set1_epi8 ('g'),  t = _mm256_set1_epi8 ('t');
+
+    size_t i=0;
+    for ( ; i+32<=length; i+=32)
+    {
+        __m256i x = _mm256_loadu_si256 ((const __m256i*) (ascii+i));
+
+        _mm256_storeu_si256 ((__m256i*) (codes+i), _mm256_and_si256 (_mm256_srli_epi16 (x, 1), three));
+
+        __m256i l  = _mm256_or_si256 (x, lower);
+        __m256i ok = _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (l,a), _mm256_cmpeq_epi8 (l,c)),
+                                      _mm256_or_si256 (_mm256_cmpeq_epi8 (l,g), _mm256_cmpeq_epi8 (l,t)));
+
+        invalid[i>>6] |= (u_int64_t) (~(u_int32_t)_mm256_movemask_epi8 (ok)) << (i&63);
+    }
+
+    encode_generic (ascii, i, length, codes, invalid);
+}
+
+__attribute__((target("avx2")))
+static void pack_avx2 (const char* ascii, size_t length, u_int8_t* packed)
+{
+    const __m256i three   = _mm256_set1_epi8 (3);
+    const __m256i weight2 = _mm256_set1_epi16 (0x0104);
+    const __m256i weight4 = _mm256_set1_epi32 (0x00010010);
+    const __m256i gather  = _mm256_setr_epi8 (0,4,8,12, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+                                              0,4,8,12, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1);
+    const __m256i lanes   = _mm256_setr_epi32 (0,4, 1,2,3,5,6,7);
+
+    size_t i=0;
+    for ( ; i+32<=length; i+=32)
+    {
+        __m256i x = _mm256_and_si256 (_mm256_srli_epi16 (_mm256_loadu_si256 ((const __m256i*) (ascii+i)), 1), three);
+        x = _mm256_madd_epi16 (_mm256_maddubs_epi16 (x, weight2), weight4);
+
+        /** Each 128 bits lane gathers its 4 bytes in its first word; both words are then moved side by side. */
+        x = _mm256_permutevar8x32_epi32 (_mm256_shuffle_epi8 (x, gather), lanes);
+
+        u_int64_t word = _mm_cvtsi128_si64 (_mm256_castsi256_si128 (x));
+        memcpy (packed + (i>>2), &word, sizeof(word));
+    }
+
+    pack_generic (ascii, i, length, packed);
+}
+
+#endif /* GATB_NUCLEOTIDE_KERNELS_X86 */
+
+/*********************************************************************
+** Dispatch
+*********************************************************************/
+struct Kernels
+{
+    const char* name;
+    EncodeFct   encode;
+    PackFct     pack;
+};
+
+static const Kernels kernelsGeneric = { "generic", encode_generic, pack_generic };
+#ifdef GATB_NUCLEOTIDE_KERNELS_X86
+static const Kernels kernelsSSE     = { "sse4.2",  encode_sse,     pack_sse     };
+static const Kernels kernelsAVX2    = { "avx2",    encode_avx2,    pack_avx2    };
+#endif
+
+static const Kernels* bestKernels ()
+{
+#ifdef GATB_NUCLEOTIDE_KERNELS_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))    { return &kernelsAVX2; }
+    if (__builtin_cpu_supports ("sse4.2"))  { return &kernelsSSE;  }
+#endif
+    return &kernelsGeneric;
+}
+
+static const Kernels*& kernels ()
+{
+    static const Kernels* current = bestKernels ();
+    return current;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void NucleotideKernels::encode (const char* ascii, size_t length, char* codes, u_int64_t* invalid)
+{
+    kernels()->encode (ascii, length, codes, invalid);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+void NucleotideKernels::pack (const char* ascii, size_t length, u_int8_t* packed)
+{
+    kernels()->pack (ascii, length, packed);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+string NucleotideKernels::getImplementation ()
+{
+    return kernels()->name;
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE :
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+bool NucleotideKernels::setImplementation (const string& name)
+{
+    const Kernels* candidate = 0;
+
+    if (name == kernelsGeneric.name)  { candidate = &kernelsGeneric; }
+#ifdef GATB_NUCLEOTIDE_KERNELS_X86
+    __builtin_cpu_init ();
+    if (name == kernelsSSE.name  && __builtin_cpu_supports ("sse4.2"))  { candidate = &kernelsSSE;  }
+    if (name == kernelsAVX2.name && __builtin_cpu_supports ("avx2"))    { candidate = &kernelsAVX2; }
+#endif
+
+    if (candidate == 0)  { return false; }
+
+    kernels() = candidate;
+    return true;
+}
+
+/********************************************************************************/
+} } } } } /* end of namespaces. */
+/********************************************************************************/
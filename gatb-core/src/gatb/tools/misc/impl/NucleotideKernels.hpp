@@ -0,0 +1,85 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/** \file NucleotideKernels.hpp
+ *  \brief Block conversion of ASCII nucleotides into 2 bits codes
+ */
+
+#ifndef _GATB_CORE_TOOLS_MISC_NUCLEOTIDE_KERNELS_HPP_
+#define _GATB_CORE_TOOLS_MISC_NUCLEOTIDE_KERNELS_HPP_
+
+/********************************************************************************/
+
+#include <gatb/system/api/types.hpp>
+#include <string>
+
+/********************************************************************************/
+namespace gatb      {
+namespace core      {
+namespace tools     {
+namespace misc      {
+namespace impl      {
+/********************************************************************************/
+
+/** \brief Conversion of ASCII nucleotides into 2 bits codes, many nucleotides at a time.
+ *
+ * The codes are the ones of Data::ConvertASCII, ie. (c>>1)&3, which gives A=0, C=1, T=2, G=3.
+ * A nucleotide is invalid when it is not one of ACGT (lower case included), as for Data::validNucleotide;
+ * invalid nucleotides still get a code (N gives 3).
+ *
+ * Each method has a scalar implementation and SSE4.2 (16 nucleotides per step) and AVX2
+ * (32 nucleotides per step) ones. The implementation is chosen at first use according to
+ * the instruction sets supported by the running CPU. Note that this runtime dispatch only makes
+ * the library portable when it is configured with -DNO_AVX2=1: otherwise CMake adds -mavx2 to the
+ * whole build on an AVX2 host (see LargeIntAVX2.pri), and the library then requires AVX2 anyway.
+ */
+class NucleotideKernels
+{
+public:
+
+    /** Convert ASCII nucleotides into one code per byte (ie. the Data::INTEGER encoding),
+     * and set the bit i of the 'invalid' bitmap for each invalid nucleotide i.
+     * \param[in]  ascii : nucleotides to be converted
+     * \param[in]  length : number of nucleotides
+     * \param[out] codes : codes of the nucleotides, 'length' bytes
+     * \param[out] invalid : bitmap of the invalid nucleotides, (length+63)/64 words */
+    static void encode (const char* ascii, size_t length, char* codes, u_int64_t* invalid);
+
+    /** Convert ASCII nucleotides into 4 codes per byte (ie. the Data::BINARY encoding), the first
+     * nucleotide being in the most significant bits. The last byte is padded with zeros.
+     * \param[in]  ascii : nucleotides to be converted
+     * \param[in]  length : number of nucleotides
+     * \param[out] packed : packed codes, (length+3)/4 bytes */
+    static void pack (const char* ascii, size_t length, u_int8_t* packed);
+
+    /** Get the name of the implementation in use.
+     * \return "avx2", "sse4.2" or "generic" */
+    static std::string getImplementation ();
+
+    /** Force the implementation to be used; mainly for tests and benchmarks, not thread safe.
+     * \param[in] name : one of the names returned by getImplementation
+     * \return false if the implementation is not supported by the CPU (the current one is kept). */
+    static bool setImplementation (const std::string& name);
+};
+
+/********************************************************************************/
+} } } } } /* end of namespaces. */
+/********************************************************************************/
+
+#endif /* _GATB_CORE_TOOLS_MISC_NUCLEOTIDE_KERNELS_HPP_ */
@@ -23,6 +23,14 @@
 #include <gatb/tools/math/NativeInt8.hpp>
 #include <gatb/tools/designpattern/impl/IteratorHelpers.hpp>
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+
+#include <zlib.h>
+
 /********************************************************************************/
 namespace gatb { namespace core {  namespace tools {  namespace storage {  namespace impl {
 /********************************************************************************/
@@ -239,6 +247,13 @@ class Storage_istreambuf : public std::streambuf
             return traits_type::to_int_type(*gptr());
         }
 
+        // overrides base class seekoff(), only for telling the current position (tellg)
+        pos_type seekoff (off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+        {
+            if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::in))  {  return pos_type(off_type(-1));  }
+            return pos_type (currentIdx - (egptr() - gptr()));
+        }
+
         // copy ctor and assignment not implemented;
         // copying not allowed
         Storage_istreambuf(const Storage_istreambuf &);
@@ -309,10 +324,15 @@ Storage::istream::~istream ()
 ////////// SuperKmerBinFiles //////////
 ///////////////////////////////////////
 	
-SuperKmerBinFiles::SuperKmerBinFiles(const std::string& path,const std::string& name, size_t nb_files) : _basefilename(name), _path(path),_nb_files(nb_files)
+SuperKmerBinFiles::SuperKmerBinFiles(const std::string& path,const std::string& name, size_t nb_files, int codec, u_int64_t memoryBudget) : _basefilename(name), _path(path), _codec(codec), _nb_files(nb_files), _writer(0)
 {
 	_nbKmerperFile.resize(_nb_files,0);
 	_FileSize.resize(_nb_files,0);
+	_RawSize.resize(_nb_files,0);
+	_ReadSize.resize(_nb_files,0);
+
+	_memoryShare = _nb_files > 0 ? memoryBudget / _nb_files : 0;
+	_arenas.resize(_nb_files);
 	
 	openFiles("wb"); //at construction will open file for writing
 	// then use close() and openFiles() to open for reading
@@ -321,12 +341,19 @@ SuperKmerBinFiles::SuperKmerBinFiles(const std::string& path,const std::string&
 
 void SuperKmerBinFiles::openFile( const char* mode, int fileId)
 {
-	std::stringstream ss;
-	ss << _basefilename << "." << fileId;
-		
-	_files[fileId] = system::impl::System::file().newFile (_path, ss.str(), mode);
+	//with a memory budget, a file exists only if some of its blocks did not fit in RAM
+	if(_memoryShare == 0 || _arenas[fileId].spilled)
+	{
+		std::stringstream ss;
+		ss << _basefilename << "." << fileId;
+
+		_files[fileId] = system::impl::System::file().newFile (_path, ss.str(), mode);
+	}
 	_synchros[fileId] = system::impl::System::thread().newSynchronizer();
 	_synchros[fileId]->use();
+
+	_arenas[fileId].readChunk  = 0;
+	_arenas[fileId].readOffset = 0;
 }
 	
 void SuperKmerBinFiles::openFiles( const char* mode)
@@ -338,13 +365,7 @@ void SuperKmerBinFiles::openFiles( const char* mode)
 
 	for(unsigned int ii=0;ii<_files.size();ii++)
 	{
-		std::stringstream ss;
-		ss << _basefilename << "." << ii;
-		
-		_files[ii] = system::impl::System::file().newFile (_path, ss.str(), mode);
-		_synchros[ii] = system::impl::System::thread().newSynchronizer();
-		_synchros[ii]->use();
-
+		openFile(mode, ii);
 	}
 }
 
@@ -359,9 +380,154 @@ std::string SuperKmerBinFiles::getFileName(int fileId)
 }
 
 	
+//zlib streams are kept per thread, so that blocks are encoded / decoded without allocating a new state each time
+struct SuperKmerDeflater
+{
+	SuperKmerDeflater()  { memset(&zs, 0, sizeof(zs)); deflateInit2(&zs, 1, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY); }
+	~SuperKmerDeflater() { deflateEnd(&zs); }
+	z_stream zs;
+	std::vector<unsigned char> buffer;
+};
+
+struct SuperKmerInflater
+{
+	SuperKmerInflater()  { memset(&zs, 0, sizeof(zs)); inflateInit2(&zs, -15); }
+	~SuperKmerInflater() { inflateEnd(&zs); }
+	z_stream zs;
+};
+
+//returns the size of the deflated block in out, or 0 if it is not smaller than the block
+static unsigned int deflateBlock(const unsigned char * block, unsigned int block_size, unsigned char ** out)
+{
+	static thread_local SuperKmerDeflater d;
+
+	d.buffer.resize (deflateBound(&d.zs, block_size));
+	deflateReset (&d.zs);
+
+	d.zs.next_in   = (Bytef*) block;
+	d.zs.avail_in  = block_size;
+	d.zs.next_out  = d.buffer.data();
+	d.zs.avail_out = d.buffer.size();
+
+	if (deflate (&d.zs, Z_FINISH) != Z_STREAM_END || d.zs.total_out >= block_size)  { return 0; }
+
+	*out = d.buffer.data();
+	return d.zs.total_out;
+}
+
+static void inflateBlock(const unsigned char * in, unsigned int in_size, unsigned char * block, unsigned int block_size)
+{
+	static thread_local SuperKmerInflater d;
+
+	inflateReset (&d.zs);
+
+	d.zs.next_in   = (Bytef*) in;
+	d.zs.avail_in  = in_size;
+	d.zs.next_out  = block;
+	d.zs.avail_out = block_size;
+
+	if (inflate (&d.zs, Z_FINISH) != Z_STREAM_END || d.zs.total_out != block_size)
+	{
+		throw system::Exception ("corrupted superkmer block (%u bytes expected, %lu decoded)", block_size, (unsigned long)d.zs.total_out);
+	}
+}
+
+//blocks are kept in RAM by chunks doubling from the min size to the max size (or the size of the block if bigger),
+//so that the small partitions don't waste much memory
+static const unsigned int ARENA_CHUNK_MIN_SIZE = 1 << 16;
+static const unsigned int ARENA_CHUNK_MAX_SIZE = 1 << 20;
+
+bool SuperKmerBinFiles::storeBlock(const unsigned char * stored, unsigned int stored_size, unsigned int block_size, int file_id)
+{
+	Arena& arena = _arenas[file_id];
+
+	if(_memoryShare == 0 || arena.spilled)
+		return false;
+
+	unsigned int record_size = 2*sizeof(block_size) + stored_size;
+
+	if(arena.chunks.empty() || arena.chunks.back().used + record_size > arena.chunks.back().capacity)
+	{
+		unsigned int capacity = arena.chunks.empty() ? ARENA_CHUNK_MIN_SIZE : std::min (2*arena.chunks.back().capacity, ARENA_CHUNK_MAX_SIZE);
+		capacity = std::max (record_size, (unsigned int) std::min ((u_int64_t)capacity, _memoryShare));
+
+		//the file exceeds its share of the budget : this block and the next ones go to disk
+		if(arena.size + capacity > _memoryShare)
+		{
+			arena.spilled = true;
+			return false;
+		}
+
+		Arena::Chunk chunk = { (unsigned char*) MALLOC (capacity), capacity, 0 };
+		arena.chunks.push_back(chunk);
+		arena.size += capacity;
+	}
+
+	Arena::Chunk& chunk = arena.chunks.back();
+	memcpy(chunk.data + chunk.used,                      &block_size,  sizeof(block_size));
+	memcpy(chunk.data + chunk.used + sizeof(block_size), &stored_size, sizeof(stored_size));
+	memcpy(chunk.data + chunk.used + 2*sizeof(block_size), stored, stored_size);
+	chunk.used += record_size;
+
+	return true;
+}
+
+const unsigned char * SuperKmerBinFiles::nextBlock(int file_id)
+{
+	Arena& arena = _arenas[file_id];
+
+	while(arena.readChunk < arena.chunks.size() && arena.readOffset >= arena.chunks[arena.readChunk].used)
+	{
+		arena.readChunk++;
+		arena.readOffset = 0;
+	}
+
+	if(arena.readChunk >= arena.chunks.size())
+		return 0;
+
+	const unsigned char * record = arena.chunks[arena.readChunk].data + arena.readOffset;
+
+	unsigned int stored_size;
+	memcpy(&stored_size, record + sizeof(unsigned int), sizeof(stored_size));
+	arena.readOffset += 2*sizeof(unsigned int) + stored_size;
+
+	return record;
+}
+
 int SuperKmerBinFiles::readBlock(unsigned char ** block, unsigned int* max_block_size, unsigned int* nb_bytes_read, int file_id)
 {
 	_synchros[file_id]->lock();
+
+	//the blocks kept in RAM come first ; they don't move until destruction, so they are decoded out of the lock
+	if(const unsigned char * record = nextBlock(file_id))
+	{
+		unsigned int stored_size;
+		memcpy(nb_bytes_read, record,                          sizeof(*nb_bytes_read));
+		memcpy(&stored_size,  record + sizeof(*nb_bytes_read), sizeof(stored_size));
+
+		_ReadSize[file_id] += stored_size + 2*sizeof(stored_size);
+
+		_synchros[file_id]->unlock();
+
+		if(*nb_bytes_read > *max_block_size)
+		{
+			*block = (unsigned char *) realloc(*block, *nb_bytes_read);
+			*max_block_size = *nb_bytes_read;
+		}
+
+		if(stored_size < *nb_bytes_read)
+			inflateBlock(record + 2*sizeof(stored_size), stored_size, *block, *nb_bytes_read);
+		else
+			memcpy(*block, record + 2*sizeof(stored_size), *nb_bytes_read);
+
+		return *nb_bytes_read;
+	}
+
+	if(_files[file_id] == 0)
+	{
+		_synchros[file_id]->unlock();
+		return 0;
+	}
 	
 	//block header
 	int nbr = _files[file_id]->fread(nb_bytes_read, sizeof(*max_block_size),1);
@@ -372,17 +538,32 @@ int SuperKmerBinFiles::readBlock(unsigned char ** block, unsigned int* max_block
 		_synchros[file_id]->unlock();
 		return 0;
 	}
+
+	unsigned int stored_size = *nb_bytes_read;
+	if(_codec != SUPERK_CODEC_NONE)
+		_files[file_id]->fread(&stored_size, sizeof(stored_size),1);
+
+	//a deflated block is read after the room for the decoded block
+	unsigned int needed = *nb_bytes_read + (stored_size < *nb_bytes_read ? stored_size : 0);
 	
-	if(*nb_bytes_read > *max_block_size)
+	if(needed > *max_block_size)
 	{
-		*block = (unsigned char *) realloc(*block, *nb_bytes_read);
-		*max_block_size = *nb_bytes_read;
+		*block = (unsigned char *) realloc(*block, needed);
+		*max_block_size = needed;
 	}
 	
 	//block
-	_files[file_id]->fread(*block, sizeof(unsigned char),*nb_bytes_read);
+	if(stored_size < *nb_bytes_read)
+		_files[file_id]->fread(*block + *nb_bytes_read, sizeof(unsigned char),stored_size);
+	else
+		_files[file_id]->fread(*block, sizeof(unsigned char),*nb_bytes_read);
+
+	_ReadSize[file_id] += stored_size + sizeof(*nb_bytes_read) + (_codec != SUPERK_CODEC_NONE ? sizeof(stored_size) : 0);
 	
 	_synchros[file_id]->unlock();
+
+	if(stored_size < *nb_bytes_read)
+		inflateBlock(*block + *nb_bytes_read, stored_size, *block, *nb_bytes_read);
 	
 	return *nb_bytes_read;
 }
@@ -415,29 +596,265 @@ void SuperKmerBinFiles::getFilesStats(u_int64_t & total, u_int64_t & biggest, u_
 		mean= total/_FileSize.size();
 	
 }
+
+void SuperKmerBinFiles::getMemoryStats(u_int64_t & memoryBytes, int & nbSpilledFiles)
+{
+	memoryBytes    = 0;
+	nbSpilledFiles = 0;
+	for(unsigned int ii=0;ii<_arenas.size();ii++)
+	{
+		memoryBytes += _arenas[ii].size;
+		if(_arenas[ii].spilled)
+			nbSpilledFiles++;
+	}
+}
+
+u_int64_t SuperKmerBinFiles::getMemorySize()
+{
+	u_int64_t memoryBytes;
+	int       nbSpilledFiles;
+	getMemoryStats(memoryBytes, nbSpilledFiles);
+	return memoryBytes;
+}
+
+void SuperKmerBinFiles::getCodecStats(u_int64_t & rawBytes, u_int64_t & writtenBytes, u_int64_t & readBytes)
+{
+	rawBytes = writtenBytes = readBytes = 0;
+	for(unsigned int ii=0;ii<_FileSize.size();ii++)
+	{
+		rawBytes     += _RawSize[ii];
+		writtenBytes += _FileSize[ii];
+		readBytes    += _ReadSize[ii];
+	}
+}
 	
 	
+unsigned int SuperKmerBinFiles::encodeBlock(unsigned char * block, unsigned int block_size, unsigned char ** stored)
+{
+	*stored = block;
+
+	if(_codec == SUPERK_CODEC_DEFLATE)
+	{
+		unsigned int deflated_size = deflateBlock(block, block_size, stored);
+		if(deflated_size > 0)
+			return deflated_size;
+		*stored = block;
+	}
+
+	return block_size;
+}
+
 void SuperKmerBinFiles::writeBlock(unsigned char * block, unsigned int block_size, int file_id, int nbkmers)
 {
+	//the block is encoded before taking the file lock
+	unsigned char * stored      = 0;
+	unsigned int    stored_size = encodeBlock(block, block_size, &stored);
 
+	writeEncodedBlock(stored, stored_size, block_size, file_id, nbkmers);
+}
+
+void SuperKmerBinFiles::writeEncodedBlock(const unsigned char * stored, unsigned int stored_size, unsigned int block_size, int file_id, int nbkmers)
+{
 	_synchros[file_id]->lock();
 	
 	_nbKmerperFile[file_id]+=nbkmers;
-	_FileSize[file_id] += block_size+sizeof(block_size);
+	_RawSize[file_id]  += block_size+sizeof(block_size);
+
+	if(storeBlock(stored, stored_size, block_size, file_id))
+	{
+		_synchros[file_id]->unlock();
+		return;
+	}
+
+	//the file is created when its first block is spilled out of the memory budget
+	if(_files[file_id] == 0)
+	{
+		std::stringstream ss;
+		ss << _basefilename << "." << file_id;
+		_files[file_id] = system::impl::System::file().newFile (_path, ss.str(), "wb");
+	}
+
+	_FileSize[file_id] += stored_size+sizeof(block_size);
 	//block header
 	_files[file_id]->fwrite(&block_size, sizeof(block_size),1);
 
+	if(_codec != SUPERK_CODEC_NONE)
+	{
+		_FileSize[file_id] += sizeof(stored_size);
+		_files[file_id]->fwrite(&stored_size, sizeof(stored_size),1);
+	}
+
 	//block
-	_files[file_id]->fwrite(block, sizeof(unsigned char),block_size);
+	_files[file_id]->fwrite(stored, sizeof(unsigned char),stored_size);
 	
 	_synchros[file_id]->unlock();
 
 }
 	
+//state of the background writers : blocks are handed through a bounded queue,
+//written buffers are kept in a free list to be given back to the callers of writeBlockAsync
+struct SuperKmerBinFiles::AsyncWriter
+{
+	struct Block
+	{
+		unsigned char* data;
+		unsigned int   capacity;
+		unsigned int   size;         // size of the block before encoding
+		unsigned int   stored_size;  // size of the encoded block held in data
+		int            file_id;
+		int            nbkmers;
+	};
+
+	AsyncWriter(size_t maxQueued) : _maxQueued(maxQueued), _stop(false) {}
+
+	static u_int64_t elapsed (const std::chrono::steady_clock::time_point& t0)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now() - t0).count();
+	}
+
+	void run (SuperKmerBinFiles* files)
+	{
+		while (true)
+		{
+			Block b;
+			{
+				std::unique_lock<std::mutex> lock (_mutex);
+				_notEmpty.wait (lock, [this] { return _stop || !_queue.empty(); });
+
+				//stop only once all the queued blocks are written
+				if (_queue.empty())  { return; }
+
+				b = _queue.front();
+				_queue.pop_front();
+			}
+			_notFull.notify_one();
+
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			files->writeEncodedBlock (b.data, b.stored_size, b.size, b.file_id, b.nbkmers);
+			u_int64_t t = elapsed (t0);
+
+			std::unique_lock<std::mutex> lock (_mutex);
+			files->_writerStats.writeTime += t;
+			_free.push_back (b);
+		}
+	}
+
+	size_t                   _maxQueued;
+	bool                     _stop;
+	std::deque<Block>        _queue;
+	std::vector<Block>       _free;
+	std::mutex               _mutex;
+	std::condition_variable  _notEmpty;
+	std::condition_variable  _notFull;
+	std::vector<std::thread> _threads;
+};
+
+SuperKmerBinFiles::WriterStats& SuperKmerBinFiles::WriterStats::operator+= (const WriterStats& s)
+{
+	nbBlocks      += s.nbBlocks;
+	nbBytes       += s.nbBytes;
+	maxQueueDepth  = std::max (maxQueueDepth, s.maxQueueDepth);
+	sumQueueDepth += s.sumQueueDepth;
+	nbStalls      += s.nbStalls;
+	stallTime     += s.stallTime;
+	writeTime     += s.writeTime;
+	return *this;
+}
+
+void SuperKmerBinFiles::startWriters(size_t nbWriters, size_t maxQueued)
+{
+	if (_writer != 0 || nbWriters == 0)  { return; }
+
+	_writer = new AsyncWriter (std::max (maxQueued, (size_t)1));
+
+	for (size_t i=0; i<nbWriters; i++)
+	{
+		_writer->_threads.push_back (std::thread (&AsyncWriter::run, _writer, this));
+	}
+}
+
+void SuperKmerBinFiles::stopWriters()
+{
+	if (_writer == 0)  { return; }
+
+	{
+		std::unique_lock<std::mutex> lock (_writer->_mutex);
+		_writer->_stop = true;
+	}
+	_writer->_notEmpty.notify_all();
+
+	for (size_t i=0; i<_writer->_threads.size(); i++)  {  _writer->_threads[i].join();  }
+
+	for (size_t i=0; i<_writer->_free.size(); i++)  {  FREE (_writer->_free[i].data);  }
+
+	delete _writer;
+	_writer = 0;
+}
+
+void SuperKmerBinFiles::writeBlockAsync(unsigned char ** block, unsigned int capacity, unsigned int block_size, int file_id, int nbkmers)
+{
+	if (_writer == 0)
+	{
+		writeBlock (*block, block_size, file_id, nbkmers);
+		return;
+	}
+
+	//the block is encoded by the calling thread, so the compression is spread over all the callers
+	//and the writers only do the I/O ; an encoded block is smaller than the block, so it replaces it in its buffer
+	unsigned char * stored      = 0;
+	unsigned int    stored_size = encodeBlock(*block, block_size, &stored);
+	if(stored != *block)
+		memcpy(*block, stored, stored_size);
+
+	AsyncWriter::Block b = { *block, capacity, block_size, stored_size, file_id, nbkmers };
+	unsigned char* freeBuffer = 0;
+
+	{
+		std::unique_lock<std::mutex> lock (_writer->_mutex);
+
+		if (_writer->_queue.size() >= _writer->_maxQueued)
+		{
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			_writer->_notFull.wait (lock, [this] { return _writer->_queue.size() < _writer->_maxQueued; });
+			_writerStats.nbStalls  ++;
+			_writerStats.stallTime += AsyncWriter::elapsed (t0);
+		}
+
+		_writer->_queue.push_back (b);
+
+		_writerStats.nbBlocks ++;
+		_writerStats.nbBytes       += block_size;
+		_writerStats.sumQueueDepth += _writer->_queue.size();
+		_writerStats.maxQueueDepth  = std::max (_writerStats.maxQueueDepth, (u_int64_t)_writer->_queue.size());
+
+		//we look for an already written buffer big enough
+		for (size_t i=0; i<_writer->_free.size(); i++)
+		{
+			if (_writer->_free[i].capacity >= capacity)
+			{
+				freeBuffer = _writer->_free[i].data;
+				_writer->_free[i] = _writer->_free.back();
+				_writer->_free.pop_back();
+				break;
+			}
+		}
+	}
+	_writer->_notEmpty.notify_one();
+
+	if (freeBuffer == 0)  {  freeBuffer = (unsigned char*) MALLOC (sizeof(unsigned char) * capacity);  }
+
+	*block = freeBuffer;
+}
+
 void SuperKmerBinFiles::flushFiles()
 {
+	this->stopWriters();
+
 	for(unsigned int ii=0;ii<_files.size();ii++)
 	{
+		if(_synchros[ii]==0)
+			continue;
+
 		_synchros[ii]->lock();
 
 		if(_files[ii]!=0)
@@ -468,21 +885,22 @@ void SuperKmerBinFiles::closeFile(  int fileId)
 	{
 		delete _files[fileId];
 		_files[fileId] = 0;
+	}
+	if(_synchros[fileId]!=0)
+	{
 		_synchros[fileId]->forget();
+		_synchros[fileId] = 0;
 	}
 }
 
 	
 void SuperKmerBinFiles::closeFiles()
 {
+	this->stopWriters();
+
 	for(unsigned int ii=0;ii<_files.size();ii++)
 	{
-		if(_files[ii]!=0)
-		{
-			delete _files[ii];
-			_files[ii] = 0;
-			_synchros[ii]->forget();
-		}
+		closeFile(ii);
 	}
 }
 	
@@ -490,6 +908,12 @@ SuperKmerBinFiles::~SuperKmerBinFiles()
 {
 	this->closeFiles();
 	this->eraseFiles();
+
+	for(unsigned int ii=0;ii<_arenas.size();ii++)
+	{
+		for(unsigned int jj=0;jj<_arenas[ii].chunks.size();jj++)
+			FREE (_arenas[ii].chunks[jj].data);
+	}
 }
 	
 int SuperKmerBinFiles::nbFiles()
@@ -558,7 +982,10 @@ void CacheSuperKmerBinFiles::flush(int file_id)
 {
 	if(_buffers_idx[file_id]!=0)
 	{
-		_ref->writeBlock(_buffers[file_id],_buffers_idx[file_id],file_id,_nbKmerperFile[file_id]);
+		if(_ref->hasWriters())
+			_ref->writeBlockAsync(&_buffers[file_id],_buffer_max_capacity,_buffers_idx[file_id],file_id,_nbKmerperFile[file_id]);
+		else
+			_ref->writeBlock(_buffers[file_id],_buffers_idx[file_id],file_id,_nbKmerperFile[file_id]);
 		
 		_buffers_idx[file_id]=0;
 		_nbKmerperFile[file_id] = 0;
@@ -240,6 +240,21 @@ protected:
 //the  block structure makes it easier for buffered read,
 //otherwise we would not know how to read a big chunk without stopping in the middle of superkmer
 
+//with SUPERK_CODEC_DEFLATE, block header = 4B block size + 4B stored size, and the block is stored deflated
+//(stored size == block size means the block did not compress and is stored as is)
+//blocks are compressed by writeBlock / writeBlockAsync in the calling thread and decompressed by readBlock,
+//so users of the files see the same blocks
+
+//with a memory budget, the blocks of each file are kept in RAM (encoded as in the files) as long as they fit
+//in the file share of the budget ; the next blocks of the file are then written to disk (the file is created
+//at this time only). readBlock gives the blocks kept in RAM first, then the blocks of the file.
+
+enum SuperKmerCodec
+{
+	SUPERK_CODEC_NONE    = 0,
+	SUPERK_CODEC_DEFLATE = 1
+};
+
 class SuperKmerBinFiles
 {
 	
@@ -247,7 +262,8 @@ public:
 	
 	//construtor will open the files for writing
 	//use closeFiles to close them all then openFiles to open in different mode
-	SuperKmerBinFiles(const std::string& path,const std::string& name, size_t nb_files);
+	//with memoryBudget > 0 (bytes), no file is opened until a file share of the budget is exceeded
+	SuperKmerBinFiles(const std::string& path,const std::string& name, size_t nb_files, int codec = SUPERK_CODEC_NONE, u_int64_t memoryBudget = 0);
 	
 	~SuperKmerBinFiles();
 
@@ -263,12 +279,49 @@ public:
 	int readBlock(unsigned char ** block, unsigned int* max_block_size, unsigned int* nb_bytes_read, int file_id);
 	void writeBlock(unsigned char * block, unsigned int block_size, int file_id, int nbkmers);
 
+	//background writing : once startWriters is called, filled blocks can be handed with writeBlockAsync
+	//and are written by nbWriters threads; at most maxQueued blocks wait in the queue, beyond that the caller stalls.
+	//the blocks are encoded (see SuperKmerCodec) by the caller of writeBlockAsync, the writers only do the I/O.
+	//stopWriters waits for all queued blocks to be written (also done by flushFiles and closeFiles)
+	void startWriters(size_t nbWriters, size_t maxQueued);
+	void stopWriters();
+	bool hasWriters() const { return _writer != 0; }
+
+	//hands the block to the writer threads without copying it ; *block is replaced by a free buffer of at least capacity bytes
+	void writeBlockAsync(unsigned char ** block, unsigned int capacity, unsigned int block_size, int file_id, int nbkmers);
+
+	//statistics of the background writers, accumulated since construction
+	struct WriterStats
+	{
+		WriterStats() : nbBlocks(0), nbBytes(0), maxQueueDepth(0), sumQueueDepth(0), nbStalls(0), stallTime(0), writeTime(0) {}
+
+		WriterStats& operator+= (const WriterStats& s);
+
+		u_int64_t nbBlocks;       // blocks handed to the writers
+		u_int64_t nbBytes;        // bytes of these blocks
+		u_int64_t maxQueueDepth;  // max number of blocks waiting in the queue
+		u_int64_t sumQueueDepth;  // sum of the queue depth seen at each hand off (mean = sum / nbBlocks)
+		u_int64_t nbStalls;       // number of hand offs that had to wait for a free queue slot
+		u_int64_t stallTime;      // time (microseconds) spent by the callers waiting for a free queue slot
+		u_int64_t writeTime;      // time (microseconds) spent by the writers in write calls
+	};
+
+	const WriterStats& getWriterStats() const { return _writerStats; }
+
 	int nbFiles();
 	int getNbItems(int fileId);
 	
 	void getFilesStats(u_int64_t & total, u_int64_t & biggest, u_int64_t & smallest, float & mean);
 	u_int64_t getFileSize(int fileId);
 
+	//bytes of the blocks before encoding, bytes written to the files and bytes read from them (headers included)
+	void getCodecStats(u_int64_t & rawBytes, u_int64_t & writtenBytes, u_int64_t & readBytes);
+	int getCodec() const { return _codec; }
+
+	//bytes kept in RAM and number of files written to disk because they exceeded their share of the memory budget
+	void getMemoryStats(u_int64_t & memoryBytes, int & nbSpilledFiles);
+	u_int64_t getMemorySize();
+
 	
 	std::string getFileName(int fileId);
 private:
@@ -278,10 +331,51 @@ private:
 	
 	std::vector<int> _nbKmerperFile;
 	std::vector<u_int64_t> _FileSize;
+	std::vector<u_int64_t> _RawSize;
+	std::vector<u_int64_t> _ReadSize;
+	int _codec;
 
 	std::vector<system::IFile* > _files;
 	std::vector <system::ISynchronizer*> _synchros;
 	int _nb_files;
+
+	//blocks kept in RAM : each file has a list of chunks holding < block size, stored size, block > records,
+	//and a read position (chunk, offset) reset by openFile
+	struct Arena
+	{
+		Arena() : size(0), spilled(false), readChunk(0), readOffset(0) {}
+
+		struct Chunk
+		{
+			unsigned char* data;
+			unsigned int   capacity;
+			unsigned int   used;
+		};
+
+		std::vector<Chunk> chunks;
+		u_int64_t size;
+		bool      spilled;
+		size_t    readChunk;
+		size_t    readOffset;
+	};
+
+	//encodes the block with the codec of the files ; *stored is either the block itself or a per-thread buffer
+	//(valid until the next encoding of the same thread), and the returned size is the size of *stored
+	unsigned int encodeBlock(unsigned char * block, unsigned int block_size, unsigned char ** stored);
+
+	//stores a block already encoded, in RAM or in its file (takes the file lock)
+	void writeEncodedBlock(const unsigned char * stored, unsigned int stored_size, unsigned int block_size, int file_id, int nbkmers);
+
+	//both methods are called with the file lock taken
+	bool storeBlock(const unsigned char * stored, unsigned int stored_size, unsigned int block_size, int file_id);
+	const unsigned char * nextBlock(int file_id);
+
+	u_int64_t _memoryShare;
+	std::vector<Arena> _arenas;
+
+	struct AsyncWriter;
+	AsyncWriter* _writer;
+	WriterStats  _writerStats;
 };
 
 
@@ -0,0 +1,161 @@
+/* thread scaling of the bglue step (unitigs gluing after BCALM2):
+ *  - union-find alone: concurrent unions of glue-like links, then normalization and conversion to 32-bit classes
+ *  - whole bglue on a glue file synthesized from a unitigs file: each unitig is cut in pieces overlapping by k nucleotides,
+ *    which bglue has to glue back together (so the number of output sequences is the number of input unitigs)
+ *
+ * usage: bench_glue [nb_elements] [max_threads]
+ *        bench_glue -glue <unitigs.fa> <k (< 64)> [max_threads]
+ * */
+
+#include <chrono>
+#define get_wtime() chrono::system_clock::now()
+#define diff_wtime(x,y) chrono::duration_cast<chrono::nanoseconds>(y - x).count()
+
+#include <gatb/system/impl/System.hpp>
+#include <gatb/bank/impl/BankFasta.hpp>
+#include <gatb/bcalm2/bglue_algo.hpp>
+#include <gatb/bcalm2/unionFind.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+using namespace gatb::core::system;
+using namespace gatb::core::system::impl;
+
+using namespace gatb::core::bank;
+using namespace gatb::core::bank::impl;
+
+using namespace gatb::core::debruijn::impl;
+
+static double unit = 1000000000;
+
+/* links as made by bglue: mostly between nearby elements (pieces of the same unitig), a few long range ones */
+static void bench_uf (uint32_t nbElements, int maxThreads)
+{
+    vector<pair<uint32_t,uint32_t> > links (nbElements / 2);
+    srand (0);
+    for (size_t i=0; i<links.size(); i++)
+    {
+        uint32_t a = ((uint32_t)rand() << 16 ^ rand()) % nbElements;
+        uint32_t b = (rand() % 8 == 0) ? ((uint32_t)rand() << 16 ^ rand()) % nbElements : (a + 1 + rand() % 4) % nbElements;
+        links[i] = make_pair (a, b);
+    }
+
+    cout << "union-find, " << nbElements << " elements, " << links.size() << " unions" << endl;
+
+    vector<uint32_t> reference;
+    for (int nbThreads = 1; nbThreads <= maxThreads; nbThreads *= 2)
+    {
+        unionFind uf (nbElements);
+
+        auto t0 = get_wtime();
+        vector<thread> threads;
+        for (int t=0; t<nbThreads; t++)
+        {
+            threads.push_back (thread ([&uf, &links, t, nbThreads] ()
+            {
+                for (size_t i=t; i<links.size(); i+=nbThreads)  { uf.union_ (links[i].first, links[i].second); }
+            }));
+        }
+        for (auto& th : threads)  { th.join(); }
+        auto t1 = get_wtime();
+        uf.normalize (nbThreads);
+        auto t2 = get_wtime();
+        uint32_t* classes = uf.release_classes (nbThreads);
+        auto t3 = get_wtime();
+
+        bool same = true;
+        if (reference.empty())  { reference.assign (classes, classes + nbElements); }
+        else                    { same = memcmp (reference.data(), classes, nbElements * sizeof(uint32_t)) == 0; }
+        free (classes);
+
+        cout << "   " << nbThreads << " threads :  unions " << diff_wtime(t0,t1) / unit << " s   normalize " << diff_wtime(t1,t2) / unit
+             << " s   to 32-bit " << diff_wtime(t2,t3) / unit << " s   " << (same ? "same classes" : "ERROR: classes differ") << endl;
+    }
+}
+
+/* writes <prefix>.glue and <prefix>.glue.0 as BCALM2 would, from the unitigs; returns the number of pieces */
+static size_t make_glue (const string& unitigs, const string& prefix, size_t k)
+{
+    BankFasta bank (unitigs);
+    BankFasta::Iterator it (bank);
+
+    ofstream glue ((prefix + ".glue.0").c_str());
+    size_t nbPieces = 0;
+    srand (0);
+    for (it.first(); !it.isDone(); it.next())
+    {
+        string seq = it->toString();
+        for (size_t begin = 0; begin + k <= seq.size(); )
+        {
+            size_t end = min (seq.size(), begin + k + 1 + rand() % 20); /* pieces add at least one nucleotide to the previous one */
+
+            nbPieces++;
+            glue << ">" << (begin > 0 ? '1' : '0') << (end < seq.size() ? '1' : '0') << " ";
+            for (size_t i = begin; i + k <= end; i++)  { glue << "1 "; }
+            glue << "\n" << seq.substr (begin, end - begin) << "\n";
+
+            if (end == seq.size())  { break; }
+            begin = end - k;
+        }
+    }
+    ofstream list ((prefix + ".glue").c_str());
+    list << prefix << ".glue.0" << endl;
+    return nbPieces;
+}
+
+template<size_t span> static void bench_bglue (const string& unitigs, size_t k, int maxThreads)
+{
+    string prefix = "bench_glue.tmp";
+
+    for (int nbThreads = 1; nbThreads <= maxThreads; nbThreads *= 2)
+    {
+        size_t nbPieces = make_glue (unitigs, prefix, k);
+
+        auto t0 = get_wtime();
+        bglue<span> (nullptr, prefix, k, 0, nbThreads, false, false);
+        auto t1 = get_wtime();
+
+        size_t nbGlued = 0;
+        BankFasta bank (prefix);
+        BankFasta::Iterator it (bank);
+        for (it.first(); !it.isDone(); it.next())  { nbGlued++; }
+
+        cout.precision(3); /* bglue changes it */
+        cout << "bglue, " << nbThreads << " threads : " << diff_wtime(t0,t1) / unit << " s  (" << nbPieces << " pieces glued into " << nbGlued << " sequences)" << endl;
+        System::file().remove (prefix);
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    try
+    {
+        if (argc >= 4 && strcmp (argv[1], "-glue") == 0)
+        {
+            size_t k          = atol (argv[3]);
+            int    maxThreads = argc >= 5 ? atoi (argv[4]) : System::info().getNbCores();
+            if (k < 32)  {  bench_bglue<32> (argv[2], k, maxThreads);  }
+            else         {  bench_bglue<64> (argv[2], k, maxThreads);  }
+        }
+        else
+        {
+            uint32_t nbElements = argc >= 2 ? atol (argv[1]) : 50*1000*1000;
+            int      maxThreads = argc >= 3 ? atoi (argv[2]) : System::info().getNbCores();
+            bench_uf (nbElements, maxThreads);
+        }
+    }
+    catch (Exception& e)
+    {
+        cerr << "EXCEPTION: " << e.getMessage() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -33,6 +33,13 @@
 
 #include <iostream>
 #include <memory>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -64,11 +71,8 @@ using namespace gatb::core::tools::storage::impl;
 
 /* inspired by debruijn_test3 from unit tests*/
 
-// for some reason it didn't recall those definition (yet in Minia.cpp, it did)
-template <size_t span>
-using NodeFast = Node_t<typename gatb::core::kmer::impl::Kmer<span>::Type >;
-template <size_t span>
-using EdgeFast = Edge_t<NodeFast<span> >;
+typedef GraphPoly   Graph;
+typedef NodeVariant Node;
 
 struct Parameter
 {
@@ -82,7 +86,7 @@ struct Parameter
 template<size_t span> struct debruijn_mphf_bench {  void operator ()  (Parameter params)
 {
     typedef NodeFast<span> NodeFastT;
-    typedef GraphTemplate<NodeFastT,EdgeFast<span>,GraphData<span>> GraphFast;
+    typedef gatb::core::debruijn::impl::GraphFast<span> GraphFast;
 
     size_t kmerSize = params.k;
     
@@ -111,8 +115,8 @@ template<size_t span> struct debruijn_mphf_bench {  void operator ()  (Parameter
     cout.setf(ios_base::fixed);
     cout.precision(3);
 
-    Graph::Iterator<Node> nodes = graph.iterator();
-    typename GraphFast::template Iterator<NodeFastT> nodesFast = graphFast.iterator();
+    GraphIterator<Node> nodes = graph.iterator();
+    GraphIterator<NodeFastT> nodesFast = graphFast.iterator();
     nodes.first ();
 
     /** We get the first node. */
@@ -143,15 +147,6 @@ template<size_t span> struct debruijn_mphf_bench {  void operator ()  (Parameter
         }
 
 
-        for (int i = 0; i < 0; i++)
-        {
-            auto start_tt=chrono::system_clock::now();
-            for (nodes.first(); !nodes.isDone(); nodes.next())
-                modelCanonical.EMPHFhash(nodes.item().kmer.get<Type>());
-            auto end_tt=chrono::system_clock::now();
-            cout << "time to do " << nodes.size() << " computing EMPHFhash of kmers on all nodes (" << kmerSize << "-mers) : " << (diff_wtime(start_tt, end_tt) / unit) << " seconds" << endl;
-        }
-        // it's slow. i don't understand why. see above for the "confuse mphf" part
         //return; //FIXME
     }
 
@@ -271,13 +266,6 @@ template<size_t span> struct debruijn_mphf_bench {  void operator ()  (Parameter
     cout << "time to do " << nodes.size() << " computing hash2 of kmers on all NodeFast (" << kmerSize << "-mers) : " << (diff_wtime(start_t, end_t) / unit) - baseline_hashfast_time << " seconds" << endl;
 
 
-    start_t=chrono::system_clock::now();
-    for (nodes.first(); !nodes.isDone(); nodes.next())
-        modelCanonical.EMPHFhash(nodes.item().kmer.get<Type>());
-    end_t=chrono::system_clock::now();
-
-    cout << "time to do " << nodes.size() << " computing EMPHFhash of kmers on all nodes (" << kmerSize << "-mers) : " << (diff_wtime(start_t, end_t) / unit) - baseline_hash_time << " seconds" << endl;
-    // it's slow. i don't understand why. see above for the "confuse mphf" part
 
 
     start_t=chrono::system_clock::now();
@@ -370,6 +358,123 @@ template<size_t span> struct debruijn_mphf_bench {  void operator ()  (Parameter
 }
 };
 
+/* counts the hardware cache misses of the calling thread since its creation (-1 when not available) */
+struct CacheMissCounter
+{
+#ifdef __linux__
+    CacheMissCounter ()
+    {
+        struct perf_event_attr attr;
+        memset (&attr, 0, sizeof(attr));
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~CacheMissCounter ()  {  if (fd >= 0)  { close (fd); }  }
+    long long get ()  {  long long count;  return (fd >= 0 && read (fd, &count, sizeof(count)) == sizeof(count)) ? count : -1;  }
+    int fd;
+#else
+    long long get ()  {  return -1;  }
+#endif
+};
+
+/* walks all the unitigs of the graph with simplePathAvance, from the neighbors of the branching nodes.
+ * The walk is timed with the Bloom filter, then with the adjacency precomputed, in MPHF order and in
+ * locality order. */
+template<size_t span> struct debruijn_walk_bench {  void operator ()  (Parameter params)
+{
+    typedef NodeFast<span> NodeFastT;
+    typedef EdgeFast<span> EdgeFastT;
+    typedef gatb::core::debruijn::impl::GraphFast<span> GraphFast;
+
+    /* without an input file, the reads are random sequences: almost every kmer is a unitig node */
+    vector<string> reads;
+    srand (0);
+    for (size_t i=0; params.seq != "" && i<100; i++)
+    {
+        string read (10000, 'A');
+        for (size_t j=0; j<read.size(); j++)  {  read[j] = "ACGT"[rand() & 3];  }
+        reads.push_back (read);
+    }
+
+    GraphFast graph = (params.seq == "") ?
+        GraphFast::create (params.args.c_str()) :
+        GraphFast::create (new BankStrings (reads), params.args.c_str());
+
+    double unit = 1000000000;
+    cout.setf(ios_base::fixed);
+    cout.precision(3);
+
+    /* the starting points of the walks are collected beforehand, they are not part of the timings */
+    vector<pair<NodeFastT,Direction> > starts;
+    GraphIterator<BranchingNode_t<NodeFastT> > branching = graph.iteratorBranching();
+    for (branching.first(); !branching.isDone(); branching.next())
+    {
+        for (Direction dir : { DIR_OUTCOMING, DIR_INCOMING })
+        {
+            GraphVector<NodeFastT> neighbors = graph.neighbors (branching.item(), dir);
+            for (size_t i=0; i<neighbors.size(); i++)  {  starts.push_back (make_pair (neighbors[i], dir));  }
+        }
+    }
+
+    /* walks all the paths once; returns the number of steps */
+    auto walk = [&] ()
+    {
+        u_int64_t nbSteps = 0;
+        for (size_t i=0; i<starts.size(); i++)
+        {
+            NodeFastT node = starts[i].first;
+            EdgeFastT edge;
+            node.mphfIndex = 0; // the nodes may have been renumbered since the starts were collected
+
+            while (graph.simplePathAvance (node, starts[i].second, edge) == 1)
+            {
+                node = edge.to;
+                nbSteps++;
+            }
+        }
+        return nbSteps;
+    };
+
+    /* times a walk, the first one only warms up the caches */
+    auto bench = [&] (const string& what)
+    {
+        walk ();
+
+        CacheMissCounter misses;
+        auto start_t=chrono::system_clock::now();
+        u_int64_t nbSteps = walk ();
+        auto end_t=chrono::system_clock::now();
+
+        cout << "time to walk " << nbSteps << " unitig steps from " << starts.size() << " branching neighbors (" << params.k << "-mers) "
+             << what << " : " << (diff_wtime(start_t, end_t) / unit) << " seconds, " << misses.get() << " cache misses" << endl;
+    };
+
+    bench ("using bloom");
+
+    graph.precomputeAdjacency (1, false);
+    bench ("using adjacency");
+
+    graph.precomputeAdjacency (1, false, ADJACENCY_LOCALITY);
+    bench ("using adjacency with locality layout");
+}
+};
+
+void debruijn_walk ()
+{
+    size_t kmerSizes[] = {31, 63, 127};
+
+    for (size_t j=0; j<ARRAY_SIZE(kmerSizes); j++)
+    {
+        string args = "-kmer-size " + std::to_string(kmerSizes[j]) + "  -abundance-min 1  -verbose 0  -max-memory 500";
+
+        Integer::apply<debruijn_walk_bench, Parameter> (kmerSizes[j], Parameter( kmerSizes[j], args, "random") );
+    }
+}
+
 void debruijn_mphf ()
 {
     const char* sequences [] =
@@ -399,7 +504,10 @@ int main (int argc, char* argv[])
     {
         // if no arg provided, just run the basic test on a single node
         if (argc == 1)
+        {
             debruijn_mphf();
+            debruijn_walk();
+        }
         else
             // else, use a real file! 
         {
@@ -410,6 +518,7 @@ int main (int argc, char* argv[])
 
             string args = "-in " + string(argv[1]) + " -kmer-size " + std::to_string(k) + " -abundance-min 1  -verbose 0  -max-memory 500";
             Integer::apply<debruijn_mphf_bench, Parameter> (k, Parameter( k, args) );
+            Integer::apply<debruijn_walk_bench, Parameter> (k, Parameter( k, args) );
         }
 
 
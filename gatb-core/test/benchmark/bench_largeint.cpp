@@ -0,0 +1,113 @@
+/* times the LargeInt operations used for kmers longer than 64 nucleotides:
+ *  - kmer update while iterating a sequence (shift by 2, add, mask; and the same on the reverse complement)
+ *  - revcomp, comparison (std::sort), hash1 and oahash
+ *
+ * Some operations of LargeInt<3> and LargeInt<4> are specialized when AVX2 is available at compile time
+ * (see LargeIntAVX2.pri); compile with and without -mavx2 to compare with the generic implementation.
+ *
+ * usage: bench_largeint [nb_kmers]
+ * */
+
+#include <chrono>
+#define get_wtime() chrono::system_clock::now()
+#define diff_wtime(x,y) chrono::duration_cast<chrono::nanoseconds>(y - x).count()
+
+#include <gatb/system/impl/System.hpp>
+
+#include <gatb/tools/math/LargeInt.hpp>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+using namespace gatb::core::system;
+using namespace gatb::core::system::impl;
+
+using namespace gatb::core::tools::math;
+
+template<int precision> void bench (size_t nbKmers, size_t kmerSize)
+{
+    typedef LargeInt<precision> T;
+
+    cout.setf(ios_base::fixed);
+    cout.precision(2);
+
+    T mask;  mask.setVal(1);  mask = (mask << (2*kmerSize)) - 1;
+
+    /* random sequence of nucleotides codes, and random kmers */
+    vector<u_int8_t> codes (nbKmers + kmerSize);
+    for (size_t i=0; i<codes.size(); i++)  {  codes[i] = rand() % 4;  }
+
+    vector<T> kmers (nbKmers);
+    for (size_t i=0; i<nbKmers; i++)
+    {
+        T val;  val.setVal (0);
+        for (size_t b=0; b<2*kmerSize; b+=16)  {  T r; r.setVal (rand() & 0xFFFF);  val = (val << 16) | r;  }
+        kmers[i] = val & mask;
+    }
+
+    /* the checksums keep the compiler from discarding the loops, and tell whether two builds agree */
+    u_int64_t check = 0;
+
+    /* kmer iteration, as in Model::iterate */
+    auto t0 = get_wtime();
+    T kmer, kmer_rc;  kmer.setVal(0);  kmer_rc.setVal(0);
+    for (size_t i=0; i<codes.size(); i++)
+    {
+        kmer    = ( (kmer << 2) +  codes[i]) & mask;
+        T comp;  comp.setVal (codes[i] ^ 2);
+        kmer_rc = (kmer_rc >> 2) + (comp << (2*kmerSize-2));
+        T canonical = kmer < kmer_rc ? kmer : kmer_rc;
+        check += canonical.getVal();
+    }
+    auto t1 = get_wtime();
+
+    for (size_t i=0; i<nbKmers; i++)  {  check += revcomp (kmers[i], kmerSize).getVal();  }
+    auto t2 = get_wtime();
+
+    for (size_t i=0; i<nbKmers; i++)  {  check += hash1 (kmers[i], i);  }
+    auto t3 = get_wtime();
+
+    for (size_t i=0; i<nbKmers; i++)  {  check += oahash (kmers[i]);  }
+    auto t4 = get_wtime();
+
+    std::sort (kmers.begin(), kmers.end());
+    check += kmers[nbKmers/2].getVal();
+    auto t5 = get_wtime();
+
+    double n = nbKmers;
+    cout << T::getName() << "  k=" << kmerSize << "  " << nbKmers << " kmers" << (
+#ifdef __AVX2__
+        "  (AVX2)"
+#else
+        "  (generic)"
+#endif
+    ) << endl;
+    cout << "   iteration      : " << diff_wtime(t0,t1) / n << " ns/kmer" << endl;
+    cout << "   revcomp        : " << diff_wtime(t1,t2) / n << " ns/kmer" << endl;
+    cout << "   hash1          : " << diff_wtime(t2,t3) / n << " ns/kmer" << endl;
+    cout << "   oahash         : " << diff_wtime(t3,t4) / n << " ns/kmer" << endl;
+    cout << "   std::sort      : " << diff_wtime(t4,t5) / n << " ns/kmer" << endl;
+    cout << "   checksum       : " << hex << check << dec << endl;
+}
+
+int main (int argc, char* argv[])
+{
+    size_t nbKmers  = argc >= 2 ? atol (argv[1]) : 10*1000*1000;
+
+    try
+    {
+        bench<3> (nbKmers, 95);
+        bench<4> (nbKmers, 127);
+    }
+    catch (Exception& e)
+    {
+        cerr << "EXCEPTION: " << e.getMessage() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#! /bin/bash
+
+################################################################################
+# Thread scaling of leon compression on a synthetic dataset generated by bankgen.
+#
+# ARG 1 : directory holding the leon and bankgen binaries (default: bin)
+# ARG 2 : list of cores numbers to test (default: "1 2 4 8")
+# ARG 3 : genome size given to bankgen (default: 5000000)
+# ARG 4 : coverage given to bankgen (default: 20)
+#
+# For each number of cores, prints the wall clock time of 'leon -c' and checks
+# that 'leon -d' gives back the input sequences. Headers are discarded
+# (-noheader) so that the timings reflect the DNA compression.
+################################################################################
+
+set -e
+
+BIN_DIR=${1:-bin}
+CORES_LIST=${2:-"1 2 4 8"}
+SEQ_LEN=${3:-5000000}
+COVERAGE=${4:-20}
+
+WORK_DIR=$(mktemp -d bench_leon.XXXXXX)
+trap "rm -rf $WORK_DIR" EXIT
+
+$BIN_DIR/bankgen -out $WORK_DIR/synthetic -seq-len $SEQ_LEN -read-len 100 -overlap-len 50 -coverage $COVERAGE > /dev/null
+
+REF_MD5=$(grep -v '^>' $WORK_DIR/synthetic_reads.fa | md5sum | cut -d' ' -f1)
+
+echo "# genome $SEQ_LEN bp, coverage $COVERAGE, $(stat -c%s $WORK_DIR/synthetic_reads.fa) bytes of reads"
+printf "%8s %12s %12s %8s\n" "cores" "time (s)" "size (B)" "check"
+
+for CORES in $CORES_LIST
+do
+    cp $WORK_DIR/synthetic_reads.fa $WORK_DIR/reads.fa
+
+    START=$(date +%s.%N)
+    $BIN_DIR/leon -c -file $WORK_DIR/reads.fa -nb-cores $CORES -noheader -verbose 0 > /dev/null
+    END=$(date +%s.%N)
+
+    $BIN_DIR/leon -d -file $WORK_DIR/reads.fa.leon -nb-cores $CORES -verbose 0 > /dev/null
+
+    if [ "$(grep -v '^>' $WORK_DIR/reads.fasta.d | md5sum | cut -d' ' -f1)" == "$REF_MD5" ]; then CHECK=OK; else CHECK=KO; fi
+
+    printf "%8d %12.2f %12d %8s\n" $CORES $(awk "BEGIN {print $END - $START}") $(stat -c%s $WORK_DIR/reads.fa.leon) $CHECK
+
+    rm -f $WORK_DIR/reads.fa $WORK_DIR/reads.fa.leon $WORK_DIR/reads.fasta.d
+done
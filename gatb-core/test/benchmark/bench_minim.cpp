@@ -13,6 +13,7 @@
 
 #include <gatb/tools/misc/api/StringsRepository.hpp>
 #include <gatb/tools/misc/impl/TimeInfo.hpp>
+#include <gatb/tools/misc/impl/NucleotideKernels.hpp>
 
 #include <gatb/tools/designpattern/impl/Command.hpp>
 #include <gatb/tools/designpattern/impl/IteratorHelpers.hpp>
@@ -23,6 +24,7 @@
 #include <gatb/bank/impl/BankStrings.hpp>
 #include <gatb/bank/impl/BankSplitter.hpp>
 #include <gatb/bank/impl/BankRandom.hpp>
+#include <gatb/bank/impl/Bank.hpp>
 
 #include <gatb/tools/storage/impl/Storage.hpp>
 
@@ -62,6 +64,9 @@ using namespace gatb::core::tools::storage::impl;
 
 /* inspired by debruijn_test3 from unit tests*/
 
+typedef GraphPoly   Graph;
+typedef NodeVariant Node;
+
 struct Parameter
 {
     Parameter (size_t k, const Graph& graph) : graph(graph), k(k) {}
@@ -170,6 +175,72 @@ template<size_t span> struct debruijn_minim_bench {  void operator ()  (Paramete
 }
 }; // end functor debruijn_minim_bench
 
+/* kmers (and their minimizers) extraction from reads through Model::iterate, with each
+ * implementation of the nucleotides conversion kernels */
+
+struct ExtractionParameter
+{
+    ExtractionParameter (size_t k, const vector<string>& reads) : k(k), reads(reads) {}
+    size_t k;
+    const vector<string>& reads;
+};
+
+template<size_t span> struct kmer_extraction_bench {  void operator ()  (ExtractionParameter params)
+{
+    typedef typename Kmer<span>::ModelCanonical  ModelCanonical;
+    typedef typename Kmer<span>::template ModelMinimizer <ModelCanonical>   ModelMini;
+    typedef typename ModelMini::Kmer                        KmerType;
+
+    ModelMini  modelMini (params.k, 8);
+
+    double unit = 1000000000;
+    cout.setf(ios_base::fixed);
+    cout.precision(3);
+
+    string defaultImplementation = NucleotideKernels::getImplementation();
+    cout << "---- kmer extraction from " << params.reads.size() << " reads (default kernels: " << defaultImplementation << ") -----\n";
+
+    const char* implementations[] = { "generic", "sse4.2", "avx2" };
+    u_int64_t reference = 0;
+
+    for (size_t i=0; i<ARRAY_SIZE(implementations); i++)
+    {
+        if (NucleotideKernels::setImplementation (implementations[i]) == false)
+        {
+            cout << implementations[i] << " kernels not supported by this CPU" << endl;
+            continue;
+        }
+
+        u_int64_t checksum = 0, nbKmers = 0;
+
+        auto start_t=get_wtime();
+        for (size_t r=0; r<params.reads.size(); r++)
+        {
+            Data data ((char*) params.reads[r].c_str());
+            modelMini.iterate (data, [&] (const KmerType& kmer, size_t idx)
+            {
+                if (kmer.isValid())  { checksum += kmer.value().getVal() ^ kmer.minimizer().value().getVal(); }
+                nbKmers++;
+            });
+        }
+        auto end_t=get_wtime();
+
+        double seconds = diff_wtime(start_t, end_t) / unit;
+        cout << nbKmers << " " << params.k << "-mers with " << implementations[i] << " kernels : " << seconds << " seconds ("
+             << (nbKmers / seconds / 1000000) << " Mkmers/s)" << endl;
+
+        if (i == 0)  { reference = checksum; }
+        else if (checksum != reference)
+        {
+            cout << "FAIL! kmers extracted with " << implementations[i] << " kernels differ from the generic ones" << endl;
+            exit(1);
+        }
+    }
+
+    NucleotideKernels::setImplementation (defaultImplementation);
+}
+}; // end functor kmer_extraction_bench
+
 void debruijn_minim ()
 {
     const char* sequences [] =
@@ -190,11 +261,14 @@ void debruijn_minim ()
             /** We create the graph. */
             Graph graph = Graph::create (
                     new BankStrings (sequences[i], 0),
-                    "-kmer-size %d  -abundance-min 1  -verbose 0  -max-memory %d -mphf emphf", kmerSizes[j], 500 
+                    "-kmer-size %d  -abundance-min 1  -verbose 0  -max-memory %d", kmerSizes[j], 500 
                     );
 
             Integer::apply<debruijn_minim_bench, Parameter> (kmerSizes[j], Parameter( kmerSizes[j], graph) );
 
+            vector<string> reads (1, sequences[i]);
+            Integer::apply<kmer_extraction_bench, ExtractionParameter> (kmerSizes[j], ExtractionParameter (kmerSizes[j], reads));
+
             /** We remove the graph. */
             graph.remove ();
         }
@@ -215,10 +289,16 @@ int main (int argc, char* argv[])
             if (argc > 2)
                 k = stoi(argv[2]);
             cout << "building graph with k=" + to_string(k) + " for " + string(argv[1]) << endl;
-            string args = "-in " + string(argv[1]) + " -kmer-size " + to_string(k) + " -abundance-min 1  -verbose 0  -max-memory 500 -mphf emphf";
+            string args = "-in " + string(argv[1]) + " -kmer-size " + to_string(k) + " -abundance-min 1  -verbose 0  -max-memory 500";
             Graph graph = Graph::create (args.c_str());
             cout << "graph built, benchmarking.." << endl;
             Integer::apply<debruijn_minim_bench,Parameter> (k, Parameter(k, graph));
+
+            vector<string> reads;
+            IBank* bank = Bank::open (argv[1]);  LOCAL (bank);
+            Iterator<Sequence>* itSeq = bank->iterator();  LOCAL (itSeq);
+            for (itSeq->first(); !itSeq->isDone(); itSeq->next())  {  reads.push_back (itSeq->item().toString());  }
+            Integer::apply<kmer_extraction_bench,ExtractionParameter> (k, ExtractionParameter(k, reads));
         }
 
 
@@ -0,0 +1,115 @@
+/* compares the sort engines used for counting kmers by sorted vector (see SortCommand in PartitionsCommand.cpp):
+ *  - std::sort on the kmers, and std::sort of an index vector when bank ids are carried along (multi bank counting)
+ *  - in place radix sort, moving the bank ids along with the kmers
+ *
+ * usage: bench_sort [nb_kmers] [kmer_size]
+ * */
+
+#include <chrono>
+#define get_wtime() chrono::system_clock::now()
+#define diff_wtime(x,y) chrono::duration_cast<chrono::nanoseconds>(y - x).count()
+
+#include <gatb/system/impl/System.hpp>
+
+#include <gatb/tools/math/LargeInt.hpp>
+#include <gatb/tools/math/RadixSort.hpp>
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+using namespace gatb::core::system;
+using namespace gatb::core::system::impl;
+
+using namespace gatb::core::tools::math;
+
+typedef u_int8_t BankIdType;
+
+template<typename T> struct Cmp
+{
+    const T* _kmers;
+    Cmp (const T* kmers) : _kmers(kmers) {}
+    bool operator() (size_t a, size_t b)  { return _kmers[a] < _kmers[b]; }
+};
+
+/* sorting of kmers and bank ids as done before the radix sort engine */
+template<typename T> void sortByIndex (vector<T>& kmers, vector<BankIdType>& ids)
+{
+    vector<size_t> idx (kmers.size());
+    for (size_t i=0; i<idx.size(); i++)  { idx[i]=i; }
+
+    std::sort (idx.begin(), idx.end(), Cmp<T>(kmers.data()));
+
+    vector<pair<T,BankIdType> > tmp (idx.size());
+    for (size_t i=0; i<idx.size(); i++)  { tmp[i] = make_pair (kmers[idx[i]], ids[idx[i]]); }
+    for (size_t i=0; i<idx.size(); i++)  { kmers[i] = tmp[i].first;  ids[i] = tmp[i].second; }
+}
+
+template<int precision> void bench (size_t nbKmers, size_t kmerSize)
+{
+    typedef LargeInt<precision> T;
+
+    double unit = 1000000000;
+    cout.setf(ios_base::fixed);
+    cout.precision(3);
+
+    /* random kmers sharing their 4 most significant nucleotides, as in a radix bucket of a partition */
+    T mask;  mask.setVal(1);  mask = (mask << (2*kmerSize - 8)) - 1;
+    T radix; radix.setVal(0x1B); radix = radix << (2*kmerSize - 8);
+
+    vector<T>          kmers (nbKmers);
+    vector<BankIdType> ids   (nbKmers);
+    for (size_t i=0; i<nbKmers; i++)
+    {
+        T val;  val.setVal (0);
+        for (size_t b=0; b<2*kmerSize; b+=16)  {  T r; r.setVal (rand() & 0xFFFF);  val = (val << 16) | r;  }
+        kmers[i] = (val & mask) | radix;
+        ids  [i] = rand() % 4;
+    }
+
+    vector<T>          k1 (kmers), k2 (kmers), k3 (kmers), k4 (kmers);
+    vector<BankIdType> i3 (ids),   i4 (ids);
+
+    auto t0 = get_wtime();
+    std::sort (k1.begin(), k1.end());
+    auto t1 = get_wtime();
+    radixSort (k2.data(), k2.size());
+    auto t2 = get_wtime();
+    sortByIndex (k3, i3);
+    auto t3 = get_wtime();
+    radixSort (k4.data(), i4.data(), k4.size());
+    auto t4 = get_wtime();
+
+    bool ok = (k1 == k2) && (k1 == k3) && (k1 == k4);
+
+    cout << T::getName() << "  k=" << kmerSize << "  " << nbKmers << " kmers" << endl;
+    cout << "   std::sort          : " << diff_wtime(t0,t1) / unit << " s" << endl;
+    cout << "   radix sort         : " << diff_wtime(t1,t2) / unit << " s" << endl;
+    cout << "   std::sort + ids    : " << diff_wtime(t2,t3) / unit << " s" << endl;
+    cout << "   radix sort + ids   : " << diff_wtime(t3,t4) / unit << " s" << endl;
+    cout << "   " << (ok ? "same order" : "ERROR: orders differ") << endl;
+}
+
+int main (int argc, char* argv[])
+{
+    size_t nbKmers  = argc >= 2 ? atol (argv[1]) : 10*1000*1000;
+    size_t kmerSize = argc >= 3 ? atol (argv[2]) : 0;
+
+    try
+    {
+        if (kmerSize == 0 || kmerSize < 32)   {  bench<1> (nbKmers, kmerSize ? kmerSize : 31);  }
+        if (kmerSize == 0 || (kmerSize >= 32 && kmerSize < 64))   {  bench<2> (nbKmers, kmerSize ? kmerSize : 63);  }
+        if (kmerSize == 0 || (kmerSize >= 64 && kmerSize < 96))   {  bench<3> (nbKmers, kmerSize ? kmerSize : 95);  }
+        if (kmerSize == 0 || (kmerSize >= 96 && kmerSize < 128))  {  bench<4> (nbKmers, kmerSize ? kmerSize : 127); }
+    }
+    catch (Exception& e)
+    {
+        cerr << "EXCEPTION: " << e.getMessage() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -24,8 +24,10 @@
 
 #include <gatb/bank/impl/Bank.hpp>
 #include <gatb/bank/impl/BankHelpers.hpp>
+#include <gatb/bank/impl/GzipReader.hpp>
 
 #include <gatb/tools/designpattern/impl/IteratorHelpers.hpp>
+#include <gatb/tools/designpattern/impl/Command.hpp>
 
 #include <gatb/tools/misc/api/Macros.hpp>
 
@@ -85,6 +87,9 @@ class TestBank : public Test
         //        CPPUNIT_TEST_GATB (bank_datalinesize); // disabled since we're printing fasta in one line now (see "#if 1" in BankFasta)
         CPPUNIT_TEST_GATB (bank_registery_types);
         CPPUNIT_TEST_GATB (bank_checkPower2);
+        CPPUNIT_TEST_GATB (bank_checkMmap);
+        CPPUNIT_TEST_GATB (bank_checkGzipThreads);
+        CPPUNIT_TEST_GATB (bank_checkSplit);
 
     CPPUNIT_TEST_SUITE_GATB_END();
 
@@ -1092,6 +1097,171 @@ public:
         System::file().remove(filename);
         CPPUNIT_ASSERT (System::file().doesExist(filename) == false);
     }
+
+    /********************************************************************************/
+    void bank_checkMmap_aux (const string& filename, BankFasta::Iterator::CommentMode_e mode)
+    {
+        BankFasta b (filename);
+
+        /** We iterate the bank through zlib and memory mapping and check we get the same sequences. */
+        vector<string> expected;
+
+        BankFasta::setMmap (false);
+        {
+            BankFasta::Iterator it (b, mode);
+            for (it.first(); !it.isDone(); it.next())
+            {
+                expected.push_back (it->toString() + "|" + it->getComment() + "|" + it->getQuality());
+            }
+        }
+
+        BankFasta::setMmap (true);
+        {
+            size_t nb = 0;
+
+            BankFasta::Iterator it (b, mode);
+            for (it.first(); !it.isDone(); it.next(), nb++)
+            {
+                CPPUNIT_ASSERT (nb < expected.size());
+                CPPUNIT_ASSERT (it->toString() + "|" + it->getComment() + "|" + it->getQuality() == expected[nb]);
+            }
+            CPPUNIT_ASSERT (nb == expected.size());
+        }
+    }
+
+    /********************************************************************************/
+    void bank_checkMmap ()
+    {
+        const char* files[] = { "sample1.fa", "sample2.fa", "reads1.fa", "query.fa", "sample.fastq", "sample1.fa.gz" };
+
+        for (size_t i=0; i<ARRAY_SIZE(files); i++)
+        {
+            bank_checkMmap_aux (DBPATH(files[i]), BankFasta::Iterator::FULL);
+            bank_checkMmap_aux (DBPATH(files[i]), BankFasta::Iterator::IDONLY);
+        }
+    }
+
+    /********************************************************************************/
+    void bank_checkGzipThreads_aux (const string& filename, size_t nbThreads)
+    {
+        BankFasta b (filename);
+
+        /** We iterate the bank with zlib in the current thread and with decompression threads. */
+        vector<string> expected;
+
+        BankFasta::setGzipThreads (0);
+        {
+            BankFasta::Iterator it (b);
+            for (it.first(); !it.isDone(); it.next())  {  expected.push_back (it->toString() + "|" + it->getComment());  }
+        }
+
+        BankFasta::setGzipThreads (nbThreads);
+        {
+            BankFasta::Iterator it (b);
+
+            /** We iterate twice for checking the rewind. */
+            for (size_t loop=0; loop<2; loop++)
+            {
+                size_t nb = 0;
+                for (it.first(); !it.isDone(); it.next(), nb++)
+                {
+                    CPPUNIT_ASSERT (nb < expected.size());
+                    CPPUNIT_ASSERT (it->toString() + "|" + it->getComment() == expected[nb]);
+                }
+                CPPUNIT_ASSERT (nb == expected.size());
+            }
+        }
+    }
+
+    /********************************************************************************/
+    void bank_checkGzipThreads ()
+    {
+        CPPUNIT_ASSERT (GzipReader::isGzip (DBPATH("reads1_bgzf.fa.gz")) == true);
+        CPPUNIT_ASSERT (GzipReader::isBgzf (DBPATH("reads1_bgzf.fa.gz")) == true);
+        CPPUNIT_ASSERT (GzipReader::isBgzf (DBPATH("reads1.fa.gz"))      == false);
+        CPPUNIT_ASSERT (GzipReader::isGzip (DBPATH("reads1.fa"))         == false);
+
+        const char* files[] = { "reads1_bgzf.fa.gz", "reads1.fa.gz", "sample.fastq.gz", "query.fa.gz" };
+
+        size_t nbThreadsTable[] = { 1, 2, 4 };
+
+        for (size_t i=0; i<ARRAY_SIZE(files); i++)
+        {
+            for (size_t j=0; j<ARRAY_SIZE(nbThreadsTable); j++)
+            {
+                bank_checkGzipThreads_aux (DBPATH(files[i]), nbThreadsTable[j]);
+            }
+        }
+
+        /** We restore the default. */
+        BankFasta::setGzipThreads (System::info().getNbCores());
+    }
+
+    /********************************************************************************/
+    void bank_checkSplit_aux (const string& filename, size_t nbParts)
+    {
+        BankFasta b (filename);
+
+        vector<string> expected;
+        {
+            BankFasta::Iterator it (b);
+            for (it.first(); !it.isDone(); it.next())  {  expected.push_back (it->toString() + "|" + it->getComment() + "|" + it->getQuality());  }
+        }
+
+        /** The parts iterated one after the other must give the sequences in the original order. */
+        BankFasta::Iterator it (b);
+        vector<Iterator<Sequence>*> parts = it.split (nbParts);
+
+        CPPUNIT_ASSERT (parts.size() <= nbParts);
+        CPPUNIT_ASSERT (parts.size() <= expected.size());
+
+        size_t nb = 0;
+        for (size_t i=0; i<parts.size(); i++)
+        {
+            Iterator<Sequence>* part = parts[i];
+            LOCAL (part);
+
+            for (part->first(); !part->isDone(); part->next(), nb++)
+            {
+                CPPUNIT_ASSERT (nb < expected.size());
+                CPPUNIT_ASSERT ((*part)->toString() + "|" + (*part)->getComment() + "|" + (*part)->getQuality() == expected[nb]);
+            }
+        }
+        CPPUNIT_ASSERT (nb == expected.size());
+
+        /** Parallel iteration of the parts. */
+        size_t nbIterated = 0;
+        ISynchronizer* synchro = System::thread().newSynchronizer();
+        LOCAL (synchro);
+
+        Dispatcher(4).iterateParts (b.iterator(), [&] (Sequence& seq)
+        {
+            LocalSynchronizer ls (synchro);
+            nbIterated++;
+        });
+        CPPUNIT_ASSERT (nbIterated == expected.size());
+    }
+
+    /********************************************************************************/
+    void bank_checkSplit ()
+    {
+        const char* files[] = { "reads1.fa", "sample2.fa", "query.fa", "sample.fastq" };
+
+        size_t nbPartsTable[] = { 2, 3, 7, 64 };
+
+        for (size_t i=0; i<ARRAY_SIZE(files); i++)
+        {
+            for (size_t j=0; j<ARRAY_SIZE(nbPartsTable); j++)
+            {
+                bank_checkSplit_aux (DBPATH(files[i]), nbPartsTable[j]);
+            }
+        }
+
+        /** A gzipped file can't be split. */
+        BankFasta b (DBPATH("reads1.fa.gz"));
+        BankFasta::Iterator it (b);
+        CPPUNIT_ASSERT (it.split(4).empty() == true);
+    }
 };
 
 /********************************************************************************/
@@ -30,8 +30,10 @@
 #include <gatb/tools/misc/api/Macros.hpp>
 
 #include <gatb/tools/compression/Leon.hpp>
+#include <gatb/tools/compression/QualCoder.hpp>
 
 #include <list>
+#include <fstream>
 #include <stdlib.h>     /* srand, rand */
 #include <time.h>       /* time */
 
@@ -67,6 +69,8 @@ class TestLeon : public Test
     CPPUNIT_TEST_GATB(bank_checkLeon4);
     CPPUNIT_TEST_GATB(bank_checkLeon5);
     CPPUNIT_TEST_GATB(bank_checkLeon6);
+    CPPUNIT_TEST_GATB(bank_checkLeon9);
+    CPPUNIT_TEST_GATB(bank_checkLeon10);
 	
 	//removed some large files from distrib
    // CPPUNIT_TEST_GATB(bank_checkLeon7);
@@ -425,6 +429,201 @@ public:
 		IBank* leonBank = Bank::open (leonFile);
 		bank_compare_banks_equality(leonRefBank, leonBank);
 	}
+
+    /*******************************************************************************
+	 * Test Leon random access: iteration from a given read and split of the bank
+	 * into parts decoded independently.
+	 *
+	 * */
+	void bank_checkLeon9 ()
+	{
+		std::string fastqFile = DBPATH("leon2.fastq");
+		string leonFile = fastqFile + ".leon";
+
+		// STEP 1: compress the Fastq file with small blocks (7 reads => 4 blocks)
+    	std::vector<char*>       leon_args;
+    	std::vector<std::string> data = {
+    			"-",
+				"-c",
+				"-file", fastqFile,
+				"-lossless",
+				"-verbose","0",
+				"-kmer-size", "31",
+				"-abundance", "1",
+				"-reads", "2"
+    	};
+		for(std::vector<std::string>::iterator loop = data.begin(); loop != data.end(); ++loop){
+			leon_args.push_back(&(*loop)[0]);
+		}
+		Leon().run(leon_args.size(), &leon_args[0]);
+
+		// STEP 2: get the reference reads
+		std::vector<std::string> reads;
+		IBank* fasBank = Bank::open (fastqFile);
+		LOCAL (fasBank);
+		Iterator<Sequence>* itFas = fasBank->iterator();
+		LOCAL (itFas);
+		for (itFas->first(); !itFas->isDone(); itFas->next())
+		{
+			reads.push_back ((*itFas)->getComment() + (*itFas)->toString() + (*itFas)->getQuality());
+		}
+
+		BankLeon* leonBank = dynamic_cast<BankLeon*> (Bank::open (leonFile));
+		CPPUNIT_ASSERT (leonBank != 0);
+		LOCAL (leonBank);
+
+		// STEP 3: iterate ranges of reads, some of them starting inside a block
+		for (size_t first=0; first<reads.size(); first+=3)
+		{
+			Iterator<Sequence>* itLeon = leonBank->iterator (first, 3);
+			LOCAL (itLeon);
+
+			size_t idx = first;
+			for (itLeon->first(); !itLeon->isDone(); itLeon->next(), idx++)
+			{
+				CPPUNIT_ASSERT (idx < reads.size());
+				CPPUNIT_ASSERT (reads[idx] == (*itLeon)->getComment() + (*itLeon)->toString() + (*itLeon)->getQuality());
+			}
+			CPPUNIT_ASSERT (idx == std::min (first+3, reads.size()));
+		}
+
+		// STEP 4: the parts of the bank iterate all the reads, in order when concatenated
+		Iterator<Sequence>* itLeon = leonBank->iterator();
+		LOCAL (itLeon);
+		std::vector<Iterator<Sequence>*> parts = itLeon->split (3);
+		CPPUNIT_ASSERT (parts.size() == 3);
+
+		size_t idx = 0;
+		for (size_t i=0; i<parts.size(); i++)
+		{
+			Iterator<Sequence>* part = parts[i];
+			LOCAL (part);
+			for (part->first(); !part->isDone(); part->next(), idx++)
+			{
+				CPPUNIT_ASSERT (idx < reads.size());
+				CPPUNIT_ASSERT (reads[idx] == (*part)->getComment() + (*part)->toString() + (*part)->getQuality());
+			}
+		}
+		CPPUNIT_ASSERT (idx == reads.size());
+	}
+
+    /*******************************************************************************
+	 * Compress a Fastq file with the order-2 quality codec (-qual-context), then
+	 * decompress it with the given numbers of cores and compare to the original.
+	 *
+	 * */
+	void leon_qual_context_compress_and_compare (const std::string& fastqFile, const std::vector<int>& nbCores)
+	{
+		std::string leonFile = fastqFile + ".leon";
+		std::string dFile    = System::file().getDirectory (fastqFile) + "/" + System::file().getBaseName (fastqFile) + ".fastq.d";
+
+		// STEP 1: compress with small blocks, so that the blocks are decoded by several threads
+    	std::vector<char*>       leon_args;
+    	std::vector<std::string> data = {
+    			"-",
+				"-c",
+				"-file", fastqFile,
+				"-lossless",
+				"-qual-context",
+				"-verbose","0",
+				"-kmer-size", "31",
+				"-abundance", "1",
+				"-reads", "3"
+    	};
+		for(std::vector<std::string>::iterator loop = data.begin(); loop != data.end(); ++loop){
+			leon_args.push_back(&(*loop)[0]);
+		}
+		Leon().run(leon_args.size(), &leon_args[0]);
+
+		// STEP 2: decompress with each number of cores, and compare with the original file
+		for (size_t i=0; i<nbCores.size(); i++)
+		{
+			std::vector<char*>       leon_dargs;
+			std::vector<std::string> ddata = {
+					"-",
+					"-d",
+					"-file", leonFile,
+					"-verbose","0",
+					"-nb-cores", Stringify::format ("%d", nbCores[i])
+			};
+			for(std::vector<std::string>::iterator loop = ddata.begin(); loop != ddata.end(); ++loop){
+				leon_dargs.push_back(&(*loop)[0]);
+			}
+			Leon().run(leon_dargs.size(), &leon_dargs[0]);
+
+			IBank* fasBank = Bank::open (fastqFile);
+			LOCAL (fasBank);
+			IBank* decBank = new BankFasta (dFile);
+			LOCAL (decBank);
+			bank_compare_banks_equality (fasBank, decBank);
+
+			// the leon file itself also gives back the qualities
+			IBank* leonBank = Bank::open (leonFile);
+			LOCAL (leonBank);
+			bank_compare_banks_equality (fasBank, leonBank);
+		}
+
+		System::file().remove (dFile);
+	}
+
+    /*******************************************************************************
+	 * Test the order-2 quality codec (QualCoder), which is used only with -qual-context:
+	 *   - direct round trip of a block of qualities
+	 *   - leon2.fastq and a file with varied read lengths, compressed with -qual-context
+	 *     and decompressed with 1 and several cores
+	 *
+	 * */
+	void bank_checkLeon10 ()
+	{
+		srand (0);
+
+		// STEP 1: round trip of blocks of qualities, with reads of varied sizes (including empty ones)
+		// and a wide alphabet of qualities, so that the models have many symbols
+		std::string quals;
+		for (size_t r=0; r<500; r++)
+		{
+			size_t size = (r % 50 == 0) ? 0 : rand() % 300;
+			for (size_t i=0; i<size; i++)  {  quals += (char) ('!' + (i*7 + rand() % 10) % 90);  }
+			quals += '\n';
+		}
+
+		QualCoder coder;
+		std::vector<u_int8_t> encoded;
+		for (size_t nb=0; nb<3; nb++)  // the same coder is used for several blocks, as in leon
+		{
+			std::string block = quals.substr (0, quals.size() - nb*1000);
+			block.erase (block.rfind ('\n') + 1);
+
+			coder.encode (block.data(), block.size(), encoded);
+			CPPUNIT_ASSERT (encoded.size() > 1 && encoded[0] == QualCoder::CODEC_ID);
+
+			std::string decoded;
+			coder.decode ((const char*) &encoded[0], encoded.size(), decoded);
+			CPPUNIT_ASSERT (decoded == block);
+		}
+
+		std::vector<int> nbCores = { 1, 4 };
+
+		// STEP 2: leon2.fastq
+		leon_qual_context_compress_and_compare (DBPATH("leon2.fastq"), nbCores);
+
+		// STEP 3: a file with reads of varied lengths, some shorter than the kmers
+		std::string fastqFile = System::file().getTemporaryDirectory() + "/leon_varied.fastq";
+		{
+			std::ofstream os (fastqFile.c_str());
+			for (size_t r=0; r<40; r++)
+			{
+				size_t size = 10 + rand() % 250;
+				std::string seq, qual;
+				for (size_t i=0; i<size; i++)  {  seq += "ACGT"[rand() % 4];  qual += (char) ('#' + rand() % 40);  }
+				os << "@read_" << r << " len=" << size << "\n" << seq << "\n+\n" << qual << "\n";
+			}
+		}
+		leon_qual_context_compress_and_compare (fastqFile, nbCores);
+
+		System::file().remove (fastqFile);
+		System::file().remove (fastqFile + ".leon");
+	}
 };
 
 /********************************************************************************/
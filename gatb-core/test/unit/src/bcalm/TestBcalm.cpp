@@ -64,6 +64,7 @@ class TestBcalm : public Test
     CPPUNIT_TEST_SUITE_GATB (TestBcalm);
 
         CPPUNIT_TEST_GATB (bcalm_test1); 
+        CPPUNIT_TEST_GATB (bcalm_test2); 
         CPPUNIT_TEST_SUITE_GATB_END();
 
 public:
@@ -115,6 +116,37 @@ public:
 
     }
 
+    /********************************************************************************/
+    void bcalm_test2 () // concurrent unions, then normalization and in-place conversion to 32-bit classes, as done in bglue
+    {
+        int nb_uf_elts = 1000000;
+        int nb_threads = 4;
+        unionFind uf(nb_uf_elts);
+
+        // classes are the residues modulo 1000, the smallest element of class c is c
+        auto doJoins = [&uf, nb_uf_elts](int thread)
+        {
+            for (int i = nb_uf_elts - 1 - thread; i >= 1000; i -= 4)
+                uf.union_(i, i - 1000);
+        };
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nb_threads; t++)
+            threads.push_back (std::thread (doJoins, t));
+        for (auto &thread : threads)
+            thread.join();
+
+        uf.normalize(nb_threads);
+        for (int i = 0; i < nb_uf_elts; i++)
+            CPPUNIT_ASSERT (uf.find(i) == (uint32_t)(i % 1000));
+
+        uint32_t* classes = uf.release_classes(nb_threads);
+        CPPUNIT_ASSERT (uf.size() == 0);
+        for (int i = 0; i < nb_uf_elts; i++)
+            CPPUNIT_ASSERT (classes[i] == (uint32_t)(i % 1000));
+        free (classes);
+    }
+
 };
 
 /********************************************************************************/
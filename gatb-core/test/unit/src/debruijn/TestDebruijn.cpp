@@ -516,6 +516,11 @@ public:
         graph.precomputeAdjacency(1, false);
         
         graph.iterator().iterate (fct);
+
+        /* and with the nodes laid out along the simple paths */
+        graph.precomputeAdjacency(1, false, ADJACENCY_LOCALITY);
+
+        graph.iterator().iterate (fct);
     }
 
     /********************************************************************************/
@@ -537,6 +542,21 @@ public:
 
         /** We check that we found the correct number of nodes. */
         CPPUNIT_ASSERT (path.rank() == strlen (seq) - kmerSize);
+
+        /** Same walk, the nodes being laid out along the simple paths: the indexes of the nodes come from the layout. */
+        graph.precomputeAdjacency (1, false, ADJACENCY_LOCALITY);
+
+        /** The node may have cached its MPHF code, we build it again. */
+        node = graph.buildNode (seq);
+
+        GraphIterator<Edge> path2 = graph.simplePathEdge (node, DIR_OUTCOMING);
+
+        for (path2.first(); !path2.isDone(); path2.next())
+        {
+            CPPUNIT_ASSERT (ascii(path2.item().nt) == seq [graph.getKmerSize() + path2.rank()]);
+        }
+
+        CPPUNIT_ASSERT (path2.rank() == strlen (seq) - kmerSize);
     }
 
     /** */
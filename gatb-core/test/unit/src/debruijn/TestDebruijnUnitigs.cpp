@@ -40,6 +40,7 @@
 #include <gatb/kmer/impl/DebloomAlgorithm.hpp>
 
 #include <gatb/bank/impl/BankStrings.hpp>
+#include <gatb/bank/impl/BankFasta.hpp>
 #include <gatb/bank/impl/BankSplitter.hpp>
 #include <gatb/bank/impl/BankRandom.hpp>
 
@@ -111,6 +112,7 @@ class TestDebruijnUnitigs : public Test
         CPPUNIT_TEST_GATB (debruijn_unitigs_test6);
         CPPUNIT_TEST_GATB (debruijn_unitigs_test13);
         CPPUNIT_TEST_GATB (debruijn_unitigs_build);
+        CPPUNIT_TEST_GATB (debruijn_unitigs_binary); // same graph whether the unitigs come from the FASTA file or from the binary file
         //CPPUNIT_TEST_GATB (debruijn_unitigs_traversal1); // would need to be fixed
         
         CPPUNIT_TEST_SUITE_GATB_END();
@@ -849,6 +851,102 @@ public:
         debruijn_unitigs_build_aux (sequences, ARRAY_SIZE(sequences));
     }
 
+    /********************************************************************************/
+    /** Dumps each node of the graph with its unitig, its abundance and its neighbors, one line per node. */
+    vector<string> debruijn_unitigs_binary_dump (GraphUnitigs& graph)
+    {
+        vector<string> result;
+
+        GraphIterator<Node> itNodes = graph.iterator();
+        for (itNodes.first(); !itNodes.isDone(); itNodes.next())
+        {
+            Node& node = itNodes.item();
+            bool isolatedLeft, isolatedRight;
+
+            stringstream ss;
+            ss << graph.toString (node) << " " << graph.unitigSequence (node, isolatedLeft, isolatedRight)
+               << " " << isolatedLeft << isolatedRight << " " << graph.unitigMeanAbundance (node) << " " << graph.unitigLength (node, DIR_OUTCOMING);
+
+            GraphVector<Node> successors   = graph.successors   (node);
+            GraphVector<Node> predecessors = graph.predecessors (node);
+            for (size_t i=0; i<successors.size();   i++)  {  ss << " +" << graph.toString (successors[i]);    }
+            for (size_t i=0; i<predecessors.size(); i++)  {  ss << " -" << graph.toString (predecessors[i]);  }
+
+            result.push_back (ss.str());
+        }
+
+        return result;
+    }
+
+    /** Reopens the graph from its h5 file: the unitigs are mapped from the binary file if it is valid, otherwise parsed from the FASTA file. */
+    vector<string> debruijn_unitigs_binary_reopen (const string& prefix)
+    {
+        GraphUnitigs graph = GraphUnitigs::create ("-in %s.h5 -kmer-size 31 -out %s -abundance-min 1  -verbose 0  -max-memory %d -nb-cores 1",
+            prefix.c_str(), prefix.c_str(), MAX_MEMORY);
+        return debruijn_unitigs_binary_dump (graph);
+    }
+
+    void debruijn_unitigs_binary ()
+    {
+        string prefix        = System::file().getTemporaryDirectory() + "/test_unitigs_binary";
+        string readsFilename = prefix + ".reads.fa";
+        string binFilename   = prefix + ".unitigs.bin";
+
+        /** A random genome and a copy of it with a few SNPs, so that the graph has branching nodes. */
+        srand (0);
+        string genome (2000, 'A');
+        for (size_t i=0; i<genome.size(); i++)  {  genome[i] = "ACGT"[rand() % 4];  }
+        string variant = genome;
+        for (size_t i=100; i<variant.size(); i+=300)  {  variant[i] = (variant[i] == 'A') ? 'C' : 'A';  }
+
+        vector<string> reads;
+        for (size_t i=0; i+100<=genome.size(); i+=10)  {  reads.push_back (genome.substr (i, 100));  reads.push_back (variant.substr (i, 100));  }
+
+        {
+            BankStrings source (reads);
+            BankFasta   output (readsFilename);
+            Iterator<Sequence>* it = source.iterator();  LOCAL (it);
+            for (it->first(); !it->isDone(); it->next())  {  output.insert (it->item());  }
+            output.flush ();
+        }
+
+        /** The graph is built from the reads: the unitigs are parsed from the FASTA file, then saved in the binary file. */
+        vector<string> fromFasta;
+        {
+            GraphUnitigs graph = GraphUnitigs::create ("-in %s -kmer-size 31 -out %s -abundance-min 1  -verbose 0  -max-memory %d -nb-cores 1",
+                readsFilename.c_str(), prefix.c_str(), MAX_MEMORY);
+            fromFasta = debruijn_unitigs_binary_dump (graph);
+        }
+        CPPUNIT_ASSERT (fromFasta.size() > 0);
+        CPPUNIT_ASSERT (System::file().doesExist (binFilename));
+
+        /** The unitigs are mapped from the binary file. */
+        CPPUNIT_ASSERT (debruijn_unitigs_binary_reopen (prefix) == fromFasta);
+
+        /** Without the binary file, the FASTA file is parsed (and the binary file written) again. */
+        System::file().remove (binFilename);
+        CPPUNIT_ASSERT (debruijn_unitigs_binary_reopen (prefix) == fromFasta);
+        CPPUNIT_ASSERT (System::file().doesExist (binFilename));
+
+        /** The size of the incoming section (the 10th word of the header) now goes past the end of the file:
+         *  the binary file is rejected and the FASTA file is parsed instead. */
+        {
+            FILE* file = fopen (binFilename.c_str(), "r+b");
+            CPPUNIT_ASSERT (file != 0);
+            u_int64_t incomingSize = ~(u_int64_t)0 / 16;
+            fseek (file, 9*sizeof(u_int64_t), SEEK_SET);
+            fwrite (&incomingSize, sizeof(incomingSize), 1, file);
+            fclose (file);
+        }
+        CPPUNIT_ASSERT (debruijn_unitigs_binary_reopen (prefix) == fromFasta);
+
+        System::file().remove (readsFilename);
+        System::file().remove (binFilename);
+        System::file().remove (prefix + ".unitigs.fa");
+        System::file().remove (prefix + ".unitigs.fa.glue.0");
+        System::file().remove (prefix + ".h5");
+    }
+
     /********************************************************************************/
 
     void debruijn_unitigs_traversal1_aux_aux (bool useCopyTerminator, size_t kmerSize, const char** seqs, size_t seqsSize,
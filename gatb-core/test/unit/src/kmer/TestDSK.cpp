@@ -26,6 +26,9 @@
 #include <gatb/bank/impl/Bank.hpp>
 
 #include <gatb/kmer/impl/SortingCountAlgorithm.hpp>
+#include <gatb/kmer/impl/PartitionScheduler.hpp>
+#include <gatb/kmer/impl/ConfigurationAlgorithm.hpp>
+#include <gatb/kmer/impl/RepartitionAlgorithm.hpp>
 #include <gatb/kmer/impl/Model.hpp>
 #include <gatb/kmer/impl/BankKmers.hpp>
 
@@ -34,12 +37,16 @@
 #include <gatb/tools/misc/impl/Histogram.hpp>
 
 #include <gatb/tools/designpattern/impl/IteratorHelpers.hpp>
+#include <gatb/tools/designpattern/impl/Command.hpp>
 
 #include <gatb/tools/math/LargeInt.hpp>
 #include <gatb/tools/math/Integer.hpp>
 
 #include <gatb/tools/storage/impl/Storage.hpp>
 
+#include <thread>
+#include <chrono>
+
 #include <boost/variant.hpp>
 #include <boost/mpl/for_each.hpp>
 
@@ -102,6 +109,8 @@ class TestDSK : public Test
         CPPUNIT_TEST_GATB (DSK_perBank2);
         CPPUNIT_TEST_GATB (DSK_perBankKmer);
         CPPUNIT_TEST_GATB (DSK_multibank);
+        CPPUNIT_TEST_GATB (DSK_scheduler);
+        CPPUNIT_TEST_GATB (DSK_countKinds);
 		 
 
     CPPUNIT_TEST_SUITE_GATB_END();
@@ -706,6 +715,170 @@ public:
 
         boost::mpl::for_each<gatb::core::tools::math::IntegerList>(DSK_multibank_aux());
     }
+
+    /********************************************************************************/
+    /** Job made of tasks taking some time; we count the tasks done and the workers involved. */
+    struct DSK_scheduler_job : public PartitionScheduler::IndexedJob
+    {
+        DSK_scheduler_job (size_t nbTasks) : PartitionScheduler::IndexedJob(nbTasks), _done(nbTasks,0), _nbWorkers(0) {}
+
+        void work ()  { __sync_fetch_and_add (&_nbWorkers, 1);  PartitionScheduler::IndexedJob::work();  }
+
+        void runTask (size_t idx)  {  std::this_thread::sleep_for (std::chrono::milliseconds(1));  __sync_fetch_and_add (&_done[idx], 1);  }
+
+        vector<int> _done;
+        int         _nbWorkers;
+    };
+
+    /** Partition command checking the memory bound and sharing its job with the scheduler. */
+    struct DSK_scheduler_cmd : public ICommand, public SmartPointer
+    {
+        DSK_scheduler_cmd (PartitionScheduler& scheduler, u_int64_t memory, u_int64_t& used, u_int64_t& usedMax, size_t& nbTasks, size_t& nbHelped)
+            : _scheduler(scheduler), _memory(memory), _used(used), _usedMax(usedMax), _nbTasks(nbTasks), _nbHelped(nbHelped) {}
+
+        void execute ()
+        {
+            u_int64_t used = __sync_add_and_fetch (&_used, _memory);
+            for (u_int64_t m = _usedMax; used > m; m = _usedMax)  {  __sync_bool_compare_and_swap (&_usedMax, m, used);  }
+
+            /** The memory bound holds, except for a partition bigger than the bound, which runs alone. */
+            CPPUNIT_ASSERT (used <= 100 || used == _memory);
+
+            DSK_scheduler_job job (20);
+            _scheduler.share (job);
+
+            for (size_t i=0; i<job._done.size(); i++)  {  CPPUNIT_ASSERT (job._done[i] == 1);  }
+
+            __sync_fetch_and_add (&_nbTasks, job._done.size());
+            if (job._nbWorkers > 1)  { __sync_fetch_and_add (&_nbHelped, 1); }
+
+            __sync_fetch_and_sub (&_used, _memory);
+        }
+
+        PartitionScheduler& _scheduler;
+        u_int64_t  _memory;
+        u_int64_t& _used;
+        u_int64_t& _usedMax;
+        size_t&    _nbTasks;
+        size_t&    _nbHelped;
+    };
+
+    struct DSK_scheduler_failing_cmd : public ICommand, public SmartPointer
+    {
+        void execute ()  {  throw Exception ("partition failure");  }
+    };
+
+    void DSK_scheduler ()
+    {
+        size_t nbCores = 4;
+        Dispatcher dispatcher (nbCores);
+
+        /** Partitions of various sizes with a memory bound allowing only 2 big partitions at a time. */
+        u_int64_t maxMemory = 100;
+        u_int64_t sizes[] = { 10, 60, 5, 40, 50, 20, 10, 45, 5, 30, 120 };
+
+        PartitionScheduler scheduler (nbCores, maxMemory);
+
+        u_int64_t used=0, usedMax=0;
+        size_t    nbTasks=0, nbHelped=0;
+
+        for (size_t i=0; i<ARRAY_SIZE(sizes); i++)
+        {
+            scheduler.add (new DSK_scheduler_cmd (scheduler, sizes[i], used, usedMax, nbTasks, nbHelped), sizes[i], sizes[i] >= maxMemory);
+        }
+
+        scheduler.execute (&dispatcher);
+
+        /** All the tasks have been done. */
+        CPPUNIT_ASSERT (nbTasks  == 20*ARRAY_SIZE(sizes));
+        CPPUNIT_ASSERT (usedMax  == 120);
+        CPPUNIT_ASSERT (used     == 0);
+
+        const PartitionScheduler::Stats& stats = scheduler.getStats();
+        CPPUNIT_ASSERT (stats.nbParts      == ARRAY_SIZE(sizes));
+        CPPUNIT_ASSERT (stats.nbSharedJobs == ARRAY_SIZE(sizes));
+        CPPUNIT_ASSERT (stats.maxMemory    == 120);
+        CPPUNIT_ASSERT (stats.maxParallelParts >= 2);
+
+        /** The partition run alone has been helped by the other workers. */
+        CPPUNIT_ASSERT (stats.nbHelps > 0);
+        CPPUNIT_ASSERT (nbHelped > 0);
+
+        /** An exception in a partition command is forwarded by 'execute'. */
+        PartitionScheduler failing (nbCores, maxMemory);
+        failing.add (new DSK_scheduler_failing_cmd(), 10);
+        for (size_t i=0; i<10; i++)  {  failing.add (new DSK_scheduler_cmd (failing, 10, used, usedMax, nbTasks, nbHelped), 10);  }
+
+        bool thrown = false;
+        try  {  failing.execute (&dispatcher);  }  catch (Exception& e)  {  thrown = true;  }
+        CPPUNIT_ASSERT (thrown);
+    }
+
+    /********************************************************************************/
+    /** Count the kmers of a bank in 'nbPartitions' partitions with 'maxMemory' MB, and check the
+     * way the first partition has been counted. */
+    void DSK_countKinds_aux (IBank* bank, size_t nbPartitions, size_t maxMemory, const char* kind, vector<Kmer<KSIZE_1>::Count>& solids)
+    {
+        typedef Kmer<KSIZE_1>::Count Count;
+
+        IProperties* params = SortingCountAlgorithm<>::getDefaultProperties();  LOCAL (params);
+        params->setInt (STR_KMER_SIZE,          31);
+        params->setInt (STR_MAX_MEMORY,         maxMemory);
+        params->setInt (STR_KMER_ABUNDANCE_MIN, 2);
+        params->setStr (STR_URI_OUTPUT,         "foo");
+
+        /** The superkmers go to temporary files, so the whole max memory is left for counting. */
+        params->setInt (STR_TMP_IN_MEMORY,      0);
+
+        /** We force the number of partitions of the configuration. */
+        ConfigurationAlgorithm<KSIZE_1> configAlgo (bank, params);
+        configAlgo.execute();
+        Configuration config = configAlgo.getConfiguration();
+        config._nb_partitions = nbPartitions;
+        config._nb_passes     = 1;
+
+        Storage* storage = StorageFactory(STORAGE_HDF5).create ("foo_minim", true, true);  LOCAL (storage);
+        RepartitorAlgorithm<KSIZE_1> repart (bank, storage->getGroup("minimizers"), config, 0);
+        repart.execute ();
+
+        SortingCountAlgorithm<KSIZE_1> sortingCount (bank, config, new Repartitor (storage->getGroup("minimizers")), vector<ICountProcessor<KSIZE_1>*>(), params);
+        sortingCount.execute();
+
+        string info = sortingCount.getInfo()->getStr ("part_0");
+        CPPUNIT_ASSERT (info.compare (0, strlen(kind), kind) == 0);
+
+        Iterator<Count>* iter = sortingCount.getSolidCounts()->iterator();  LOCAL (iter);
+        solids.clear();
+        for (iter->first(); !iter->isDone(); iter->next())  { solids.push_back (iter->item()); }
+    }
+
+    void DSK_countKinds ()
+    {
+        /** Reads sampled from a random genome, with some errors. */
+        srand (0);
+        string genome;
+        for (size_t i=0; i<100*1000; i++)  { genome += "ACGT"[rand()%4]; }
+
+        vector<string> reads;
+        for (size_t i=0; i<5000; i++)
+        {
+            string read = genome.substr (rand() % (genome.size()-150), 150);
+            if (i%3 == 0)  { read[rand()%150] = 'A'; }
+            reads.push_back (read);
+        }
+
+        IBank* bank = new BankStrings (reads);  LOCAL (bank);
+
+        vector<Kmer<KSIZE_1>::Count> solidsVector, solidsSubparts, solidsHash;
+
+        DSK_countKinds_aux (bank, 1, 8, "vector",   solidsVector);
+        DSK_countKinds_aux (bank, 1, 2, "subparts", solidsSubparts);
+        DSK_countKinds_aux (bank, 1, 1, "hash",     solidsHash);
+
+        CPPUNIT_ASSERT (solidsVector.size() > 0);
+        CPPUNIT_ASSERT (solidsSubparts == solidsVector);
+        CPPUNIT_ASSERT (solidsHash     == solidsVector);
+    }
 };
 
 /********************************************************************************/
@@ -24,6 +24,7 @@
 #include <gatb/bank/api/Sequence.hpp>
 #include <gatb/bank/impl/Alphabet.hpp>
 #include <gatb/kmer/impl/Model.hpp>
+#include <gatb/tools/misc/impl/NucleotideKernels.hpp>
 
 #include <gatb/tools/math/LargeInt.hpp>
 #include <gatb/tools/math/Integer.hpp>
@@ -55,6 +56,7 @@ using namespace gatb::core::tools::collections::impl;
 
 using namespace gatb::core::tools::math;
 using namespace gatb::core::tools::misc;
+using namespace gatb::core::tools::misc::impl;
 
 extern std::string DBPATH (const string& a);
 
@@ -78,6 +80,7 @@ class TestKmer : public Test
         CPPUNIT_TEST_GATB (kmer_minimizer2); // with ModelDirect
         CPPUNIT_TEST_GATB (kmer_minimizer3); // with ModelCanonical
         CPPUNIT_TEST_GATB (kmer_badchar);
+        CPPUNIT_TEST_GATB (kmer_kernels);
 
     CPPUNIT_TEST_SUITE_GATB_END();
 
@@ -568,6 +571,63 @@ public:
         model.iterate (data, fct);
     }
 
+    /** Iteration of ASCII data (converted by blocks with NucleotideKernels) compared to the iteration
+     * of the same nucleotides given as INTEGER data (converted one at a time), for each kernels implementation. */
+    void kmer_kernels (void)
+    {
+        typedef Kmer<>::ModelCanonical                          ModelCanonical;
+        typedef Kmer<>::ModelMinimizer<ModelCanonical>          ModelMini;
+        typedef ModelMini::Kmer                                 KmerType;
+
+        size_t kmerSize = 31;
+        ModelMini model (kmerSize, 9);
+
+        /** A sequence longer than the conversion blocks, with some lower case and bad nucleotides. */
+        srand (1);
+        string ascii (3000, 'A');
+        string codes (ascii.size(), 0);
+        vector<bool> bad (ascii.size(), false);
+        for (size_t i=0; i<ascii.size(); i++)
+        {
+            int r = rand() % 100;
+            ascii[i] = r<2 ? 'N' : (r<3 ? 'r' : (r<10 ? "acgt"[r%4] : "ACGT"[r%4]));
+            codes[i] = (ascii[i]>>1) & 3;
+            bad[i]   = Data::validNucleotide[(unsigned char)ascii[i]];
+        }
+
+        vector<KmerType> expected;
+        Data integer (Data::INTEGER);
+        integer.set ((char*)codes.data(), codes.size());
+        CPPUNIT_ASSERT (model.build (integer, expected) == true);
+
+        string defaultImplementation = NucleotideKernels::getImplementation();
+        const char* implementations[] = { "generic", "sse4.2", "avx2" };
+
+        for (size_t n=0; n<ARRAY_SIZE(implementations); n++)
+        {
+            if (NucleotideKernels::setImplementation (implementations[n]) == false)  { continue; }
+
+            vector<KmerType> kmers;
+            Data data (Data::ASCII);
+            data.set ((char*)ascii.data(), ascii.size());
+            CPPUNIT_ASSERT (model.build (data, kmers) == true);
+            CPPUNIT_ASSERT (kmers.size() == expected.size());
+
+            for (size_t i=0; i<kmers.size(); i++)
+            {
+                bool valid = true;
+                for (size_t j=i; j<i+kmerSize; j++)  { if (bad[j]) { valid = false; } }
+
+                CPPUNIT_ASSERT (kmers[i].isValid() == valid);
+                CPPUNIT_ASSERT (kmers[i].value()   == expected[i].value());
+                CPPUNIT_ASSERT (kmers[i].forward() == expected[i].forward());
+                CPPUNIT_ASSERT (kmers[i].minimizer().value() == expected[i].minimizer().value());
+            }
+        }
+
+        NucleotideKernels::setImplementation (defaultImplementation);
+    }
+
     void kmer_tostring (void)
     {
 #if KSIZE_32
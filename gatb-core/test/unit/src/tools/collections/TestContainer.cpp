@@ -22,6 +22,7 @@
 #include <gatb/tools/collections/impl/Bloom.hpp>
 
 #include <gatb/tools/misc/api/Macros.hpp>
+#include <gatb/tools/misc/impl/Stringify.hpp>
 
 #include <gatb/tools/math/NativeInt64.hpp>
 #include <gatb/tools/math/NativeInt128.hpp>
@@ -31,11 +32,14 @@
 #include <time.h>       /* time */
 
 #include <set>
+#include <algorithm>
 
 using namespace std;
 using namespace gatb::core::tools::collections;
 using namespace gatb::core::tools::collections::impl;
 using namespace gatb::core::tools::math;
+using namespace gatb::core::tools::misc;
+using namespace gatb::core::tools::misc::impl;
 
 /********************************************************************************/
 namespace gatb  {  namespace tests  {
@@ -51,6 +55,7 @@ class TestContainer : public Test
     CPPUNIT_TEST_SUITE_GATB (TestContainer);
 
         CPPUNIT_TEST_GATB (bloom_checkContains);
+        CPPUNIT_TEST_GATB (bloom_checkBlocked);
 
     CPPUNIT_TEST_SUITE_GATB_END();
 
@@ -132,6 +137,71 @@ public:
         bloom_checkContains_aux<LargeInt<5> > (values2, ARRAY_SIZE(values2));
         bloom_checkContains_aux<LargeInt<5> > (values3, ARRAY_SIZE(values3));
     }
+
+    /********************************************************************************/
+    template<typename Item> void bloom_checkBlocked_aux (size_t nbItems, size_t nbHash)
+    {
+        /** About 10 bits per item. */
+        IBloom<Item>* bloom = BloomFactory::singleton().createBloom<Item> (BLOOM_BLOCKED, 10*nbItems, nbHash, 31);
+        LOCAL (bloom);
+
+        CPPUNIT_ASSERT (bloom->getName() == "blocked");
+        CPPUNIT_ASSERT (bloom->getBitSize() % 512 == 0);
+        CPPUNIT_ASSERT ((bloom->getSize() >= bloom->getBitSize()/8));
+        CPPUNIT_ASSERT (((size_t)bloom->getArray() & 63) == 0);
+
+        /** Even items are inserted, odd ones are not. */
+        for (size_t i=0; i<nbItems; i++)  {  Item item;  item.setVal (2*i);  bloom->insert (item);  }
+
+        /** No false negative. */
+        for (size_t i=0; i<nbItems; i++)  {  Item item;  item.setVal (2*i);  CPPUNIT_ASSERT (bloom->contains (item));  }
+
+        size_t nbFalsePositives = 0;
+        for (size_t i=0; i<nbItems; i++)  {  Item item;  item.setVal (2*i+1);  if (bloom->contains (item))  { nbFalsePositives++; }  }
+
+        /** The blocked filter is a bit worse than a classical one (~1% for 10 bits per item). */
+        CPPUNIT_ASSERT (nbFalsePositives < nbItems/20);
+
+        /** A filter created from the saved properties and filled with the saved array gives the same answers. */
+        IBloom<Item>* other = BloomFactory::singleton().createBloom<Item> (
+            bloom->getName(), Stringify::format ("%lld", (long long)bloom->getBitSize()), Stringify::format ("%d", nbHash), "31"
+        );
+        LOCAL (other);
+
+        CPPUNIT_ASSERT (other->getSize() == bloom->getSize());
+        memcpy (other->getArray(), bloom->getArray(), bloom->getSize());
+
+        for (size_t i=0; i<2*nbItems; i++)  {  Item item;  item.setVal (i);  CPPUNIT_ASSERT (other->contains (item) == bloom->contains (item));  }
+
+        CPPUNIT_ASSERT (other->weight() == bloom->weight());
+        CPPUNIT_ASSERT (bloom->weight() <= nbItems*nbHash);
+
+        /** The neighbors queries give the same answers as the queries of the canonical neighbors (31-mers). */
+        Item kmerMask;  kmerMask.setVal(1);  kmerMask = (kmerMask << 62) - kmerMask;
+        for (size_t i=0; i<std::min (nbItems, (size_t)1000); i++)
+        {
+            Item item;  item.setVal (2*i);
+            std::bitset<8> mask = bloom->contains8 (item);
+
+            for (size_t j=0; j<8; j++)
+            {
+                Item nt;  nt.setVal (j%4);
+                Item neighbor = j<4 ? ((item << 2) & kmerMask) | nt : (item >> 2) | (nt << 60);
+                Item rev = revcomp (neighbor, 31);
+                if (rev < neighbor)  { neighbor = rev; }
+                CPPUNIT_ASSERT (mask[j] == bloom->contains (neighbor));
+            }
+        }
+    }
+
+    /** */
+    void bloom_checkBlocked ()
+    {
+        bloom_checkBlocked_aux<NativeInt64>  (10000,  7);
+        bloom_checkBlocked_aux<LargeInt<1> > (100000, 7);
+        bloom_checkBlocked_aux<LargeInt<2> > (100000, 4);
+        bloom_checkBlocked_aux<LargeInt<3> > (1000,   3);
+    }
 };
 
 /********************************************************************************/
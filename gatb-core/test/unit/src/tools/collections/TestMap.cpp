@@ -20,7 +20,10 @@
 
 #include <gatb/system/impl/System.hpp>
 #include <gatb/tools/designpattern/api/Iterator.hpp>
+#include <gatb/tools/designpattern/api/ICommand.hpp>
+#include <gatb/tools/designpattern/impl/Command.hpp>
 #include <gatb/tools/collections/impl/OAHash.hpp>
+#include <gatb/tools/collections/impl/OAHashConcurrent.hpp>
 #include <gatb/tools/collections/impl/MapMPHF.hpp>
 #include <gatb/tools/math/NativeInt8.hpp>
 #include <gatb/tools/math/NativeInt64.hpp>
@@ -39,6 +42,7 @@
 using namespace std;
 
 using namespace gatb::core::tools::dp;
+using namespace gatb::core::tools::dp::impl;
 using namespace gatb::core::tools::collections;
 using namespace gatb::core::tools::collections::impl;
 using namespace gatb::core::tools::math;
@@ -62,6 +66,7 @@ class TestMap : public Test
     CPPUNIT_TEST_SUITE_GATB (TestMap);
 
         CPPUNIT_TEST_GATB (checkOAHash);
+        CPPUNIT_TEST_GATB (checkOAHashConcurrent);
         CPPUNIT_TEST_GATB (checkMapMPHF);
 
     CPPUNIT_TEST_SUITE_GATB_END();
@@ -131,6 +136,128 @@ public:
         }
     }
 
+    /********************************************************************************/
+    template<typename T> class OAHashConcurrentInsertCommand : public ICommand, public SmartPointer
+    {
+    public:
+        OAHashConcurrentInsertCommand (OAHashConcurrent<T>& hash, size_t nbKeys, size_t offset)
+            : _hash(hash), _nbKeys(nbKeys), _offset(offset) {}
+
+        /** Each command inserts all the keys, starting at its own offset, so that the threads
+         * insert the same keys at the same time. */
+        void execute ()
+        {
+            for (size_t i=0; i<_nbKeys; i++)
+            {
+                u_int64_t k = (_offset + i) % _nbKeys;
+                T key;  key.setVal (k);
+                u_int32_t val;
+                bool inserted = _hash.insertIfAbsent (key, &val);
+                _results.push_back (Result (k, val, inserted));
+            }
+        }
+
+        struct Result
+        {
+            Result (u_int64_t key, u_int32_t val, bool inserted) : key(key), val(val), inserted(inserted) {}
+            u_int64_t key;  u_int32_t val;  bool inserted;
+        };
+        vector<Result> _results;
+
+    private:
+        OAHashConcurrent<T>& _hash;
+        size_t               _nbKeys;
+        size_t               _offset;
+    };
+
+    template<typename T>
+    void checkOAHashConcurrent_aux (size_t nbCores, size_t nbKeys, size_t nbItemsEstimate)
+    {
+        OAHashConcurrent<T> hash (nbItemsEstimate);
+
+        u_int64_t firstLevelSize = hash.getByteSize();
+
+        Dispatcher dispatcher (nbCores);
+
+        vector<OAHashConcurrentInsertCommand<T>*> inserts;
+        vector<ICommand*> commands;
+        for (size_t i=0; i<nbCores; i++)
+        {
+            inserts.push_back (new OAHashConcurrentInsertCommand<T> (hash, nbKeys, i*nbKeys/nbCores));
+            inserts.back()->use();
+            commands.push_back (inserts.back());
+        }
+
+        dispatcher.dispatchCommands (commands, 0);
+
+        /** A key may have been inserted twice while a level was getting full, so there may be
+         * more ranks than keys; each rank is given by exactly one insertion. */
+        size_t nbRanks = hash.size();
+        CPPUNIT_ASSERT (nbRanks >= nbKeys);
+
+        vector<T> keys;
+        hash.getKeys (keys);
+        CPPUNIT_ASSERT (keys.size() == nbRanks);
+
+        vector<bool> rankSeen (nbRanks, false);
+        vector<bool> keySeen  (nbKeys,  false);
+
+        for (size_t i=0; i<inserts.size(); i++)
+        {
+            for (size_t j=0; j<inserts[i]->_results.size(); j++)
+            {
+                typename OAHashConcurrentInsertCommand<T>::Result& r = inserts[i]->_results[j];
+                T key;  key.setVal (r.key);
+
+                /** The ranks are dense and the key of a rank is the one it was given for. */
+                CPPUNIT_ASSERT (r.val < nbRanks);
+                CPPUNIT_ASSERT (keys[r.val] == key);
+
+                if (r.inserted)
+                {
+                    CPPUNIT_ASSERT (rankSeen[r.val] == false);
+                    rankSeen[r.val] = true;
+                    keySeen[r.key]  = true;
+                }
+            }
+            inserts[i]->forget();
+        }
+
+        for (size_t i=0; i<nbRanks; i++)  {  CPPUNIT_ASSERT (rankSeen[i] == true);  }
+
+        /** Every key has been inserted, and the lookups agree with getKeys. */
+        for (size_t i=0; i<nbKeys; i++)
+        {
+            CPPUNIT_ASSERT (keySeen[i] == true);
+
+            T key;  key.setVal (i);
+            u_int32_t val;
+            CPPUNIT_ASSERT (hash.get (key, &val) == true);
+            CPPUNIT_ASSERT (keys[val] == key);
+        }
+
+        T badKey;  badKey.setVal (nbKeys + 1);
+        u_int32_t val;
+        CPPUNIT_ASSERT (hash.get (badKey, &val) == false);
+
+        /** The table has grown past its first level if there were more keys than expected. */
+        if (nbKeys > 2*nbItemsEstimate + 1024)  {  CPPUNIT_ASSERT (hash.getByteSize() > firstLevelSize);  }
+    }
+
+    /********************************************************************************/
+    void checkOAHashConcurrent ()
+    {
+        size_t nbCores[] = { 1, 4, 8 };
+
+        for (size_t i=0; i<ARRAY_SIZE(nbCores); i++)
+        {
+            /** Sized for all the keys, then far too small so that several levels are appended. */
+            checkOAHashConcurrent_aux<NativeInt64>   (nbCores[i], 100*1000, 100*1000);
+            checkOAHashConcurrent_aux<NativeInt64>   (nbCores[i], 100*1000, 10);
+            checkOAHashConcurrent_aux<LargeInt<3> >  (nbCores[i], 100*1000, 10);
+        }
+    }
+
     /********************************************************************************/
     static void checkMapMPHF_progress (size_t round, size_t initial, size_t remaining)
     {
@@ -22,6 +22,11 @@
 
 #include <gatb/tools/math/LargeInt.hpp>
 #include <gatb/tools/math/Integer.hpp>
+#include <gatb/tools/math/RadixSort.hpp>
+#include <gatb/tools/misc/api/Macros.hpp>
+
+#include <algorithm>
+#include <cstdlib>
 
 using namespace std;
 using namespace gatb::core::tools::math;
@@ -38,6 +43,8 @@ class TestMath : public Test
         CPPUNIT_TEST_GATB (math_checkBasic);
         CPPUNIT_TEST_GATB (math_checkFibo);
         CPPUNIT_TEST_GATB (math_test1);
+        CPPUNIT_TEST_GATB (math_radixSort);
+        CPPUNIT_TEST_GATB (math_checkSpecialized);
 
     CPPUNIT_TEST_SUITE_GATB_END();
 
@@ -172,6 +179,157 @@ public:
         math_test1_template <LargeInt<4> >();
         math_test1_template <LargeInt<5> >();
     }
+
+    /********************************************************************************/
+    template <typename T> void math_radixSort_template (size_t nb, size_t nbBits, size_t nbDistinct)
+    {
+        srand (nb + nbBits);
+
+        /** We build random values of at most nbBits bits, with at most nbDistinct distinct values. */
+        vector<T> distinct (nbDistinct);
+        for (size_t i=0; i<nbDistinct; i++)
+        {
+            T val (0);
+            for (size_t b=0; b<nbBits; b+=16)  {  val = (val << 16) | T(rand() & 0xFFFF);  }
+            distinct[i] = val;
+        }
+
+        vector<T>        keys (nb);
+        vector<u_int8_t> ids  (nb);
+        for (size_t i=0; i<nb; i++)  {  keys[i] = distinct[rand() % nbDistinct];  ids[i] = i % 251;  }
+
+        vector<pair<T,u_int8_t> > expected (nb);
+        for (size_t i=0; i<nb; i++)  {  expected[i] = make_pair (keys[i], ids[i]);  }
+        std::sort (expected.begin(), expected.end());
+
+        /** Keys only. */
+        vector<T> keys2 (keys);
+        radixSort (keys2.data(), nb);
+        for (size_t i=0; i<nb; i++)  {  CPPUNIT_ASSERT (keys2[i] == expected[i].first);  }
+
+        /** Keys with payload: the sort is not stable, so we check the (key,id) couples as a set. */
+        radixSort (keys.data(), ids.data(), nb);
+        vector<pair<T,u_int8_t> > result (nb);
+        for (size_t i=0; i<nb; i++)  {  CPPUNIT_ASSERT (keys[i] == expected[i].first);  result[i] = make_pair (keys[i], ids[i]);  }
+        std::sort (result.begin(), result.end());
+        CPPUNIT_ASSERT (result == expected);
+    }
+
+    template <typename T> void math_radixSort_aux ()
+    {
+        size_t nbTable[]   = { 0, 1, 2, 50, 1000, 100000 };
+        size_t bitsTable[] = { 8, 20, 62, T::getSize() };
+
+        for (size_t i=0; i<ARRAY_SIZE(nbTable); i++)
+        {
+            for (size_t j=0; j<ARRAY_SIZE(bitsTable); j++)
+            {
+                math_radixSort_template<T> (nbTable[i], bitsTable[j], 1000);
+                math_radixSort_template<T> (nbTable[i], bitsTable[j], 3);
+            }
+        }
+    }
+
+    void math_radixSort ()
+    {
+        math_radixSort_aux <LargeInt<1> >();
+        math_radixSort_aux <LargeInt<2> >();
+        math_radixSort_aux <LargeInt<3> >();
+        math_radixSort_aux <LargeInt<4> >();
+    }
+
+    /********************************************************************************/
+    /** The 'precision' lower limbs of a value, read through getByte (which is never specialized). */
+    template <typename T> static void getLimbs (const T& x, u_int64_t* limbs, size_t nbLimbs)
+    {
+        for (size_t i=0; i<nbLimbs; i++)
+        {
+            limbs[i] = 0;
+            for (size_t j=0; j<8; j++)  {  limbs[i] |= (u_int64_t) x.getByte (8*i+j) << (8*j);  }
+        }
+    }
+
+    template <int precision, typename T, typename W> static bool sameLimbs (const T& x, const W& ref)
+    {
+        u_int64_t a[precision], b[precision];
+        getLimbs (x,   a, precision);
+        getLimbs (ref, b, precision);
+        return std::equal (a, a+precision, b);
+    }
+
+    /** Checks the operations of LargeInt<precision>, which may be specialized (see LargeIntAVX2.pri), against
+     * the generic implementation of LargeInt<precision+2>, truncated to 'precision' limbs. */
+    template <int precision> void math_checkSpecialized_template (size_t nbChecks)
+    {
+        typedef LargeInt<precision>   T;
+        typedef LargeInt<precision+2> W;
+
+        srand (precision);
+
+        for (size_t n=0; n<nbChecks; n++)
+        {
+            /** Random values, the second one often differing from the first one by a single chunk of 16 bits. */
+            T a(0), b(0);
+            W wa(0), wb(0);
+            for (size_t i=0; i<4*precision; i++)
+            {
+                u_int64_t r1 = rand() & 0xFFFF, r2 = rand() & 0xFFFF;
+                a = (a << 16) | T(r1);  wa = (wa << 16) | W(r1);
+                b = (b << 16) | T(r2);  wb = (wb << 16) | W(r2);
+            }
+            if (n%2 == 0)
+            {
+                size_t    pos = 16 * (rand() % (4*precision));
+                u_int64_t r   = rand() & 0xFFFF;
+                b  = a  ^ (T(r) << pos);
+                wb = wa ^ (W(r) << pos);
+            }
+
+            CPPUNIT_ASSERT ((sameLimbs<precision> (a, wa)));
+            CPPUNIT_ASSERT ((sameLimbs<precision> (b, wb)));
+
+            for (int s=0; s<64*precision; s++)
+            {
+                CPPUNIT_ASSERT ((sameLimbs<precision> (a << s, wa << s)));
+                CPPUNIT_ASSERT ((sameLimbs<precision> (a >> s, wa >> s)));
+            }
+
+            CPPUNIT_ASSERT ((sameLimbs<precision> (a ^ b, wa ^ wb)));
+            CPPUNIT_ASSERT ((sameLimbs<precision> (a | b, wa | wb)));
+            CPPUNIT_ASSERT ((sameLimbs<precision> (a & b, wa & wb)));
+            CPPUNIT_ASSERT ((sameLimbs<precision> (~a,    ~wa)));
+
+            CPPUNIT_ASSERT ((a == b) == (wa == wb));
+            CPPUNIT_ASSERT ((a != b) == (wa != wb));
+            CPPUNIT_ASSERT ((a <  b) == (wa <  wb));
+            CPPUNIT_ASSERT ((b <  a) == (wb <  wa));
+            CPPUNIT_ASSERT ((a <= b) == (wa <= wb));
+            CPPUNIT_ASSERT ((b <= a) == (wb <= wa));
+            CPPUNIT_ASSERT (a == a && a <= a && !(a < a) && !(a != a));
+
+            for (size_t k=32*(precision-1)+1; k<=32*precision; k++)
+            {
+                T mask = ~T(0) >> (2*(32*precision-k));
+                CPPUNIT_ASSERT ((sameLimbs<precision> (revcomp (a, k), revcomp (wa, k))));
+                CPPUNIT_ASSERT ((sameLimbs<precision> (revcomp (revcomp (a & mask, k), k), wa & ((W(1) << (2*k)) - W(1)))));
+            }
+
+            /** The hashes are the XOR of the 64 bits hashes of the limbs. */
+            u_int64_t limbs[precision];
+            getLimbs (a, limbs, precision);
+            u_int64_t h1 = 0, h2 = 0;
+            for (size_t i=0; i<precision; i++)  {  h1 ^= NativeInt64::hash64 (limbs[i], n);  h2 ^= NativeInt64::oahash64 (limbs[i]);  }
+
+            CPPUNIT_ASSERT (hash1  (a, n) == h1);
+            CPPUNIT_ASSERT (oahash (a)    == h2);
+        }
+    }
+
+    void math_checkSpecialized ()
+    {
+        math_checkSpecialized_template<3> (1000);
+        math_checkSpecialized_template<4> (1000);
+    }
 };
 
 /********************************************************************************/
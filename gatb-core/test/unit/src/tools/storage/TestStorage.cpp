@@ -74,6 +74,10 @@ class TestStorage : public Test
 
         CPPUNIT_TEST_GATB (storage_HDF5_check_collection);
         CPPUNIT_TEST_GATB (storage_HDF5_check_partition);
+
+        CPPUNIT_TEST_GATB (storage_superkmer_writers);
+        CPPUNIT_TEST_GATB (storage_superkmer_codec);
+        CPPUNIT_TEST_GATB (storage_superkmer_memory);
         
         CPPUNIT_TEST_SUITE_GATB_END();
 
@@ -452,6 +456,120 @@ public:
         free(buffer2);
     }
 
+    /********************************************************************************/
+    void storage_superkmer_writers_aux (size_t nbWriters, size_t maxQueued, int codec=SUPERK_CODEC_NONE, u_int64_t memoryBudget=0)
+    {
+        const int nbFiles  = 4;
+        const int nbItems  = 10000;
+        const int itemSize = 8;
+
+        SuperKmerBinFiles files ("test_superk_writers", "superk", nbFiles, codec, memoryBudget);
+        files.startWriters (nbWriters, maxQueued);
+
+        /** We insert items in small buffers in order to have many blocks handed to the writers. */
+        vector<u_int64_t> checksum (nbFiles, 0);
+        {
+            CacheSuperKmerBinFiles cache (&files, 100);
+
+            for (int i=0; i<nbItems; i++)
+            {
+                u_int64_t item = i;
+                cache.insertSuperkmer ((u_int8_t*)&item, itemSize, 1, i % nbFiles);
+                checksum[i % nbFiles] += item;
+            }
+        }
+        files.flushFiles();
+        files.closeFiles();
+
+        CPPUNIT_ASSERT (files.hasWriters() == false);
+        /** 11 items of 9 bytes fit in a buffer of 100 bytes. */
+        u_int64_t nbBlocksPerFile = (nbItems/nbFiles + 10) / 11;
+        CPPUNIT_ASSERT (files.getWriterStats().nbBlocks == (nbWriters>0 ? nbFiles*nbBlocksPerFile : 0));
+        CPPUNIT_ASSERT (files.getWriterStats().maxQueueDepth <= maxQueued);
+
+        u_int64_t rawBytes, writtenBytes, readBytes;
+        files.getCodecStats (rawBytes, writtenBytes, readBytes);
+        CPPUNIT_ASSERT (rawBytes == (u_int64_t)nbItems*(itemSize+1) + nbFiles*nbBlocksPerFile*sizeof(unsigned int));
+        CPPUNIT_ASSERT (codec == SUPERK_CODEC_NONE && memoryBudget == 0 ? writtenBytes == rawBytes : writtenBytes < rawBytes);
+        CPPUNIT_ASSERT (readBytes == 0);
+
+        /** With a memory budget, the blocks not written to disk are kept in RAM. */
+        u_int64_t memoryBytes;
+        int       nbSpilledFiles;
+        files.getMemoryStats (memoryBytes, nbSpilledFiles);
+        CPPUNIT_ASSERT (memoryBytes <= memoryBudget);
+        CPPUNIT_ASSERT (memoryBudget == 0 || (nbSpilledFiles == 0) == (writtenBytes == 0));
+
+        /** We read back the blocks and check the content of each file (twice, the RAM blocks being given again). */
+        unsigned int   maxBlockSize = 0;
+        unsigned int   nbBytes      = 0;
+        unsigned char* block        = 0;
+
+        for (int round=0; round<2; round++)
+        {
+            files.openFiles ("rb");
+
+            for (int f=0; f<nbFiles; f++)
+            {
+                u_int64_t sum = 0;
+                int       nb  = 0;
+
+                while (files.readBlock (&block, &maxBlockSize, &nbBytes, f))
+                {
+                    CPPUNIT_ASSERT (nbBytes % (itemSize+1) == 0);
+
+                    for (unsigned int i=0; i<nbBytes; i+=itemSize+1, nb++)
+                    {
+                        u_int64_t item;
+                        memcpy (&item, block + i + 1, itemSize);
+                        CPPUNIT_ASSERT (block[i] == 1);
+                        CPPUNIT_ASSERT ((int)(item % nbFiles) == f);
+                        sum += item;
+                    }
+                }
+
+                CPPUNIT_ASSERT (nb  == nbItems / nbFiles);
+                CPPUNIT_ASSERT (nb  == files.getNbItems(f));
+                CPPUNIT_ASSERT (sum == checksum[f]);
+            }
+
+            files.closeFiles();
+        }
+
+        free (block);
+
+        files.getCodecStats (rawBytes, writtenBytes, readBytes);
+        CPPUNIT_ASSERT (memoryBudget == 0 ? readBytes == 2*writtenBytes : readBytes > 2*writtenBytes);
+    }
+
+    /********************************************************************************/
+    void storage_superkmer_writers ()
+    {
+        storage_superkmer_writers_aux (0, 1);
+        storage_superkmer_writers_aux (1, 1);
+        storage_superkmer_writers_aux (1, 16);
+        storage_superkmer_writers_aux (4, 2);
+    }
+
+    /********************************************************************************/
+    void storage_superkmer_codec ()
+    {
+        storage_superkmer_writers_aux (0, 1, SUPERK_CODEC_DEFLATE);
+        storage_superkmer_writers_aux (4, 2, SUPERK_CODEC_DEFLATE);
+    }
+
+    /********************************************************************************/
+    void storage_superkmer_memory ()
+    {
+        /** All the blocks fit in RAM: no file is written. */
+        storage_superkmer_writers_aux (0, 1,  SUPERK_CODEC_NONE,    4*MBYTE);
+        storage_superkmer_writers_aux (1, 16, SUPERK_CODEC_DEFLATE, 4*MBYTE);
+
+        /** Each file exceeds its share of the budget: the next blocks are written to disk. */
+        storage_superkmer_writers_aux (0, 1,  SUPERK_CODEC_NONE,    4*8*KBYTE);
+        storage_superkmer_writers_aux (4, 2,  SUPERK_CODEC_DEFLATE, 4*2*KBYTE);
+    }
+
 
 };
 
@@ -575,6 +575,13 @@ we need this 2-functors scheme because HashFunctors won't work with unordered_ma
 			return _bitArray[cell64];
 		}
 
+		//prefetch the word of bit pos and its rank sample
+		void prefetch(uint64_t pos) const
+		{
+			__builtin_prefetch(_bitArray + (pos >> 6), 0, 3);
+			__builtin_prefetch(&_ranks[pos / _nb_bits_per_rank_sample], 0, 3);
+		}
+
 		//set bit pos to 1
 		void set(uint64_t pos)
 		{
@@ -676,6 +683,11 @@ we need this 2-functors scheme because HashFunctors won't work with unordered_ma
 			uint64_t hashi =    hash_raw %  hash_domain;
 			return bitset.get(hashi);
 		}
+
+		void prefetch(uint64_t hash_raw) const
+		{
+			bitset.prefetch(hash_raw %  hash_domain);
+		}
 		
 		uint64_t idx_begin;
 		uint64_t hash_domain;
@@ -820,6 +832,15 @@ we need this 2-functors scheme because HashFunctors won't work with unordered_ma
 			return minimal_hp;
 		}
 
+		//prefetch the first level bits of elem, where most of the keys are found, ahead of a lookup
+		void prefetch(elem_t elem)
+		{
+			if(! _built || _nb_levels < 2) return;
+
+			hash_pair_t bbhash;
+			_levels[0].prefetch(_hasher.h0(bbhash,elem));
+		}
+
 		uint64_t nbKeys() const
 		{
             return _nelem;
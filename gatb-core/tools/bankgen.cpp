@@ -90,9 +90,7 @@ int main (int argc, char* argv[])
     }
     catch (OptionFailure& e)
     {
-        e.getParser().displayErrors (stdout);
-        e.getParser().displayHelp   (stdout);
-        return EXIT_FAILURE;
+        return e.displayErrors (std::cout);
     }
 
     return EXIT_SUCCESS;